@@ -0,0 +1,273 @@
+/**
+ * @file arena.c
+ *
+ * @brief Bump-pointer arena. Chunks are allocated by calloc(), so new allocations are zeroed without memset(),
+ *        freed small blocks are zeroed when they are reused. Big blocks are allocated by calloc() one by one
+ *        and freed by free(), so a compilation does not keep memory of long strings it does not use.
+ *
+ * @author Skuratovich Aliaksandr <xskura01@vutbr.cz>
+ */
+#include "arena.h"
+#include "debug.h"
+#include "errors.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+// freed blocks are poisoned for AddressSanitizer, so it finds their use.
+#if defined(__SANITIZE_ADDRESS__)
+#include <sanitizer/asan_interface.h>
+#define POISON(ptr, size) ASAN_POISON_MEMORY_REGION((ptr), (size))
+#define UNPOISON(ptr, size) ASAN_UNPOISON_MEMORY_REGION((ptr), (size))
+#else
+#define POISON(ptr, size) ((void) (ptr), (void) (size))
+#define UNPOISON(ptr, size) ((void) (ptr), (void) (size))
+#endif
+
+
+// sizes of chunks, they double from the first to the last one.
+#define CHUNK_FIRST (16 * 1024)
+#define CHUNK_MAX (1024 * 1024)
+
+// alignment of allocations, and the step of sizes of reused blocks.
+#define ALIGN 16
+
+
+struct arena_chunk {
+    arena_chunk_t *prev;
+    size_t size; ///< bytes of data.
+    size_t used; ///< bytes of data in use.
+    max_align_t data[];
+};
+
+/** Big block, it is in a list to be freed by Arena.release().
+ */
+struct arena_block {
+    arena_block_t *prev;
+    arena_block_t *next;
+    max_align_t data[];
+};
+
+
+static size_t align_up(size_t size) {
+    return (size + ALIGN - 1) & ~((size_t) ALIGN - 1);
+}
+
+/** Index of the list of freed blocks of an aligned size.
+ */
+static size_t size_class(size_t aligned) {
+    return aligned / ALIGN - 1;
+}
+
+/** Blocks of an aligned size bigger than the size classes are big blocks.
+ */
+static bool is_big(size_t aligned) {
+    return size_class(aligned) >= ARENA_CLASSES;
+}
+
+static arena_block_t *block_of(void *ptr) {
+    return (arena_block_t *) ((char *) ptr - offsetof(arena_block_t, data));
+}
+
+static void link_block(arena_t *arena, arena_block_t *block) {
+    block->prev = NULL;
+    block->next = arena->blocks;
+    if (arena->blocks != NULL) {
+        arena->blocks->prev = block;
+    }
+    arena->blocks = block;
+}
+
+static void unlink_block(arena_t *arena, arena_block_t *block) {
+    if (block->prev != NULL) {
+        block->prev->next = block->next;
+    } else {
+        arena->blocks = block->next;
+    }
+    if (block->next != NULL) {
+        block->next->prev = block->prev;
+    }
+}
+
+/** Count bytes of big blocks, which are added or freed.
+ */
+static void count_big(arena_t *arena, size_t added, size_t freed) {
+    arena->big = arena->big + added - freed;
+    if (arena->big > arena->big_peak) {
+        arena->big_peak = arena->big;
+    }
+}
+
+/** Allocate a zeroed big block.
+ */
+static void *alloc_big(arena_t *arena, size_t aligned) {
+    arena_block_t *block = calloc(1, sizeof(arena_block_t) + aligned);
+    soft_assert(block != NULL, ERROR_INTERNAL);
+    link_block(arena, block);
+    count_big(arena, aligned, 0);
+    arena->allocations++;
+    arena->used += aligned;
+    return block->data;
+}
+
+/** Make a big block bigger, the rest is zeroed.
+ */
+static void *grow_big(arena_t *arena, void *ptr, size_t old_size, size_t new_aligned) {
+    arena_block_t *block = block_of(ptr);
+    size_t old_aligned = align_up(old_size ? old_size : 1);
+    unlink_block(arena, block);
+    block = realloc(block, sizeof(arena_block_t) + new_aligned);
+    soft_assert(block != NULL, ERROR_INTERNAL);
+    link_block(arena, block);
+    memset((char *) block->data + old_size, 0, new_aligned - old_size);
+    count_big(arena, new_aligned, old_aligned);
+    arena->used += new_aligned - old_aligned;
+    return block->data;
+}
+
+/** Add a chunk with at least size free bytes.
+ */
+static void add_chunk(arena_t *arena, size_t size) {
+    size_t chunk_size = (arena->chunk) ? arena->chunk->size * 2 : CHUNK_FIRST;
+    if (chunk_size > CHUNK_MAX) {
+        chunk_size = CHUNK_MAX;
+    }
+    if (chunk_size < size) {
+        chunk_size = size;
+    }
+
+    arena_chunk_t *chunk = calloc(1, sizeof(arena_chunk_t) + chunk_size);
+    soft_assert(chunk != NULL, ERROR_INTERNAL);
+    chunk->size = chunk_size;
+    chunk->prev = arena->chunk;
+    arena->chunk = chunk;
+    arena->reserved += chunk_size;
+    arena->chunks++;
+}
+
+/** Allocate zeroed memory.
+ *
+ * @param arena
+ * @param size number of bytes.
+ * @return memory aligned for any type.
+ */
+static void *Alloc(arena_t *arena, size_t size) {
+    size = align_up(size ? size : 1);
+    if (is_big(size)) {
+        return alloc_big(arena, size);
+    }
+    if (arena->freed[size_class(size)] != NULL) {
+        void **block = arena->freed[size_class(size)];
+        UNPOISON(block, size);
+        arena->freed[size_class(size)] = *block;
+        memset(block, 0, size);
+        arena->reused++;
+        return block;
+    }
+
+    if (arena->chunk == NULL || arena->chunk->size - arena->chunk->used < size) {
+        add_chunk(arena, size);
+    }
+
+    void *ptr = (char *) arena->chunk->data + arena->chunk->used;
+    arena->chunk->used += size;
+    arena->last = ptr;
+    arena->allocations++;
+    arena->used += size;
+    return ptr;
+}
+
+/** Make an allocation bigger.
+ *
+ * @param arena
+ * @param ptr allocation of old_size bytes, or NULL.
+ * @param old_size
+ * @param new_size
+ * @return memory of new_size bytes with the first old_size bytes of ptr.
+ */
+static void *Grow(arena_t *arena, void *ptr, size_t old_size, size_t new_size) {
+    if (ptr == NULL) {
+        return Alloc(arena, new_size);
+    }
+    if (new_size <= old_size) {
+        return ptr;
+    }
+    size_t new_aligned = align_up(new_size);
+    if (is_big(align_up(old_size ? old_size : 1))) {
+        return grow_big(arena, ptr, old_size, new_aligned);
+    }
+
+    // the last allocation takes the rest of its chunk, unless it becomes a big block.
+    if (ptr == arena->last && !is_big(new_aligned)) {
+        arena_chunk_t *chunk = arena->chunk;
+        size_t offset = (char *) ptr - (char *) chunk->data;
+        size_t old_aligned = chunk->used - offset;
+        if (chunk->size - offset >= new_aligned) {
+            chunk->used = offset + new_aligned;
+            arena->used += new_aligned - old_aligned;
+            return ptr;
+        }
+    }
+
+    void *moved = Alloc(arena, new_size);
+    memcpy(moved, ptr, old_size);
+    Arena.free(arena, ptr, old_size);
+    return moved;
+}
+
+/** Give a block back to the arena.
+ *
+ * @param arena
+ * @param ptr allocation or NULL.
+ * @param size bytes of the allocation.
+ */
+static void Free(arena_t *arena, void *ptr, size_t size) {
+    size = align_up(size ? size : 1);
+    if (ptr == NULL) {
+        return;
+    }
+    if (is_big(size)) {
+        arena_block_t *block = block_of(ptr);
+        unlink_block(arena, block);
+        count_big(arena, 0, size);
+        free(block);
+        return;
+    }
+    if (ptr == arena->last) {
+        arena->last = NULL;
+    }
+    *(void **) ptr = arena->freed[size_class(size)];
+    arena->freed[size_class(size)] = ptr;
+    POISON(ptr, size);
+}
+
+/** Release all memory of the arena.
+ *
+ * @param arena
+ */
+static void Release(arena_t *arena) {
+    arena_chunk_t *chunk = arena->chunk;
+    while (chunk != NULL) {
+        arena_chunk_t *prev = chunk->prev;
+        UNPOISON(chunk->data, chunk->size);
+        free(chunk);
+        chunk = prev;
+    }
+    arena_block_t *block = arena->blocks;
+    while (block != NULL) {
+        arena_block_t *next = block->next;
+        free(block);
+        block = next;
+    }
+    *arena = (arena_t) {0};
+}
+
+
+const struct arena_interface_t Arena = {
+        .alloc = Alloc,
+        .grow = Grow,
+        .free = Free,
+        .release = Release,
+};
@@ -0,0 +1,72 @@
+/**
+ * @file arena.h
+ *
+ * @brief Bump-pointer arena. Memory is taken from big zeroed chunks and released all at once.
+ *        Freed small blocks are kept in lists by their size and reused by next allocations,
+ *        bigger blocks are allocated one by one and given back to malloc() when they are freed.
+ *
+ * @author Skuratovich Aliaksandr <xskura01@vutbr.cz>
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+
+
+typedef struct arena_chunk arena_chunk_t;
+typedef struct arena_block arena_block_t;
+
+// blocks up to ARENA_CLASSES * 16 bytes are taken from chunks and reused, bigger ones are big blocks.
+#define ARENA_CLASSES 64
+
+/** An arena, zero-initialised struct is an empty arena.
+ */
+typedef struct arena {
+    arena_chunk_t *chunk; ///< current chunk, it points to the previous ones.
+    void *last; ///< the last allocation, it can grow in place.
+    size_t allocations; ///< number of allocations.
+    size_t used; ///< bytes of all allocations.
+    size_t reserved; ///< bytes of all chunks.
+    size_t chunks; ///< number of chunks.
+    size_t reused; ///< number of allocations of freed blocks.
+    void *freed[ARENA_CLASSES]; ///< lists of freed blocks by their size.
+    arena_block_t *blocks; ///< big blocks, which are not freed.
+    size_t big; ///< bytes of big blocks, which are not freed.
+    size_t big_peak; ///< the most bytes of big blocks at once.
+} arena_t;
+
+extern const struct arena_interface_t Arena;
+
+struct arena_interface_t {
+    /** Allocate zeroed memory.
+     *
+     * @param arena
+     * @param size number of bytes.
+     * @return memory aligned for any type.
+     */
+    void *(*alloc)(arena_t *, size_t);
+
+    /** Make an allocation bigger, the last allocation grows in place, other ones are copied.
+     *
+     * @param arena
+     * @param ptr allocation of old_size bytes, or NULL.
+     * @param old_size
+     * @param new_size
+     * @return memory of new_size bytes with the first old_size bytes of ptr, the rest is zeroed.
+     */
+    void *(*grow)(arena_t *, void *, size_t, size_t);
+
+    /** Give a block back to the arena, small blocks are reused, big blocks are freed.
+     *
+     * @param arena
+     * @param ptr allocation or NULL.
+     * @param size bytes of the allocation.
+     */
+    void (*free)(arena_t *, void *, size_t);
+
+    /** Release all memory of the arena, it is empty again.
+     *
+     * @param arena
+     */
+    void (*release)(arena_t *);
+};
@@ -5,75 +5,189 @@
  */
 
 #include "code_generator.h"
+#include "context.h"
 
+#include <pthread.h>
+#include <stdarg.h>
+
+/*
+ * Variables used for code generator are in the compilation context, see context.h.
+ */
 /*
- * Global variables used for code generator.
+ * Instruction builder.
+ * An instruction is a record of an opcode and typed operands, see instrbuf.h.
+ * ADD_INSTR() and ADD_INSTR_OP() add an instruction to the active list right away,
+ * ADD_INSTR_PART() and ADD_INSTR_PART_TEXT() add it to tmp_instr, which goes to a list
+ * at once with ADD_INSTR_TMP() or ADD_INSTR_WHILE().
  */
-list_t *instrList;                      // pointer to the list of instr that is currently used
-static dynstring_t *tmp_instr;          // instruction that is currently being generated
-instructions_t instructions;            // structure that holds info about generated code
 
 /*
- * Adds new instruction to the list of instructions.
+ * Adds an instruction with argc operands from args to the buffer.
+ */
+static void add_instr(instrbuf_t *buf, opcode_t opcode, const char *text, size_t argc, va_list args) {
+    operand_t operands[10];
+    for (size_t i = 0; i < argc; i++) {
+        operands[i] = va_arg(args, operand_t);
+    }
+    Instrbuf.append(buf, opcode, text, argc, operands);
+}
+
+/*
+ * Adds new text instruction to the list of instructions.
  */
-void ADD_INSTR(char *instr) {
-    dynstring_t *instr_ds = Dynstring.ctor(instr);
+void ADD_INSTR(const char *instr) {
+    Instrbuf.append(context->instrList, INSTR_TEXT, instr, 0, NULL);
+}
 
-    List.append(instrList, instr_ds);
+/*
+ * Adds new instruction with argc operands to the list of instructions.
+ */
+void ADD_INSTR_OP(opcode_t opcode, size_t argc, ...) {
+    va_list args;
+    va_start(args, argc);
+    add_instr(context->instrList, opcode, NULL, argc, args);
+    va_end(args);
 }
 
 /*
- * Adds part of an instruction to global tmp_instr.
- * Converts instrPart to a dynstring_t*.
+ * Adds instruction with argc operands to global tmp_instr.
  */
-void ADD_INSTR_PART(char *instrPart) {
-    dynstring_t *newInstrPart = Dynstring.ctor(instrPart);
-    Dynstring.cat(tmp_instr, newInstrPart);
-    Dynstring.dtor(newInstrPart);
+void ADD_INSTR_PART(opcode_t opcode, size_t argc, ...) {
+    va_list args;
+    va_start(args, argc);
+    add_instr(context->tmp_instr, opcode, NULL, argc, args);
+    va_end(args);
 }
 
 /*
- * Adds part of an instruction to global tmp_instr.
- * instrPartDynstr already is a dyntring_t*.
+ * Adds text instruction to global tmp_instr,
+ * INSTR_ARG(i) in the text is replaced with the i-th operand when it is printed.
  */
-void ADD_INSTR_PART_DYN(dynstring_t *instrPartDyn) {
-    Dynstring.cat(tmp_instr, instrPartDyn);
+void ADD_INSTR_PART_TEXT(const char *text, size_t argc, ...) {
+    va_list args;
+    va_start(args, argc);
+    add_instr(context->tmp_instr, INSTR_TEXT, text, argc, args);
+    va_end(args);
 }
 
 /*
  * Adds tmp_inst to the list of instructions.
  */
 void ADD_INSTR_TMP() {
-    List.append(instrList,
-                Dynstring.ctor(Dynstring.c_str(tmp_instr))
-    );
-    Dynstring.clear(tmp_instr);
+    Instrbuf.append_buf(context->instrList, context->tmp_instr);
+    Instrbuf.clear(context->tmp_instr);
 }
 
 /*
  * Inserts tmp_inst before while loop.
  */
 void ADD_INSTR_WHILE() {
-    List.insert_after(instructions.before_loop_start,
-                      Dynstring.ctor(Dynstring.c_str(tmp_instr))
-    );
-    Dynstring.clear(tmp_instr);
+    Instrbuf.hoist(context->instructions.before_loop_start, context->tmp_instr);
+    Instrbuf.clear(context->tmp_instr);
 }
 
 /*
- * Converts integer to string and adds it to tmp_instr
+ * Adds a comment to the list of instructions, if the emission level of the compilation keeps it.
+ * IFJ21_EMIT_MINIMAL comments mark statements, IFJ21_EMIT_FULL ones also tell how operands are generated.
  */
-void ADD_INSTR_INT(uint64_t num) {
-    char str[MAX_CHAR] = "\0";
-    sprintf(str, "%lu", num);
-    ADD_INSTR_PART(str);
+static void ADD_COMMENT(ifj21_emit_t level, const char *comment) {
+    if (context->emit <= level) {
+        ADD_INSTR(comment);
+    }
 }
 
 /*
  * Change active list of instructions.
  */
-void INSTR_CHANGE_ACTIVE_LIST(list_t *newList) {
-    instrList = (newList);
+void INSTR_CHANGE_ACTIVE_LIST(instrbuf_t *newList) {
+    context->instrList = (newList);
+}
+
+/*
+ * Operands.
+ */
+
+/*
+ * GF@%expr_result, GF@%expr_result2 or GF@%expr_result3.
+ */
+static operand_t expr_result(affix_t affix) {
+    return (operand_t) {.type = OPERAND_REG, .frame = FRAME_GF, .affix = affix};
+}
+
+/*
+ * Numbered variable of the generator, frame@%affix_index.
+ */
+static operand_t tmp_var(frame_t frame, affix_t affix, size_t index) {
+    return (operand_t) {.type = OPERAND_TMP, .frame = frame, .affix = affix, .id = (uint32_t) index};
+}
+
+/*
+ * Variable of the scope, LF@%affix_scope_id%name.
+ */
+static operand_t scope_var(affix_t affix, size_t scope_id, const atom_t *name) {
+    return (operand_t) {.type = OPERAND_VAR, .frame = FRAME_LF, .affix = affix, .id = (uint32_t) scope_id,
+            .atom = name};
+}
+
+/*
+ * Label of a statement, $affix$scope_id$suffix.
+ */
+static operand_t label(affix_t affix, size_t scope_id, affix_t suffix) {
+    return (operand_t) {.type = OPERAND_LABEL, .affix = affix, .suffix = suffix, .id = (uint32_t) scope_id};
+}
+
+/*
+ * Label of a branch of a condition, $if$scope_id$cond_num.
+ */
+static operand_t cond_label(size_t if_scope_id, size_t cond_num) {
+    return (operand_t) {.type = OPERAND_LABEL, .affix = AFFIX_IF, .suffix = AFFIX_NUMBER,
+            .id = (uint32_t) if_scope_id, .num_i = cond_num};
+}
+
+/*
+ * Label of a function, $name$suffix.
+ */
+static operand_t func_label(const char *func_name, affix_t suffix) {
+    return (operand_t) {.type = OPERAND_FUNC, .suffix = suffix, .text = func_name};
+}
+
+/*
+ * Label of the code of the generator, $$name.
+ */
+static operand_t builtin(const char *name) {
+    return (operand_t) {.type = OPERAND_BUILTIN, .text = name};
+}
+
+static operand_t int_const(uint64_t num) {
+    return (operand_t) {.type = OPERAND_INT, .num_i = num};
+}
+
+static operand_t float_const(double num) {
+    return (operand_t) {.type = OPERAND_FLOAT, .num_f = num};
+}
+
+/*
+ * String constant, characters are copied to the memory of the compilation.
+ */
+static operand_t string_const(const char *str, size_t len) {
+    char *chars = Context.alloc(MEM_GENERATOR, len + 1);
+    memcpy(chars, str, len);
+    return (operand_t) {.type = OPERAND_STRING, .id = (uint32_t) len, .text = chars};
+}
+
+static operand_t bool_const(bool value) {
+    return (operand_t) {.type = OPERAND_BOOL, .id = value};
+}
+
+static operand_t nil_const() {
+    return (operand_t) {.type = OPERAND_NIL};
+}
+
+/*
+ * Operand printed as it is.
+ */
+static operand_t text_operand(const char *text) {
+    return (operand_t) {.type = OPERAND_TEXT, .text = text};
 }
 
 /*
@@ -452,19 +566,19 @@ static void generate_ands_short() {
  */
 static void initialise_generator() {
     debug_msg("\n");
-    tmp_instr = Dynstring.ctor("");
+    context->tmp_instr = Instrbuf.ctor();
     // initialise the instructions structure
-    instructions.startList = List.ctor();
-    instructions.instrListFunctions = List.ctor();
-    instructions.mainList = List.ctor();
-    instructions.in_loop = false;
-    instructions.outer_loop_id = 0;
-    instructions.before_loop_start = NULL;
-    instructions.outer_cond_id = 0;
-    instructions.cond_cnt = 1;
-    instructions.cond_info = Dynstring.ctor("");
+    context->instructions.startList = Instrbuf.ctor();
+    context->instructions.instrListFunctions = Instrbuf.ctor();
+    context->instructions.mainList = Instrbuf.ctor();
+    context->instructions.in_loop = false;
+    context->instructions.outer_loop_id = 0;
+    context->instructions.before_loop_start = NULL;
+    context->instructions.outer_cond_id = 0;
+    context->instructions.cond_cnt = 1;
+    context->instructions.cond_info = Dynstring.ctor_tagged("", MEM_GENERATOR);
     // sets instructions list active
-    instrList = instructions.startList;
+    context->instrList = context->instructions.startList;
 }
 
 /*
@@ -472,142 +586,139 @@ static void initialise_generator() {
  */
 static void dtor() {
     debug_msg("\n");
-    List.dtor(instructions.startList, (void (*)(void *)) (Dynstring.dtor));
-    List.dtor(instructions.instrListFunctions, (void (*)(void *)) Dynstring.dtor);
-    List.dtor(instructions.mainList, (void (*)(void *)) Dynstring.dtor);
-    Dynstring.dtor(instructions.cond_info);
-    Dynstring.dtor(tmp_instr);
+    // instructions are released with the arena of the compilation.
+    context->instructions.startList = NULL;
+    context->instructions.instrListFunctions = NULL;
+    context->instructions.mainList = NULL;
+    context->instructions.cond_info = NULL;
+    context->tmp_instr = NULL;
 }
 
 /*
  * @brief Prints the list of instructions.
  */
 static void Print_instr_list(instr_list_t instr_list_type) {
+    instrbuf_t *list;
     switch (instr_list_type) {
         case LIST_INSTR_START:
-            List.print_list(instructions.startList, (char *(*)(void *)) Dynstring.c_str);
+            list = context->instructions.startList;
             break;
         case LIST_INSTR_FUNC:
-            List.print_list(instructions.instrListFunctions, (char *(*)(void *)) Dynstring.c_str);
+            list = context->instructions.instrListFunctions;
             break;
         case LIST_INSTR_MAIN:
-            List.print_list(instructions.mainList, (char *(*)(void *)) Dynstring.c_str);
+            list = context->instructions.mainList;
             break;
         default:
             debug_msg("Undefined instruction list.\n");
-            break;
+            return;
+    }
+
+    // instructions are written to the sink of the compilation.
+    Instrbuf.print(list, context->sink);
+}
+
+/*
+ * @brief Writes the code nothing can be inserted before any more, if the code is streamed.
+ *        Instructions are hoisted only before the most outer loop, so the code of the functions
+ *        is final out of loops. The main scope goes after the functions, it is printed at the end.
+ */
+static void Flush_instr_lists() {
+    if (!context->stream_code || context->instructions.before_loop_start != NULL || Errors.get_error()) {
+        return;
     }
+    Instrbuf.flush(context->instructions.startList, context->sink);
+    Instrbuf.flush(context->instructions.instrListFunctions, context->sink);
 }
 
 /*
  * @brief Generates comment.
  */
 static void generate_comment(char *comment) {
-    ADD_INSTR_PART("# ");
-    ADD_INSTR_PART(comment);
+    // instructions waiting in tmp_instr go to the list even without the comment.
+    if (context->emit <= IFJ21_EMIT_MINIMAL) {
+        ADD_INSTR_PART_TEXT("# " INSTR_ARG(0), 1, text_operand(comment));
+    }
     ADD_INSTR_TMP();
 }
 
 /*
  * @brief Generates code with value of the token.
+ * @return operand with the value.
  */
-static void generate_var_value(token_t token) {
-    char str_tmp[MAX_CHAR];
-    memset(str_tmp, '\0', MAX_CHAR);
+static operand_t generate_var_value(token_t token) {
+    operand_t value;
     switch (token.type) {
         case TOKEN_STR:
-            ADD_INSTR("\n# var value generating");
-            ADD_INSTR("\n# --------------------");
-            ADD_INSTR_PART("string@");
-            // transform the string format
-            unsigned str_len = Dynstring.len(token.attribute.id);
-            char *str_id = Dynstring.c_str(token.attribute.id);
-            for (unsigned i = 0; i < str_len; i++) {
-                // check format
-                if (str_id[i] <= 32 || str_id[i] == '#' || str_id[i] == '\\' || !isprint(str_id[i])) {
-                    // print as an escape sequence
-                    sprintf(str_tmp, "\\%03d", str_id[i]);
-                } else {
-                    sprintf(str_tmp, "%c", str_id[i]);
-                }
-                ADD_INSTR_PART(str_tmp);
-                memset(str_tmp, '\0', MAX_CHAR);
-            }
-            ADD_INSTR("\n# --------------------");
+            ADD_COMMENT(IFJ21_EMIT_FULL, "\n# var value generating");
+            ADD_COMMENT(IFJ21_EMIT_FULL, "\n# --------------------");
+            value = string_const(Dynstring.c_str(token.attribute.id), Dynstring.len(token.attribute.id));
+            ADD_COMMENT(IFJ21_EMIT_FULL, "\n# --------------------");
             break;
         case TOKEN_NUM_F:
-            ADD_INSTR("\n#generating var value: float");
-            ADD_INSTR_PART("float@");
-            sprintf(str_tmp, "%a", token.attribute.num_f);
-            ADD_INSTR_PART(str_tmp);
-            ADD_INSTR("\n# --------------------");
+            ADD_COMMENT(IFJ21_EMIT_FULL, "\n#generating var value: float");
+            value = float_const(token.attribute.num_f);
+            ADD_COMMENT(IFJ21_EMIT_FULL, "\n# --------------------");
             break;
         case TOKEN_NUM_I:
-            ADD_INSTR("\n#generating var value: int");
-            ADD_INSTR_PART("int@");
-            sprintf(str_tmp, "%lu", token.attribute.num_i);
-            ADD_INSTR_PART(str_tmp);
-            ADD_INSTR("\n# --------------------");
+            ADD_COMMENT(IFJ21_EMIT_FULL, "\n#generating var value: int");
+            value = int_const(token.attribute.num_i);
+            ADD_COMMENT(IFJ21_EMIT_FULL, "\n# --------------------");
             break;
         case KEYWORD_nil:
-            ADD_INSTR("\n#generating var value: nil");
-            ADD_INSTR_PART("nil@nil");
-            ADD_INSTR("\n# --------------------");
+            ADD_COMMENT(IFJ21_EMIT_FULL, "\n#generating var value: nil");
+            value = nil_const();
+            ADD_COMMENT(IFJ21_EMIT_FULL, "\n# --------------------");
             break;
         case KEYWORD_0:
-            ADD_INSTR("\n#generating var value: false");
-            ADD_INSTR_PART("bool@false");
-            ADD_INSTR("\n# --------------------");
+            ADD_COMMENT(IFJ21_EMIT_FULL, "\n#generating var value: false");
+            value = bool_const(false);
+            ADD_COMMENT(IFJ21_EMIT_FULL, "\n# --------------------");
             break;
         case KEYWORD_1:
-            ADD_INSTR("\n#generating var value: true");
-            ADD_INSTR_PART("bool@true");
-            ADD_INSTR("\n# --------------------");
+            ADD_COMMENT(IFJ21_EMIT_FULL, "\n#generating var value: true");
+            value = bool_const(true);
+            ADD_COMMENT(IFJ21_EMIT_FULL, "\n# --------------------");
             break;
         case TOKEN_ID:
-            ADD_INSTR("\n #generating var value: id - lf what the fuck");
-            ADD_INSTR_PART("LF@%");
+            ADD_COMMENT(IFJ21_EMIT_FULL, "\n #generating var value: id - lf what the fuck");
             symbol_t *symbol;
-            if (!Symstack.get_local_symbol(symstack, token.attribute.id, &symbol)) {
-                ADD_INSTR_INT(Symstack.get_scope_info(symstack).unique_id);
+            if (!Symstack.get_local_symbol(context->symstack, token.attribute.atom, &symbol)) {
+                value = scope_var(AFFIX_NONE, Symstack.get_scope_info(context->symstack).unique_id,
+                                  token.attribute.atom);
             } else {
-                ADD_INSTR_INT(symbol->id_of_parent_scope);
+                value = scope_var(AFFIX_NONE, symbol->id_of_parent_scope, token.attribute.atom);
             }
-            ADD_INSTR_PART("%");
-            ADD_INSTR_PART_DYN(token.attribute.id);
-            ADD_INSTR("\n# --------------------");
+            ADD_COMMENT(IFJ21_EMIT_FULL, "\n# --------------------");
             break;
         default:
-            ADD_INSTR_PART("unexpected_token");
-            ADD_INSTR("\n# --------------------");
+            value = text_operand("unexpected_token");
+            ADD_COMMENT(IFJ21_EMIT_FULL, "\n# --------------------");
             break;
     }
+    return value;
 }
 
 /*
  * @brief Generates the name of variable.
- *        scope_id%name
+ *        LF@%scope_id%name
  * @param new_def true if the variable is being declared now
  *        false if it should be found in the symtable
  */
-static void generate_var_name(dynstring_t *var_name, bool new_def) {
+static operand_t generate_var_name(const atom_t *var_name, bool new_def) {
     symbol_t *symbol = NULL;
-    if (new_def || !Symstack.get_local_symbol(symstack, var_name, &symbol)) {
-        ADD_INSTR_INT(Symstack.get_scope_info(symstack).unique_id);
-    } else {
-        ADD_INSTR_INT(symbol->id_of_parent_scope);
+    if (new_def || !Symstack.get_local_symbol(context->symstack, var_name, &symbol)) {
+        return scope_var(AFFIX_NONE, Symstack.get_scope_info(context->symstack).unique_id, var_name);
     }
-    ADD_INSTR_PART("%");
-    ADD_INSTR_PART_DYN(var_name);
+    return scope_var(AFFIX_NONE, symbol->id_of_parent_scope, var_name);
 }
 
 /*
  * @brief Generates DEFVAR LF@%var.
  */
-static void generate_defvar(dynstring_t *var_name) {
-    ADD_INSTR_PART("DEFVAR LF@%");
-    generate_var_name(var_name, true);  // true == new variable
-    if (instructions.in_loop) {
+static void generate_defvar(const atom_t *var_name) {
+    ADD_INSTR_PART(INSTR(DEFVAR), 1, generate_var_name(var_name, true));  // true == new variable
+    if (context->instructions.in_loop) {
         ADD_INSTR_WHILE();
     } else {
         ADD_INSTR_TMP();
@@ -617,25 +728,22 @@ static void generate_defvar(dynstring_t *var_name) {
 /*
  * @brief Generates variable declaration.
  */
-static void generate_var_declaration(dynstring_t *var_name) {
+static void generate_var_declaration(const atom_t *var_name) {
     generate_defvar(var_name);
 
     // initialise to nil
-    ADD_INSTR_PART("MOVE LF@%");
-    generate_var_name(var_name, true);  // true == new variable
-    ADD_INSTR_PART(" nil@nil");
+    ADD_INSTR_PART(INSTR(MOVE), 2, generate_var_name(var_name, true), nil_const());  // true == new variable
     ADD_INSTR_TMP();
 }
 
 /*
  * @brief Generates variable definition.
  */
-static void generate_var_definition(dynstring_t *var_name) {
+static void generate_var_definition(const atom_t *var_name) {
     generate_defvar(var_name);
 
-    ADD_INSTR_PART("MOVE LF@%");
-    generate_var_name(var_name, true);   // true == new variable
-    ADD_INSTR_PART(" GF@%expr_result");
+    ADD_INSTR_PART(INSTR(MOVE), 2, generate_var_name(var_name, true),   // true == new variable
+                   expr_result(AFFIX_EXPR_RESULT));
     ADD_INSTR_TMP();
 }
 
@@ -643,28 +751,22 @@ static void generate_var_definition(dynstring_t *var_name) {
  * @brief Generates variable used for code generating.
  */
 static void generate_tmp_var_definition_float(char *var_name) {
-    dynstring_t *name = Dynstring.ctor(var_name);
+    const atom_t *name = Intern.get_c_str(var_name);
     generate_defvar(name);
 
-    ADD_INSTR("PUSHS GF@%expr_result");
-    ADD_INSTR("CALL $$recast_to_float_second");
-    ADD_INSTR_PART("POPS LF@%");
-    generate_var_name(name, true);  // true == new variable
+    ADD_INSTR_OP(INSTR(PUSHS), 1, expr_result(AFFIX_EXPR_RESULT));
+    ADD_INSTR_OP(INSTR(CALL), 1, builtin("recast_to_float_second"));
+    ADD_INSTR_PART(INSTR(POPS), 1, generate_var_name(name, true));  // true == new variable
     ADD_INSTR_TMP();
-    ADD_INSTR_PART("JUMPIFEQ $$ERROR_NIL LF@%");
-    generate_var_name(name, true);  // true == new variable
-    ADD_INSTR_PART(" nil@nil");
+    ADD_INSTR_PART(INSTR(JUMPIFEQ), 3, builtin("ERROR_NIL"), generate_var_name(name, true), nil_const());
     ADD_INSTR_TMP();
-
-    Dynstring.dtor(name);
 }
  /*
   * @brief Sets variable to nil.
   */
- static void generate_var_set_nil(dynstring_t *var_name) {
-     ADD_INSTR_PART("MOVE LF@%");
-     generate_var_name(var_name, false);    // false 00 var is already declared
-     ADD_INSTR_PART(" nil@nil");
+ static void generate_var_set_nil(const atom_t *var_name) {
+     ADD_INSTR_PART(INSTR(MOVE), 2, generate_var_name(var_name, false),    // false 00 var is already declared
+                    nil_const());
      ADD_INSTR_TMP();
  }
 
@@ -672,9 +774,8 @@ static void generate_tmp_var_definition_float(char *var_name) {
  * @brief Generates assignment to a variable
  *        MOVE LF@%0%i GF@%expr_result
  */
-static void generate_var_assignment(dynstring_t *var_name) {
-    ADD_INSTR_PART("POPS LF@%");
-    generate_var_name(var_name, false); // false == var is already declared
+static void generate_var_assignment(const atom_t *var_name) {
+    ADD_INSTR_PART(INSTR(POPS), 1, generate_var_name(var_name, false)); // false == var is already declared
     ADD_INSTR_TMP();
 }
 
@@ -682,30 +783,28 @@ static void generate_var_assignment(dynstring_t *var_name) {
  * @brief Generates pop from the stack to GF@%expr_result.
  */
 static void generate_expression_pop() {
-    ADD_INSTR("POPS GF@%expr_result");
+    ADD_INSTR_OP(INSTR(POPS), 1, expr_result(AFFIX_EXPR_RESULT));
 }
 
 /*
  * @brief Generates pushing GF@%expr_result to the stack.
  */
 static void generate_expression_push() {
-    ADD_INSTR("PUSHS GF@%expr_result");
+    ADD_INSTR_OP(INSTR(PUSHS), 1, expr_result(AFFIX_EXPR_RESULT));
 }
 
 /*
  * @brief Generates pop from the stack to GF@%expr_result.
  */
 static void generate_expression_push_nil() {
-    ADD_INSTR("PUSHS nil@nil");
+    ADD_INSTR_OP(INSTR(PUSHS), 1, nil_const());
 }
 
 /*
  * @brief Generates nil assignment to return variable.
  */
 static void generate_return_nil(size_t index) {
-    ADD_INSTR_PART("MOVE LF@%return");
-    ADD_INSTR_INT(index);
-    ADD_INSTR_PART(" nil@nil");
+    ADD_INSTR_PART(INSTR(MOVE), 2, tmp_var(FRAME_LF, AFFIX_RETURN, index), nil_const());
     ADD_INSTR_TMP();
 }
 
@@ -713,7 +812,7 @@ static void generate_return_nil(size_t index) {
  * @brief Converts GF@%expr_result int -> float
  */
 static void recast_expression_to_bool(void) {
-    ADD_INSTR("CALL $$recast_to_bool");
+    ADD_INSTR_OP(INSTR(CALL), 1, builtin("recast_to_bool"));
 }
 
 /*
@@ -722,20 +821,21 @@ static void recast_expression_to_bool(void) {
  *        to check is integer (true) or float (false).
  */
 static void generate_division_check(bool is_integer) {
-    ADD_INSTR("POPS GF@%expr_result");
+    ADD_INSTR_OP(INSTR(POPS), 1, expr_result(AFFIX_EXPR_RESULT));
     if (is_integer) {
-        ADD_INSTR("JUMPIFEQ $$ERROR_DIV_BY_ZERO GF@%expr_result int@0");
+        ADD_INSTR_OP(INSTR(JUMPIFEQ), 3, builtin("ERROR_DIV_BY_ZERO"), expr_result(AFFIX_EXPR_RESULT), int_const(0));
     } else {
-        ADD_INSTR("JUMPIFEQ $$ERROR_DIV_BY_ZERO GF@%expr_result float@0x0p+0");
+        ADD_INSTR_OP(INSTR(JUMPIFEQ), 3, builtin("ERROR_DIV_BY_ZERO"), expr_result(AFFIX_EXPR_RESULT),
+                     float_const(0.0));
     }
-    ADD_INSTR("PUSHS GF@%expr_result");
+    ADD_INSTR_OP(INSTR(PUSHS), 1, expr_result(AFFIX_EXPR_RESULT));
 }
 
 /*
  * @brief Generates nil check.
  */
 static void generate_nil_check() {
-    ADD_INSTR("CALL $$nil_check");
+    ADD_INSTR_OP(INSTR(CALL), 1, builtin("nil_check"));
 }
 
 /*
@@ -744,11 +844,11 @@ static void generate_nil_check() {
  */
 static void recast_to_float(type_recast_t recast) {
     if (recast == TYPE_RECAST_FIRST) {
-        ADD_INSTR("CALL $$recast_to_float_first");
+        ADD_INSTR_OP(INSTR(CALL), 1, builtin("recast_to_float_first"));
     } else if (recast == TYPE_RECAST_SECOND) {
-        ADD_INSTR("CALL $$recast_to_float_second");
+        ADD_INSTR_OP(INSTR(CALL), 1, builtin("recast_to_float_second"));
     } else if (recast == TYPE_RECAST_BOTH) {
-        ADD_INSTR("CALL $$recast_to_float_both");
+        ADD_INSTR_OP(INSTR(CALL), 1, builtin("recast_to_float_both"));
     }
 }
 
@@ -756,8 +856,7 @@ static void recast_to_float(type_recast_t recast) {
  * @brief Generates code for pushing operand on the stack (with nil check).
  */
 static void generate_expression_operand(token_t token) {
-    ADD_INSTR_PART("PUSHS ");
-    generate_var_value(token);
+    ADD_INSTR_PART(INSTR(PUSHS), 1, generate_var_value(token));
     ADD_INSTR_TMP();
 }
 
@@ -770,29 +869,29 @@ static void generate_expression_binary(op_list_t op, type_recast_t recast) {
     switch (op) {
         case OP_ADD:    // '+'
             generate_nil_check();
-            ADD_INSTR("ADDS");
+            ADD_INSTR_OP(INSTR(ADDS), 0);
             break;
         case OP_SUB:    // '-'
             generate_nil_check();
-            ADD_INSTR("SUBS");
+            ADD_INSTR_OP(INSTR(SUBS), 0);
             break;
         case OP_MUL:    // '*'
             generate_nil_check();
-            ADD_INSTR("MULS");
+            ADD_INSTR_OP(INSTR(MULS), 0);
             break;
         case OP_DIV_I:  // '/'
             generate_nil_check();
             generate_division_check(true); // true == int div check
-            ADD_INSTR("IDIVS");
+            ADD_INSTR_OP(INSTR(IDIVS), 0);
             break;
         case OP_DIV_F:  // '//'
             generate_nil_check();
             generate_division_check(false); // false == float div check
-            ADD_INSTR("DIVS");
+            ADD_INSTR_OP(INSTR(DIVS), 0);
             break;
         case OP_LT:     // '<'
             generate_nil_check();
-            ADD_INSTR("LTS");
+            ADD_INSTR_OP(INSTR(LTS), 0);
             break;
         case OP_LE:     // '<='
             ADD_INSTR("POPS GF@%expr_result2 \n"
@@ -806,7 +905,7 @@ static void generate_expression_binary(op_list_t op, type_recast_t recast) {
             break;
         case OP_GT:     // '>'
             generate_nil_check();
-            ADD_INSTR("GTS");
+            ADD_INSTR_OP(INSTR(GTS), 0);
             break;
         case OP_GE:     // '>='
             ADD_INSTR("POPS GF@%expr_result2 \n"
@@ -819,17 +918,17 @@ static void generate_expression_binary(op_list_t op, type_recast_t recast) {
                       "PUSHS GF@%expr_result");
             break;
         case OP_EQ:     // '=='
-            ADD_INSTR("EQS");
+            ADD_INSTR_OP(INSTR(EQS), 0);
             break;
         case OP_NE:     // '~='
             ADD_INSTR("EQS \n"
                       "NOTS");
             break;
         case OP_AND:    // 'and'
-            ADD_INSTR("CALL $$ands_short");
+            ADD_INSTR_OP(INSTR(CALL), 1, builtin("ands_short"));
             break;
         case OP_OR:     // 'or'
-            ADD_INSTR("CALL $$ors_short");
+            ADD_INSTR_OP(INSTR(CALL), 1, builtin("ors_short"));
             break;
         case OP_STRCAT: // '..'
             ADD_INSTR("POPS GF@%expr_result2 \n"
@@ -840,14 +939,14 @@ static void generate_expression_binary(op_list_t op, type_recast_t recast) {
                       "PUSHS GF@%expr_result");
             break;
         case OP_CARET:  // ^
-            ADD_INSTR("CALL $$power");
+            ADD_INSTR_OP(INSTR(CALL), 1, builtin("power"));
             break;
         case OP_PERCENT: // %
             ADD_INSTR("CREATEFRAME \n"
                       "CALL $$modulo");
             break;
         default:
-            ADD_INSTR("# unrecognized_operation");
+            ADD_COMMENT(IFJ21_EMIT_FULL, "# unrecognized_operation");
     }
 
 }
@@ -861,7 +960,7 @@ static void generate_expression_unary(op_list_t op) {
             ADD_INSTR("POPS GF@%expr_result2 \n"
                       "JUMPIFEQ $$ERROR_NIL GF@%expr_result2 nil@nil \n"
                       "PUSHS GF@%expr_result2");
-            ADD_INSTR("NOTS");
+            ADD_INSTR_OP(INSTR(NOTS), 0);
             break;
         case OP_HASH:   // '#'
             ADD_INSTR("POPS GF@%expr_result2 \n"
@@ -870,10 +969,10 @@ static void generate_expression_unary(op_list_t op) {
                       "PUSHS GF@%expr_result");
             break;
         case OP_MINUS_UNARY:    // -
-            ADD_INSTR("CALL $$minus");
+            ADD_INSTR_OP(INSTR(CALL), 1, builtin("minus"));
             break;
         default:
-            ADD_INSTR("# unrecognized_operation");
+            ADD_COMMENT(IFJ21_EMIT_FULL, "# unrecognized_operation");
     }
 
 }
@@ -884,12 +983,10 @@ static void generate_expression_unary(op_list_t op) {
  *        - gets info from instructions struct
  */
 static void push_cond_info() {
-    Dynstring.append(instructions.cond_info, instructions.cond_cnt);
+    Dynstring.append(context->instructions.cond_info, context->instructions.cond_cnt);
     char cond_id_str[6] = "\0";
-    sprintf(cond_id_str, "%.5lu", instructions.outer_cond_id);
-    dynstring_t *new_id_str = Dynstring.ctor(cond_id_str);
-    Dynstring.cat(instructions.cond_info, new_id_str);
-    Dynstring.dtor(new_id_str);
+    sprintf(cond_id_str, "%.5lu", context->instructions.outer_cond_id);
+    Dynstring.append_n(context->instructions.cond_info, cond_id_str, strlen(cond_id_str));
 }
 
 /*
@@ -898,22 +995,19 @@ static void push_cond_info() {
  *        - saves info to outer_cond_id and cond_cnt
  */
 static void pop_cond_info() {
-    long unsigned num = strtoul(&Dynstring.c_str(instructions.cond_info)
-                [Dynstring.len(instructions.cond_info) - 5], NULL, 10);
-    instructions.outer_cond_id = num;
-    instructions.cond_cnt = Dynstring.c_str(instructions.cond_info)
-                                        [Dynstring.len(instructions.cond_info) - 6];
-    Dynstring.trunc_to_len(instructions.cond_info, Dynstring.len(instructions.cond_info) - 6);
+    long unsigned num = strtoul(&Dynstring.c_str(context->instructions.cond_info)
+                [Dynstring.len(context->instructions.cond_info) - 5], NULL, 10);
+    context->instructions.outer_cond_id = num;
+    context->instructions.cond_cnt = Dynstring.c_str(context->instructions.cond_info)
+                                        [Dynstring.len(context->instructions.cond_info) - 6];
+    Dynstring.trunc_to_len(context->instructions.cond_info, Dynstring.len(context->instructions.cond_info) - 6);
 }
 
 /*
  * @brief Generates condition label.     LABEL $if$id$scope_num
  */
 static void generate_cond_label(size_t if_scope_id, size_t cond_num) {
-    ADD_INSTR_PART("LABEL $if$");
-    ADD_INSTR_INT(if_scope_id);
-    ADD_INSTR_PART("$");
-    ADD_INSTR_INT(cond_num);
+    ADD_INSTR_PART(INSTR(LABEL), 1, cond_label(if_scope_id, cond_num));
     ADD_INSTR_TMP();
 }
 
@@ -923,11 +1017,8 @@ static void generate_cond_label(size_t if_scope_id, size_t cond_num) {
  *         generates: JUMPIFNEQ $if$id$next_cond LF@%result bool@true
  */
 static void generate_cond_if(size_t if_scope_id, size_t cond_num) {
-    ADD_INSTR_PART("JUMPIFNEQ $if$");
-    ADD_INSTR_INT(if_scope_id);
-    ADD_INSTR_PART("$");
-    ADD_INSTR_INT(cond_num);
-    ADD_INSTR_PART(" GF@%expr_result bool@true");
+    ADD_INSTR_PART(INSTR(JUMPIFNEQ), 3, cond_label(if_scope_id, cond_num), expr_result(AFFIX_EXPR_RESULT),
+                   bool_const(true));
     ADD_INSTR_TMP();
 }
 
@@ -938,12 +1029,10 @@ static void generate_cond_if(size_t if_scope_id, size_t cond_num) {
  *                     LABEL $if$id$scope_num
  */
 static void generate_cond_elseif(size_t if_scope_id, size_t cond_num) {
-    ADD_INSTR_PART("JUMP $if$");
-    ADD_INSTR_INT(if_scope_id);
-    ADD_INSTR_PART("$end");
+    ADD_INSTR_PART(INSTR(JUMP), 1, label(AFFIX_IF, if_scope_id, AFFIX_END));
     ADD_INSTR_TMP();
 
-    ADD_INSTR("\n# condition - elseif part");
+    ADD_COMMENT(IFJ21_EMIT_MINIMAL, "\n# condition - elseif part");
     generate_cond_label(if_scope_id, cond_num);
 }
 
@@ -953,12 +1042,10 @@ static void generate_cond_elseif(size_t if_scope_id, size_t cond_num) {
  *          LABEL $if$id$scope_num
  */
 static void generate_cond_else(size_t if_scope_id, size_t cond_num) {
-    ADD_INSTR_PART("JUMP $if$");
-    ADD_INSTR_INT(if_scope_id);
-    ADD_INSTR_PART("$end");
+    ADD_INSTR_PART(INSTR(JUMP), 1, label(AFFIX_IF, if_scope_id, AFFIX_END));
     ADD_INSTR_TMP();
 
-    ADD_INSTR("\n# condition - else part");
+    ADD_COMMENT(IFJ21_EMIT_MINIMAL, "\n# condition - else part");
     generate_cond_label(if_scope_id, cond_num - 1);
 }
 
@@ -968,9 +1055,7 @@ static void generate_cond_else(size_t if_scope_id, size_t cond_num) {
  *                     LABEL $if$id$scope_num
  */
 static void generate_cond_end(size_t if_scope_id, size_t cond_num) {
-    ADD_INSTR_PART("LABEL $if$");
-    ADD_INSTR_INT(if_scope_id);
-    ADD_INSTR_PART("$end");
+    ADD_INSTR_PART(INSTR(LABEL), 1, label(AFFIX_IF, if_scope_id, AFFIX_END));
     ADD_INSTR_TMP();
 
     generate_cond_label(if_scope_id, cond_num);
@@ -981,8 +1066,7 @@ static void generate_cond_end(size_t if_scope_id, size_t cond_num) {
  * @brief Generates break instruction.
  */
 static void generate_break() {
-    ADD_INSTR_PART("JUMP $end$");
-    ADD_INSTR_INT(Symstack.get_scope_info(symstack).unique_id);
+    ADD_INSTR_PART(INSTR(JUMP), 1, label(AFFIX_END, Symstack.get_scope_info(context->symstack).unique_id, AFFIX_NONE));
     ADD_INSTR_TMP();
     ADD_INSTR("");
 }
@@ -992,9 +1076,8 @@ static void generate_break() {
 *        LABEL $end$id
 */
 static void generate_end() {
-    ADD_INSTR("#generate_end");
-    ADD_INSTR_PART("LABEL $end$");
-    ADD_INSTR_INT(Symstack.get_scope_info(symstack).unique_id);
+    ADD_COMMENT(IFJ21_EMIT_FULL, "#generate_end");
+    ADD_INSTR_PART(INSTR(LABEL), 1, label(AFFIX_END, Symstack.get_scope_info(context->symstack).unique_id, AFFIX_NONE));
     ADD_INSTR_TMP();
     ADD_INSTR("");
 }
@@ -1004,8 +1087,8 @@ static void generate_end() {
  * generates sth like: LABEL $while$id
  */
 static void generate_while_header() {
-    ADD_INSTR_PART("LABEL $while$");
-    ADD_INSTR_INT(Symstack.get_scope_info(symstack).unique_id);
+    ADD_INSTR_PART(INSTR(LABEL), 1, label(AFFIX_WHILE, Symstack.get_scope_info(context->symstack).unique_id,
+                                          AFFIX_NONE));
     ADD_INSTR_TMP();
 }
 
@@ -1014,9 +1097,9 @@ static void generate_while_header() {
  * generates sth like: JUMPIFNEQ $end$id GF@%expr_result bool@true
  */
 static void generate_while_cond() {
-    ADD_INSTR_PART("JUMPIFNEQ $end$");
-    ADD_INSTR_INT(Symstack.get_scope_info(symstack).unique_id);
-    ADD_INSTR_PART(" GF@%expr_result bool@true");
+    ADD_INSTR_PART(INSTR(JUMPIFNEQ), 3,
+                   label(AFFIX_END, Symstack.get_scope_info(context->symstack).unique_id, AFFIX_NONE),
+                   expr_result(AFFIX_EXPR_RESULT), bool_const(true));
     ADD_INSTR_TMP();
 }
 
@@ -1026,8 +1109,8 @@ static void generate_while_cond() {
  *                     LABEL $end$id
  */
 static void generate_while_end() {
-    ADD_INSTR_PART("JUMP $while$");
-    ADD_INSTR_INT(Symstack.get_scope_info(symstack).unique_id);
+    ADD_INSTR_PART(INSTR(JUMP), 1, label(AFFIX_WHILE, Symstack.get_scope_info(context->symstack).unique_id,
+                                         AFFIX_NONE));
     ADD_INSTR_TMP();
     generate_end();
 }
@@ -1037,8 +1120,8 @@ static void generate_while_end() {
  * generates sth like: LABEL $repeat$id
  */
 static void generate_repeat_until_header() {
-    ADD_INSTR_PART("LABEL $repeat$");
-    ADD_INSTR_INT(Symstack.get_scope_info(symstack).unique_id);
+    ADD_INSTR_PART(INSTR(LABEL), 1, label(AFFIX_REPEAT, Symstack.get_scope_info(context->symstack).unique_id,
+                                          AFFIX_NONE));
     ADD_INSTR_TMP();
 }
 
@@ -1048,9 +1131,9 @@ static void generate_repeat_until_header() {
  *                     LABEL $end$id
  */
 static void generate_repeat_until_cond() {
-    ADD_INSTR_PART("JUMPIFNEQ $repeat$");
-    ADD_INSTR_INT(Symstack.get_scope_info(symstack).unique_id);
-    ADD_INSTR_PART(" GF@%expr_result bool@true");
+    ADD_INSTR_PART(INSTR(JUMPIFNEQ), 3,
+                   label(AFFIX_REPEAT, Symstack.get_scope_info(context->symstack).unique_id, AFFIX_NONE),
+                   expr_result(AFFIX_EXPR_RESULT), bool_const(true));
     ADD_INSTR_TMP();
 
     generate_end();
@@ -1061,111 +1144,85 @@ static void generate_repeat_until_cond() {
  *        initialise it to 1.
  */
 static void generate_for_default_step() {
-    dynstring_t *var_name = Dynstring.ctor("for%step");
+    const atom_t *var_name = Intern.get_c_str("for%step");
     generate_defvar(var_name);
 
-    ADD_INSTR_PART("MOVE LF@%");
-    generate_var_name(var_name, true);
-    ADD_INSTR_PART(" float@0x1.0p+0");      // check if it is number 1
+    ADD_INSTR_PART(INSTR(MOVE), 2, generate_var_name(var_name, true),
+                   text_operand("float@0x1.0p+0"));      // check if it is number 1
     ADD_INSTR_TMP();
 }
 
+/*
+ * Check of the condition of a for loop, with comments and without them.
+ * Operands: step, label of step < 0, control variable, terminating condition, end label, body label, variable.
+ */
+#define FOR_COND_TEXT(COMMENT) \
+    COMMENT("# check if step is < 0 \n") \
+    "LT GF@%expr_result " INSTR_ARG(0) " float@0x1.0p+0 \n" \
+    "JUMPIFEQ " INSTR_ARG(1) " GF@%expr_result bool@true \n" \
+    COMMENT("    # step >= 0 \n") \
+    COMMENT("    # if i <= cond then break \n") \
+    "    PUSHS " INSTR_ARG(2) "\n" \
+    "    PUSHS " INSTR_ARG(3) "\n" \
+    "    POPS GF@%expr_result2 \n" \
+    "    POPS GF@%expr_result \n" \
+    "    LT GF@%expr_result3 GF@%expr_result GF@%expr_result2 \n" \
+    "    EQ GF@%expr_result2 GF@%expr_result GF@%expr_result2 \n" \
+    "    OR GF@%expr_result GF@%expr_result2 GF@%expr_result3 \n" \
+    "    PUSHS GF@%expr_result \n" \
+    "    JUMPIFNEQ " INSTR_ARG(4) " GF@%expr_result bool@true \n" \
+    "    JUMP " INSTR_ARG(5) " \n" \
+    "LABEL " INSTR_ARG(1) " \n" \
+    COMMENT("    # step < 0 \n") \
+    COMMENT("    # if i >= cond then break \n") \
+    "    PUSHS " INSTR_ARG(6) "\n" \
+    "    PUSHS " INSTR_ARG(3) " \n" \
+    "    POPS GF@%expr_result2 \n" \
+    "    POPS GF@%expr_result \n" \
+    "    GT GF@%expr_result3 GF@%expr_result GF@%expr_result2 \n" \
+    "    EQ GF@%expr_result2 GF@%expr_result GF@%expr_result2 \n" \
+    "    OR GF@%expr_result GF@%expr_result2 GF@%expr_result3 \n" \
+    "    PUSHS GF@%expr_result \n" \
+    "    JUMPIFNEQ " INSTR_ARG(4) " GF@%expr_result bool@true \n" \
+    "\n" \
+    "LABEL " INSTR_ARG(5) " " \
+    COMMENT("\n# for loop body ")
+#define KEEP_COMMENT(comment) comment
+#define DROP_COMMENT(comment) ""
+
+static const char *const for_cond_text[] = {
+        FOR_COND_TEXT(KEEP_COMMENT),
+        FOR_COND_TEXT(DROP_COMMENT),
+};
+
 /*
  * @brief Generates for loop condition check.
+ *        The check stays in tmp_instr and goes to the list with the first instruction of the body.
  * @param var_name name of the control variable
  */
-static void generate_for_cond(dynstring_t *var_name) {
-    size_t scope_id = Symstack.get_scope_info(symstack).unique_id;
-    ADD_INSTR_PART("DEFVAR LF@%for%");
-    ADD_INSTR_INT(scope_id);
-    ADD_INSTR_PART("%");
-    ADD_INSTR_PART_DYN(var_name);
+static void generate_for_cond(const atom_t *var_name) {
+    size_t scope_id = Symstack.get_scope_info(context->symstack).unique_id;
+    operand_t for_var = scope_var(AFFIX_FOR_VAR, scope_id, var_name);
+    operand_t var = scope_var(AFFIX_NONE, scope_id, var_name);
+
+    ADD_INSTR_PART(INSTR(DEFVAR), 1, for_var);
     ADD_INSTR_WHILE();
-    ADD_INSTR_PART("\nMOVE LF@%for%");
-    ADD_INSTR_INT(scope_id);
-    ADD_INSTR_PART("%");
-    ADD_INSTR_PART_DYN(var_name);
-    ADD_INSTR_PART(" LF@%");
-    ADD_INSTR_INT(scope_id);
-    ADD_INSTR_PART("%");
-    ADD_INSTR_PART_DYN(var_name);
-    ADD_INSTR_PART("\nPUSHS LF@%for%");
-    ADD_INSTR_INT(scope_id);
-    ADD_INSTR_PART("%");
-    ADD_INSTR_PART_DYN(var_name);
-    ADD_INSTR_PART("\nCALL $$recast_to_float_second \n"
-                   "POPS LF@%for%");
-    ADD_INSTR_INT(scope_id);
-    ADD_INSTR_PART("%");
-    ADD_INSTR_PART_DYN(var_name);
-    ADD_INSTR_PART("\nJUMPIFEQ $$ERROR_NIL LF@%");
-    ADD_INSTR_INT(scope_id);
-    ADD_INSTR_PART("%");
-    ADD_INSTR_PART_DYN(var_name);
-    ADD_INSTR_PART(" nil@nil");
-    ADD_INSTR_PART("\nLABEL $for$");
-    ADD_INSTR_INT(scope_id);
-    ADD_INSTR_PART("\nMOVE LF@%");
-    ADD_INSTR_INT(scope_id);
-    ADD_INSTR_PART("%");
-    ADD_INSTR_PART_DYN(var_name);
-    ADD_INSTR_PART(" LF@%for%");
-    ADD_INSTR_INT(scope_id);
-    ADD_INSTR_PART("%");
-    ADD_INSTR_PART_DYN(var_name);
-    ADD_INSTR_PART(  "\n# check if step is < 0 \n"
-                     "LT GF@%expr_result LF@%");
-    ADD_INSTR_INT(scope_id);
-    ADD_INSTR_PART("%for%step float@0x1.0p+0 \n"
-                   "JUMPIFEQ $for$");
-    ADD_INSTR_INT(scope_id);
-    ADD_INSTR_PART("$step_le GF@%expr_result bool@true \n"
-                   "    # step >= 0 \n"
-                   "    # if i <= cond then break \n"
-                   "    PUSHS LF@%for%");
-    ADD_INSTR_INT(scope_id);
-    ADD_INSTR_PART("%");
-    ADD_INSTR_PART_DYN(var_name);
-    ADD_INSTR_PART("\n    PUSHS LF@%");
-    ADD_INSTR_INT(scope_id);
-    ADD_INSTR_PART("%for%terminating_cond");
-    ADD_INSTR_PART("\n    POPS GF@%expr_result2 \n"
-                   "    POPS GF@%expr_result \n"
-                   "    LT GF@%expr_result3 GF@%expr_result GF@%expr_result2 \n"
-                   "    EQ GF@%expr_result2 GF@%expr_result GF@%expr_result2 \n"
-                   "    OR GF@%expr_result GF@%expr_result2 GF@%expr_result3 \n"
-                   "    PUSHS GF@%expr_result \n"
-                   "    JUMPIFNEQ $end$");
-    ADD_INSTR_INT(scope_id);
-    ADD_INSTR_PART(" GF@%expr_result bool@true \n"
-                   "    JUMP $for$");
-    ADD_INSTR_INT(scope_id);
-    ADD_INSTR_PART("$body \n"
-                   "LABEL $for$");
-    ADD_INSTR_INT(scope_id);
-    ADD_INSTR_PART("$step_le \n"
-                   "    # step < 0 \n"
-                   "    # if i >= cond then break \n"
-                   "    PUSHS LF@%");
-    ADD_INSTR_INT(scope_id);
-    ADD_INSTR_PART("%");
-    ADD_INSTR_PART_DYN(var_name);
-    ADD_INSTR_PART("\n    PUSHS LF@%");
-    ADD_INSTR_INT(scope_id);
-    ADD_INSTR_PART("%for%terminating_cond \n"
-                   "    POPS GF@%expr_result2 \n"
-                   "    POPS GF@%expr_result \n"
-                   "    GT GF@%expr_result3 GF@%expr_result GF@%expr_result2 \n"
-                   "    EQ GF@%expr_result2 GF@%expr_result GF@%expr_result2 \n"
-                   "    OR GF@%expr_result GF@%expr_result2 GF@%expr_result3 \n"
-                   "    PUSHS GF@%expr_result \n"
-                   "    JUMPIFNEQ $end$");
-    ADD_INSTR_INT(scope_id);
-    ADD_INSTR_PART(" GF@%expr_result bool@true \n"
-                   "\nLABEL $for$");
-    ADD_INSTR_INT(scope_id);
-    ADD_INSTR_PART("$body \n"
-                   "# for loop body \n");
+    ADD_INSTR_PART_TEXT("", 0);
+    ADD_INSTR_PART(INSTR(MOVE), 2, for_var, var);
+    ADD_INSTR_PART(INSTR(PUSHS), 1, for_var);
+    ADD_INSTR_PART_TEXT("CALL $$recast_to_float_second ", 0);
+    ADD_INSTR_PART(INSTR(POPS), 1, for_var);
+    ADD_INSTR_PART(INSTR(JUMPIFEQ), 3, builtin("ERROR_NIL"), var, nil_const());
+    ADD_INSTR_PART(INSTR(LABEL), 1, label(AFFIX_FOR, scope_id, AFFIX_NONE));
+    ADD_INSTR_PART(INSTR(MOVE), 2, var, for_var);
+    ADD_INSTR_PART_TEXT(for_cond_text[context->emit != IFJ21_EMIT_FULL], 7,
+                        scope_var(AFFIX_NONE, scope_id, Intern.get_c_str("for%step")),
+                        label(AFFIX_FOR, scope_id, AFFIX_STEP_LE),
+                        for_var,
+                        scope_var(AFFIX_NONE, scope_id, Intern.get_c_str("for%terminating_cond")),
+                        label(AFFIX_END, scope_id, AFFIX_NONE),
+                        label(AFFIX_FOR, scope_id, AFFIX_BODY),
+                        var);
 }
 
 /*
@@ -1174,17 +1231,15 @@ static void generate_for_cond(dynstring_t *var_name) {
  *                     JUMP $for$id
  *                     LABEL $end$id
  */
-static void generate_for_end(dynstring_t *var_name) {
-    ADD_INSTR_PART("ADD LF@%for%");\
-    generate_var_name(var_name, false);
-    ADD_INSTR_PART(" LF@%for%");
-    generate_var_name(var_name, false);
-    ADD_INSTR_PART(" LF@%");
-    ADD_INSTR_INT(Symstack.get_scope_info(symstack).unique_id);
-    ADD_INSTR_PART("%for%step");
+static void generate_for_end(const atom_t *var_name) {
+    operand_t for_var = generate_var_name(var_name, false);
+    for_var.affix = AFFIX_FOR_VAR;
+    ADD_INSTR_PART(INSTR(ADD), 3, for_var, for_var,
+                   scope_var(AFFIX_NONE, Symstack.get_scope_info(context->symstack).unique_id,
+                             Intern.get_c_str("for%step")));
     ADD_INSTR_TMP();
-    ADD_INSTR_PART("JUMP $for$");
-    ADD_INSTR_INT(Symstack.get_scope_info(symstack).unique_id);
+    ADD_INSTR_PART(INSTR(JUMP), 1, label(AFFIX_FOR, Symstack.get_scope_info(context->symstack).unique_id,
+                                         AFFIX_NONE));
     ADD_INSTR_TMP();
 
     generate_end();
@@ -1195,26 +1250,26 @@ static void generate_for_end(dynstring_t *var_name) {
  * generates sth like: LABEL $foo
  *                     PUSHFRAME
  */
-static void generate_func_start(dynstring_t *func_name) {
-    INSTR_CHANGE_ACTIVE_LIST(instructions.instrListFunctions);
-    ADD_INSTR_PART("\nLABEL $");   // add name of function
-    ADD_INSTR_PART_DYN(func_name);
+static void generate_func_start(const atom_t *func_name) {
+    INSTR_CHANGE_ACTIVE_LIST(context->instructions.instrListFunctions);
+    ADD_INSTR_PART_TEXT("", 0);
+    ADD_INSTR_PART(INSTR(LABEL), 1, func_label(Dynstring.c_str(func_name->name), AFFIX_NONE));
     ADD_INSTR_TMP();
-    ADD_INSTR("PUSHFRAME");
+    ADD_INSTR_OP(INSTR(PUSHFRAME), 0);
 }
 
 /*
  * @brief Generates function definition end.
  */
 static void generate_func_end(char *func_name) {
-    ADD_INSTR_PART("LABEL $");
-    ADD_INSTR_PART(func_name);
-    ADD_INSTR_PART("$end");
+    ADD_INSTR_PART(INSTR(LABEL), 1, func_label(func_name, AFFIX_END));
     ADD_INSTR_TMP();
 
-    ADD_INSTR("POPFRAME");
-    ADD_INSTR("RETURN\n");
-    INSTR_CHANGE_ACTIVE_LIST(instructions.mainList);
+    ADD_INSTR_OP(INSTR(POPFRAME), 0);
+    ADD_INSTR_OP(INSTR(RETURN), 0);
+    ADD_INSTR("");
+    INSTR_CHANGE_ACTIVE_LIST(context->instructions.mainList);
+    Flush_instr_lists();
 }
 
 /*
@@ -1223,19 +1278,15 @@ static void generate_func_end(char *func_name) {
  *      DEFVAR LF@%param
  *      MOVE LF@%param LF@%0
  */
-static void generate_func_start_param(dynstring_t *param_name, size_t index) {
-    ADD_INSTR("\n# generate passing parameter from TF to LF");
-    ADD_INSTR("\n#------------------------------------------");
-    ADD_INSTR_PART("DEFVAR LF@%");
-    generate_var_name(param_name, true);
+static void generate_func_start_param(const atom_t *param_name, size_t index) {
+    ADD_COMMENT(IFJ21_EMIT_FULL, "\n# generate passing parameter from TF to LF");
+    ADD_COMMENT(IFJ21_EMIT_FULL, "\n#------------------------------------------");
+    ADD_INSTR_PART(INSTR(DEFVAR), 1, generate_var_name(param_name, true));
     ADD_INSTR_TMP();
 
-    ADD_INSTR_PART("MOVE LF@%");
-    generate_var_name(param_name, true);
-    ADD_INSTR_PART(" LF@%");
-    ADD_INSTR_INT(index);
+    ADD_INSTR_PART(INSTR(MOVE), 2, generate_var_name(param_name, true), tmp_var(FRAME_LF, AFFIX_NONE, index));
     ADD_INSTR_TMP();
-    ADD_INSTR("\n#------------------------------------------");
+    ADD_COMMENT(IFJ21_EMIT_FULL, "\n#------------------------------------------");
 }
 
 /*
@@ -1244,9 +1295,7 @@ static void generate_func_start_param(dynstring_t *param_name, size_t index) {
  *          MOVE LF@%return0 GF@%expr_type
  */
 static void generate_func_pass_return(size_t index) {
-    ADD_INSTR_PART("MOVE LF@%return");
-    ADD_INSTR_INT(index);
-    ADD_INSTR_PART(" GF@%expr_result");
+    ADD_INSTR_PART(INSTR(MOVE), 2, tmp_var(FRAME_LF, AFFIX_RETURN, index), expr_result(AFFIX_EXPR_RESULT));
     ADD_INSTR_TMP();
 }
 
@@ -1257,17 +1306,14 @@ static void generate_func_pass_return(size_t index) {
  *      MOVE LF@%return0 nil@nil
  */
 static void generate_func_return_value(size_t index) {
-    ADD_INSTR("\n# generate func return");
-    ADD_INSTR("\n# --------------------");
-    ADD_INSTR_PART("DEFVAR LF@%return");
-    ADD_INSTR_INT(index);
+    ADD_COMMENT(IFJ21_EMIT_FULL, "\n# generate func return");
+    ADD_COMMENT(IFJ21_EMIT_FULL, "\n# --------------------");
+    ADD_INSTR_PART(INSTR(DEFVAR), 1, tmp_var(FRAME_LF, AFFIX_RETURN, index));
     ADD_INSTR_TMP();
 
-    ADD_INSTR_PART("MOVE LF@%return");
-    ADD_INSTR_INT(index);
-    ADD_INSTR_PART(" nil@nil");
+    ADD_INSTR_PART(INSTR(MOVE), 2, tmp_var(FRAME_LF, AFFIX_RETURN, index), nil_const());
     ADD_INSTR_TMP();
-    ADD_INSTR("\n# --------------------");
+    ADD_COMMENT(IFJ21_EMIT_FULL, "\n# --------------------");
 }
 
 /*
@@ -1289,7 +1335,7 @@ static void generate_return_defvars(dynstring_t *returns_vector) {
 static void generate_return(type_recast_t r_type, size_t return_index) {
     // recast if needed and assign parameter
     if (r_type != NO_RECAST) {
-        ADD_INSTR("CALL $$recast_to_float_second");
+        ADD_INSTR_OP(INSTR(CALL), 1, builtin("recast_to_float_second"));
     }
     generate_expression_pop();
     generate_func_pass_return(return_index);
@@ -1299,9 +1345,7 @@ static void generate_return(type_recast_t r_type, size_t return_index) {
  * @brief Generates jump to function end after return.
  */
 static void generate_return_end() {
-    ADD_INSTR_PART("JUMP $");
-    ADD_INSTR_PART(Symstack.get_parent_func_name(symstack));
-    ADD_INSTR_PART("$end");
+    ADD_INSTR_PART(INSTR(JUMP), 1, func_label(Symstack.get_parent_func_name(context->symstack), AFFIX_END));
     ADD_INSTR_TMP();
 }
 
@@ -1309,8 +1353,8 @@ static void generate_return_end() {
  * @brief Generates creation of a frame before passing parameters to a function
  */
 static void generate_func_createframe() {
-    ADD_INSTR("\n# creating of a frame before passing parameters to a function");
-    ADD_INSTR("CREATEFRAME");
+    ADD_COMMENT(IFJ21_EMIT_FULL, "\n# creating of a frame before passing parameters to a function");
+    ADD_INSTR_OP(INSTR(CREATEFRAME), 0);
 }
 
 /*
@@ -1320,17 +1364,14 @@ static void generate_func_createframe() {
  *          MOVE TF@%0 GF@%expr_result
  */
 static void generate_func_call_pass_param(size_t param_index) {
-    ADD_INSTR("\n# generate parameter passed to a function");
-    ADD_INSTR("\n# --------------------");
-    ADD_INSTR_PART("DEFVAR TF@%");
-    ADD_INSTR_INT(param_index);
+    ADD_COMMENT(IFJ21_EMIT_FULL, "\n# generate parameter passed to a function");
+    ADD_COMMENT(IFJ21_EMIT_FULL, "\n# --------------------");
+    ADD_INSTR_PART(INSTR(DEFVAR), 1, tmp_var(FRAME_TF, AFFIX_NONE, param_index));
     ADD_INSTR_TMP();
 
-    ADD_INSTR_PART("MOVE TF@%");
-    ADD_INSTR_INT(param_index);
-    ADD_INSTR_PART(" GF@%expr_result");
+    ADD_INSTR_PART(INSTR(MOVE), 2, tmp_var(FRAME_TF, AFFIX_NONE, param_index), expr_result(AFFIX_EXPR_RESULT));
     ADD_INSTR_TMP();
-    ADD_INSTR("\n# --------------------");
+    ADD_COMMENT(IFJ21_EMIT_FULL, "\n# --------------------");
 }
 
 /*
@@ -1342,7 +1383,7 @@ static void generate_func_call_pass_param(size_t param_index) {
 static void generate_param(type_recast_t r_type, size_t param_index) {
     // recast if needed and assign parameter
     if (r_type != NO_RECAST) {
-        ADD_INSTR("CALL $$recast_to_float_second");
+        ADD_INSTR_OP(INSTR(CALL), 1, builtin("recast_to_float_second"));
     }
     generate_expression_pop();
     generate_func_call_pass_param(param_index);
@@ -1354,12 +1395,10 @@ static void generate_param(type_recast_t r_type, size_t param_index) {
  *        This function is used for function write call.
  */
 static void generate_pop_to_tmp_var(size_t index) {
-    ADD_INSTR_PART("DEFVAR TF@%write");
-    ADD_INSTR_INT(index);
+    ADD_INSTR_PART(INSTR(DEFVAR), 1, tmp_var(FRAME_TF, AFFIX_WRITE, index));
     ADD_INSTR_TMP();
 
-    ADD_INSTR_PART("POPS TF@%write");
-    ADD_INSTR_INT(index);
+    ADD_INSTR_PART(INSTR(POPS), 1, tmp_var(FRAME_TF, AFFIX_WRITE, index));
     ADD_INSTR_TMP();
 }
 
@@ -1368,8 +1407,7 @@ static void generate_pop_to_tmp_var(size_t index) {
  *        This function is used for function write call.
  */
 static void generate_move_tmp_var(size_t index) {
-    ADD_INSTR_PART("MOVE GF@%expr_result TF@%write");
-    ADD_INSTR_INT(index);
+    ADD_INSTR_PART(INSTR(MOVE), 2, expr_result(AFFIX_EXPR_RESULT), tmp_var(FRAME_TF, AFFIX_WRITE, index));
     ADD_INSTR_TMP();
 }
 
@@ -1377,8 +1415,7 @@ static void generate_move_tmp_var(size_t index) {
  * @brief Generates function call.
  */
 static void generate_func_call(char *func_name) {
-    ADD_INSTR_PART("CALL $");
-    ADD_INSTR_PART(func_name);
+    ADD_INSTR_PART(INSTR(CALL), 1, func_label(func_name, AFFIX_NONE));
     ADD_INSTR_TMP();
 }
 
@@ -1405,8 +1442,7 @@ static void generate_multiple_write(size_t expr_len) {
  * generates sth like:  MOVE LF%id%res TF@%return0
  */
 static void generate_func_call_return_value(size_t index) {
-    ADD_INSTR_PART("PUSHS TF@%return");
-    ADD_INSTR_INT(index);
+    ADD_INSTR_PART(INSTR(PUSHS), 1, tmp_var(FRAME_TF, AFFIX_RETURN, index));
     ADD_INSTR_TMP();
 }
 
@@ -1414,26 +1450,96 @@ static void generate_func_call_return_value(size_t index) {
  * @brief Generates start of main scope.
  */
 static void generate_main_start() {
-    INSTR_CHANGE_ACTIVE_LIST(instructions.mainList);
-    ADD_INSTR("\n# main scope");
-    ADD_INSTR("LABEL $$MAIN");
-    ADD_INSTR("CREATEFRAME");
-    ADD_INSTR("PUSHFRAME");
+    INSTR_CHANGE_ACTIVE_LIST(context->instructions.mainList);
+    ADD_COMMENT(IFJ21_EMIT_MINIMAL, "\n# main scope");
+    ADD_INSTR_OP(INSTR(LABEL), 1, builtin("MAIN"));
+    ADD_INSTR_OP(INSTR(CREATEFRAME), 0);
+    ADD_INSTR_OP(INSTR(PUSHFRAME), 0);
 }
 
 /*
  * @brief Generates end of main scope.
  */
 static void generate_main_end() {
-    ADD_INSTR("LABEL $$MAIN$end");
-    ADD_INSTR("CLEARS");
+    ADD_INSTR_OP(INSTR(LABEL), 1, builtin("MAIN$end"));
+    ADD_INSTR_OP(INSTR(CLEARS), 0);
 }
 
 /*
- * @brief Generates program start (adds header, define built-in functions).
+ * Header and built-in functions are the same for every program,
+ * they are generated once and kept as two strings, with comments and without them.
  */
-static void generate_prog_start() {
-    INSTR_CHANGE_ACTIVE_LIST(instructions.startList);
+static char *prelude_start[2];
+static char *prelude_functions[2];
+static pthread_once_t prelude_once = PTHREAD_ONCE_INIT;
+
+/*
+ * Characters of joined instructions.
+ */
+typedef struct joined {
+    char *chars;
+    size_t len;
+    size_t cap;
+} joined_t;
+
+/*
+ * @brief Sink appending to joined_t.
+ */
+static void join_write(void *data, const char *str, size_t len) {
+    joined_t *joined = data;
+    if (joined->len + len + 1 > joined->cap) {
+        joined->cap = (joined->len + len + 1) * 2;
+        joined->chars = realloc(joined->chars, joined->cap);
+        soft_assert(joined->chars != NULL, ERROR_INTERNAL);
+    }
+    memcpy(joined->chars + joined->len, str, len);
+    joined->len += len;
+}
+
+/*
+ * @brief Joins instructions of the list as Print_instr_list() prints them, without the last newline.
+ */
+static char *join_instr_list(instrbuf_t *list) {
+    joined_t joined = {.chars = NULL, .len = 0, .cap = 0};
+    ifj21_sink_t sink = {.write = join_write, .data = &joined};
+    join_write(&joined, "", 0);
+    Instrbuf.print(list, &sink);
+    joined.chars[(joined.len != 0) ? joined.len - 1 : 0] = '\0';
+    return joined.chars;
+}
+
+/*
+ * @brief Copies the code without lines which are only comments.
+ */
+static char *strip_comments(const char *code) {
+    char *stripped = malloc(strlen(code) + 1);
+    soft_assert(stripped != NULL, ERROR_INTERNAL);
+    char *end = stripped;
+    while (*code != '\0') {
+        const char *line_end = strchr(code, '\n');
+        size_t len = (line_end != NULL) ? (size_t) (line_end - code) + 1 : strlen(code);
+        const char *first = code + strspn(code, " \t");
+        if (*first != '#') {
+            memcpy(end, code, len);
+            end += len;
+        }
+        code += len;
+    }
+    // the prelude is printed with a newline after it.
+    end -= (end != stripped && end[-1] == '\n') ? 1 : 0;
+    *end = '\0';
+    return stripped;
+}
+
+/*
+ * @brief Generates the header and built-in functions into prelude strings.
+ */
+static void generate_prelude() {
+    instrbuf_t *active = context->instrList;
+    instrbuf_t *start = Instrbuf.ctor();
+    instrbuf_t *functions = Instrbuf.ctor();
+
+    INSTR_CHANGE_ACTIVE_LIST(start);
     ADD_INSTR(".IFJcode21");
     ADD_INSTR("DEFVAR GF@%expr_result \n"
               "MOVE GF@%expr_result nil@nil");
@@ -1447,7 +1553,7 @@ static void generate_prog_start() {
               "LABEL $$ERROR_DIV_BY_ZERO \n"
               "EXIT int@9");
 
-    INSTR_CHANGE_ACTIVE_LIST(instructions.instrListFunctions);
+    INSTR_CHANGE_ACTIVE_LIST(functions);
     generate_func_ord();
     generate_func_chr();
     generate_func_substr();
@@ -1467,8 +1573,25 @@ static void generate_prog_start() {
     generate_ors_short();
     generate_ands_short();
 
-    INSTR_CHANGE_ACTIVE_LIST(instructions.mainList);
+    prelude_start[0] = join_instr_list(start);
+    prelude_functions[0] = join_instr_list(functions);
+    prelude_start[1] = strip_comments(prelude_start[0]);
+    prelude_functions[1] = strip_comments(prelude_functions[0]);
+    INSTR_CHANGE_ACTIVE_LIST(active);
+}
+
+/*
+ * @brief Generates program start (adds header, define built-in functions).
+ */
+static void generate_prog_start() {
+    pthread_once(&prelude_once, generate_prelude);
+    bool comments = context->emit == IFJ21_EMIT_FULL;
+    Instrbuf.append(context->instructions.startList, INSTR_TEXT, prelude_start[!comments], 0, NULL);
+    Instrbuf.append(context->instructions.instrListFunctions, INSTR_TEXT, prelude_functions[!comments], 0, NULL);
+
+    INSTR_CHANGE_ACTIVE_LIST(context->instructions.mainList);
     generate_main_start();
+    Flush_instr_lists();
 }
 
 /**
@@ -1479,6 +1602,7 @@ const struct code_generator_interface_t Generator = {
         .initialise = initialise_generator,
         .dtor = dtor,
         .print_instr_list = Print_instr_list,
+        .flush = Flush_instr_lists,
         .comment = generate_comment,
         .var_declaration = generate_var_declaration,
         .var_definition = generate_var_definition,
@@ -7,7 +7,7 @@
 #pragma once
 
 #include "dynstring.h"
-#include "list.h"
+#include "instrbuf.h"
 #include "scanner.h"
 #include "parser.h"
 
@@ -17,12 +17,12 @@
  * Structure that holds information needed for the code generator.
  */
 typedef struct {
-    list_t *startList;                  // instrs that are first in the program
-    list_t *instrListFunctions;         // instr list for defining functions
-    list_t *mainList;                   // instr list for the main scope
+    instrbuf_t *startList;              // instrs that are first in the program
+    instrbuf_t *instrListFunctions;     // instr list for defining functions
+    instrbuf_t *mainList;               // instr list for the main scope
     bool in_loop;                       // var that indicates whether we are in loop
     size_t outer_loop_id;               // id of scope of the most outer loop
-    list_item_t *before_loop_start;     // ptr to instr before the most outer loop
+    instr_t *before_loop_start;         // place of DEFVARs before the most outer loop
                                         // if (!in_loop) before_loop_start == NULL
     size_t outer_cond_id;               // id of scope of the most outer if
     char cond_cnt;                      // counter of elseif/else branches after if
@@ -35,9 +35,6 @@ typedef enum instr_list {
     LIST_INSTR_MAIN,
 } instr_list_t;
 
-extern instructions_t instructions;
-extern list_t *instrList;
-
 /**
  * A structure that store pointers to the functions from code_generator.c. So we can use them in different files as interface.
  */
@@ -58,15 +55,20 @@ struct code_generator_interface_t {
      */
     void (*print_instr_list)(instr_list_t);
 
+    /*
+     * @brief Writes the code nothing can be inserted before any more, if the code is streamed.
+     */
+    void (*flush)(void);
+
     /*
      * @brief Generates variable declaration.
      */
-    void (*var_declaration)(dynstring_t *);
+    void (*var_declaration)(const atom_t *);
 
     /*
      * @brief Generates variable declaration.
      */
-    void (*var_definition)(dynstring_t *);
+    void (*var_definition)(const atom_t *);
 
     /*
      * @brief Generates variable used for code generating.
@@ -76,12 +78,12 @@ struct code_generator_interface_t {
     /*
      * @brief Generates assignment to a variable
      */
-    void (*var_assignment)(dynstring_t *);
+    void (*var_assignment)(const atom_t *);
 
     /*
      * @brief Sets variable to nil.
      */
-    void (*var_set_nil)(dynstring_t *);
+    void (*var_set_nil)(const atom_t *);
 
     /*
      * @brief Converts GF@%expr_result to bool
@@ -199,17 +201,17 @@ struct code_generator_interface_t {
     /*
      * @brief Generates for loop condition check.
      */
-    void (*for_cond)(dynstring_t *);
+    void (*for_cond)(const atom_t *);
 
     /*
      * @brief Generates for loop end.
      */
-    void (*for_end)(dynstring_t *);
+    void (*for_end)(const atom_t *);
 
     /*
      * @brief Generates function definition start.
      */
-    void (*func_start)(dynstring_t *);
+    void (*func_start)(const atom_t *);
 
     /*
      * @brief Generates function definition end.
@@ -219,7 +221,7 @@ struct code_generator_interface_t {
     /*
      * @brief Generates passing param from TF to LF.
      */
-    void (*func_start_param)(dynstring_t *, size_t);
+    void (*func_start_param)(const atom_t *, size_t);
 
     /*
      * Generates definition of return values - sets them to nil.
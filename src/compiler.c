@@ -0,0 +1,409 @@
+/**
+ * @file compiler.c
+ *
+ * @brief Library interface of the compiler.
+ *
+ * @author Skuratovich Aliaksandr <xskura01@vutbr.cz>
+ */
+#include "compiler.h"
+#include "context.h"
+#include "errors.h"
+#include "parser.h"
+#include "code_generator.h"
+#include "pool.h"
+#include "writer.h"
+
+// suffix of the generated code, and of the programs, which is replaced by it.
+#define BATCH_SUFFIX ".code"
+#define PROGRAM_SUFFIX ".tl"
+
+
+/** Write characters to stdout.
+ */
+static void write_stdout(void *data, const char *s, size_t len) {
+    (void) data;
+    fwrite(s, 1, len, stdout);
+}
+
+const ifj21_sink_t ifj21_stdout = {
+        .write = write_stdout,
+        .data = NULL,
+};
+
+
+/** Compile a program from a file in a new context.
+ *
+ * @param pfile program file.
+ * @param lex_threads 0 lexes tokens on demand.
+ * @param sink output of the generated code.
+ * @return error code.
+ */
+int ifj21_compile_file(pfile_t *pfile, size_t lex_threads, const ifj21_sink_t *sink) {
+    ifj21_options_t options = {.lex_threads = lex_threads};
+    return ifj21_compile_file_stats(pfile, &options, sink, NULL);
+}
+
+/** Compile a program from a file with options and count its allocations.
+ *
+ * @param pfile program file.
+ * @param options options, or NULL for the defaults.
+ * @param sink output of the generated code.
+ * @param stats counters, or NULL.
+ * @return error code.
+ */
+int ifj21_compile_file_stats(pfile_t *pfile, const ifj21_options_t *options, const ifj21_sink_t *sink,
+                             mem_stats_t *stats) {
+    static const ifj21_options_t defaults = {0};
+    options = (options != NULL) ? options : &defaults;
+    context_t *ctx = Context.ctor(sink);
+    context_t *outer = Context.enter(ctx);
+    ctx->mem_stats = stats;
+    ctx->stream_code = options->stream_code;
+    ctx->emit = options->emit;
+
+    Generator.initialise();
+    if (Parser.analyse(pfile, options->lex_threads)) {
+        // Prints the list of instructions to the sink
+        debug_msg("# ---------- Instructions List ----------\n");
+
+        debug_msg("# ---------- startList ----------\n");
+        Generator.print_instr_list(LIST_INSTR_START);
+
+        debug_msg("# ---------- listFunctions ----------\n");
+        Generator.print_instr_list(LIST_INSTR_FUNC);
+
+        debug_msg("# ---------- mainList ----------\n");
+        Generator.print_instr_list(LIST_INSTR_MAIN);
+    }
+    Generator.dtor();
+
+    int error = Errors.get_error();
+    if (stats != NULL) {
+        stats->reserved = ctx->arena.reserved;
+        stats->chunks = ctx->arena.chunks;
+        stats->big_peak = ctx->arena.big_peak;
+    }
+    Context.enter(outer);
+    Context.dtor(ctx);
+    return error;
+}
+
+/** Compile a program in memory.
+ *
+ * @param src characters of the program.
+ * @param len number of characters.
+ * @param sink output of the generated code.
+ * @return error code.
+ */
+int ifj21_compile(const char *src, size_t len, const ifj21_sink_t *sink) {
+    pfile_t *pfile = Pfile.ctor_n(src, len);
+    if (!pfile) {
+        return ERROR_INTERNAL;
+    }
+
+    int error = ifj21_compile_file(pfile, 0, sink);
+    Pfile.dtor(pfile);
+    return error;
+}
+
+/** One file of a batch.
+ */
+typedef struct batch_job {
+    const char *file;
+    const ifj21_options_t *options;
+    int *error;
+} batch_job_t;
+
+/** Make the name of the output of a program.
+ *
+ * @param file name of the program.
+ * @return new string, name.tl gives name.code.
+ */
+static char *output_name(const char *file) {
+    size_t len = strlen(file);
+    size_t suffix = strlen(PROGRAM_SUFFIX);
+    if (len > suffix && strcmp(file + len - suffix, PROGRAM_SUFFIX) == 0) {
+        len -= suffix;
+    }
+
+    char *name = malloc(len + sizeof(BATCH_SUFFIX));
+    soft_assert(name != NULL, ERROR_INTERNAL);
+    memcpy(name, file, len);
+    memcpy(name + len, BATCH_SUFFIX, sizeof(BATCH_SUFFIX));
+    return name;
+}
+
+/** Compile one file of a batch, it is a task of the pool.
+ */
+static void compile_batch_job(void *arg) {
+    batch_job_t *job = arg;
+    char *name = output_name(job->file);
+    pfile_t *pfile = Pfile.getfile(job->file);
+    writer_t *out = (pfile) ? Writer.open(name) : NULL;
+
+    if (out) {
+        *job->error = ifj21_compile_file_stats(pfile, job->options, &out->sink, NULL);
+        if (Writer.dtor(out) != 0 && *job->error == 0) {
+            *job->error = ERROR_INTERNAL;
+        }
+    } else {
+        *job->error = ERROR_INTERNAL;
+    }
+    if (pfile) {
+        Pfile.dtor(pfile);
+    }
+    free(name);
+}
+
+/** Compile programs from files at once on a work-stealing thread pool.
+ *
+ * @param files names of program files.
+ * @param count number of files.
+ * @param jobs number of threads.
+ * @param options options of every file, or NULL.
+ * @param errors error code of every file.
+ * @return error code of the first file which failed, 0 if all of them are compiled.
+ */
+int ifj21_compile_batch(const char *const *files, size_t count, size_t jobs, const ifj21_options_t *options,
+                        int *errors) {
+    batch_job_t *batch = calloc(count + 1, sizeof(batch_job_t));
+    soft_assert(batch != NULL, ERROR_INTERNAL);
+
+    pool_t *pool = Pool.ctor(jobs);
+    for (size_t i = 0; i < count; i++) {
+        batch[i] = (batch_job_t) {.file = files[i], .options = options, .error = &errors[i]};
+        Pool.submit(pool, compile_batch_job, &batch[i]);
+    }
+    Pool.wait(pool);
+    Pool.dtor(pool);
+    free(batch);
+
+    for (size_t i = 0; i < count; i++) {
+        if (errors[i] != 0) {
+            return errors[i];
+        }
+    }
+    return 0;
+}
+
+
+#ifdef SELFTEST_compiler
+#include <pthread.h>
+
+/** Output collected in memory.
+ */
+typedef struct buffer {
+    char *s;
+    size_t len;
+    size_t cap;
+} buffer_t;
+
+static void write_buffer(void *data, const char *s, size_t len) {
+    buffer_t *buf = data;
+    if (buf->len + len > buf->cap) {
+        buf->cap = (buf->len + len) * 2;
+        buf->s = realloc(buf->s, buf->cap);
+        soft_assert(buf->s != NULL, ERROR_INTERNAL);
+    }
+    memcpy(buf->s + buf->len, s, len);
+    buf->len += len;
+}
+
+/** Result of a compilation of a file.
+ */
+typedef struct result {
+    buffer_t out;
+    int error;
+} result_t;
+
+typedef struct job {
+    char **programs;
+    size_t *lens;
+    result_t *results;
+    int count;
+} job_t;
+
+/** Compile all programs of a job.
+ */
+static void *compile_all(void *arg) {
+    job_t *job = arg;
+    for (int i = 0; i < job->count; i++) {
+        ifj21_sink_t sink = {.write = write_buffer, .data = &job->results[i].out};
+        job->results[i].error = ifj21_compile(job->programs[i], job->lens[i], &sink);
+    }
+    return NULL;
+}
+
+/** Compile all programs of a job with options.
+ */
+static void compile_all_options(job_t *job, const ifj21_options_t *options) {
+    for (int i = 0; i < job->count; i++) {
+        ifj21_sink_t sink = {.write = write_buffer, .data = &job->results[i].out};
+        pfile_t *pfile = Pfile.ctor_n(job->programs[i], job->lens[i]);
+        soft_assert(pfile != NULL, ERROR_INTERNAL);
+        job->results[i].error = ifj21_compile_file_stats(pfile, options, &sink, NULL);
+        Pfile.dtor(pfile);
+    }
+}
+
+/** Skip empty lines and comments of code.
+ *
+ * @param comments set if a comment is skipped.
+ * @return the next line with an instruction, or end.
+ */
+static const char *skip_comments(const char *line, const char *end, bool *comments) {
+    while (line < end) {
+        const char *first = line;
+        while (first < end && (*first == ' ' || *first == '\t')) {
+            first++;
+        }
+        if (first < end && *first != '\n' && *first != '#') {
+            return line;
+        }
+        *comments |= first < end && *first == '#';
+        const char *line_end = memchr(first, '\n', end - first);
+        line = (line_end != NULL) ? line_end + 1 : end;
+    }
+    return end;
+}
+
+/** Compare code of compilations with comments and without them, lines of instructions must be the same.
+ */
+static bool same_instructions(job_t *a, job_t *b) {
+    for (int i = 0; i < a->count; i++) {
+        result_t *x = &a->results[i], *y = &b->results[i];
+        if (x->error != y->error) {
+            return false;
+        }
+        const char *p = x->out.s, *p_end = p + x->out.len;
+        const char *q = y->out.s, *q_end = q + y->out.len;
+        bool comments = false, no_comments = false;
+        while (x->error == 0) {
+            p = skip_comments(p, p_end, &comments);
+            q = skip_comments(q, q_end, &no_comments);
+            if (p == p_end || q == q_end || no_comments) {
+                if (p != p_end || q != q_end || no_comments) {
+                    return false;
+                }
+                break;
+            }
+            const char *p_line = memchr(p, '\n', p_end - p), *q_line = memchr(q, '\n', q_end - q);
+            p_line = (p_line != NULL) ? p_line : p_end;
+            q_line = (q_line != NULL) ? q_line : q_end;
+            if (p_line - p != q_line - q || memcmp(p, q, p_line - p) != 0) {
+                return false;
+            }
+            p = p_line;
+            q = q_line;
+        }
+    }
+    return true;
+}
+
+static bool same_results(job_t *a, job_t *b, bool with_errors) {
+    for (int i = 0; i < a->count; i++) {
+        result_t *x = &a->results[i], *y = &b->results[i];
+        if (x->error != y->error) {
+            return false;
+        }
+        if ((x->error == 0 || with_errors) && (x->out.len != y->out.len
+            || (x->out.len != 0 && memcmp(x->out.s, y->out.s, x->out.len) != 0))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void free_results(job_t *job) {
+    for (int i = 0; i < job->count; i++) {
+        free(job->results[i].out.s);
+    }
+    free(job->results);
+}
+
+/** Usage: compiler_selftest files...
+ *  Compilations of the same program must give the same code and error,
+ *  one after another in one process, with streamed code, without comments, and at once on threads.
+ */
+int main(int argc, char **argv) {
+    const int threads = 4;
+    int count = argc - 1;
+    char **programs = calloc(count + 1, sizeof(char *));
+    size_t *lens = calloc(count + 1, sizeof(size_t));
+    job_t jobs[threads + 1];
+    pthread_t ids[threads];
+    int failed = 0;
+    soft_assert(programs && lens, ERROR_INTERNAL);
+
+    for (int i = 0; i < count; i++) {
+        pfile_t *pfile = Pfile.getfile(argv[i + 1]);
+        soft_assert(pfile != NULL, ERROR_INTERNAL);
+        lens[i] = Pfile.available(pfile);
+        programs[i] = malloc(lens[i] + 1);
+        soft_assert(programs[i] != NULL, ERROR_INTERNAL);
+        memcpy(programs[i], Pfile.get_tape(pfile), lens[i]);
+        Pfile.dtor(pfile);
+    }
+
+    for (int t = 0; t <= threads; t++) {
+        jobs[t] = (job_t) {.programs = programs, .lens = lens, .count = count,
+                           .results = calloc(count + 1, sizeof(result_t))};
+        soft_assert(jobs[t].results != NULL, ERROR_INTERNAL);
+    }
+
+    // one after another.
+    compile_all(&jobs[0]);
+    compile_all(&jobs[1]);
+    if (!same_results(&jobs[0], &jobs[1], true)) {
+        fprintf(stderr, "FAILED: the second compilation in the process differs\n");
+        failed = 1;
+    }
+    free_results(&jobs[1]);
+    jobs[1].results = calloc(count + 1, sizeof(result_t));
+    soft_assert(jobs[1].results != NULL, ERROR_INTERNAL);
+
+    // streamed code is the same.
+    compile_all_options(&jobs[1], &(ifj21_options_t) {.stream_code = true});
+    if (!same_results(&jobs[0], &jobs[1], false)) {
+        fprintf(stderr, "FAILED: the streamed code differs\n");
+        failed = 1;
+    }
+    free_results(&jobs[1]);
+    jobs[1].results = calloc(count + 1, sizeof(result_t));
+    soft_assert(jobs[1].results != NULL, ERROR_INTERNAL);
+
+    // code without comments has the same instructions.
+    compile_all_options(&jobs[1], &(ifj21_options_t) {.emit = IFJ21_EMIT_NONE});
+    if (!same_instructions(&jobs[0], &jobs[1])) {
+        fprintf(stderr, "FAILED: the code without comments differs\n");
+        failed = 1;
+    }
+    free_results(&jobs[1]);
+    jobs[1].results = calloc(count + 1, sizeof(result_t));
+    soft_assert(jobs[1].results != NULL, ERROR_INTERNAL);
+
+    // at once.
+    for (int t = 0; t < threads; t++) {
+        soft_assert(pthread_create(&ids[t], NULL, compile_all, &jobs[t + 1]) == 0, ERROR_INTERNAL);
+    }
+    for (int t = 0; t < threads; t++) {
+        pthread_join(ids[t], NULL);
+        if (!same_results(&jobs[0], &jobs[t + 1], true)) {
+            fprintf(stderr, "FAILED: a compilation on thread %d differs\n", t);
+            failed = 1;
+        }
+    }
+
+    printf("%d programs compiled twice, streamed, without comments and on %d threads: %s\n", count, threads, failed ? "FAILED" : "OK");
+
+    for (int t = 0; t <= threads; t++) {
+        free_results(&jobs[t]);
+    }
+    for (int i = 0; i < count; i++) {
+        free(programs[i]);
+    }
+    free(programs);
+    free(lens);
+    return failed;
+}
+#endif
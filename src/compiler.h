@@ -0,0 +1,90 @@
+/**
+ * @file compiler.h
+ *
+ * @brief Library interface of the compiler. Every compilation has its own context,
+ *        so programs can be compiled one after another, or at once on different threads.
+ *
+ * @author Skuratovich Aliaksandr <xskura01@vutbr.cz>
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "progfile.h"
+#include "memstats.h"
+
+
+/** Output of the compiler, the generated code is written by write(data, characters, length).
+ */
+typedef struct ifj21_sink {
+    void (*write)(void *, const char *, size_t);
+    void *data;
+} ifj21_sink_t;
+
+/** Sink writing to stdout.
+ */
+extern const ifj21_sink_t ifj21_stdout;
+
+/** Comments written to the generated code.
+ */
+typedef enum ifj21_emit {
+    IFJ21_EMIT_FULL, ///< all comments, how statements and their operands are generated.
+    IFJ21_EMIT_MINIMAL, ///< a comment for every statement.
+    IFJ21_EMIT_NONE, ///< no comments.
+} ifj21_emit_t;
+
+/** Options of a compilation, zeroed options are the defaults.
+ */
+typedef struct ifj21_options {
+    size_t lex_threads; ///< see ifj21_compile_file().
+    /** Write the code of a function as soon as it is generated, and the code of a loop as soon as nothing
+     *  can be hoisted before it, so the generator takes memory for the biggest function, not for the program.
+     *  Calls of the main scope are written at the end. If there are errors, the code written so far stays.
+     */
+    bool stream_code;
+    ifj21_emit_t emit; ///< comments written to the code.
+} ifj21_options_t;
+
+/** Compile a program.
+ *
+ * @param src characters of the program, they do not need to end with '\0'.
+ * @param len number of characters.
+ * @param sink output of the generated code, it is written only if there are no errors.
+ * @return error code from errors.h, 0 on success.
+ */
+int ifj21_compile(const char *src, size_t len, const ifj21_sink_t *sink);
+
+/** Compile a program from a file.
+ *
+ * @param pfile program file, it is not freed.
+ * @param lex_threads lex the whole file into a token buffer before parsing on up to lex_threads threads,
+ *                    0 lexes tokens on demand. The file must not be a stream.
+ * @param sink output of the generated code, it is written only if there are no errors.
+ * @return error code from errors.h, 0 on success.
+ */
+int ifj21_compile_file(pfile_t *pfile, size_t lex_threads, const ifj21_sink_t *sink);
+
+/** Compile a program from a file with options and count its allocations by subsystems, see ifj21_compile_file().
+ *
+ * @param pfile program file, it is not freed.
+ * @param options options of the compilation, or NULL for the defaults.
+ * @param sink output of the generated code.
+ * @param stats zeroed counters the allocations are added to, or NULL to count nothing.
+ * @return error code from errors.h, 0 on success.
+ */
+int ifj21_compile_file_stats(pfile_t *pfile, const ifj21_options_t *options, const ifj21_sink_t *sink,
+                             mem_stats_t *stats);
+
+/** Compile programs from files at once on a work-stealing thread pool.
+ *  The code of "name.tl" is written next to it to "name.code", other names get ".code" appended.
+ *  The output file is created for every program, it is empty if there are errors.
+ *
+ * @param files names of program files.
+ * @param count number of files.
+ * @param jobs number of threads, 0 means one.
+ * @param options options of the compilation of every file, or NULL for the defaults.
+ * @param errors error code of every file from errors.h, 0 on success.
+ * @return error code of the first file which failed, 0 if all of them are compiled.
+ */
+int ifj21_compile_batch(const char *const *files, size_t count, size_t jobs, const ifj21_options_t *options,
+                        int *errors);
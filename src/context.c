@@ -0,0 +1,121 @@
+/**
+ * @file context.c
+ *
+ * @brief State of one compilation.
+ *
+ * @author Skuratovich Aliaksandr <xskura01@vutbr.cz>
+ */
+#include "context.h"
+#include "errors.h"
+
+#include <string.h>
+
+
+_Thread_local context_t *context;
+
+
+/** Create an empty context.
+ *
+ * @param sink output of the generated code.
+ * @return new context.
+ */
+static context_t *Ctor(const ifj21_sink_t *sink) {
+    context_t *ctx = calloc(1, sizeof(context_t));
+    soft_assert(ctx != NULL, ERROR_INTERNAL);
+
+    ctx->errmsg = "";
+    ctx->sink = sink;
+    return ctx;
+}
+
+/** Make the context current on this thread.
+ *
+ * @param ctx context or NULL.
+ * @return the previous context.
+ */
+static context_t *Enter(context_t *ctx) {
+    context_t *previous = context;
+    context = ctx;
+    return previous;
+}
+
+/** Free the context.
+ *
+ * @param ctx
+ */
+static void Dtor(context_t *ctx) {
+    if (context == ctx) {
+        context = NULL;
+    }
+    Arena.release(&ctx->arena);
+    free(ctx);
+}
+
+/** Allocate zeroed memory of the compilation.
+ *
+ * @param tag subsystem.
+ * @param size number of bytes.
+ * @return memory.
+ */
+static void *Alloc(mem_tag_t tag, size_t size) {
+    if (context != NULL) {
+        if (context->mem_stats != NULL) {
+            MemStats.alloc(context->mem_stats, tag, size);
+        }
+        return Arena.alloc(&context->arena, size);
+    }
+    void *ptr = calloc(1, size);
+    soft_assert(ptr != NULL, ERROR_INTERNAL);
+    return ptr;
+}
+
+/** Make memory from Alloc() bigger.
+ *
+ * @param tag subsystem.
+ * @param ptr allocation of old_size bytes, or NULL.
+ * @param old_size
+ * @param new_size
+ * @return memory of new_size bytes.
+ */
+static void *Grow(mem_tag_t tag, void *ptr, size_t old_size, size_t new_size) {
+    if (context != NULL) {
+        if (context->mem_stats != NULL) {
+            MemStats.grow(context->mem_stats, tag, old_size, new_size);
+        }
+        return Arena.grow(&context->arena, ptr, old_size, new_size);
+    }
+    if (new_size <= old_size) {
+        return ptr;
+    }
+    char *grown = realloc(ptr, new_size);
+    soft_assert(grown != NULL, ERROR_INTERNAL);
+    memset(grown + old_size, 0, new_size - old_size);
+    return grown;
+}
+
+/** Free memory from Alloc().
+ *
+ * @param tag subsystem.
+ * @param ptr
+ * @param size bytes of the allocation.
+ */
+static void Free(mem_tag_t tag, void *ptr, size_t size) {
+    if (context != NULL) {
+        if (context->mem_stats != NULL && ptr != NULL) {
+            MemStats.free(context->mem_stats, tag, size);
+        }
+        Arena.free(&context->arena, ptr, size);
+    } else {
+        free(ptr);
+    }
+}
+
+
+const struct context_interface_t Context = {
+        .ctor = Ctor,
+        .enter = Enter,
+        .dtor = Dtor,
+        .alloc = Alloc,
+        .grow = Grow,
+        .free = Free,
+};
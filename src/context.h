@@ -0,0 +1,121 @@
+/**
+ * @file context.h
+ *
+ * @brief State of one compilation. Modules keep their state in the context of the current thread,
+ *        so there are no process globals and compilations do not share anything but read-only tables.
+ *
+ * @author Skuratovich Aliaksandr <xskura01@vutbr.cz>
+ */
+#pragma once
+
+#include "scanner.h"
+#include "tokbuf.h"
+#include "intern.h"
+#include "symtable.h"
+#include "symstack.h"
+#include "list.h"
+#include "expressions.h"
+#include "code_generator.h"
+#include "compiler.h"
+#include "arena.h"
+#include "memstats.h"
+
+
+/** Everything a compilation changes.
+ */
+typedef struct context {
+    // memory
+    arena_t arena; ///< dynstrings, lists, stacks, symbol tables and function semantics of the compilation.
+    mem_stats_t *mem_stats; ///< counters of allocations by subsystems, or NULL if they are not counted.
+
+    // errors
+    int error; ///< error code of the compilation.
+    char *errmsg; ///< message of the error.
+
+    // intern table
+    intern_table_t intern; ///< atoms of the compilation.
+    intern_table_t signatures; ///< interned signatures of functions.
+
+    // scanner
+    token_t prev; ///< previous token.
+    token_t curr; ///< current token.
+    pfile_t *source; ///< the program, spans of tokens point to its tape.
+    tokbuf_t *prelexed; ///< tokens lexed in advance by Scanner.prelex(), or NULL.
+    size_t prelexed_next; ///< index of the next token in prelexed.
+
+    // parser and expressions
+    pfile_t *pfile; ///< the program being parsed.
+    symstack_t *symstack; ///< a symbol stack with symbol tables for the program.
+    symtable_t *global_table; ///< global scope(the first one) with function declarations and definitions.
+    symtable_t *local_table; ///< a current table.
+    int nested_cycle_level; ///< depth of nested loops.
+    prec_stack_t prec_stack; ///< precedence stack of expressions.
+
+    // symstack
+    size_t unique_id; ///< id of the next scope.
+
+    // code generator
+    instrbuf_t *instrList; ///< list of instructions that is currently used.
+    instrbuf_t *tmp_instr; ///< instructions that are currently being generated.
+    instructions_t instructions; ///< info about generated code.
+    const ifj21_sink_t *sink; ///< output of the generated code.
+    bool stream_code; ///< code of finished functions and loops is written right away, see ifj21_options_t.
+    ifj21_emit_t emit; ///< comments written to the code.
+} context_t;
+
+
+/** Context of the compilation on this thread, NULL outside of a compilation.
+ */
+extern _Thread_local context_t *context;
+
+extern const struct context_interface_t Context;
+
+struct context_interface_t {
+    /** Create an empty context.
+     *
+     * @param sink output of the generated code.
+     * @return new context.
+     */
+    context_t *(*ctor)(const ifj21_sink_t *);
+
+    /** Make the context current on this thread.
+     *
+     * @param ctx context or NULL.
+     * @return the previous context.
+     */
+    context_t *(*enter)(context_t *);
+
+    /** Free the context with its arena. Modules free their own state at the end of the compilation.
+     *
+     * @param ctx
+     */
+    void (*dtor)(context_t *);
+
+    /** Allocate zeroed memory in the arena of the compilation on this thread,
+     *  or on the heap outside of a compilation.
+     *
+     * @param tag subsystem the memory is counted to, if the compilation counts allocations.
+     * @param size number of bytes.
+     * @return memory, it is never NULL.
+     */
+    void *(*alloc)(mem_tag_t, size_t);
+
+    /** Make memory from Context.alloc() bigger, new bytes are zeroed.
+     *
+     * @param tag subsystem of the allocation.
+     * @param ptr allocation of old_size bytes, or NULL.
+     * @param old_size
+     * @param new_size
+     * @return memory of new_size bytes with the first old_size bytes of ptr.
+     */
+    void *(*grow)(mem_tag_t, void *, size_t, size_t);
+
+    /** Free memory from Context.alloc(). Small blocks of a compilation are reused by its next allocations,
+     *  the rest is released with its arena.
+     *
+     * @param tag subsystem of the allocation.
+     * @param ptr
+     * @param size bytes of the allocation.
+     */
+    void (*free)(mem_tag_t, void *, size_t);
+};
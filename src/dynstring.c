@@ -9,11 +9,15 @@
 #include "dynstring.h"
 #include <stdlib.h>
 #include "errors.h"
+#include "context.h"
 #include <stdio.h>
 
 
 #define STRSIZE 42
 
+// strings shorter than SMALLSIZE are kept in the struct, which is 64 bytes on 64-bit targets.
+#define SMALLSIZE 38
+
 
 /**
  * A structure represented dynstring_t
@@ -21,34 +25,86 @@
 typedef struct dynstring {
     size_t size;    /**< Allocated len on heap. */
     size_t len;              /**< String length. */
-    char *str;              /**< String. */
+    char *str;              /**< String, it points to small if it fits there. */
+    bool in_arena;          /**< Allocated in the arena of a compilation, strings of prelexing threads are not. */
+    unsigned char tag;      /**< Subsystem the string is counted to, see mem_tag_t. */
+    char small[SMALLSIZE];  /**< Inline buffer of short strings. */
 } dynstring_t;
 
 /**
- * @brief Create a dynstring_t from a c_string, with len(@param str) + STRSIZE
+ * @brief Allocate a dynstring with a buffer of at least alloc characters,
+ *        in the arena of the compilation, or on the heap outside of a compilation.
+ *        Short strings use the inline buffer, so they need one allocation.
+ *
+ * @param tag subsystem the string is counted to.
+ * @param alloc size of the buffer.
+ * @return zeroed dynstring_t object.
+ */
+static dynstring_t *str_alloc(mem_tag_t tag, size_t alloc) {
+    dynstring_t *str = Context.alloc(tag, sizeof(dynstring_t));
+    str->in_arena = context != NULL;
+    str->tag = (unsigned char) tag;
+    if (alloc <= SMALLSIZE) {
+        str->size = SMALLSIZE;
+        str->str = str->small;
+    } else {
+        str->size = alloc;
+        str->str = Context.alloc(tag, alloc);
+    }
+    return str;
+}
+
+/**
+ * @brief Grow the buffer of a dynstring, the inline buffer is copied to a new one.
+ *
+ * @param str dynstring_t object.
+ * @param nsiz new size of the buffer.
+ */
+static void str_grow(dynstring_t *str, size_t nsiz) {
+    if (!str->in_arena) {
+        char *old = (str->str == str->small) ? NULL : str->str;
+        str->str = realloc(old, nsiz + sizeof(dynstring_t));
+        soft_assert(str->str, ERROR_INTERNAL);
+        if (old == NULL) {
+            memcpy(str->str, str->small, str->size);
+        }
+    } else if (str->str == str->small) {
+        str->str = Context.alloc(str->tag, nsiz);
+        memcpy(str->str, str->small, str->size);
+    } else {
+        str->str = Context.grow(str->tag, str->str, str->size, nsiz);
+    }
+}
+
+/**
+ * @brief Create a dynstring_t counted to a subsystem, see Str_ctor().
  *
- * @param s static c dynstring_t.
  * @param s Char that to convert to dynstring_t.
+ * @param tag subsystem the string is counted to.
  * @return pointer to the dynstring_t object.
  */
-static dynstring_t *Str_ctor(const char *s) {
+static dynstring_t *Str_ctor_tagged(const char *s, mem_tag_t tag) {
     soft_assert(s, ERROR_INTERNAL); // dont deal with NULLptr
 
     size_t length = strlen(s);
-    size_t alloc = length + STRSIZE + 1;
-
-    dynstring_t *str = calloc(1, sizeof(dynstring_t));
-    soft_assert(str, ERROR_INTERNAL);
-    str->size = alloc;
+    dynstring_t *str = str_alloc(tag, length < SMALLSIZE ? length + 1 : length + STRSIZE + 1);
     str->len = length;
 
-    str->str = calloc(1, alloc);
-    soft_assert(str->str, ERROR_INTERNAL);
-
-    strcpy(str->str, s);
+    memcpy(str->str, s, length);
     return str;
 }
 
+/**
+ * @brief Create a dynstring_t from a c_string, with len(@param str) + STRSIZE
+ *
+ * @param s static c dynstring_t.
+ * @param s Char that to convert to dynstring_t.
+ * @return pointer to the dynstring_t object.
+ */
+static dynstring_t *Str_ctor(const char *s) {
+    return Str_ctor_tagged(s, MEM_DYNSTRING);
+}
+
 /**
  * @brief Create an empty dynstring_t of size length.
  *
@@ -56,18 +112,9 @@ static dynstring_t *Str_ctor(const char *s) {
  * @return non-null pointer to dynstring_t object.
  */
 static dynstring_t *Str_ctor_empty(size_t length) {
-    size_t alloc = length + STRSIZE + 1;
-
-    dynstring_t *str = calloc(1, sizeof(dynstring_t));
-    soft_assert(str, ERROR_INTERNAL);
-    str->size = alloc;
+    dynstring_t *str = str_alloc(MEM_DYNSTRING, length < SMALLSIZE ? length + 1 : length + STRSIZE + 1);
     str->len = length;
 
-    str->str = calloc(1, alloc);
-    soft_assert(str->str, ERROR_INTERNAL);
-
-    memset(str->str, '\0', length);
-
     return str;
 }
 
@@ -114,8 +161,13 @@ static void Str_clear(dynstring_t *str) {
  */
 static void Str_free(dynstring_t *str) {
 
-    if (str != NULL) {
-        if (str->str != NULL) {
+    if (str != NULL && str->in_arena) {
+        if (str->str != str->small) {
+            Context.free(str->tag, str->str, str->size);
+        }
+        Context.free(str->tag, str, sizeof(dynstring_t));
+    } else if (str != NULL) {
+        if (str->str != str->small) {
             free(str->str);
         }
         free(str);
@@ -133,15 +185,38 @@ static void Str_append(dynstring_t *str, char ch) {
     soft_assert(str->str != NULL, ERROR_INTERNAL);
 
     if (str->len + 1 >= str->size) {
-        size_t nsiz = str->size *= 2;
-        char *tmp = realloc(str->str, nsiz + sizeof(dynstring_t));
-        soft_assert(tmp, ERROR_INTERNAL);
-        str->str = tmp;
+        size_t nsiz = str->size * 2;
+        str_grow(str, nsiz);
+        str->size = nsiz;
     }
     str->str[str->len++] = ch;
     str->str[str->len] = '\0';
 }
 
+/**
+ * @brief Appends n characters.
+ *
+ * @param str dynstring_t heap structure.
+ * @param s characters to append, can contain '\0'.
+ * @param n number of characters.
+ */
+static void Str_append_n(dynstring_t *str, const char *s, size_t n) {
+    soft_assert(str != NULL, ERROR_INTERNAL);
+    soft_assert(str->str != NULL, ERROR_INTERNAL);
+
+    if (str->len + n >= str->size) {
+        size_t nsiz = str->size;
+        while (str->len + n >= nsiz) {
+            nsiz *= 2;
+        }
+        str_grow(str, nsiz);
+        str->size = nsiz;
+    }
+    memcpy(str->str + str->len, s, n);
+    str->len += n;
+    str->str[str->len] = '\0';
+}
+
 /**
  * @brief Compare dynstring_t and char* using strcmp.
  *
@@ -173,13 +248,15 @@ static void Str_cat(dynstring_t *s1, dynstring_t *s2) {
 
     bool needs_realloc = s1->size <= s1->len + s2->len;
     if (needs_realloc) {
+        str_grow(s1, s1->size + s2->size);
         s1->size += s2->size;
-        s1->str = realloc(s1->str, s1->size + sizeof(dynstring_t));
-        soft_assert(s1->str, ERROR_INTERNAL);
     }
 
-    strcat(s1->str, s2->str);
-    s1->len = strlen(s1->str);
+    // as strcat(), but s1 and s2 may be the same string.
+    size_t at = strlen(s1->str);
+    size_t n = strlen(s2->str);
+    memmove(s1->str + at, s2->str, n + 1);
+    s1->len = at + n;
 }
 
 static void Trunc_to_len(dynstring_t *self, size_t new_len) {
@@ -190,7 +267,7 @@ static void Trunc_to_len(dynstring_t *self, size_t new_len) {
 }
 
 /**
- * @brief Duplicates a dynstring.
+ * @brief Duplicates a dynstring, the copy is counted to the same subsystem.
  *
  * @param s dynstring to be duplicated.
  * @return pointer to the new dynstring_t object.
@@ -201,7 +278,7 @@ static dynstring_t *Str_dup(dynstring_t *s) {
     }
     soft_assert(s->str != NULL, ERROR_INTERNAL);
 
-    return Str_ctor(s->str);
+    return Str_ctor_tagged(s->str, (mem_tag_t) s->tag);
 }
 
 static int Cmp_c_str(dynstring_t *s1, char *s2) {
@@ -220,9 +297,11 @@ const struct dynstring_interface_t Dynstring = {
         /*@{*/
         .ctor = Str_ctor,
         .ctor_empty = Str_ctor_empty,
+        .ctor_tagged = Str_ctor_tagged,
         .len = Str_length,
         .c_str = Str_c_str,
         .append = Str_append,
+        .append_n = Str_append_n,
         .dtor = Str_free,
         .cmp = Str_cmp,
         .cat = Str_cat,
@@ -233,42 +312,137 @@ const struct dynstring_interface_t Dynstring = {
 };
 
 #ifdef SELFTEST_dynstring
-#include "tests/tests.h"
-int main() {
-    fprintf(stderr, "Selftests: %s\n", __FILE__);
-    dynstring_t *string1 = Dynstring.ctor("");
-    dynstring_t *string2 = Dynstring.ctor("hello");
-    dynstring_t *string3 = Dynstring.ctor("cat");
-
-    Dynstring.cat(string1, string2);
-    Dynstring.clear(string1);
-
-    printf("string1 = '%s'. Must be empty\n", Dynstring.c_str(string1));
-    Dynstring.clear(string1);
-    Dynstring.clear(string2);
-
-
-    Dynstring.cat(string2, string3);
-    Dynstring.cat(string1, string2);
-
-    printf("string1 = '%s'. Must be cat\n", Dynstring.c_str(string1));
-    Dynstring.clear(string1);
-    Dynstring.clear(string2);
-
-
-    Dynstring.cat(string1, string3);
-    Dynstring.cat(string1, string1);
+#include "compiler.h"
+#include "parser.h"
+#include "code_generator.h"
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "FAILED: %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        failed = 1; \
+    } \
+} while (0)
+
+static void write_nothing(void *data, const char *s, size_t len) {
+    (void) data, (void) s, (void) len;
+}
 
-    printf("string1 = '%s'. Must be catcat\n", Dynstring.c_str(string1));
+/** Memory of compilations of programs.
+ */
+typedef struct line_stats {
+    size_t lines; ///< lines of the programs.
+    size_t allocations; ///< allocations in arenas.
+    size_t bytes; ///< bytes of allocations in arenas.
+} line_stats_t;
 
+/** Compile a program as ifj21_compile_file() does and add memory its arena allocated to stats.
+ */
+static void compile_counting(const char *file, line_stats_t *stats) {
+    static const ifj21_sink_t sink = {.write = write_nothing};
+    pfile_t *pfile = Pfile.getfile(file);
+    soft_assert(pfile != NULL, ERROR_INTERNAL);
+
+    const char *tape = Pfile.get_tape(pfile);
+    for (size_t i = 0; i < Pfile.available(pfile); i++) {
+        stats->lines += tape[i] == '\n';
+    }
 
-    Dynstring.trunc_to_len(string1, 0);
-    printf("string1 = '%s'. Must be catcat\n", Dynstring.c_str(string1));
+    context_t *ctx = Context.ctor(&sink);
+    context_t *outer = Context.enter(ctx);
+    Generator.initialise();
+    if (Parser.analyse(pfile, 0)) {
+        Generator.print_instr_list(LIST_INSTR_START);
+        Generator.print_instr_list(LIST_INSTR_FUNC);
+        Generator.print_instr_list(LIST_INSTR_MAIN);
+    }
+    Generator.dtor();
+    stats->allocations += ctx->arena.allocations + ctx->arena.reused;
+    stats->bytes += ctx->arena.used;
+    Context.enter(outer);
+    Context.dtor(ctx);
+    Pfile.dtor(pfile);
+}
 
-    Dynstring.dtor(string1);
-    Dynstring.dtor(string2);
-    Dynstring.dtor(string3);
+/** Usage: dynstring_selftest [files...]
+ *  Operations on dynstrings on the heap and in an arena,
+ *  then allocations per line of compilations of the files.
+ */
+int main(int argc, char **argv) {
+    fprintf(stderr, "Selftests: %s\n", __FILE__);
+    int failed = 0;
+
+    for (int in_arena = 0; in_arena <= 1; in_arena++) {
+        context_t *ctx = in_arena ? Context.ctor(NULL) : NULL;
+        context_t *outer = Context.enter(ctx);
+
+        dynstring_t *string1 = Dynstring.ctor("");
+        dynstring_t *string2 = Dynstring.ctor("hello");
+        dynstring_t *string3 = Dynstring.ctor("cat");
+
+        Dynstring.cat(string1, string2);
+        CHECK(Dynstring.cmp_c_str(string1, "hello") == 0);
+        Dynstring.clear(string1);
+        CHECK(Dynstring.cmp_c_str(string1, "") == 0);
+        Dynstring.clear(string2);
+
+        Dynstring.cat(string2, string3);
+        Dynstring.cat(string1, string2);
+        CHECK(Dynstring.cmp_c_str(string1, "cat") == 0);
+        Dynstring.clear(string1);
+        Dynstring.clear(string2);
+
+        Dynstring.cat(string1, string3);
+        Dynstring.cat(string1, string1);
+        CHECK(Dynstring.cmp_c_str(string1, "catcat") == 0);
+        CHECK(Dynstring.len(string1) == 6);
+
+        Dynstring.trunc_to_len(string1, 0);
+        CHECK(Dynstring.cmp_c_str(string1, "") == 0);
+
+        // short strings growing past any inline buffer.
+        char expected[1001] = {0};
+        for (int i = 0; i < 1000; i++) {
+            expected[i] = (char) ('a' + i % 26);
+            Dynstring.append(string2, expected[i]);
+            if (i % 100 == 0) {
+                Dynstring.append_n(string3, expected, (size_t) i);
+                Dynstring.trunc_to_len(string3, 0);
+            }
+        }
+        CHECK(Dynstring.cmp_c_str(string2, expected) == 0);
+        Dynstring.cat(string1, string2);
+        Dynstring.cat(string1, string2);
+        CHECK(Dynstring.len(string1) == 2000);
+        CHECK(strncmp(Dynstring.c_str(string1) + 1000, expected, 1000) == 0);
+
+        dynstring_t *dup = Dynstring.dup(string2);
+        CHECK(Dynstring.cmp(dup, string2) == 0);
+        dynstring_t *empty = Dynstring.ctor_empty(100);
+        CHECK(Dynstring.len(empty) == 100 && Dynstring.c_str(empty)[99] == '\0');
+
+        Dynstring.dtor(empty);
+        Dynstring.dtor(dup);
+        Dynstring.dtor(string1);
+        Dynstring.dtor(string2);
+        Dynstring.dtor(string3);
+
+        Context.enter(outer);
+        if (ctx != NULL) {
+            Context.dtor(ctx);
+        }
+    }
+    printf("dynstring operations: %s\n", failed ? "FAILED" : "OK");
 
-    return 0;
+    if (argc > 1) {
+        line_stats_t stats = {0};
+        for (int i = 1; i < argc; i++) {
+            compile_counting(argv[i], &stats);
+        }
+        printf("%d programs, %zu lines: %.2f allocations, %.1f bytes per line\n",
+               argc - 1, stats.lines,
+               (double) stats.allocations / (double) (stats.lines ? stats.lines : 1),
+               (double) stats.bytes / (double) (stats.lines ? stats.lines : 1));
+    }
+    return failed;
 }
 #endif
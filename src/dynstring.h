@@ -12,6 +12,7 @@
 #include <string.h>
 #include "errors.h"
 #include "debug.h" // debug macros
+#include "memstats.h"
 
 
 typedef struct dynstring dynstring_t;
@@ -38,6 +39,15 @@ struct dynstring_interface_t {
      */
     dynstring_t *(*ctor_empty)(size_t);
 
+    /**
+     * @brief Create a dynstring_t counted to a subsystem if the compilation counts allocations.
+     *
+     * @param s Char that we want to convert to dynstring_t.
+     * @param tag subsystem, dynstrings made by other constructors are MEM_DYNSTRING.
+     * @return non-null pointer to dynstring_t object.
+     */
+    dynstring_t *(*ctor_tagged)(const char *, mem_tag_t);
+
     /**
      * @brief Appends a character shrunk.
      *
@@ -46,6 +56,15 @@ struct dynstring_interface_t {
      */
     void (*append)(dynstring_t *, char);
 
+    /**
+     * @brief Appends n characters.
+     *
+     * @param str dynstring_t heap structure.
+     * @param s characters to append, can contain '\0'.
+     * @param n number of characters.
+     */
+    void (*append_n)(dynstring_t *, const char *, size_t);
+
     /**
      * @brief Compares two dynstrings.
      *
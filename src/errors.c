@@ -7,16 +7,24 @@
  */
 #include "errors.h"
 #include "debug.h"
+#include "context.h"
 
-static int error = 0;
-static char *errmsg = "";
+/** Errors outside of a compilation, e.g. when a file cannot be read.
+ */
+static _Thread_local context_t outside = {.errmsg = ""};
+
+/** Context, which holds the error.
+ */
+static inline context_t *current() {
+    return context ? context : &outside;
+}
 
 /** Error getter.
  *
  * @return return errorcode defined in error.h, which has been set or 0.
  */
 static int Get_error() {
-    return error;
+    return current()->error;
 }
 
 /** Error setter.
@@ -24,6 +32,8 @@ static int Get_error() {
  * @param errcode Errors codes are defined in errors.h.
  */
 static void Set_error(int errcode) {
+    char *errmsg = current()->errmsg;
+
     if (errcode != ERROR_NOERROR) {
         debug_msg("\n#######################################################\n"
                   "################ Error will be set NOW! ###############\n"
@@ -88,11 +98,12 @@ static void Set_error(int errcode) {
         (void) (2 + 2 == 5);
     }
 
-    error = errcode;
+    current()->error = errcode;
+    current()->errmsg = errmsg;
 }
 
 static char *Get_error_msg() {
-    return errmsg;
+    return current()->errmsg;
 }
 
 /** Functions are in struct so we can use them in different files.
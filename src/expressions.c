@@ -11,10 +11,12 @@
 #include "expressions.h"
 #include "parser.h"
 #include "symtable.h"
-#include "stack.h"
 #include "code_generator.h"
+#include "context.h"
 
-static pfile_t *pfile;
+
+// initial capacity of the precedence stack.
+#define PREC_STACK_SIZE 64
 
 /**
  * @brief Safely peek item from top of the stack.
@@ -22,31 +24,53 @@ static pfile_t *pfile;
  * @param stack
  * @param item
  */
-#define STACK_ITEM_PEEK(stack, item)          \
-    do {                                      \
-        (item) = Stack.peek((stack));         \
-        if ((item) == NULL) {                 \
-            Errors.set_error(ERROR_INTERNAL); \
-            goto err;                         \
-        }                                     \
+#define STACK_ITEM_PEEK(stack, item)                    \
+    do {                                                \
+        if ((stack)->len == 0) {                        \
+            Errors.set_error(ERROR_INTERNAL);           \
+            goto err;                                   \
+        }                                               \
+        (item) = &(stack)->items[(stack)->len - 1];     \
     } while (0)
 
 /**
- * @brief Peek expression if it is in top of the stack.
+ * @brief Peek expression if it is in top of the stack, it stays on the stack.
  *
  * @param stack
- * @param item
+ * @param item set to the expression if there is one.
  */
 #define STACK_ITEM_PEEK_EXPR(stack, item)               \
     do {                                                \
         stack_item_t *tmp;                              \
         STACK_ITEM_PEEK((stack), tmp);                  \
         if (tmp->type == ITEM_TYPE_EXPR) {              \
-            (item) = stack_item_copy(tmp);              \
-            Stack.pop((stack), stack_item_dtor);        \
+            (item) = tmp;                               \
         }                                               \
     } while (0)
 
+/**
+ * @brief Safely peek the next item of a handle.
+ *
+ * @param handle
+ * @param item
+ */
+#define HANDLE_ITEM_PEEK(handle, item)                  \
+    do {                                                \
+        if ((handle)->next == (handle)->end) {          \
+            Errors.set_error(ERROR_INTERNAL);           \
+            goto err;                                   \
+        }                                               \
+        (item) = (handle)->next;                        \
+    } while (0)
+
+/**
+ * Items of a handle (rule) on the precedence stack, they are checked from the first one.
+ */
+typedef struct handle {
+    stack_item_t *next; ///< the next item to check.
+    stack_item_t *end; ///< the end of the handle.
+} handle_t;
+
 /**
  * @brief Checks if identifier is defined.
  *
@@ -54,39 +78,27 @@ static pfile_t *pfile;
  */
 #define CHECK_DEFINITION(id_name)                                       \
     do {                                                                \
-        if (!Symstack.get_local_symbol(symstack, (id_name), NULL)) {    \
+        if (!Symstack.get_local_symbol(context->symstack, (id_name), NULL)) {    \
             Errors.set_error(ERROR_DEFINITION);                         \
             goto err;                                                   \
         }                                                               \
     } while (0)
 
 /**
- * @brief Get function params and returns (types).
+ * @brief Get semantics of a function.
  *
  * @param id_name name of the function.
- * @param func_params is a vector for params.
- * @param func_returns is a vector for returns.
+ * @param func variable to store the function semantics.
  */
-#define GET_FUNCTION_SIGNATURES(id_name, func_params, func_returns)                         \
-    do {                                                                                    \
-        symbol_t *sym;                                                                      \
-                                                                                            \
-        if (!Symtable.get_symbol(global_table, id_name, &sym)) {                            \
-            Errors.set_error(ERROR_DEFINITION);                                             \
-            goto err;                                                                       \
-        }                                                                                   \
-                                                                                            \
-        if ((func_params) != NULL) {                                                        \
-            Dynstring.cat((func_params), Semantics.is_defined(sym->function_semantics) ?    \
-                                    sym->function_semantics->definition.params :            \
-                                    sym->function_semantics->declaration.params);           \
-        }                                                                                   \
-                                                                                            \
-        if ((func_returns) != NULL) {                                                       \
-            Dynstring.cat((func_returns), Semantics.is_defined(sym->function_semantics) ?   \
-                                    sym->function_semantics->definition.returns :           \
-                                    sym->function_semantics->declaration.returns);          \
-        }                                                                                   \
+#define GET_FUNCTION_SEMANTICS(id_name, func)                                       \
+    do {                                                                            \
+        symbol_t *sym;                                                              \
+                                                                                    \
+        if (!Symtable.get_symbol(context->global_table, id_name, &sym)) {           \
+            Errors.set_error(ERROR_DEFINITION);                                     \
+            goto err;                                                               \
+        }                                                                           \
+        (func) = sym->function_semantics;                                           \
     } while(0)
 
 /**
@@ -119,14 +131,23 @@ static pfile_t *pfile;
         }                                                           \
     } while(0)
 
+/**
+ * @brief Atoms are owned by the intern table, a list of identifiers does not free them.
+ *
+ * @param atom
+ */
+static void atom_dtor(void *atom) {
+    (void) atom;
+}
+
 /**
  * @brief Checks if identifier is a function.
  *
  * @param id_name identifier name.
  * @return bool.
  */
-static inline bool is_a_function(dynstring_t *id_name) {
-    return Symtable.get_symbol(global_table, id_name, NULL);
+static inline bool is_a_function(const atom_t *id_name) {
+    return Symtable.get_symbol(context->global_table, id_name, NULL);
 }
 
 /**
@@ -135,8 +156,8 @@ static inline bool is_a_function(dynstring_t *id_name) {
  * @param id_name identifier name.
  * @return bool.
  */
-static inline bool is_a_variable(dynstring_t *id_name) {
-    return Symstack.get_local_symbol(symstack, id_name, NULL);
+static inline bool is_a_variable(const atom_t *id_name) {
+    return Symstack.get_local_symbol(context->symstack, id_name, NULL);
 }
 
 /**
@@ -296,6 +317,8 @@ static char *stack_item_to_string(item_type_t item_type) {
             return "<";
         case ITEM_TYPE_DOLLAR:
             return "$";
+        case ITEM_TYPE_PAREN:
+            return "(";
         default:
             return "unrecognized stack item";
     }
@@ -328,92 +351,94 @@ static bool is_binary_op(op_list_t op) {
 }
 
 /**
- * @brief Set token for new created/copied item.
+ * @brief Item is the bottom of an expression, $ or ( of an expression in parentheses.
  *
  * @param item
- * @param tok token to set (can be NULL).
+ * @return bool.
  */
-static void stack_item_set_token(stack_item_t *item, token_t *tok) {
-    if (tok == NULL || item == NULL) {
-        goto noerr;
-    }
-
-    item->token = *tok;
-
-    if (item->type != ITEM_TYPE_TOKEN) {
-        goto noerr;
-    }
-
-    if (tok->type == TOKEN_ID) {
-        item->token.attribute.id = Dynstring.dup(tok->attribute.id);
-    }
-
-    noerr:;
+static bool is_bottom(const stack_item_t *item) {
+    return item->type == ITEM_TYPE_DOLLAR || item->type == ITEM_TYPE_PAREN;
 }
 
 /**
- * @brief Create stack item.
+ * @brief Push an item to the stack.
  *
+ * @param stack
  * @param type stack item type.
- * @param tok token to set (can be NULL).
- * @return new stack item.
+ * @return new item on top of the stack, it is valid until the next push.
  */
-static stack_item_t *stack_item_ctor(item_type_t type, token_t *tok) {
-    stack_item_t *new_item = calloc(1, sizeof(stack_item_t));
-    soft_assert(new_item, ERROR_INTERNAL);
-
-    new_item->type = type;
-    new_item->expression_type = Dynstring.ctor("");
-    stack_item_set_token(new_item, tok);
-
-    return new_item;
+static stack_item_t *stack_push(prec_stack_t *stack, item_type_t type) {
+    if (stack->len == stack->cap) {
+        size_t cap = (stack->cap) ? stack->cap * 2 : PREC_STACK_SIZE;
+        stack->items = Context.grow(MEM_EXPRESSIONS, stack->items,
+                                    stack->cap * sizeof(stack_item_t), cap * sizeof(stack_item_t));
+        stack->cap = cap;
+    }
+
+    stack_item_t *item = &stack->items[stack->len++];
+    item->type = type;
+    item->expression_type = NULL;
+    return item;
 }
 
 /**
- * @brief Copy stack item.
+ * @brief Push a token from the scanner, the span of a string is materialized.
  *
- * @param item
- * @return new stack item.
+ * @param stack
+ * @param tok
  */
-static stack_item_t *stack_item_copy(stack_item_t *item) {
-    if (item == NULL) {
-        return NULL;
+static void stack_push_token(prec_stack_t *stack, token_t *tok) {
+    stack_item_t *item = stack_push(stack, ITEM_TYPE_TOKEN);
+    item->token = *tok;
+    if (tok->type == TOKEN_STR) {
+        item->token.attribute.id = Scanner.materialize(tok);
     }
-
-    stack_item_t *new_item = calloc(1, sizeof(stack_item_t));
-    soft_assert(new_item, ERROR_INTERNAL);
-
-    new_item->type = item->type;
-    new_item->expression_type = Dynstring.dup(item->expression_type);
-    stack_item_set_token(new_item, &(item->token));
-
-    return new_item;
 }
 
 /**
- * @brief Delete stack item.
+ * @brief Push an expression.
  *
- * @param item
+ * @param stack
+ * @param expression_type interned signature of the expression.
  */
-static void stack_item_dtor(void *item) {
-    if (item == NULL) {
-        return;
-    }
-
-    stack_item_t *s_item = (stack_item_t *) item;
-
-    Dynstring.dtor(s_item->expression_type);
+static void stack_push_expr(prec_stack_t *stack, const atom_t *expression_type) {
+    stack_push(stack, ITEM_TYPE_EXPR)->expression_type = expression_type;
+}
 
-    if (s_item->type != ITEM_TYPE_TOKEN) {
-        goto noerr;
+/**
+ * @brief Pop items until the stack has len items.
+ *
+ * @param stack
+ * @param len
+ */
+static void stack_pop_to(prec_stack_t *stack, size_t len) {
+    while (stack->len > len) {
+        stack_item_t *item = &stack->items[--stack->len];
+        if (item->type == ITEM_TYPE_TOKEN && item->token.type == TOKEN_STR) {
+            Dynstring.dtor(item->token.attribute.id);
+        }
     }
+}
 
-    if (s_item->token.type == TOKEN_ID) {
-        Dynstring.dtor(s_item->token.attribute.id);
-    }
+/**
+ * @brief Signature of an expression with one value.
+ *
+ * @param type
+ * @return interned signature.
+ */
+static const atom_t *single_type(expr_type_t type) {
+    char type_code = Semantics.of_expr_type(type);
+    return Intern.signature(&type_code, 1);
+}
 
-    noerr:
-    free(s_item);
+/**
+ * @brief Signature of an expression is empty.
+ *
+ * @param expression_type
+ * @return bool.
+ */
+static bool is_empty_signature(const atom_t *expression_type) {
+    return Dynstring.len(expression_type->name) == 0;
 }
 
 /**
@@ -455,28 +480,26 @@ static bool precedence_cmp(op_list_t first_op, op_list_t second_op, int *cmp) {
  * @brief Shift current token to the stack.
  *
  * @param stack stack to compare precedence and analyze an expression.
- * @param expr expression on top of the stack.
+ * @param expr_on_top there is an expression on top of the stack.
  * @param cmp comparison result.
  * @return bool.
  */
-static bool shift(sstack_t *stack, stack_item_t *expr, int const cmp) {
-    debug_msg("SHIFT ->\n");
-
+static bool shift(prec_stack_t *stack, bool expr_on_top, int const cmp) {
     token_t tok;
 
-    // If first_op has a lower precedence, then push less than symbol
+    // If first_op has a lower precedence, then push less than symbol under the expression
     if (cmp < 0) {
-        Stack.push(stack, stack_item_ctor(ITEM_TYPE_LT, NULL));
-    }
-
-    // Push expression if exists
-    if (expr != NULL) {
-        Stack.push(stack, stack_item_copy(expr));
+        stack_push(stack, ITEM_TYPE_LT);
+        if (expr_on_top) {
+            stack_item_t lt = stack->items[stack->len - 1];
+            stack->items[stack->len - 1] = stack->items[stack->len - 2];
+            stack->items[stack->len - 2] = lt;
+        }
     }
 
     // Push token from the input
     tok = Scanner.get_curr_token();
-    Stack.push(stack, stack_item_ctor(ITEM_TYPE_TOKEN, &tok));
+    stack_push_token(stack, &tok);
 
     // Get next token
     EXPECTED(tok.type);
@@ -489,17 +512,15 @@ static bool shift(sstack_t *stack, stack_item_t *expr, int const cmp) {
 /**
  * @brief Check binary operator.
  *
- * @param r_stack stack with handle (rule).
+ * @param handle items of the handle (rule), the operator is taken from its beginning.
  * @param result_op variable to set operator.
  * @return bool.
  */
-static bool binary_op(sstack_t *r_stack, op_list_t *result_op) {
-    debug_msg("binary_op ->\n");
-
+static bool binary_op(handle_t *handle, op_list_t *result_op) {
     stack_item_t *item;
     op_list_t op;
 
-    STACK_ITEM_PEEK(r_stack, item);
+    HANDLE_ITEM_PEEK(handle, item);
 
     if (item->type != ITEM_TYPE_TOKEN) {
         goto err;
@@ -511,7 +532,7 @@ static bool binary_op(sstack_t *r_stack, op_list_t *result_op) {
     }
 
     *result_op = op;
-    Stack.pop(r_stack, stack_item_dtor);
+    handle->next++;
     return true;
     err:
     Errors.set_error(ERROR_SYNTAX);
@@ -521,17 +542,15 @@ static bool binary_op(sstack_t *r_stack, op_list_t *result_op) {
 /**
  * @brief Check unary operator.
  *
- * @param r_stack stack with handle (rule).
+ * @param handle items of the handle (rule).
  * @param result_op variable to set operator.
  * @return bool.
  */
-static bool unary_op(sstack_t *r_stack, op_list_t *result_op) {
-    debug_msg("unary_op ->\n");
-
+static bool unary_op(handle_t *handle, op_list_t *result_op) {
     stack_item_t *item;
     op_list_t op;
 
-    STACK_ITEM_PEEK(r_stack, item);
+    HANDLE_ITEM_PEEK(handle, item);
 
     if (item->type != ITEM_TYPE_TOKEN) {
         goto err;
@@ -549,7 +568,7 @@ static bool unary_op(sstack_t *r_stack, op_list_t *result_op) {
 
     noerr:
     *result_op = op;
-    Stack.pop(r_stack, stack_item_dtor);
+    handle->next++;
     return true;
     err:
     Errors.set_error(ERROR_SYNTAX);
@@ -559,22 +578,21 @@ static bool unary_op(sstack_t *r_stack, op_list_t *result_op) {
 /**
  * @brief Check expression.
  *
- * @param r_stack stack with handle (rule).
- * @param type initialized vector to store an expression type.
+ * @param handle items of the handle (rule).
+ * @param type variable to store an expression type.
  * @return bool.
  */
-static bool expr(sstack_t *r_stack, dynstring_t *type) {
-    debug_msg("expr ->\n");
-
+static bool expr(handle_t *handle, expr_type_t *type) {
     stack_item_t *item;
-    STACK_ITEM_PEEK(r_stack, item);
+    HANDLE_ITEM_PEEK(handle, item);
 
     if (item->type != ITEM_TYPE_EXPR) {
         goto err;
     }
 
-    Dynstring.cat(type, item->expression_type);
-    Stack.pop(r_stack, stack_item_dtor);
+    // operands are truncated to one type before they are reduced.
+    *type = Semantics.expr_type(Dynstring.c_str(item->expression_type->name)[0]);
+    handle->next++;
     return true;
     err:
     Errors.set_error(ERROR_SYNTAX);
@@ -588,39 +606,36 @@ static bool expr(sstack_t *r_stack, dynstring_t *type) {
  * !rule expr -> unary_op expr
  * !rule expr -> id
  *
- * @param r_stack stack with handle (rule).
- * @param expression_type initialized vector to store an expression type.
+ * @param handle items of the handle (rule).
+ * @param result_type variable to store the type of the expression.
  * @return bool.
  */
-static bool check_rule(sstack_t *r_stack, dynstring_t *expression_type) {
-    debug_msg("check_rule ->\n");
-
+static bool check_rule(handle_t *handle, expr_type_t *result_type) {
     stack_item_t *item;
-    dynstring_t *first_type = Dynstring.ctor("");
-    dynstring_t *second_type = Dynstring.ctor("");
+    expr_type_t first_type, second_type;
     op_list_t op;
     type_recast_t r_type = NO_RECAST;
 
-    STACK_ITEM_PEEK(r_stack, item);
+    HANDLE_ITEM_PEEK(handle, item);
 
     // expr binary_op expr
     if (item->type == ITEM_TYPE_EXPR) {
         // expr
-        if (!expr(r_stack, first_type)) {
+        if (!expr(handle, &first_type)) {
             goto err;
         }
 
         // binary_op
-        if (!binary_op(r_stack, &op)) {
+        if (!binary_op(handle, &op)) {
             goto err;
         }
 
         // expr
-        if (!expr(r_stack, second_type)) {
+        if (!expr(handle, &second_type)) {
             goto err;
         }
 
-        if (!Semantics.check_binary_compatibility(first_type, second_type, op, expression_type, &r_type)) {
+        if (!Semantics.check_binary_compatibility(first_type, second_type, op, result_type, &r_type)) {
             goto err;
         }
 
@@ -636,16 +651,16 @@ static bool check_rule(sstack_t *r_stack, dynstring_t *expression_type) {
         case OP_NOT:
         case OP_MINUS_UNARY:
             // unary_op
-            if (!unary_op(r_stack, &op)) {
+            if (!unary_op(handle, &op)) {
                 goto err;
             }
 
             // expr
-            if (!expr(r_stack, first_type)) {
+            if (!expr(handle, &first_type)) {
                 goto err;
             }
 
-            if (!Semantics.check_unary_compatibility(first_type, op, expression_type)) {
+            if (!Semantics.check_unary_compatibility(first_type, op, result_type)) {
                 goto err;
             }
 
@@ -656,14 +671,14 @@ static bool check_rule(sstack_t *r_stack, dynstring_t *expression_type) {
 
         // id
         case OP_ID:
-            if (!Semantics.check_operand(item->token, expression_type)) {
+            if (!Semantics.check_operand(item->token, result_type)) {
                 goto err;
             }
 
             // generate code for operand
             Generator.expression_operand(item->token);
 
-            Stack.pop(r_stack, stack_item_dtor);
+            handle->next++;
             goto noerr;
 
         default:
@@ -671,12 +686,8 @@ static bool check_rule(sstack_t *r_stack, dynstring_t *expression_type) {
     }
 
     noerr:
-    Dynstring.dtor(first_type);
-    Dynstring.dtor(second_type);
     return true;
     err:
-    Dynstring.dtor(first_type);
-    Dynstring.dtor(second_type);
     return false;
 }
 
@@ -684,58 +695,42 @@ static bool check_rule(sstack_t *r_stack, dynstring_t *expression_type) {
  * @brief Reduce expression.
  *
  * @param stack stack to compare precedence and analyze an expression.
- * @param expr expression on top of the stack.
  * @return bool.
  */
-static bool reduce(sstack_t *stack, stack_item_t *expr) {
-    debug_msg("REDUCE ->\n");
-
-    stack_item_t *top;
-    sstack_t *r_stack = NULL;
-    stack_item_t *new_expr = stack_item_ctor(ITEM_TYPE_EXPR, NULL);
+static bool reduce(prec_stack_t *stack) {
+    expr_type_t result_type;
+    size_t start = stack->len;
 
-    // Push expression if exists
-    if (expr != NULL) {
-        Stack.push(stack, stack_item_copy(expr));
+    // The handle is above the less than symbol, $ or (
+    while (start > 0 && stack->items[start - 1].type != ITEM_TYPE_LT && !is_bottom(&stack->items[start - 1])) {
+        start--;
     }
-
-    // Peek item from top of the stack
-    STACK_ITEM_PEEK(stack, top);
-
-    // Reduce rule
-    r_stack = Stack.ctor();
-    while (top->type != ITEM_TYPE_LT && top->type != ITEM_TYPE_DOLLAR) {
-        Stack.push(r_stack, stack_item_copy(top));
-        Stack.pop(stack, stack_item_dtor);
-        STACK_ITEM_PEEK(stack, top);
+    if (start == 0) {
+        Errors.set_error(ERROR_INTERNAL);
+        goto err;
     }
 
+    handle_t handle = {.next = &stack->items[start], .end = &stack->items[stack->len]};
+
     /**
-     * | check_rule | stack     | state  |
+     * | check_rule | handle    | state  |
      * | true       | empty     | ok     |
      * | true       | not empty | not ok |
      * | false      | empty     | not ok |
      * | false      | not empty | not ok |
      */
-    if (!check_rule(r_stack, new_expr->expression_type) || !Stack.is_empty(r_stack)) {
+    if (!check_rule(&handle, &result_type) || handle.next != handle.end) {
         debug_msg("Reduction error!\n");
         goto err;
     }
 
-    // Delete less than symbol
-    if (top->type == ITEM_TYPE_LT) {
-        Stack.pop(stack, stack_item_dtor);
-    }
+    // Delete the handle with less than symbol
+    stack_pop_to(stack, (stack->items[start - 1].type == ITEM_TYPE_LT) ? start - 1 : start);
 
     // Push an expression
-    Stack.push(stack, stack_item_copy(new_expr));
-
-    Stack.dtor(r_stack, stack_item_dtor);
-    stack_item_dtor(new_expr);
+    stack_push_expr(stack, single_type(result_type));
     return true;
     err:
-    Stack.dtor(r_stack, stack_item_dtor);
-    stack_item_dtor(new_expr);
     return false;
 }
 
@@ -743,14 +738,16 @@ static bool reduce(sstack_t *stack, stack_item_t *expr) {
  * @brief Check an expression end.
  *
  * @param first_op first operator.
+ * @param next type of the current token.
  * @param function_parsed true if function was parsed.
  * @param parents_parsed true if parents were parsed.
  * @return bool.
  */
 static bool expression_end(op_list_t first_op,
+                           token_type_t next,
                            bool function_parsed,
                            bool parents_parsed) {
-    bool is_token_id = (Scanner.get_curr_token().type == TOKEN_ID);
+    bool is_token_id = (next == TOKEN_ID);
     return  (first_op == OP_ID && is_token_id) ||
             (function_parsed && is_token_id) ||
             (parents_parsed && is_token_id);
@@ -795,10 +792,10 @@ static void check_unary_minus(op_list_t first_op, op_list_t *second_op, stack_it
 /** Function call declaration for parse_function.
  *
  * @param id_name function identifier name.
- * @param function_returns is an initialized empty vector.
+ * @param function_returns variable to store the interned signature of return values, or NULL.
  * @return bool.
  */
-static bool func_call(dynstring_t *, dynstring_t *);
+static bool func_call(const atom_t *, const atom_t **);
 
 /**
  * @brief Parse function if identifier is in global scope.
@@ -807,12 +804,10 @@ static bool func_call(dynstring_t *, dynstring_t *);
  * @param function_parsed true if function was parsed.
  * @return int.
  */
-static bool parse_function(sstack_t *stack, bool *function_parsed) {
-    debug_msg("parse_function\n");
-
+static bool parse_function(prec_stack_t *stack, bool *function_parsed) {
     stack_item_t *top;
-    dynstring_t *id_name = NULL;
-    stack_item_t *new_expr = stack_item_ctor(ITEM_TYPE_EXPR, NULL);
+    const atom_t *id_name = NULL;
+    const atom_t *function_returns = NULL;
 
     if (Scanner.get_curr_token().type != TOKEN_ID) {
         goto noerr;
@@ -841,252 +836,238 @@ static bool parse_function(sstack_t *stack, bool *function_parsed) {
     EXPECTED(TOKEN_ID);
 
     // [func_call]
-    if (!func_call(id_name, new_expr->expression_type)) {
+    if (!func_call(id_name, &function_returns)) {
         goto err;
     }
 
     *function_parsed = true;
 
     // Push an expression
-    Stack.push(stack, stack_item_copy(new_expr));
+    stack_push_expr(stack, function_returns);
 
     // generate get return values assigment
-    for (size_t i = 0; i < Dynstring.len(new_expr->expression_type); i++) {
+    for (size_t i = 0; i < Dynstring.len(function_returns->name); i++) {
         Generator.func_call_return_value(i);
     }
 
     noerr:
-    Dynstring.dtor(id_name);
-    stack_item_dtor(new_expr);
     return true;
     err:
-    Dynstring.dtor(id_name);
-    stack_item_dtor(new_expr);
     return false;
 }
 
-/** Parse initialize declaration for parse_parents.
- *
- * @param received_signature is an initialized empty vector.
- * @return bool.
- */
-static bool parse_init(dynstring_t *);
-
 /**
- * @brief Parse parents.
+ * @brief Append nil to an expression without values, a function which does not return anything
+ *        pushes nil.
  *
- * @param stack for precedence analyse.
- * @param parents_parsed true if parents were parsed.
- * @return
+ * @param expr
+ * @param function_parsed the expression is a function call.
  */
-static bool parse_parents(sstack_t *stack, bool *parents_parsed) {
-    debug_msg("parse_parents \n");
-
-    stack_item_t *new_expr = stack_item_ctor(ITEM_TYPE_EXPR, NULL);
-
-    // (
-    if (Scanner.get_curr_token().type != TOKEN_LPAREN) {
-        goto noerr;
-    }
-
-    EXPECTED(TOKEN_LPAREN);
-
-    // expr
-    if (!parse_init(new_expr->expression_type)) {
-        goto err;
+static void expression_nil(stack_item_t *expr, bool function_parsed) {
+    if (!is_empty_signature(expr->expression_type)) {
+        return;
     }
 
-    // Check empty expression
-    if (Dynstring.len(new_expr->expression_type) == 0) {
-        Errors.set_error(ERROR_SYNTAX);
-        goto err;
+    if (function_parsed) {
+        // generate code for function which does not return anything
+        Generator.expression_push_nil();
     }
-
-    // )
-    EXPECTED(TOKEN_RPAREN);
-
-    *parents_parsed = true;
-
-    // Push an expression
-    Stack.push(stack, stack_item_copy(new_expr));
-
-    noerr:
-    stack_item_dtor(new_expr);
-    return true;
-    err:
-    stack_item_dtor(new_expr);
-    return false;
+    expr->expression_type = Intern.signature_append(expr->expression_type, 'n');
 }
 
 /**
- * @brief Expression parsing.
+ * @brief Expression parsing. Every step shifts a token or reduces a handle on the stack,
+ *        the state between steps is the stack and hard_reduce, so the steps are a loop.
+ *        ( of an expression in parentheses is pushed as its $ with hard_reduce
+ *        of the outer expression, ) replaces them both with the reduced expression.
  *
  * @param stack stack for precedence analyse.
- * @param received_signature is an initialized empty vector.
- * @param hard_reduce reduce without precedence analyse.
+ * @param received_signature variable to store the interned signature of the expression.
  * @return bool.
  */
-static bool parse(sstack_t *stack, dynstring_t *received_signature, bool hard_reduce) {
+static bool parse(prec_stack_t *stack, const atom_t **received_signature) {
     debug_msg("parse ->\n");
 
     int cmp;
     stack_item_t *top;
-    stack_item_t *expr = NULL;
-    bool function_parsed = false;
-    bool parents_parsed = false;
-
-    // Try parse parents
-    if (!parse_parents(stack, &parents_parsed)) {
-        goto err;
-    }
-
-    // Try parse a function
-    if (!parents_parsed && !hard_reduce) {
-        if (!parse_function(stack, &function_parsed)) {
-            goto err;
+    bool hard_reduce = false;
+    bool closed_parents = false;
+
+    while (true) {
+        stack_item_t *expr = NULL;
+        bool function_parsed = false;
+        bool parents_parsed = closed_parents;
+        closed_parents = false;
+
+        // Open parents
+        if (!parents_parsed && Scanner.get_curr_token().type == TOKEN_LPAREN) {
+            EXPECTED(TOKEN_LPAREN);
+            stack_push(stack, ITEM_TYPE_PAREN)->hard_reduce = hard_reduce;
+            hard_reduce = false;
+            continue;
         }
-    }
 
-    // Pop expression if we have it on the top of the stack
-    STACK_ITEM_PEEK_EXPR(stack, expr);
-
-    // Peek top item from the stack
-    STACK_ITEM_PEEK(stack, top);
-
-    op_list_t first_op = (top->type == ITEM_TYPE_DOLLAR) ? OP_DOLLAR : get_op(top->token.type);
-    op_list_t second_op = get_op(Scanner.get_curr_token().type);
-
-    check_unary_minus(first_op, &second_op, expr);
+        // Try parse a function
+        if (!parents_parsed && !hard_reduce) {
+            if (!parse_function(stack, &function_parsed)) {
+                goto err;
+            }
+        }
 
-    debug_msg("Top: { %s } Next: { %s%s }\n",
-              op_to_string(first_op),
-              Scanner.to_string(Scanner.get_curr_token().type),
-              (second_op == OP_MINUS_UNARY) ? " (unary)" : "");
+        // Peek expression if we have it on the top of the stack, the top item is under it.
+        // There is always $ or ( under an expression.
+        STACK_ITEM_PEEK_EXPR(stack, expr);
+        top = &stack->items[stack->len - ((expr != NULL) ? 2 : 1)];
 
-    // Check an expression end
-    if (!hard_reduce) {
-        hard_reduce = expression_end(first_op, function_parsed, parents_parsed);
-    }
+        token_type_t next = Scanner.get_curr_token().type;
+        op_list_t first_op = is_bottom(top) ? OP_DOLLAR : get_op(top->token.type);
+        op_list_t second_op = get_op(next);
 
-    // Check a success parsing
-    if (parse_success(first_op, second_op, hard_reduce)) {
-        debug_msg("Successful parsing\n");
+        check_unary_minus(first_op, &second_op, expr);
 
-        if (expr == NULL) {
-            goto noerr;
+        // Check an expression end
+        if (!hard_reduce) {
+            hard_reduce = expression_end(first_op, next, function_parsed, parents_parsed);
         }
 
-        // Append nil if expression type is empty
-        if (Dynstring.len(expr->expression_type) == 0) {
-            if (function_parsed) {
-                // generate code for function which does not return anything
-                Generator.expression_push_nil();
+        // Check a success parsing
+        if (parse_success(first_op, second_op, hard_reduce)) {
+            // Append nil if expression type is empty
+            if (expr != NULL) {
+                expression_nil(expr, function_parsed);
             }
 
-            Dynstring.append(expr->expression_type, 'n');
-        }
+            if (top->type == ITEM_TYPE_PAREN) {
+                // Check empty expression
+                if (expr == NULL) {
+                    Errors.set_error(ERROR_SYNTAX);
+                    goto err;
+                }
+
+                // Close parents
+                EXPECTED(TOKEN_RPAREN);
+
+                const atom_t *expression_type = expr->expression_type;
+                hard_reduce = top->hard_reduce;
+                stack_pop_to(stack, stack->len - 2);
+                stack_push_expr(stack, expression_type);
+                closed_parents = true;
+                continue;
+            }
 
-        if (received_signature != NULL) {
-            // Set return types
-            Dynstring.cat(received_signature, expr->expression_type);
-        }
-        goto noerr;
-    }
+            debug_msg("Successful parsing\n");
 
-    // Truncate expression type and clear generator stack
-    // if there is expression on top of the precedence stack
-    if (expr != NULL && expr->type == ITEM_TYPE_EXPR) {
-        // Append nil if expression type is empty
-        if (Dynstring.len(expr->expression_type) == 0) {
-            if (function_parsed) {
-                // generate code for function which does not return anything
-                Generator.expression_push_nil();
+            // Set return types
+            if (expr != NULL) {
+                *received_signature = expr->expression_type;
             }
-
-            Dynstring.append(expr->expression_type, 'n');
+            goto noerr;
         }
 
-        clear_expressions(expr->expression_type);
-    }
-
-    // Precedence comparison
-    if (!hard_reduce && !precedence_cmp(first_op, second_op, &cmp)) {
-        debug_msg("Precedence error\n");
-        Errors.set_error(ERROR_SYNTAX);
-        goto err;
-    }
+        // Truncate expression type and clear generator stack
+        // if there is expression on top of the precedence stack
+        if (expr != NULL) {
+            // Append nil if expression type is empty
+            expression_nil(expr, function_parsed);
 
-    debug_msg("\n");
-    if (!hard_reduce && cmp <= 0) {
-        if (!shift(stack, expr, cmp)) {
-            goto err;
+            size_t values = Dynstring.len(expr->expression_type->name);
+            if (values > 1) {
+                expr->expression_type = Intern.signature(Dynstring.c_str(expr->expression_type->name), 1);
+            }
+            for (size_t i = 0; i < values - 1; i++) {
+                Generator.expression_pop();
+            }
         }
 
-        // If second operand was unary minus,
-        // then change token type of top stack element
-        // from TOKEN_SUB to TOKEN_UNARY_MINUS
-        if (second_op == OP_MINUS_UNARY) {
-            STACK_ITEM_PEEK(stack, top);
-            top->token.type = TOKEN_MINUS_UNARY;
-        }
-    } else {
-        if (!reduce(stack, expr)) {
+        // Precedence comparison
+        if (!hard_reduce && !precedence_cmp(first_op, second_op, &cmp)) {
+            debug_msg("Precedence error\n");
+            Errors.set_error(ERROR_SYNTAX);
             goto err;
         }
-    }
-    debug_msg("\n");
 
-    if (!parse(stack, received_signature, hard_reduce)) {
-        goto err;
+        if (!hard_reduce && cmp <= 0) {
+            if (!shift(stack, expr != NULL, cmp)) {
+                goto err;
+            }
+
+            // If second operand was unary minus,
+            // then change token type of top stack element
+            // from TOKEN_SUB to TOKEN_UNARY_MINUS
+            if (second_op == OP_MINUS_UNARY) {
+                STACK_ITEM_PEEK(stack, top);
+                top->token.type = TOKEN_MINUS_UNARY;
+            }
+        } else {
+            if (!reduce(stack)) {
+                goto err;
+            }
+        }
     }
 
     noerr:
-    stack_item_dtor(expr);
     return true;
     err:
-    stack_item_dtor(expr);
     return false;
 }
 
 /**
- * @brief Expression parsing initialization.
+ * @brief Expression parsing on the precedence stack of the compilation,
+ *        over items of an outer expression if this one is nested.
  *
- * @param received_signature is an initialized empty vector.
+ * @param received_signature variable to store the interned signature of the expression,
+ *                           it is not set if there is no expression.
  * @return bool.
  */
-static bool parse_init(dynstring_t *received_signature) {
+static bool parse_expression(const atom_t **received_signature) {
     debug_msg("parse_init ->\n");
 
-    sstack_t *stack = Stack.ctor();
+    prec_stack_t *stack = &context->prec_stack;
+    size_t base = stack->len;
 
     // Push $ on stack
-    Stack.push(stack, stack_item_ctor(ITEM_TYPE_DOLLAR, NULL));
+    stack_push(stack, ITEM_TYPE_DOLLAR);
 
     // Parse expression
-    if (!parse(stack, received_signature, false)) {
-        goto err;
+    bool res = parse(stack, received_signature);
+
+    stack_pop_to(stack, base);
+    return res;
+}
+
+/**
+ * @brief Expression parsing initialization.
+ *
+ * @param received_signature is an initialized empty vector.
+ * @return bool.
+ */
+static bool parse_init(dynstring_t *received_signature) {
+    const atom_t *expression_type = NULL;
+
+    if (!parse_expression(&expression_type)) {
+        return false;
     }
 
-    Stack.dtor(stack, stack_item_dtor);
+    if (expression_type != NULL && received_signature != NULL) {
+        Dynstring.append_n(received_signature, Dynstring.c_str(expression_type->name),
+                           Dynstring.len(expression_type->name));
+    }
     return true;
-    err:
-    Stack.dtor(stack, stack_item_dtor);
-    return false;
 }
 
 /** Function call other expressions.
  *
  * !rule [fc_other_expr] -> , expr [fc_other_expr] | )
  *
- * @param expected_params
+ * @param expected_params interned signature of parameters.
  * @param last_expression
- * @param func_name
+ * @param variadic the function takes any number of parameters of any types.
  * @param params_cnt counter of function parameters.
  * @return bool.
  */
-static bool fc_other_expr(dynstring_t *expected_params,
+static bool fc_other_expr(const atom_t *expected_params,
                           dynstring_t *last_expression,
-                          dynstring_t *func_name,
+                          bool variadic,
                           size_t params_cnt) {
     debug_msg("[fc_other_expr] ->\n");
 
@@ -1095,7 +1076,7 @@ static bool fc_other_expr(dynstring_t *expected_params,
 
     // | )
     if (Scanner.get_curr_token().type == TOKEN_RPAREN) {
-        if (Dynstring.cmp_c_str(func_name, "write") == 0) {
+        if (variadic) {
             // generate multiple write functions
             Generator.multiple_write(Dynstring.len(last_expression));
         } else {
@@ -1103,17 +1084,17 @@ static bool fc_other_expr(dynstring_t *expected_params,
             size_t received_params = params_cnt + Dynstring.len(last_expression);
 
             // Check params number
-            if (received_params != Dynstring.len(expected_params)) {
+            if (received_params != Dynstring.len(expected_params->name)) {
                 Errors.set_error(ERROR_FUNCTION_SEMANTICS);
                 goto err;
             }
 
             // Parse other params
             for (size_t i = 0; i < Dynstring.len(last_expression); i++) {
-                CHECK_EXPR_TYPES(Dynstring.c_str(expected_params)[Dynstring.len(expected_params) - i - 1],
+                CHECK_EXPR_TYPES(Dynstring.c_str(expected_params->name)[Dynstring.len(expected_params->name) - i - 1],
                                  Dynstring.c_str(last_expression)[Dynstring.len(last_expression) - i - 1],
                                  r_type);
-                Generator.pass_param(r_type, Dynstring.len(expected_params) - i - 1);
+                Generator.pass_param(r_type, Dynstring.len(expected_params->name) - i - 1);
                 r_type = NO_RECAST;
                 params_cnt++;
             }
@@ -1126,12 +1107,12 @@ static bool fc_other_expr(dynstring_t *expected_params,
     // ,
     EXPECTED(TOKEN_COMMA);
 
-    if (Dynstring.cmp_c_str(func_name, "write") == 0) {
+    if (variadic) {
         // generate write for each return value
         Generator.multiple_write(Dynstring.len(last_expression));
     } else {
         clear_expressions(last_expression);
-        CHECK_EXPR_TYPES(Dynstring.c_str(expected_params)[params_cnt],
+        CHECK_EXPR_TYPES(Dynstring.c_str(expected_params->name)[params_cnt],
                          Dynstring.c_str(last_expression)[0],
                          r_type);
         Generator.pass_param(r_type, params_cnt);
@@ -1147,7 +1128,7 @@ static bool fc_other_expr(dynstring_t *expected_params,
     CHECK_EMPTY_SIGNATURE(received_signature);
 
     // [fc_other_expr]
-    if (!fc_other_expr(expected_params, received_signature, func_name, params_cnt)) {
+    if (!fc_other_expr(expected_params, received_signature, variadic, params_cnt)) {
         goto err;
     }
 
@@ -1163,11 +1144,11 @@ static bool fc_other_expr(dynstring_t *expected_params,
  *
  * !rule [fc_expr] -> expr [fc_other_expr] | )
  *
- * @param expected_params
- * @param func_name
+ * @param expected_params interned signature of parameters.
+ * @param variadic the function takes any number of parameters of any types.
  * @return bool.
  */
-static bool fc_expr(dynstring_t *expected_params, dynstring_t *func_name) {
+static bool fc_expr(const atom_t *expected_params, bool variadic) {
     debug_msg("[fc_expr] ->\n");
 
     size_t params_cnt = 0;
@@ -1177,7 +1158,7 @@ static bool fc_expr(dynstring_t *expected_params, dynstring_t *func_name) {
     //EXPECTED_OPT(TOKEN_RPAREN);
     if (Scanner.get_curr_token().type == TOKEN_RPAREN) {
         // if function has params, set error
-        if (Dynstring.len(expected_params) > 0) {
+        if (Dynstring.len(expected_params->name) > 0) {
             Errors.set_error(ERROR_FUNCTION_SEMANTICS);
             goto err;
         }
@@ -1193,7 +1174,7 @@ static bool fc_expr(dynstring_t *expected_params, dynstring_t *func_name) {
     CHECK_EMPTY_SIGNATURE(received_signature);
 
     // [fc_other_expr]
-    if (!fc_other_expr(expected_params, received_signature, func_name, params_cnt)) {
+    if (!fc_other_expr(expected_params, received_signature, variadic, params_cnt)) {
         goto err;
     }
 
@@ -1210,18 +1191,25 @@ static bool fc_expr(dynstring_t *expected_params, dynstring_t *func_name) {
  * !rule [func_call] -> ( [fc_expr]
  *
  * @param id_name function identifier name.
- * @param function_returns is an initialized empty vector.
+ * @param function_returns variable to store the interned signature of return values, or NULL.
  * @return bool.
  */
-static bool func_call(dynstring_t *id_name, dynstring_t *function_returns) {
+static bool func_call(const atom_t *id_name, const atom_t **function_returns) {
     debug_msg("[func_call] ->\n");
 
-    dynstring_t *expected_params = Dynstring.ctor("");
-    GET_FUNCTION_SIGNATURES(id_name, expected_params, function_returns);
+    func_semantics_t *func;
+    GET_FUNCTION_SEMANTICS(id_name, func);
 
+    // a function can be called before its definition, then its declaration is used.
+    func_info_t *signatures = Semantics.is_defined(func) ? &func->definition : &func->declaration;
+    bool variadic = Semantics.is_variadic(func);
+
+    if (function_returns != NULL) {
+        *function_returns = signatures->returns;
+    }
 
     // generate code for function call start
-    if (Dynstring.cmp_c_str(id_name, "write") != 0) {
+    if (!variadic) {
         Generator.comment("start of function call");
         Generator.func_createframe();
     }
@@ -1230,19 +1218,17 @@ static bool func_call(dynstring_t *id_name, dynstring_t *function_returns) {
     EXPECTED(TOKEN_LPAREN);
 
     // [fc_expr]
-    if (!fc_expr(expected_params, id_name)) {
+    if (!fc_expr(signatures->params, variadic)) {
         goto err;
     }
 
     // generate code for function call
-    if (Dynstring.cmp_c_str(id_name, "write") != 0) {
-        Generator.func_call(Dynstring.c_str(id_name));
+    if (!variadic) {
+        Generator.func_call(Dynstring.c_str(id_name->name));
     }
 
-    Dynstring.dtor(expected_params);
     return true;
     err:
-    Dynstring.dtor(expected_params);
     return false;
 }
 
@@ -1250,12 +1236,12 @@ static bool func_call(dynstring_t *id_name, dynstring_t *function_returns) {
  *
  * !rule [r_other_expr] -> , expr [r_other_expr] | e
  *
- * @param expected_rets
+ * @param expected_rets interned signature of return values.
  * @param last_expression
  * @param return_cnt
  * @return bool.
  */
-static bool r_other_expr(dynstring_t *expected_rets,
+static bool r_other_expr(const atom_t *expected_rets,
                          dynstring_t *last_expression,
                          size_t return_cnt) {
     debug_msg("[r_other_expr] ->\n");
@@ -1265,10 +1251,11 @@ static bool r_other_expr(dynstring_t *expected_rets,
 
     // | e
     if (Scanner.get_curr_token().type != TOKEN_COMMA) {
-        // Total number of received return values
+        // Total number of received return values,
+        // they may be a prefix of the signature, the rest of return values is nil.
         size_t received_rets = return_cnt + Dynstring.len(last_expression);
 
-        if (received_rets > Dynstring.len(expected_rets)) {
+        if (received_rets > Dynstring.len(expected_rets->name)) {
             Errors.set_error(ERROR_FUNCTION_SEMANTICS);
             goto err;
         }
@@ -1276,7 +1263,7 @@ static bool r_other_expr(dynstring_t *expected_rets,
         // Parse other return values
         size_t received_ret_cnt = return_cnt + Dynstring.len(last_expression);
         for (size_t i = 0; i < Dynstring.len(last_expression); i++) {
-            CHECK_EXPR_TYPES(Dynstring.c_str(expected_rets)[received_ret_cnt - i - 1],
+            CHECK_EXPR_TYPES(Dynstring.c_str(expected_rets->name)[received_ret_cnt - i - 1],
                              Dynstring.c_str(last_expression)[Dynstring.len(last_expression) - i - 1],
                              r_type);
             Generator.pass_return(r_type, received_ret_cnt - i - 1);
@@ -1291,7 +1278,7 @@ static bool r_other_expr(dynstring_t *expected_rets,
 
     clear_expressions(last_expression);
 
-    CHECK_EXPR_TYPES(Dynstring.c_str(expected_rets)[return_cnt],
+    CHECK_EXPR_TYPES(Dynstring.c_str(expected_rets->name)[return_cnt],
                      Dynstring.c_str(last_expression)[0],
                      r_type);
     Generator.pass_return(r_type, return_cnt);
@@ -1324,10 +1311,10 @@ static bool r_other_expr(dynstring_t *expected_rets,
  * !rule [r_expr] -> expr [r_other_expr]
  *
  * @param received_rets is an initialized empty vector.
- * @param expected_rets
+ * @param expected_rets interned signature of return values.
  * @return bool.
  */
-static bool r_expr(dynstring_t *expected_rets) {
+static bool r_expr(const atom_t *expected_rets) {
     debug_msg("[r_expr] ->\n");
 
     size_t return_cnt = 0;
@@ -1385,7 +1372,7 @@ static bool check_multiple_assignment(list_t *ids_list, dynstring_t *rhs_express
 
     while (id != NULL) {
         symbol_t *sym;
-        if (!Symstack.get_local_symbol(symstack, id->data, &sym)) {
+        if (!Symstack.get_local_symbol(context->symstack, id->data, &sym)) {
             Errors.set_error(ERROR_DEFINITION);
             goto err;
         }
@@ -1498,7 +1485,7 @@ static bool a_expr(dynstring_t *rhs_expressions) {
 static bool a_other_id(list_t *ids_list) {
     debug_msg("[a_other_id] ->\n");
 
-    dynstring_t *id_name = NULL;
+    const atom_t *id_name = NULL;
     dynstring_t *rhs_expressions = Dynstring.ctor("");
 
     // | = [a_expr]
@@ -1524,7 +1511,7 @@ static bool a_other_id(list_t *ids_list) {
     CHECK_DEFINITION(id_name);
 
     // Prepend next identifier
-    List.prepend(ids_list, Dynstring.dup(id_name));
+    List.prepend(ids_list, (void *) id_name);
 
     // [a_other_id]
     if (!a_other_id(ids_list)) {
@@ -1532,11 +1519,9 @@ static bool a_other_id(list_t *ids_list) {
     }
 
     noerr:
-    Dynstring.dtor(id_name);
     Dynstring.dtor(rhs_expressions);
     return true;
     err:
-    Dynstring.dtor(id_name);
     Dynstring.dtor(rhs_expressions);
     return false;
 }
@@ -1548,7 +1533,7 @@ static bool a_other_id(list_t *ids_list) {
  * @param id_name identifier name.
  * @return bool.
  */
-static bool assign_id(dynstring_t *id_name) {
+static bool assign_id(const atom_t *id_name) {
     debug_msg("[assign_id] ->\n");
 
     // Create a list of identifiers
@@ -1557,17 +1542,17 @@ static bool assign_id(dynstring_t *id_name) {
     CHECK_DEFINITION(id_name);
 
     // Prepend first identifier
-    List.prepend(ids_list, Dynstring.dup(id_name));
+    List.prepend(ids_list, (void *) id_name);
 
     // [a_other_id]
     if (!a_other_id(ids_list)) {
         goto err;
     }
 
-    List.dtor(ids_list, (void (*)(void *)) Dynstring.dtor);
+    List.dtor(ids_list, atom_dtor);
     return true;
     err:
-    List.dtor(ids_list, (void (*)(void *)) Dynstring.dtor);
+    List.dtor(ids_list, atom_dtor);
     return false;
 }
 
@@ -1577,13 +1562,13 @@ static bool assign_id(dynstring_t *id_name) {
  *
  * @param pfile_
  * @param received_signature is an initialized empty vector.
- * @param func_rets
+ * @param func_rets interned signature of return values of the function.
  * @return true if successful parsing performed.
  */
-static bool Return_expressions(pfile_t *pfile_, dynstring_t *expected_rets) {
+static bool Return_expressions(pfile_t *pfile_, const atom_t *expected_rets) {
     debug_msg("Return_expression\n");
 
-    pfile = pfile_;
+    context->pfile = pfile_;
 
     // [r_expr]
     if (!r_expr(expected_rets)) {
@@ -1611,7 +1596,7 @@ static bool Default_expression(pfile_t *pfile_,
                                type_expr_statement_t type_expr_statement) {
     debug_msg("Default_expression\n");
 
-    pfile = pfile_;
+    context->pfile = pfile_;
 
     // expr
     if (!parse_init(received_signature)) {
@@ -1652,8 +1637,8 @@ static bool Default_expression(pfile_t *pfile_,
 static bool Global_expression(pfile_t *pfile_) {
     debug_msg("Global_expression\n");
 
-    pfile = pfile_;
-    dynstring_t *id_name = NULL;
+    context->pfile = pfile_;
+    const atom_t *id_name = NULL;
 
     GET_ID_SAFE(id_name);
     // id
@@ -1669,10 +1654,8 @@ static bool Global_expression(pfile_t *pfile_) {
         goto err;
     }
 
-    Dynstring.dtor(id_name);
     return true;
     err:
-    Dynstring.dtor(id_name);
     return false;
 }
 
@@ -1685,8 +1668,8 @@ static bool Global_expression(pfile_t *pfile_) {
 static bool Function_expression(pfile_t *pfile_) {
     debug_msg("Function_expression\n");
 
-    pfile = pfile_;
-    dynstring_t *id_name = NULL;
+    context->pfile = pfile_;
+    const atom_t *id_name = NULL;
 
     GET_ID_SAFE(id_name);
     // id
@@ -1704,13 +1687,21 @@ static bool Function_expression(pfile_t *pfile_) {
         }
     }
 
-    Dynstring.dtor(id_name);
     return true;
     err:
-    Dynstring.dtor(id_name);
     return false;
 }
 
+/**
+ * @brief Free the precedence stack of the compilation.
+ */
+static void Free_expressions() {
+    prec_stack_t *stack = &context->prec_stack;
+    stack_pop_to(stack, 0);
+    Context.free(MEM_EXPRESSIONS, stack->items, stack->cap * sizeof(stack_item_t));
+    memset(stack, 0x0, sizeof(*stack));
+}
+
 /**
  * Functions are in struct so we can use them in different files.
  */
@@ -1719,4 +1710,5 @@ const struct expr_interface_t Expr = {
         .global_expression = Global_expression,
         .default_expression = Default_expression,
         .return_expressions = Return_expressions,
+        .free = Free_expressions,
 };
@@ -46,6 +46,7 @@ typedef enum op_list {
 typedef enum item_type {
     ITEM_TYPE_LT,
     ITEM_TYPE_DOLLAR,
+    ITEM_TYPE_PAREN, ///< $ of an expression in parentheses.
     ITEM_TYPE_EXPR,
     ITEM_TYPE_TOKEN,
 } item_type_t;
@@ -56,14 +57,24 @@ typedef enum type_expr_statement {
 } type_expr_statement_t;
 
 /**
- * Item of precedence analyse stack
+ * Item of precedence analyse stack, items are stored in the stack by value.
  */
 typedef struct stack_item {
     item_type_t type;
-    token_t token;
-    dynstring_t *expression_type;
+    bool hard_reduce; ///< hard_reduce of the outer expression of ITEM_TYPE_PAREN.
+    token_t token; ///< token of ITEM_TYPE_TOKEN, a string token owns its dynstring.
+    const atom_t *expression_type; ///< interned signature of ITEM_TYPE_EXPR, type codes of its values.
 } stack_item_t;
 
+/**
+ * Precedence analyse stack. Nested expressions are analysed over items of outer ones.
+ */
+typedef struct prec_stack {
+    stack_item_t *items;
+    size_t len; ///< number of items.
+    size_t cap; ///< capacity of items.
+} prec_stack_t;
+
 struct expr_interface_t {
     /**
      * @brief Expression in the return statement.
@@ -71,10 +82,10 @@ struct expr_interface_t {
      *
      * @param pfile_
      * @param received_signature is an initialized empty vector.
-     * @param func_rets
+     * @param func_rets interned signature of return values of the function.
      * @return true if successive parsing performed.
      */
-    bool (*return_expressions)(pfile_t *, dynstring_t *);
+    bool (*return_expressions)(pfile_t *, const atom_t *);
 
     /**
      * @brief Default expression after = in the local assignment
@@ -104,6 +115,11 @@ struct expr_interface_t {
      * @return true if successive parsing and semantic analysis of expressions performed.
      */
     bool (*global_expression)(pfile_t *);
+
+    /**
+     * @brief Free the precedence stack at the end of the compilation.
+     */
+    void (*free)(void);
 };
 
 extern const struct expr_interface_t Expr;
@@ -6,39 +6,251 @@
  */
 
 #include "errors.h"
-#include "parser.h"
 #include "progfile.h"
-#include "list.h"
-#include "code_generator.h"
+#include "compiler.h"
+#include "server.h"
+#include "writer.h"
 
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
 
-int main() {
-    pfile_t *pfile = NULL;
 
-    if (!(pfile = Pfile.getfile_stdin())) {
-        return Errors.get_error();
+/** Open the output of the code.
+ *
+ * @param output path of the output file, NULL for stdout.
+ * @return writer, or NULL if the file cannot be opened.
+ */
+static writer_t *open_output(const char *output) {
+    if (!output) {
+        return Writer.ctor(STDOUT_FILENO);
+    }
+    writer_t *out = Writer.open(output);
+    if (!out) {
+        perror(output);
+    }
+    return out;
+}
+
+/** Write the rest of the code and close the output.
+ *
+ * @param out writer.
+ * @param output path of the output file, NULL for stdout.
+ * @param error error code of the compilation.
+ * @return error code of the compilation, or ERROR_INTERNAL if the code cannot be written.
+ */
+static int close_output(writer_t *out, const char *output, int error) {
+    int write_error = Writer.dtor(out);
+    if (write_error != 0) {
+        fprintf(stderr, "%s: %s\n", output ? output : "stdout", strerror(write_error));
+        return (error != 0) ? error : ERROR_INTERNAL;
+    }
+    return error;
+}
+
+/** Options, which are followed by an argument.
+ */
+static const char *const argument_options[] = {"--server", "--client", "--jobs", "-o", "--emit", "--lex-threads"};
+
+/** Report a wrong option.
+ *
+ * @param option the option.
+ * @param message what is wrong.
+ * @return ERROR_INTERNAL.
+ */
+static int usage_error(const char *option, const char *message) {
+    fprintf(stderr, "ifj21: %s %s\n", option, message);
+    return ERROR_INTERNAL;
+}
+
+/** Check an argument, which is not an option known to main().
+ *
+ * @param arg the argument.
+ * @return 0 if it is a file, "-" is stdin. ERROR_INTERNAL if it is an option.
+ */
+static int check_file_argument(const char *arg) {
+    if (arg[0] != '-' || arg[1] == '\0') {
+        return 0;
     }
+    for (size_t i = 0; i < sizeof(argument_options) / sizeof(*argument_options); i++) {
+        if (strcmp(arg, argument_options[i]) == 0) {
+            return usage_error(arg, "needs an argument");
+        }
+    }
+    return usage_error(arg, "is an unknown option");
+}
 
-    Generator.initialise();
+/**
+ * Usage: ifj21 [--stream | --prelex | --lex-threads N] [--stream-code] [--emit none|minimal|full]
+ *              [--mem-stats[=json]] [-o outputfile] [inputfile.tl]
+ * If no file is given, or it is "-", the program is read from stdin. Unknown options, options without their argument
+ * and more than one file are errors, ERROR_INTERNAL is returned.
+ * -o writes the code to outputfile instead of stdout ("-"), the file is empty if the program has errors.
+ * --stream reads the program by chunks, so the input takes a constant amount of memory.
+ * --stream-code writes the code of every function when it is generated, so the generator takes memory
+ *               for the biggest function. If the program has errors, the code written so far stays.
+ * --emit sets comments in the code, none, one for every statement, or all of them (the default).
+ * --prelex lexes the whole program into a token buffer before parsing, it is an error with --stream.
+ * --lex-threads N prelexes big programs by parts on up to N threads.
+ * --mem-stats prints allocations of the compilation by subsystems to stderr, --mem-stats=json as a JSON object.
+ *
+ * Usage: ifj21 --batch [--jobs N] [--prelex | --lex-threads N] [--stream-code] [--emit none|minimal|full]
+ *              inputfiles.tl...
+ * Compiles the files at once on N threads, the code of name.tl is written to name.code.
+ * --stream, -o and --mem-stats are errors with --batch.
+ * Prints "error_code file" for every file, returns the error code of the first file which failed.
+ *
+ * Usage: ifj21 --server SOCKET [--jobs N]
+ * Compiles programs sent to the Unix domain socket until SIGINT or SIGTERM, N programs at once.
+ * With SOCKET "-" requests are read from stdin and responses are written to stdout, see server.h.
+ *
+ * Usage: ifj21 --client SOCKET [-o outputfile] [inputfile.tl]
+ * Compiles the program on the server, prints the code and returns the error code.
+ */
+int main(int argc, char **argv) {
+    pfile_t *pfile = NULL;
+    const char *filename = NULL;
+    const char *output = NULL;
+    bool stream = false;
+    ifj21_options_t options = {0};
+    bool batch = false;
+    size_t jobs = 1;
+    const char *server = NULL;
+    const char *client = NULL;
+    bool mem_stats = false;
+    bool mem_stats_json = false;
+    const char **files = calloc(argc, sizeof(char *));
+    size_t count = 0;
+    if (!files) {
+        return ERROR_INTERNAL;
+    }
 
-    if (!Parser.analyse(pfile)) {
-        goto ret;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--batch") == 0) {
+            batch = true;
+        } else if (strcmp(argv[i], "--server") == 0 && i + 1 < argc) {
+            server = argv[++i];
+        } else if (strcmp(argv[i], "--client") == 0 && i + 1 < argc) {
+            client = argv[++i];
+        } else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+            jobs = strtoul(argv[++i], NULL, 10);
+            jobs = (jobs == 0) ? 1 : jobs;
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else if (strcmp(argv[i], "--stream") == 0) {
+            stream = true;
+        } else if (strcmp(argv[i], "--stream-code") == 0) {
+            options.stream_code = true;
+        } else if (strcmp(argv[i], "--emit") == 0 && i + 1 < argc) {
+            const char *emit = argv[++i];
+            if (strcmp(emit, "none") == 0) {
+                options.emit = IFJ21_EMIT_NONE;
+            } else if (strcmp(emit, "minimal") == 0) {
+                options.emit = IFJ21_EMIT_MINIMAL;
+            } else if (strcmp(emit, "full") == 0) {
+                options.emit = IFJ21_EMIT_FULL;
+            } else {
+                free(files);
+                return usage_error("--emit", "is none, minimal or full");
+            }
+        } else if (strcmp(argv[i], "--prelex") == 0) {
+            options.lex_threads = 1;
+        } else if (strcmp(argv[i], "--lex-threads") == 0 && i + 1 < argc) {
+            options.lex_threads = strtoul(argv[++i], NULL, 10);
+            options.lex_threads = (options.lex_threads == 0) ? 1 : options.lex_threads;
+        } else if (strcmp(argv[i], "--mem-stats") == 0 || strcmp(argv[i], "--mem-stats=json") == 0) {
+            mem_stats = true;
+            mem_stats_json = argv[i][sizeof("--mem-stats") - 1] == '=';
+        } else if (check_file_argument(argv[i]) != 0) {
+            free(files);
+            return ERROR_INTERNAL;
+        } else {
+            filename = argv[i];
+            files[count++] = argv[i];
+        }
     }
-    
-    // Prints the list of instructions to stdout
-    debug_msg("# ---------- Instructions List ----------\n");
 
-    debug_msg("# ---------- startList ----------\n");
-    Generator.print_instr_list(LIST_INSTR_START);
+    if (batch) {
+        const char *option = (stream) ? "--stream" : (output) ? "-o" : (mem_stats) ? "--mem-stats" : NULL;
+        if (option) {
+            free(files);
+            return usage_error(option, "cannot be used with --batch");
+        }
+        int *errors = calloc(count + 1, sizeof(int));
+        if (!errors) {
+            free(files);
+            return ERROR_INTERNAL;
+        }
+        int error = ifj21_compile_batch(files, count, jobs, &options, errors);
+        for (size_t i = 0; i < count; i++) {
+            printf("%d %s\n", errors[i], files[i]);
+        }
+        free(errors);
+        free(files);
+        return error;
+    }
+    free(files);
+    if (stream && options.lex_threads != 0) {
+        // a stream does not hold spans of prelexed tokens.
+        return usage_error("--stream", "cannot be used with --prelex or --lex-threads");
+    }
+    if (count > 1) {
+        return usage_error(filename, "is not the only file, several files are compiled with --batch");
+    }
+
+    // "-" is stdin and stdout.
+    filename = (filename && strcmp(filename, "-") == 0) ? NULL : filename;
+    output = (output && strcmp(output, "-") == 0) ? NULL : output;
 
-    debug_msg("# ---------- listFunctions ----------\n");
-    Generator.print_instr_list(LIST_INSTR_FUNC);
+    if (server && strcmp(server, "-") == 0) {
+        signal(SIGPIPE, SIG_IGN);
+        return Server.serve_fd(STDIN_FILENO, STDOUT_FILENO);
+    } else if (server) {
+        return Server.serve(server, jobs);
+    }
+
+    if (client) {
+        pfile = (filename) ? Pfile.getfile(filename) : Pfile.getfile_stdin();
+        if (!pfile) {
+            return Errors.get_error();
+        }
+        int fd = Server.connect(client);
+        if (fd < 0) {
+            perror(client);
+            Pfile.dtor(pfile);
+            return ERROR_INTERNAL;
+        }
+        writer_t *out = open_output(output);
+        if (!out) {
+            close(fd);
+            Pfile.dtor(pfile);
+            return ERROR_INTERNAL;
+        }
+        int error = Server.request(fd, Pfile.get_tape(pfile), Pfile.available(pfile), &out->sink);
+        close(fd);
+        Pfile.dtor(pfile);
+        return close_output(out, output, error);
+    }
 
-    debug_msg("# ---------- mainList ----------\n");
-    Generator.print_instr_list(LIST_INSTR_MAIN);
+    if (stream) {
+        pfile = Pfile.getfile_stream(filename);
+    } else {
+        pfile = (filename) ? Pfile.getfile(filename) : Pfile.getfile_stdin();
+    }
+    if (!pfile) {
+        return Errors.get_error();
+    }
+    writer_t *out = open_output(output);
+    if (!out) {
+        Pfile.dtor(pfile);
+        return ERROR_INTERNAL;
+    }
 
-    ret:
-    Generator.dtor();
+    mem_stats_t stats = {0};
+    int error = ifj21_compile_file_stats(pfile, &options, &out->sink, mem_stats ? &stats : NULL);
+    if (mem_stats) {
+        MemStats.print(&stats, stderr, mem_stats_json);
+    }
     Pfile.dtor(pfile);
-    return Errors.get_error();
+    return close_output(out, output, error);
 }
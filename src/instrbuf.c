@@ -0,0 +1,556 @@
+/**
+ * @file instrbuf.c
+ *
+ * @brief Buffer of generated instructions. An instruction is a record of an opcode and typed operands,
+ *        records are stored in chunked arrays, and the text of the code is made only when it is printed.
+ *
+ * @author Skuratovich Aliaksandr <xskura01@vutbr.cz>
+ */
+#include "instrbuf.h"
+#include "context.h"
+
+#include <ctype.h>
+
+
+// cells of the first chunk, the next chunks are twice as big up to INSTRBUF_CHUNK_MAX.
+#define INSTRBUF_CHUNK_MIN 64
+#define INSTRBUF_CHUNK_MAX 4096
+
+// size of the text buffered before it goes to the sink.
+#define INSTRBUF_OUT_SIZE 4096
+
+
+static const char *const mnemonics[] = {
+#define X(name) [INSTR(name)] = #name,
+        INSTR_OPCODES(X)
+#undef X
+};
+
+static const char *const frames[] = {
+        [FRAME_GF] = "GF",
+        [FRAME_LF] = "LF",
+        [FRAME_TF] = "TF",
+};
+
+static const char *const affixes[] = {
+        [AFFIX_NONE] = "",
+        [AFFIX_NUMBER] = "",
+        [AFFIX_FOR_VAR] = "for%",
+        [AFFIX_RETURN] = "return",
+        [AFFIX_WRITE] = "write",
+        [AFFIX_EXPR_RESULT] = "expr_result",
+        [AFFIX_EXPR_RESULT2] = "expr_result2",
+        [AFFIX_EXPR_RESULT3] = "expr_result3",
+        [AFFIX_IF] = "if",
+        [AFFIX_END] = "end",
+        [AFFIX_WHILE] = "while",
+        [AFFIX_REPEAT] = "repeat",
+        [AFFIX_FOR] = "for",
+        [AFFIX_STEP_LE] = "step_le",
+        [AFFIX_BODY] = "body",
+};
+
+/** Text of instructions on the way to a sink.
+ */
+typedef struct out {
+    const ifj21_sink_t *sink;
+    size_t len;
+    char buf[INSTRBUF_OUT_SIZE];
+} out_t;
+
+static void out_flush(out_t *out) {
+    if (out->len != 0) {
+        out->sink->write(out->sink->data, out->buf, out->len);
+        out->len = 0;
+    }
+}
+
+static void out_put(out_t *out, const char *str, size_t len) {
+    if (out->len + len > sizeof(out->buf)) {
+        out_flush(out);
+        if (len > sizeof(out->buf)) {
+            out->sink->write(out->sink->data, str, len);
+            return;
+        }
+    }
+    memcpy(out->buf + out->len, str, len);
+    out->len += len;
+}
+
+static void out_str(out_t *out, const char *str) {
+    out_put(out, str, strlen(str));
+}
+
+static void out_uint(out_t *out, uint64_t num) {
+    char digits[20];
+    size_t pos = sizeof(digits);
+    do {
+        digits[--pos] = (char) ('0' + num % 10);
+        num /= 10;
+    } while (num != 0);
+    out_put(out, digits + pos, sizeof(digits) - pos);
+}
+
+/** Put a string literal in the format of IFJcode21,
+ *  white spaces, control characters, '#' and '\\' are escape sequences \xyz.
+ */
+static void out_escaped(out_t *out, const char *str, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (str[i] <= 32 || str[i] == '#' || str[i] == '\\' || !isprint(str[i])) {
+            char esc[8];
+            if (str[i] >= 0) {
+                esc[0] = '\\';
+                esc[1] = (char) ('0' + str[i] / 100);
+                esc[2] = (char) ('0' + str[i] / 10 % 10);
+                esc[3] = (char) ('0' + str[i] % 10);
+                out_put(out, esc, 4);
+            } else {
+                // characters over 127 are negative
+                out_put(out, esc, (size_t) snprintf(esc, sizeof(esc), "\\%03d", str[i]));
+            }
+        } else {
+            out_put(out, &str[i], 1);
+        }
+    }
+}
+
+static void out_operand(out_t *out, const operand_t *op) {
+    switch (op->type) {
+        case OPERAND_VAR:
+            out_str(out, frames[op->frame]);
+            out_put(out, "@%", 2);
+            out_str(out, affixes[op->affix]);
+            out_uint(out, op->id);
+            out_put(out, "%", 1);
+            out_put(out, Dynstring.c_str(op->atom->name), Dynstring.len(op->atom->name));
+            break;
+        case OPERAND_TMP:
+            out_str(out, frames[op->frame]);
+            out_put(out, "@%", 2);
+            out_str(out, affixes[op->affix]);
+            out_uint(out, op->id);
+            break;
+        case OPERAND_REG:
+            out_str(out, frames[op->frame]);
+            out_put(out, "@%", 2);
+            out_str(out, affixes[op->affix]);
+            break;
+        case OPERAND_LABEL:
+            out_put(out, "$", 1);
+            out_str(out, affixes[op->affix]);
+            out_put(out, "$", 1);
+            out_uint(out, op->id);
+            if (op->suffix == AFFIX_NUMBER) {
+                out_put(out, "$", 1);
+                out_uint(out, op->num_i);
+            } else if (op->suffix != AFFIX_NONE) {
+                out_put(out, "$", 1);
+                out_str(out, affixes[op->suffix]);
+            }
+            break;
+        case OPERAND_FUNC:
+            out_put(out, "$", 1);
+            out_str(out, op->text);
+            if (op->suffix != AFFIX_NONE) {
+                out_put(out, "$", 1);
+                out_str(out, affixes[op->suffix]);
+            }
+            break;
+        case OPERAND_BUILTIN:
+            out_put(out, "$$", 2);
+            out_str(out, op->text);
+            break;
+        case OPERAND_INT:
+            out_put(out, "int@", 4);
+            out_uint(out, op->num_i);
+            break;
+        case OPERAND_FLOAT: {
+            char num[32];
+            out_put(out, "float@", 6);
+            out_put(out, num, (size_t) snprintf(num, sizeof(num), "%a", op->num_f));
+            break;
+        }
+        case OPERAND_STRING:
+            out_put(out, "string@", 7);
+            out_escaped(out, op->text, op->id);
+            break;
+        case OPERAND_BOOL:
+            out_str(out, op->id ? "bool@true" : "bool@false");
+            break;
+        case OPERAND_NIL:
+            out_put(out, "nil@nil", 7);
+            break;
+        case OPERAND_TEXT:
+            out_str(out, op->text);
+            break;
+        default:
+            debug_msg("Undefined operand type.\n");
+            break;
+    }
+}
+
+/** Put text of INSTR_TEXT with its operands in place of INSTR_ARG(i).
+ */
+static void out_text(out_t *out, const char *text, const operand_t *args) {
+    const char *arg;
+    while ((arg = strchr(text, '\x01')) != NULL) {
+        out_put(out, text, (size_t) (arg - text));
+        out_operand(out, &args[arg[1] - '0']);
+        text = arg + 2;
+    }
+    out_str(out, text);
+}
+
+static void out_cells(out_t *out, const instr_cell_t *cells, size_t len) {
+    for (size_t i = 0; i < len; i += 1 + cells[i].instr.argc) {
+        const instr_t *instr = &cells[i].instr;
+        const operand_t *args = &cells[i + 1].operand;
+        switch (instr->opcode) {
+            case INSTR_TEXT:
+                out_text(out, instr->text, args);
+                break;
+            case INSTR_HOIST:
+                for (const instr_group_t *group = instr->hoisted; group != NULL; group = group->next) {
+                    out_cells(out, group->cells, group->len);
+                }
+                continue;   // the place itself is not printed
+            default:
+                out_str(out, mnemonics[instr->opcode]);
+                for (size_t arg = 0; arg < instr->argc; arg++) {
+                    out_put(out, " ", 1);
+                    out_operand(out, &args[arg]);
+                }
+                break;
+        }
+        out_put(out, "\n", 1);
+    }
+}
+
+/** Create an empty buffer in the memory of the compilation, its chunks are counted as MEM_GENERATOR.
+ *
+ * @return buffer.
+ */
+static instrbuf_t *Ctor() {
+    return Context.alloc(MEM_GENERATOR, sizeof(instrbuf_t));
+}
+
+/** Get room for cells at the end of the buffer.
+ */
+static instr_cell_t *reserve(instrbuf_t *self, size_t cells) {
+    instr_chunk_t *tail = self->tail;
+    if (tail != NULL && tail->len + cells > tail->cap && tail->next != NULL && tail->next->cap >= cells) {
+        // chunks kept by Instrbuf.flush().
+        self->tail = tail = tail->next;
+    }
+    if (tail == NULL || tail->len + cells > tail->cap) {
+        size_t cap = (tail == NULL) ? INSTRBUF_CHUNK_MIN : tail->cap * 2;
+        cap = (cap > INSTRBUF_CHUNK_MAX) ? INSTRBUF_CHUNK_MAX : cap;
+        cap = (cap < cells) ? cells : cap;
+        instr_chunk_t *chunk = Context.alloc(MEM_GENERATOR, sizeof(instr_chunk_t) + cap * sizeof(instr_cell_t));
+        chunk->cap = cap;
+        if (tail == NULL) {
+            self->head = chunk;
+        } else {
+            chunk->next = tail->next;
+            tail->next = chunk;
+        }
+        self->tail = tail = chunk;
+    }
+    instr_cell_t *cells_end = tail->cells + tail->len;
+    tail->len += cells;
+    self->len += cells;
+    return cells_end;
+}
+
+/** Append an instruction.
+ *
+ * @param self buffer.
+ * @param opcode opcode_t.
+ * @param text text of INSTR_TEXT, it must live as long as the buffer, NULL otherwise.
+ * @param argc number of operands.
+ * @param args operands, strings and texts they point to must live as long as the buffer.
+ */
+static void Append(instrbuf_t *self, opcode_t opcode, const char *text, size_t argc, const operand_t *args) {
+    instr_cell_t *cells = reserve(self, 1 + argc);
+    cells[0].instr = (instr_t) {.opcode = (uint8_t) opcode, .argc = (uint8_t) argc, .text = text};
+    for (size_t i = 0; i < argc; i++) {
+        cells[1 + i].operand = args[i];
+    }
+}
+
+/** Append instructions of another buffer.
+ *
+ * @param self buffer.
+ * @param other buffer, it is not changed.
+ */
+static void Append_buf(instrbuf_t *self, const instrbuf_t *other) {
+    for (const instr_chunk_t *chunk = other->head; chunk != NULL; chunk = chunk->next) {
+        for (size_t i = 0; i < chunk->len; i += 1 + chunk->cells[i].instr.argc) {
+            size_t cells = 1 + chunk->cells[i].instr.argc;
+            memcpy(reserve(self, cells), &chunk->cells[i], cells * sizeof(instr_cell_t));
+        }
+    }
+}
+
+/** Append a place instructions can be hoisted to later.
+ *
+ * @param self buffer.
+ * @return the place.
+ */
+static instr_t *Mark(instrbuf_t *self) {
+    instr_cell_t *cell = reserve(self, 1);
+    cell->instr = (instr_t) {.opcode = INSTR_HOIST, .argc = 0, .hoisted = NULL};
+    return &cell->instr;
+}
+
+/** Hoist instructions of a buffer to a place. Instructions hoisted later are printed first.
+ *
+ * @param place the place from Instrbuf.mark().
+ * @param other buffer, it is not changed.
+ */
+static void Hoist(instr_t *place, const instrbuf_t *other) {
+    instr_group_t *group = Context.alloc(MEM_GENERATOR, sizeof(instr_group_t) + other->len * sizeof(instr_cell_t));
+    for (const instr_chunk_t *chunk = other->head; chunk != NULL; chunk = chunk->next) {
+        memcpy(group->cells + group->len, chunk->cells, chunk->len * sizeof(instr_cell_t));
+        group->len += chunk->len;
+    }
+    group->next = place->hoisted;
+    place->hoisted = group;
+}
+
+/** Remove all instructions, the first chunk is kept.
+ *
+ * @param self buffer.
+ */
+static void Clear(instrbuf_t *self) {
+    if (self->head == NULL) {
+        return;
+    }
+    instr_chunk_t *chunk = self->head->next;
+    while (chunk != NULL) {
+        instr_chunk_t *next = chunk->next;
+        Context.free(MEM_GENERATOR, chunk, sizeof(instr_chunk_t) + chunk->cap * sizeof(instr_cell_t));
+        chunk = next;
+    }
+    self->head->next = NULL;
+    self->head->len = 0;
+    self->tail = self->head;
+    self->len = 0;
+}
+
+/** Print instructions, each one is followed by a newline.
+ *
+ * @param self buffer.
+ * @param sink output.
+ */
+static void Print(const instrbuf_t *self, const ifj21_sink_t *sink) {
+    out_t out = {.sink = sink, .len = 0};
+    for (const instr_chunk_t *chunk = self->head; chunk != NULL; chunk = chunk->next) {
+        out_cells(&out, chunk->cells, chunk->len);
+    }
+    out_flush(&out);
+}
+
+/** Give hoisted groups and characters of strings of cells back to the memory of the compilation.
+ */
+static void release_cells(const instr_cell_t *cells, size_t len) {
+    for (size_t i = 0; i < len; i += 1 + cells[i].instr.argc) {
+        const instr_t *instr = &cells[i].instr;
+        if (instr->opcode == INSTR_HOIST) {
+            for (instr_group_t *group = instr->hoisted, *next; group != NULL; group = next) {
+                next = group->next;
+                release_cells(group->cells, group->len);
+                Context.free(MEM_GENERATOR, group, sizeof(instr_group_t) + group->len * sizeof(instr_cell_t));
+            }
+        }
+        for (size_t arg = 1; arg <= instr->argc; arg++) {
+            const operand_t *op = &cells[i + arg].operand;
+            if (op->type == OPERAND_STRING) {
+                Context.free(MEM_GENERATOR, (char *) op->text, op->id + 1);
+            }
+        }
+    }
+}
+
+/** Print instructions and remove them. Chunks are kept for next instructions,
+ *  so a buffer flushed from time to time takes as much memory as the most instructions between flushes.
+ *
+ * @param self buffer.
+ * @param sink output.
+ */
+static void Flush(instrbuf_t *self, const ifj21_sink_t *sink) {
+    Print(self, sink);
+    for (instr_chunk_t *chunk = self->head; chunk != NULL; chunk = chunk->next) {
+        release_cells(chunk->cells, chunk->len);
+        chunk->len = 0;
+    }
+    self->tail = self->head;
+    self->len = 0;
+}
+
+/**
+ * Interface to use when dealing with the buffer of instructions.
+ */
+const struct instrbuf_interface_t Instrbuf = {
+        .ctor = Ctor,
+        .append = Append,
+        .append_buf = Append_buf,
+        .mark = Mark,
+        .hoist = Hoist,
+        .clear = Clear,
+        .print = Print,
+        .flush = Flush,
+};
+
+#ifdef SELFTEST_instrbuf
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "FAILED: %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        failed = 1; \
+    } \
+} while (0)
+
+static void write_output(void *data, const char *s, size_t len) {
+    Dynstring.append_n(data, s, len);
+}
+
+/** Number of printed characters and the first ones of them.
+ */
+typedef struct flushed {
+    size_t len;
+    char start[64];
+} flushed_t;
+
+static void write_flushed(void *data, const char *s, size_t len) {
+    flushed_t *flushed = data;
+    if (flushed->len < sizeof(flushed->start)) {
+        size_t part = sizeof(flushed->start) - flushed->len;
+        memcpy(flushed->start + flushed->len, s, (len < part) ? len : part);
+    }
+    flushed->len += len;
+}
+
+/** Print a buffer to a new dynstring.
+ */
+static dynstring_t *printed(instrbuf_t *buf) {
+    dynstring_t *code = Dynstring.ctor("");
+    ifj21_sink_t sink = {.write = write_output, .data = code};
+    Instrbuf.print(buf, &sink);
+    return code;
+}
+
+/** Records are printed as the generator used to build their text.
+ */
+int main() {
+    int failed = 0;
+    Context.enter(Context.ctor(NULL));
+    const atom_t *x = Intern.get_c_str("x");
+
+    // every kind of operands.
+    instrbuf_t *buf = Instrbuf.ctor();
+    operand_t args[][3] = {
+            {{.type = OPERAND_VAR, .frame = FRAME_LF, .affix = AFFIX_FOR_VAR, .id = 12, .atom = x},
+                    {.type = OPERAND_TMP, .frame = FRAME_TF, .affix = AFFIX_WRITE, .id = 3},
+                    {.type = OPERAND_REG, .frame = FRAME_GF, .affix = AFFIX_EXPR_RESULT2}},
+            {{.type = OPERAND_LABEL, .affix = AFFIX_IF, .id = 7, .suffix = AFFIX_NUMBER, .num_i = 2},
+                    {.type = OPERAND_LABEL, .affix = AFFIX_FOR, .id = 7, .suffix = AFFIX_STEP_LE},
+                    {.type = OPERAND_LABEL, .affix = AFFIX_END, .id = 7}},
+            {{.type = OPERAND_FUNC, .text = "foo", .suffix = AFFIX_END},
+                    {.type = OPERAND_BUILTIN, .text = "ERROR_NIL"},
+                    {.type = OPERAND_INT, .num_i = 18446744073709551615u}},
+            {{.type = OPERAND_FLOAT, .num_f = 0.5},
+                    {.type = OPERAND_STRING, .text = "a b#\\\n\xc3", .id = 7},
+                    {.type = OPERAND_BOOL, .id = 1}},
+            {{.type = OPERAND_BOOL, .id = 0},
+                    {.type = OPERAND_NIL},
+                    {.type = OPERAND_TEXT, .text = "float@0x1.0p+0"}},
+    };
+    for (size_t i = 0; i < sizeof(args) / sizeof(args[0]); i++) {
+        Instrbuf.append(buf, INSTR(MOVE), NULL, 3, args[i]);
+    }
+    Instrbuf.append(buf, INSTR(ADDS), NULL, 0, NULL);
+    Instrbuf.append(buf, INSTR_TEXT, "# " INSTR_ARG(1) " and " INSTR_ARG(0) ",", 2, args[0]);
+    const char *expected =
+            "MOVE LF@%for%12%x TF@%write3 GF@%expr_result2\n"
+            "MOVE $if$7$2 $for$7$step_le $end$7\n"
+            "MOVE $foo$end $$ERROR_NIL int@18446744073709551615\n"
+            "MOVE float@0x1p-1 string@a\\032b\\035\\092\\010\\-61 bool@true\n"
+            "MOVE bool@false nil@nil float@0x1.0p+0\n"
+            "ADDS\n"
+            "# TF@%write3 and LF@%for%12%x,\n";
+    dynstring_t *code = printed(buf);
+    CHECK(strcmp(Dynstring.c_str(code), expected) == 0);
+    if (strcmp(Dynstring.c_str(code), expected) != 0) {
+        fprintf(stderr, "%s", Dynstring.c_str(code));
+    }
+
+    // hoisted instructions are printed in place of the mark, the last hoisted first.
+    instrbuf_t *loop = Instrbuf.ctor();
+    instrbuf_t *tmp = Instrbuf.ctor();
+    Instrbuf.append(loop, INSTR_TEXT, "before", 0, NULL);
+    instr_t *place = Instrbuf.mark(loop);
+    Instrbuf.append(loop, INSTR_TEXT, "loop", 0, NULL);
+    Instrbuf.append(tmp, INSTR_TEXT, "first", 0, NULL);
+    Instrbuf.append(tmp, INSTR_TEXT, "hoisted", 0, NULL);
+    Instrbuf.hoist(place, tmp);
+    Instrbuf.clear(tmp);
+    CHECK(tmp->len == 0);
+    Instrbuf.append(tmp, INSTR_TEXT, "second", 0, NULL);
+    Instrbuf.hoist(place, tmp);
+    Instrbuf.append_buf(loop, tmp);
+    code = printed(loop);
+    CHECK(strcmp(Dynstring.c_str(code), "before\nsecond\nfirst\nhoisted\nloop\nsecond\n") == 0);
+
+    // instructions are not split between chunks.
+    instrbuf_t *big = Instrbuf.ctor();
+    const size_t count = 100000;
+    for (size_t i = 0; i < count; i++) {
+        Instrbuf.append(big, INSTR(JUMPIFEQ), NULL, (i % 4), args[1]);
+    }
+    Instrbuf.clear(tmp);
+    Instrbuf.append_buf(tmp, big);
+    CHECK(tmp->len == big->len);
+    code = printed(tmp);
+    size_t lines = 0;
+    for (size_t i = 0; i < Dynstring.len(code); i++) {
+        lines += Dynstring.c_str(code)[i] == '\n';
+    }
+    CHECK(lines == count);
+    CHECK(strncmp(Dynstring.c_str(code), "JUMPIFEQ\nJUMPIFEQ $if$7$2\nJUMPIFEQ $if$7$2 $for$7$step_le\n", 57) == 0);
+
+    // flushed instructions are printed once, chunks, hoisted groups and strings are reused.
+    flushed_t flushed = {.len = 0};
+    ifj21_sink_t flushed_sink = {.write = write_flushed, .data = &flushed};
+    Instrbuf.flush(big, &flushed_sink);
+    CHECK(flushed.len == Dynstring.len(code));
+    size_t reserved = 0;
+    for (size_t round = 0; round < 3; round++) {
+        flushed.len = 0;
+        Instrbuf.append(big, INSTR_TEXT, "before", 0, NULL);
+        place = Instrbuf.mark(big);
+        char *chars = Context.alloc(MEM_GENERATOR, 3);
+        memcpy(chars, "ab", 2);
+        operand_t string = {.type = OPERAND_STRING, .text = chars, .id = 2};
+        Instrbuf.clear(tmp);
+        Instrbuf.append(tmp, INSTR(PUSHS), NULL, 1, &string);
+        Instrbuf.hoist(place, tmp);
+        for (size_t i = 0; i < count; i++) {
+            Instrbuf.append(big, INSTR(JUMPIFEQ), NULL, (i % 4), args[1]);
+        }
+        Instrbuf.flush(big, &flushed_sink);
+        CHECK(big->len == 0);
+        CHECK(flushed.len == Dynstring.len(code) + strlen("before\nPUSHS string@ab\n"));
+        CHECK(strncmp(flushed.start, "before\nPUSHS string@ab\nJUMPIFEQ\n", 32) == 0);
+        reserved = (round == 0) ? context->arena.reserved : reserved;
+    }
+    CHECK(context->arena.reserved == reserved);
+    CHECK(context->arena.reused >= 2);
+
+    printf("%s\n", failed ? "FAILED" : "OK");
+    Intern.free();
+    Context.dtor(context);
+    return failed;
+}
+
+#endif
@@ -0,0 +1,251 @@
+/**
+ * @file instrbuf.h
+ *
+ * @brief Buffer of generated instructions. An instruction is a record of an opcode and typed operands,
+ *        records are stored in chunked arrays, and the text of the code is made only when it is printed.
+ *
+ * @author Skuratovich Aliaksandr <xskura01@vutbr.cz>
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "intern.h"
+#include "compiler.h"
+
+
+/** Instructions of IFJcode21.
+ */
+#define INSTR_OPCODES(X) \
+    X(MOVE)              \
+    X(CREATEFRAME)       \
+    X(PUSHFRAME)         \
+    X(POPFRAME)          \
+    X(DEFVAR)            \
+    X(CALL)              \
+    X(RETURN)            \
+    X(PUSHS)             \
+    X(POPS)              \
+    X(CLEARS)            \
+    X(ADD)               \
+    X(SUB)               \
+    X(MUL)               \
+    X(DIV)               \
+    X(IDIV)              \
+    X(ADDS)              \
+    X(SUBS)              \
+    X(MULS)              \
+    X(DIVS)              \
+    X(IDIVS)             \
+    X(LT)                \
+    X(GT)                \
+    X(EQ)                \
+    X(LTS)               \
+    X(GTS)               \
+    X(EQS)               \
+    X(AND)               \
+    X(OR)                \
+    X(NOT)               \
+    X(ANDS)              \
+    X(ORS)               \
+    X(NOTS)              \
+    X(INT2FLOAT)         \
+    X(FLOAT2INT)         \
+    X(INT2CHAR)          \
+    X(STRI2INT)          \
+    X(READ)              \
+    X(WRITE)             \
+    X(CONCAT)            \
+    X(STRLEN)            \
+    X(GETCHAR)           \
+    X(SETCHAR)           \
+    X(TYPE)              \
+    X(LABEL)             \
+    X(JUMP)              \
+    X(JUMPIFEQ)          \
+    X(JUMPIFNEQ)         \
+    X(EXIT)              \
+    X(BREAK)             \
+    X(DPRINT)
+
+#define INSTR(name) INSTR_##name
+
+typedef enum opcode {
+    INSTR_TEXT, ///< text as it is, comments and fixed blocks of code. INSTR_ARG(i) in it is the i-th operand.
+    INSTR_HOIST, ///< place of instructions hoisted before a loop, it has no text itself.
+#define X(name) INSTR(name),
+    INSTR_OPCODES(X)
+#undef X
+} opcode_t;
+
+/** Placeholder of the i-th operand (0-9) in the text of INSTR_TEXT.
+ */
+#define INSTR_ARG(i) "\x01" #i
+
+/** Kinds of operands and how they are printed.
+ */
+typedef enum operand_type {
+    OPERAND_VAR, ///< <frame>@%<affix><id>%<atom>, variables of the program.
+    OPERAND_TMP, ///< <frame>@%<affix><id>, numbered variables of the generator, LF@%return0, TF@%0.
+    OPERAND_REG, ///< <frame>@%<affix>, global variables of the generator, GF@%expr_result.
+    OPERAND_LABEL, ///< $<affix>$<id>[$<suffix>], labels of statements, $if$12$3, $end$12.
+    OPERAND_FUNC, ///< $<text>[$<suffix>], labels of functions.
+    OPERAND_BUILTIN, ///< $$<text>, labels of the code of the generator, $$ERROR_NIL.
+    OPERAND_INT, ///< int@<num_i>
+    OPERAND_FLOAT, ///< float@<num_f in %a>
+    OPERAND_STRING, ///< string@<id characters of text, escaped>
+    OPERAND_BOOL, ///< bool@true if id is not 0, else bool@false.
+    OPERAND_NIL, ///< nil@nil
+    OPERAND_TEXT, ///< text as it is.
+} operand_type_t;
+
+typedef enum frame {
+    FRAME_GF,
+    FRAME_LF,
+    FRAME_TF,
+} frame_t;
+
+/** Parts of names of variables and labels.
+ */
+typedef enum affix {
+    AFFIX_NONE, ///< nothing.
+    AFFIX_NUMBER, ///< num_i of the operand, only as a suffix.
+    AFFIX_FOR_VAR, ///< for%
+    AFFIX_RETURN, ///< return
+    AFFIX_WRITE, ///< write
+    AFFIX_EXPR_RESULT, ///< expr_result
+    AFFIX_EXPR_RESULT2, ///< expr_result2
+    AFFIX_EXPR_RESULT3, ///< expr_result3
+    AFFIX_IF, ///< if
+    AFFIX_END, ///< end
+    AFFIX_WHILE, ///< while
+    AFFIX_REPEAT, ///< repeat
+    AFFIX_FOR, ///< for
+    AFFIX_STEP_LE, ///< step_le
+    AFFIX_BODY, ///< body
+} affix_t;
+
+/** Operand of an instruction, 16 bytes.
+ */
+typedef struct operand {
+    uint8_t type; ///< operand_type_t
+    uint8_t frame; ///< frame_t of variables.
+    uint8_t affix; ///< affix_t before the id.
+    uint8_t suffix; ///< affix_t after the id of labels.
+    uint32_t id; ///< scope id of variables and labels, index of numbered variables, length of strings.
+    union {
+        const atom_t *atom; ///< name of a variable.
+        const char *text; ///< characters of strings, names of functions and labels, text operands.
+        uint64_t num_i; ///< integer number, a number of a label.
+        double num_f; ///< floating point number.
+    };
+} operand_t;
+
+struct instr_group;
+
+/** Header of an instruction, 16 bytes. It is followed by argc operands in the same chunk.
+ */
+typedef struct instr {
+    uint8_t opcode; ///< opcode_t
+    uint8_t argc; ///< number of operands.
+    union {
+        const char *text; ///< text of INSTR_TEXT, it is not copied.
+        struct instr_group *hoisted; ///< instructions hoisted to INSTR_HOIST, the last hoisted is the first one.
+    };
+} instr_t;
+
+/** Cell of chunks, either a header of an instruction or an operand.
+ */
+typedef union instr_cell {
+    instr_t instr;
+    operand_t operand;
+} instr_cell_t;
+
+/** Chunk of instructions, an instruction is never split between two chunks.
+ */
+typedef struct instr_chunk {
+    struct instr_chunk *next; ///< next chunk.
+    size_t len; ///< number of used cells.
+    size_t cap; ///< number of cells.
+    instr_cell_t cells[]; ///< instructions one after another.
+} instr_chunk_t;
+
+/** Instructions hoisted at once.
+ */
+typedef struct instr_group {
+    struct instr_group *next; ///< group hoisted before this one.
+    size_t len; ///< number of cells.
+    instr_cell_t cells[]; ///< instructions one after another.
+} instr_group_t;
+
+/** Instructions in the order they are printed.
+ */
+typedef struct instrbuf {
+    instr_chunk_t *head; ///< first chunk.
+    instr_chunk_t *tail; ///< chunk instructions are appended to.
+    size_t len; ///< number of cells of all chunks.
+} instrbuf_t;
+
+
+extern const struct instrbuf_interface_t Instrbuf;
+
+struct instrbuf_interface_t {
+    /** Create an empty buffer in the memory of the compilation, its chunks are counted as MEM_GENERATOR.
+     *
+     * @return buffer.
+     */
+    instrbuf_t *(*ctor)(void);
+
+    /** Append an instruction.
+     *
+     * @param self buffer.
+     * @param opcode opcode_t.
+     * @param text text of INSTR_TEXT, it must live as long as the buffer, NULL otherwise.
+     * @param argc number of operands.
+     * @param args operands, strings and texts they point to must live as long as the buffer.
+     */
+    void (*append)(instrbuf_t *, opcode_t, const char *, size_t, const operand_t *);
+
+    /** Append instructions of another buffer.
+     *
+     * @param self buffer.
+     * @param other buffer, it is not changed.
+     */
+    void (*append_buf)(instrbuf_t *, const instrbuf_t *);
+
+    /** Append a place instructions can be hoisted to later.
+     *
+     * @param self buffer.
+     * @return the place.
+     */
+    instr_t *(*mark)(instrbuf_t *);
+
+    /** Hoist instructions of a buffer to a place. Instructions hoisted later are printed first.
+     *
+     * @param place the place from Instrbuf.mark().
+     * @param other buffer, it is not changed.
+     */
+    void (*hoist)(instr_t *, const instrbuf_t *);
+
+    /** Remove all instructions, the first chunk is kept.
+     *
+     * @param self buffer.
+     */
+    void (*clear)(instrbuf_t *);
+
+    /** Print instructions, each one is followed by a newline.
+     *
+     * @param self buffer.
+     * @param sink output.
+     */
+    void (*print)(const instrbuf_t *, const ifj21_sink_t *);
+
+    /** Print instructions and remove them, chunks are kept for next instructions.
+     *  Hoisted instructions and characters of string operands are given back to the memory of the compilation,
+     *  the characters must be allocated by Context.alloc(MEM_GENERATOR, length + 1).
+     *
+     * @param self buffer.
+     * @param sink output.
+     */
+    void (*flush)(instrbuf_t *, const ifj21_sink_t *);
+};
@@ -0,0 +1,233 @@
+/**
+ * @file intern.c
+ *
+ * @brief Tables of interned identifiers and function signatures. Implemented as hash tables with linear probing.
+ *
+ * @author Skuratovich Aliaksandr <xskura01@vutbr.cz>
+ */
+#include "intern.h"
+#include "errors.h"
+#include "context.h"
+
+
+// initial number of slots, a power of 2.
+#define INTERN_SLOTS 256
+
+
+// FNV-1a offset basis, the hash of an empty name.
+#define HASH_START 2166136261u
+
+
+/** FNV-1a hash of a name, continued from the hash of its prefix.
+ */
+static uint32_t hash_name(uint32_t h, const char *name, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char) name[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/** Make a table twice bigger.
+ */
+static void grow(intern_table_t *table) {
+    size_t capacity = table->capacity ? table->capacity * 2 : INTERN_SLOTS;
+    atom_t **slots = calloc(capacity, sizeof(atom_t *));
+    soft_assert(slots != NULL, ERROR_INTERNAL);
+
+    for (size_t i = 0; i < table->capacity; i++) {
+        atom_t *atom = table->slots[i];
+        if (atom == NULL) {
+            continue;
+        }
+        size_t slot = atom->hash & (capacity - 1);
+        while (slots[slot] != NULL) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        slots[slot] = atom;
+    }
+
+    if (context->mem_stats != NULL) {
+        MemStats.alloc(context->mem_stats, MEM_OTHER, capacity * sizeof(atom_t *));
+        MemStats.free(context->mem_stats, MEM_OTHER, table->capacity * sizeof(atom_t *));
+    }
+    free(table->slots);
+    table->slots = slots;
+    table->capacity = capacity;
+}
+
+/** Get the atom of a name from a table, the name is a prefix atom followed by characters.
+ *
+ * @param table
+ * @param prefix atom of the same table, or NULL.
+ * @param name characters after the prefix.
+ * @param len number of characters.
+ * @return atom.
+ */
+static const atom_t *intern(intern_table_t *table, const atom_t *prefix, const char *name, size_t len) {
+    if ((table->count + 1) * 2 > table->capacity) {
+        grow(table);
+    }
+
+    const char *prefix_chars = (prefix) ? Dynstring.c_str(prefix->name) : "";
+    size_t prefix_len = (prefix) ? Dynstring.len(prefix->name) : 0;
+    uint32_t hash = hash_name((prefix) ? prefix->hash : HASH_START, name, len);
+    size_t slot = hash & (table->capacity - 1);
+    atom_t *atom;
+
+    while ((atom = table->slots[slot]) != NULL) {
+        const char *chars = Dynstring.c_str(atom->name);
+        if (atom->hash == hash && Dynstring.len(atom->name) == prefix_len + len
+            && memcmp(chars, prefix_chars, prefix_len) == 0
+            && memcmp(chars + prefix_len, name, len) == 0) {
+            return atom;
+        }
+        slot = (slot + 1) & (table->capacity - 1);
+    }
+
+    atom = Context.alloc(MEM_OTHER, sizeof(atom_t));
+    atom->name = Dynstring.ctor_tagged("", MEM_OTHER);
+    Dynstring.append_n(atom->name, prefix_chars, prefix_len);
+    Dynstring.append_n(atom->name, name, len);
+    atom->hash = hash;
+    atom->id = (uint32_t) table->count++;
+    table->slots[slot] = atom;
+    return atom;
+}
+
+/** Get the atom of a name.
+ *
+ * @param name characters of the name.
+ * @param len length of the name.
+ * @return atom.
+ */
+static const atom_t *Get(const char *name, size_t len) {
+    return intern(&context->intern, NULL, name, len);
+}
+
+/** Get the atom of a C string name.
+ *
+ * @param name
+ * @return atom.
+ */
+static const atom_t *Get_c_str(const char *name) {
+    return Get(name, strlen(name));
+}
+
+/** Get the interned signature of types.
+ *
+ * @param types characters of types.
+ * @param len number of types.
+ * @return signature.
+ */
+static const atom_t *Signature(const char *types, size_t len) {
+    return intern(&context->signatures, NULL, types, len);
+}
+
+/** Get the signature with one more type at the end.
+ *
+ * @param signature
+ * @param type character of the type.
+ * @return signature.
+ */
+static const atom_t *Signature_append(const atom_t *signature, char type) {
+    return intern(&context->signatures, signature, &type, 1);
+}
+
+/** Number of interned names.
+ */
+static size_t Count() {
+    return context->intern.count;
+}
+
+/** Free all atoms, they are in the arena of the compilation.
+ */
+static void Free() {
+    free(context->intern.slots);
+    memset(&context->intern, 0x0, sizeof(context->intern));
+    free(context->signatures.slots);
+    memset(&context->signatures, 0x0, sizeof(context->signatures));
+}
+
+
+const struct intern_interface_t Intern = {
+        .get = Get,
+        .get_c_str = Get_c_str,
+        .signature = Signature,
+        .signature_append = Signature_append,
+        .count = Count,
+        .free = Free,
+};
+
+
+#ifdef SELFTEST_intern
+#include <time.h>
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/** Every name has exactly one atom, ids are stable when the table grows.
+ */
+int main() {
+    const size_t names = 100000;
+    const size_t rounds = 20;
+    const atom_t **atoms = calloc(names, sizeof(atom_t *));
+    char buf[32];
+    int failed = 0;
+    soft_assert(atoms != NULL, ERROR_INTERNAL);
+    Context.enter(Context.ctor(NULL));
+
+    for (size_t i = 0; i < names; i++) {
+        sprintf(buf, "id_%zu", i);
+        atoms[i] = Get_c_str(buf);
+        if (atoms[i]->id != i || strcmp(Dynstring.c_str(atoms[i]->name), buf) != 0) {
+            fprintf(stderr, "FAILED: '%s' got a wrong atom\n", buf);
+            failed = 1;
+        }
+    }
+
+    double start = now();
+    for (size_t r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < names; i++) {
+            sprintf(buf, "id_%zu", i);
+            if (Get_c_str(buf) != atoms[i]) {
+                fprintf(stderr, "FAILED: '%s' was interned twice\n", buf);
+                failed = 1;
+            }
+        }
+    }
+    double lookup = now() - start;
+
+    if (Count() != names) {
+        fprintf(stderr, "FAILED: %zu atoms for %zu names\n", Count(), names);
+        failed = 1;
+    }
+
+    // signatures built type by type are the same as whole ones, and names are not signatures.
+    const char *types = "sifbnsifbn";
+    const atom_t *signature = Signature("", 0);
+    for (size_t len = 1; len <= strlen(types); len++) {
+        signature = Signature_append(signature, types[len - 1]);
+        if (signature != Signature(types, len) || Dynstring.len(signature->name) != len
+            || memcmp(Dynstring.c_str(signature->name), types, len) != 0) {
+            fprintf(stderr, "FAILED: signature '%.*s' was interned twice\n", (int) len, types);
+            failed = 1;
+        }
+    }
+    if (Signature("s", 1) == Get_c_str("s") || Signature("s", 1) != Signature_append(Signature("", 0), 's')) {
+        fprintf(stderr, "FAILED: signatures are not in their own table\n");
+        failed = 1;
+    }
+
+    printf("intern table, %zu names: %6.2f ns/lookup\n", names, lookup * 1e9 / (double) (rounds * names));
+    printf("%s\n", failed ? "FAILED" : "OK");
+
+    free(atoms);
+    Free();
+    Context.dtor(context);
+    return failed;
+}
+#endif
@@ -0,0 +1,80 @@
+/**
+ * @file intern.h
+ *
+ * @brief Tables of interned identifiers and function signatures.
+ *
+ * @author Skuratovich Aliaksandr <xskura01@vutbr.cz>
+ */
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include "dynstring.h"
+#include "debug.h"
+
+
+/** An interned identifier. There is only one atom for every name,
+ *  so atoms are compared by pointers.
+ */
+typedef struct atom {
+    dynstring_t *name; ///< the name, it lives until Intern.free().
+    uint32_t hash; ///< hash of the name.
+    uint32_t id; ///< atoms are numbered from 0 in the order of interning.
+} atom_t;
+
+/** Table of atoms, one for every compilation.
+ *  slots has a power of 2 entries and is at most half full.
+ */
+typedef struct intern_table {
+    atom_t **slots;
+    size_t capacity;
+    size_t count;
+} intern_table_t;
+
+
+extern const struct intern_interface_t Intern;
+
+struct intern_interface_t {
+    /** Get the atom of a name. It is created, when the name is seen for the first time.
+     *
+     * @param name characters of the name.
+     * @param len length of the name.
+     * @return atom.
+     */
+    const atom_t *(*get)(const char *, size_t);
+
+    /** Get the atom of a C string name.
+     *
+     * @param name
+     * @return atom.
+     */
+    const atom_t *(*get_c_str)(const char *);
+
+    /** Get the interned signature of types, signatures are compared by pointers as names are.
+     *  A signature is a string of characters of types, see Semantics.of_id_type().
+     *
+     * @param types characters of types.
+     * @param len number of types.
+     * @return signature.
+     */
+    const atom_t *(*signature)(const char *, size_t);
+
+    /** Get the signature with one more type at the end, without hashing the signature again.
+     *
+     * @param signature
+     * @param type character of the type.
+     * @return signature.
+     */
+    const atom_t *(*signature_append)(const atom_t *, char);
+
+    /** Number of interned names.
+     */
+    size_t (*count)(void);
+
+    /** Free all atoms and signatures.
+     */
+    void (*free)(void);
+};
@@ -5,6 +5,7 @@
  * @author Lucie Svobodova <xsvobo1x@vutbr.cz>
  */
 #include "list.h"
+#include "context.h"
 
 
 /**
@@ -13,9 +14,7 @@
  * @return Pointer to the allocated memory.
  */
 static list_t *Ctor(void) {
-    list_t *l = calloc(1, sizeof(list_t));
-    soft_assert(l != NULL, ERROR_INTERNAL);
-    return l;
+    return Context.alloc(MEM_LIST, sizeof(list_t));
 }
 
 /**
@@ -27,8 +26,7 @@ static list_t *Ctor(void) {
 static void Prepend(list_t *list, void *data) {
     soft_assert(list != NULL, ERROR_INTERNAL);
 
-    list_item_t *new_item = calloc(1, sizeof(list_item_t));
-    soft_assert(new_item != NULL, ERROR_INTERNAL);
+    list_item_t *new_item = Context.alloc(MEM_LIST, sizeof(list_item_t));
 
     if (List.copy_data != NULL) {
         List.copy_data(new_item, data);
@@ -48,8 +46,7 @@ static void Prepend(list_t *list, void *data) {
 static void Append(list_t *list, void *data) {
     soft_assert(list != NULL, ERROR_INTERNAL);
 
-    list_item_t *new_item = calloc(1, sizeof(list_item_t));
-    soft_assert(new_item, ERROR_INTERNAL);
+    list_item_t *new_item = Context.alloc(MEM_LIST, sizeof(list_item_t));
 
     if (List.copy_data != NULL) {
         List.copy_data(new_item, data);
@@ -69,8 +66,7 @@ static void Append(list_t *list, void *data) {
 static void Insert_after(list_item_t *item, void *data) {
     soft_assert(item != NULL, ERROR_INTERNAL);
 
-    list_item_t *new_item = calloc(1, sizeof(list_item_t));
-    soft_assert(new_item, ERROR_INTERNAL);
+    list_item_t *new_item = Context.alloc(MEM_LIST, sizeof(list_item_t));
 
     if (List.copy_data != NULL) {
         List.copy_data(new_item, data);
@@ -99,7 +95,7 @@ static void Delete_first(list_t *list, void (*clear_fun)(void *)) {
 
     list->head = list->head->next;
     clear_fun(tmp->data);
-    free(tmp);
+    Context.free(MEM_LIST, tmp, sizeof(list_item_t));
 }
 
 static void Print_list(list_t *list, char *(*pp_fun)(void *)) {
@@ -144,9 +140,9 @@ static void Dtor(list_t *list, void (*clear_fun)(void *)) {
         return;
     }
     soft_assert(clear_fun != NULL, ERROR_INTERNAL);
-    
+
     Clear(list, clear_fun);
-    free(list);
+    Context.free(MEM_LIST, list, sizeof(list_t));
 }
 
 /**
@@ -158,8 +154,7 @@ static void Dtor(list_t *list, void (*clear_fun)(void *)) {
 static void Insert(list_item_t *reference_item, void *data) {
     soft_assert(reference_item, ERROR_INTERNAL);
 
-    list_item_t *new_item = calloc(1, sizeof(list_item_t));
-    soft_assert(new_item, ERROR_INTERNAL);
+    list_item_t *new_item = Context.alloc(MEM_LIST, sizeof(list_item_t));
 
     new_item->data = data;
     list_item_t *tmp = reference_item->next;
@@ -0,0 +1,378 @@
+/**
+ * @file memstats.c
+ *
+ * @brief Counters of memory of a compilation by subsystems of the compiler.
+ *
+ * @author Skuratovich Aliaksandr <xskura01@vutbr.cz>
+ */
+#include "memstats.h"
+
+
+/** Add bytes to a counter.
+ */
+static void count(mem_counter_t *counter, size_t size) {
+    counter->allocations++;
+    counter->bytes += size;
+    counter->live += size;
+    if (counter->live > counter->peak) {
+        counter->peak = counter->live;
+    }
+}
+
+/** Count an allocation.
+ *
+ * @param stats
+ * @param tag subsystem.
+ * @param size bytes of the allocation.
+ */
+static void Alloc(mem_stats_t *stats, mem_tag_t tag, size_t size) {
+    count(&stats->tags[tag], size);
+    count(&stats->total, size);
+}
+
+/** Count an allocation that grows from old_size to new_size bytes.
+ *
+ * @param stats
+ * @param tag subsystem.
+ * @param old_size
+ * @param new_size
+ */
+static void Grow(mem_stats_t *stats, mem_tag_t tag, size_t old_size, size_t new_size) {
+    size_t size = (new_size > old_size) ? new_size - old_size : 0;
+    count(&stats->tags[tag], size);
+    count(&stats->total, size);
+}
+
+/** Count freed memory.
+ *
+ * @param stats
+ * @param tag subsystem.
+ * @param size bytes of the allocation.
+ */
+static void Free(mem_stats_t *stats, mem_tag_t tag, size_t size) {
+    stats->tags[tag].live -= size;
+    stats->total.live -= size;
+}
+
+/** Name of a subsystem.
+ *
+ * @param tag
+ * @return name.
+ */
+static const char *Name(mem_tag_t tag) {
+    static const char *names[MEM_TAGS] = {
+            [MEM_DYNSTRING] = "dynstring",
+            [MEM_LIST] = "list/stack",
+            [MEM_SYMTABLE] = "symtable/symstack",
+            [MEM_EXPRESSIONS] = "expressions",
+            [MEM_GENERATOR] = "generator",
+            [MEM_OTHER] = "other",
+    };
+    return names[tag];
+}
+
+/** Print a report.
+ *
+ * @param stats
+ * @param out
+ * @param json print a JSON object instead of a table.
+ */
+static void Print(const mem_stats_t *stats, FILE *out, bool json) {
+    if (json) {
+        fprintf(out, "{\"subsystems\": {");
+        for (mem_tag_t tag = 0; tag < MEM_TAGS; tag++) {
+            const mem_counter_t *c = &stats->tags[tag];
+            fprintf(out, "%s\"%s\": {\"allocations\": %zu, \"bytes\": %zu, \"peak_bytes\": %zu}",
+                    tag ? ", " : "", Name(tag), c->allocations, c->bytes, c->peak);
+        }
+        fprintf(out, "}, \"total\": {\"allocations\": %zu, \"bytes\": %zu, \"peak_bytes\": %zu}, "
+                     "\"arena\": {\"chunks\": %zu, \"reserved_bytes\": %zu, \"big_blocks_peak_bytes\": %zu}}\n",
+                stats->total.allocations, stats->total.bytes, stats->total.peak,
+                stats->chunks, stats->reserved, stats->big_peak);
+        return;
+    }
+
+    fprintf(out, "%-20s %12s %14s %14s\n", "subsystem", "allocations", "bytes", "peak bytes");
+    for (mem_tag_t tag = 0; tag < MEM_TAGS; tag++) {
+        const mem_counter_t *c = &stats->tags[tag];
+        fprintf(out, "%-20s %12zu %14zu %14zu\n", Name(tag), c->allocations, c->bytes, c->peak);
+    }
+    fprintf(out, "%-20s %12zu %14zu %14zu\n", "total",
+            stats->total.allocations, stats->total.bytes, stats->total.peak);
+    fprintf(out, "arena: %zu chunks, %zu bytes reserved, %zu bytes of big blocks at most\n",
+            stats->chunks, stats->reserved, stats->big_peak);
+}
+
+
+const struct mem_stats_interface_t MemStats = {
+        .alloc = Alloc,
+        .grow = Grow,
+        .free = Free,
+        .name = Name,
+        .print = Print,
+};
+
+#ifdef SELFTEST_memstats
+#include "compiler.h"
+#include "dynstring.h"
+#include <string.h>
+#include <stdlib.h>
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "FAILED: %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        failed = 1; \
+    } \
+} while (0)
+
+/** Generated code of a compilation.
+ */
+typedef struct output {
+    dynstring_t *code;
+} output_t;
+
+static void write_output(void *data, const char *s, size_t len) {
+    Dynstring.append_n(((output_t *) data)->code, s, len);
+}
+
+static const char program[] =
+        "require \"ifj21\"\n"
+        "function f(a : integer, b : string) : integer, string\n"
+        "    local x : integer = a * 2 + (a - 1) // 2\n"
+        "    return x, b .. \"!\"\n"
+        "end\n"
+        "function main()\n"
+        "    local s : string = \"hello\"\n"
+        "    local n : integer\n"
+        "    n, s = f(3, s)\n"
+        "    write(n, s, \"\\n\")\n"
+        "    while n > 0 do\n"
+        "        n = n - 1\n"
+        "    end\n"
+        "end\n"
+        "main()\n";
+
+/** Compile a program into out.
+ */
+static int compile(const char *src, size_t len, output_t *out, mem_stats_t *stats) {
+    const ifj21_sink_t sink = {.write = write_output, .data = out};
+    pfile_t *pfile = Pfile.ctor_n(src, len);
+    int error = ifj21_compile_file_stats(pfile, NULL, &sink, stats);
+    Pfile.dtor(pfile);
+    return error;
+}
+
+static void write_nothing(void *data, const char *s, size_t len) {
+    (void) data;
+    (void) s;
+    (void) len;
+}
+
+/** Program with an expression of terms terms, x + x + ... + x.
+ */
+static char *long_expression(size_t terms, size_t *len) {
+    static const char head[] = "require \"ifj21\"\n"
+                               "function main()\n"
+                               "  local x : integer = 1\n"
+                               "  local y : integer = x";
+    static const char term[] = " + x";
+    static const char tail[] = "\n"
+                               "  write(y)\n"
+                               "end\n"
+                               "main()\n";
+    *len = sizeof(head) - 1 + (terms - 1) * (sizeof(term) - 1) + sizeof(tail) - 1;
+    char *src = malloc(*len + 1);
+    soft_assert(src != NULL, ERROR_INTERNAL);
+    char *end = src;
+    memcpy(end, head, sizeof(head) - 1);
+    end += sizeof(head) - 1;
+    for (size_t i = 1; i < terms; i++) {
+        memcpy(end, term, sizeof(term) - 1);
+        end += sizeof(term) - 1;
+    }
+    memcpy(end, tail, sizeof(tail));
+    return src;
+}
+
+/** Program with an expression of x in depth parentheses, ((...(x)...)).
+ */
+static char *nested_parentheses(size_t depth, size_t *len) {
+    static const char head[] = "require \"ifj21\"\n"
+                               "function main()\n"
+                               "  local x : integer = 1\n"
+                               "  local y : integer = ";
+    static const char tail[] = "\n"
+                               "  write(y)\n"
+                               "end\n"
+                               "main()\n";
+    *len = sizeof(head) - 1 + 2 * depth + 1 + sizeof(tail) - 1;
+    char *src = malloc(*len + 1);
+    soft_assert(src != NULL, ERROR_INTERNAL);
+    char *end = src;
+    memcpy(end, head, sizeof(head) - 1);
+    end += sizeof(head) - 1;
+    memset(end, '(', depth);
+    end += depth;
+    *end++ = 'x';
+    memset(end, ')', depth);
+    end += depth;
+    memcpy(end, tail, sizeof(tail));
+    return src;
+}
+
+/** Program of functions writing a string literal of chars characters.
+ */
+static char *long_literals(size_t functions, size_t chars, size_t *len) {
+    static const char tail[] = "function main()\n"
+                               "  f0()\n"
+                               "end\n"
+                               "main()\n";
+    char *literal = malloc(chars);
+    soft_assert(literal != NULL, ERROR_INTERNAL);
+    memset(literal, 'a', chars);
+
+    dynstring_t *src = Dynstring.ctor("require \"ifj21\"\n");
+    char head[64];
+    for (size_t i = 0; i < functions; i++) {
+        snprintf(head, sizeof(head), "function f%zu()\n  write(\"", i);
+        Dynstring.append_n(src, head, strlen(head));
+        Dynstring.append_n(src, literal, chars);
+        Dynstring.append_n(src, "\")\nend\n", 7);
+    }
+    Dynstring.append_n(src, tail, sizeof(tail) - 1);
+    free(literal);
+
+    *len = Dynstring.len(src);
+    char *program = malloc(*len + 1);
+    soft_assert(program != NULL, ERROR_INTERNAL);
+    memcpy(program, Dynstring.c_str(src), *len + 1);
+    Dynstring.dtor(src);
+    return program;
+}
+
+/** Compile a program with code streamed without comments to nowhere.
+ */
+static int compile_streamed(char *src, size_t len, mem_stats_t *stats) {
+    const ifj21_sink_t nothing = {.write = write_nothing};
+    pfile_t *pfile = Pfile.ctor_n(src, len);
+    *stats = (mem_stats_t) {0};
+    int error = ifj21_compile_file_stats(pfile, &(ifj21_options_t) {.stream_code = true, .emit = IFJ21_EMIT_NONE},
+                                         &nothing, stats);
+    Pfile.dtor(pfile);
+    free(src);
+    return error;
+}
+
+/** Counters of subsystems must add up to the total.
+ *
+ * @param stats counters of one compilation.
+ * @param error error code of the compilation.
+ * @return 0 if they do.
+ */
+static int check_counters(const mem_stats_t *stats, int error) {
+    int failed = 0;
+    mem_counter_t sum = {0};
+    for (mem_tag_t tag = 0; tag < MEM_TAGS; tag++) {
+        CHECK(stats->tags[tag].peak >= stats->tags[tag].live);
+        CHECK(stats->tags[tag].bytes >= stats->tags[tag].peak);
+        sum.allocations += stats->tags[tag].allocations;
+        sum.bytes += stats->tags[tag].bytes;
+        sum.live += stats->tags[tag].live;
+    }
+    CHECK(sum.allocations == stats->total.allocations && sum.bytes == stats->total.bytes);
+    CHECK(sum.live == stats->total.live && stats->total.peak >= stats->total.live);
+    CHECK(stats->chunks > 0 && stats->reserved > 0);
+    // the precedence stack is freed with the parser.
+    CHECK(error != 0 || stats->tags[MEM_EXPRESSIONS].live == 0);
+    return failed;
+}
+
+/** Usage: memstats_selftest [files...]
+ *  Counters of a compilation must add up and must not change the generated code,
+ *  the same for compilations of the files.
+ */
+int main(int argc, char **argv) {
+    fprintf(stderr, "Selftests: %s\n", __FILE__);
+    int failed = 0;
+
+    mem_stats_t stats = {0};
+    MemStats.alloc(&stats, MEM_LIST, 100);
+    MemStats.grow(&stats, MEM_LIST, 100, 300);
+    MemStats.free(&stats, MEM_LIST, 300);
+    MemStats.alloc(&stats, MEM_OTHER, 50);
+    CHECK(stats.tags[MEM_LIST].allocations == 2 && stats.tags[MEM_LIST].bytes == 300);
+    CHECK(stats.tags[MEM_LIST].live == 0 && stats.tags[MEM_LIST].peak == 300);
+    CHECK(stats.total.live == 50 && stats.total.peak == 300);
+
+    output_t plain = {Dynstring.ctor("")};
+    output_t counted = {Dynstring.ctor("")};
+    stats = (mem_stats_t) {0};
+    CHECK(compile(program, sizeof(program) - 1, &plain, NULL) == 0);
+    CHECK(compile(program, sizeof(program) - 1, &counted, &stats) == 0);
+    CHECK(Dynstring.len(plain.code) > 0 && Dynstring.cmp(plain.code, counted.code) == 0);
+    for (mem_tag_t tag = 0; tag < MEM_TAGS; tag++) {
+        CHECK(stats.tags[tag].allocations > 0);
+    }
+    failed |= check_counters(&stats, 0);
+    Dynstring.dtor(plain.code);
+    Dynstring.dtor(counted.code);
+    printf("memory counters: %s\n", failed ? "FAILED" : "OK");
+
+    // the precedence stack of a long expression is as big as of a short one, steps of parse() are not recursive.
+    const size_t terms[] = {1000, 1000000};
+    size_t peaks[2];
+    size_t len;
+    for (int i = 0; i < 2; i++) {
+        char *src = long_expression(terms[i], &len);
+        CHECK(compile_streamed(src, len, &stats) == 0);
+        peaks[i] = stats.tags[MEM_EXPRESSIONS].peak;
+    }
+    CHECK(peaks[0] == peaks[1]);
+    printf("expression of %zu terms: %zu bytes of expressions: %s\n", terms[1], peaks[1], failed ? "FAILED" : "OK");
+
+    // parentheses are items of the precedence stack, not calls of parse().
+    char *src = nested_parentheses(100000, &len);
+    CHECK(compile_streamed(src, len, &stats) == 0);
+    printf("expression in %d parentheses: %zu bytes of expressions: %s\n", 100000,
+           stats.tags[MEM_EXPRESSIONS].peak, failed ? "FAILED" : "OK");
+
+    // long literals of functions, which are printed, are freed, the compilation reserves
+    // as much memory for them as for short ones, and no more for more of them.
+    mem_stats_t short_literals, few_literals, literals;
+    src = long_literals(4000, 10, &len);
+    CHECK(compile_streamed(src, len, &short_literals) == 0);
+    src = long_literals(1000, 2000, &len);
+    CHECK(compile_streamed(src, len, &few_literals) == 0);
+    src = long_literals(4000, 2000, &len);
+    CHECK(compile_streamed(src, len, &literals) == 0);
+    CHECK(literals.reserved == short_literals.reserved);
+    CHECK(literals.big_peak == few_literals.big_peak);
+    printf("4000 literals of 2000 characters: %zu bytes reserved, %zu bytes of big blocks: %s\n",
+           literals.reserved, literals.big_peak, failed ? "FAILED" : "OK");
+
+    int files_failed = 0;
+    for (int i = 1; i < argc; i++) {
+        pfile_t *pfile = Pfile.getfile(argv[i]);
+        if (pfile == NULL) {
+            continue;
+        }
+        plain = (output_t) {Dynstring.ctor("")};
+        counted = (output_t) {Dynstring.ctor("")};
+        stats = (mem_stats_t) {0};
+        int error = compile(Pfile.get_tape(pfile), Pfile.available(pfile), &plain, NULL);
+        int counted_error = compile(Pfile.get_tape(pfile), Pfile.available(pfile), &counted, &stats);
+        if (error != counted_error || Dynstring.cmp(plain.code, counted.code) != 0
+            || check_counters(&stats, error) != 0) {
+            fprintf(stderr, "FAILED: %s\n", argv[i]);
+            files_failed = 1;
+        }
+        Pfile.dtor(pfile);
+        Dynstring.dtor(plain.code);
+        Dynstring.dtor(counted.code);
+    }
+    if (argc > 1) {
+        printf("%d programs: %s\n", argc - 1, files_failed ? "FAILED" : "OK");
+    }
+    return failed | files_failed;
+}
+#endif
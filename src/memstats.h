@@ -0,0 +1,90 @@
+/**
+ * @file memstats.h
+ *
+ * @brief Counters of memory of a compilation by subsystems of the compiler.
+ *        They are counted only if the compilation has them, see ifj21_compile_file_stats().
+ *
+ * @author Skuratovich Aliaksandr <xskura01@vutbr.cz>
+ */
+#pragma once
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+
+/** Subsystems, every allocation of a compilation belongs to one of them.
+ */
+typedef enum mem_tag {
+    MEM_DYNSTRING, ///< dynstrings, except instructions.
+    MEM_LIST, ///< lists and stacks.
+    MEM_SYMTABLE, ///< symbol tables, the symbol stack and function semantics.
+    MEM_EXPRESSIONS, ///< items of the precedence stack.
+    MEM_GENERATOR, ///< instructions of the generated code.
+    MEM_OTHER, ///< interned names and signatures.
+    MEM_TAGS,
+} mem_tag_t;
+
+/** Counters of one subsystem.
+ */
+typedef struct mem_counter {
+    size_t allocations; ///< number of allocations, growing counts as one.
+    size_t bytes; ///< bytes of all allocations.
+    size_t live; ///< bytes allocated and not freed yet.
+    size_t peak; ///< the most bytes live at once.
+} mem_counter_t;
+
+/** Counters of a compilation, a zero-initialised struct is empty.
+ */
+typedef struct mem_stats {
+    mem_counter_t tags[MEM_TAGS]; ///< counters of subsystems.
+    mem_counter_t total; ///< counters of all subsystems, its peak is the peak of their sum.
+    size_t reserved; ///< bytes of chunks of the arena.
+    size_t chunks; ///< number of chunks of the arena.
+    size_t big_peak; ///< the most bytes of big blocks of the arena at once, they are not in chunks.
+} mem_stats_t;
+
+
+extern const struct mem_stats_interface_t MemStats;
+
+struct mem_stats_interface_t {
+    /** Count an allocation.
+     *
+     * @param stats
+     * @param tag subsystem.
+     * @param size bytes of the allocation.
+     */
+    void (*alloc)(mem_stats_t *, mem_tag_t, size_t);
+
+    /** Count an allocation that grows from old_size to new_size bytes.
+     *
+     * @param stats
+     * @param tag subsystem.
+     * @param old_size
+     * @param new_size
+     */
+    void (*grow)(mem_stats_t *, mem_tag_t, size_t, size_t);
+
+    /** Count freed memory.
+     *
+     * @param stats
+     * @param tag subsystem.
+     * @param size bytes of the allocation.
+     */
+    void (*free)(mem_stats_t *, mem_tag_t, size_t);
+
+    /** Name of a subsystem.
+     *
+     * @param tag
+     * @return name.
+     */
+    const char *(*name)(mem_tag_t);
+
+    /** Print a report.
+     *
+     * @param stats
+     * @param out
+     * @param json print a JSON object instead of a table.
+     */
+    void (*print)(const mem_stats_t *, FILE *, bool);
+};
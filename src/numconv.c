@@ -0,0 +1,298 @@
+/**
+ * @file numconv.c
+ *
+ * @brief Conversions of numeric literals. Doubles are rounded by the Clinger's fast path,
+ *        then by the Eisel-Lemire algorithm, and strtod() is called only if both of them cannot decide.
+ *
+ * @author Skuratovich Aliaksandr <xskura01@vutbr.cz>
+ */
+#include "numconv.h"
+#include "numconv_table.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+
+// doubles have 53 bits of the mantissa, so integers up to 2^53 are exact.
+#define EXACT_MANTISSA (1ull << 53)
+// 10^22 is the biggest power of ten, which is an exact double.
+#define EXACT_POW10 22
+
+#ifdef __SIZEOF_INT128__
+__extension__ typedef unsigned __int128 uint128_t;
+#endif
+
+static const double exact_pow10[EXACT_POW10 + 1] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+
+/** Full product of 64-bit numbers.
+ *
+ * @param a
+ * @param b
+ * @param lo returns the lower 64 bits.
+ * @return the higher 64 bits.
+ */
+static inline uint64_t mul_128(uint64_t a, uint64_t b, uint64_t *lo) {
+#ifdef __SIZEOF_INT128__
+    uint128_t x = (uint128_t) a * b;
+    *lo = (uint64_t) x;
+    return (uint64_t) (x >> 64);
+#else
+    uint64_t p0 = (a & 0xffffffff) * (b & 0xffffffff), p1 = (a & 0xffffffff) * (b >> 32);
+    uint64_t p2 = (a >> 32) * (b & 0xffffffff), p3 = (a >> 32) * (b >> 32);
+    uint64_t mid = (p0 >> 32) + (p1 & 0xffffffff) + (p2 & 0xffffffff);
+    *lo = (mid << 32) | (p0 & 0xffffffff);
+    return p3 + (p1 >> 32) + (p2 >> 32) + (mid >> 32);
+#endif
+}
+
+/** Eisel-Lemire algorithm, w * 10^q rounded to the nearest double.
+ *  See D. Lemire, Number Parsing at a Gigabyte per Second, 2021.
+ *
+ * @param w nonzero mantissa.
+ * @param q exponent in [POW10_MIN, POW10_MAX].
+ * @param res returns the double.
+ * @return false if the result is not decided, it is a halfway case, a subnormal or an infinity.
+ */
+static bool eisel_lemire(uint64_t w, int64_t q, double *res) {
+    const uint64_t *pow10 = pow10_128[q - POW10_MIN];
+    int lz = __builtin_clzll(w);
+    w <<= lz;
+    // floor(log2(10^q)) + 64 + bias, the shift of a negative number is arithmetic.
+    uint64_t exp2 = (uint64_t) (((217706 * q) >> 16) + 64 + 1023 - lz);
+
+    // the highest 128 bits of w * 10^q.
+    uint64_t lo;
+    uint64_t hi = mul_128(w, pow10[0], &lo);
+    if ((hi & 0x1ff) == 0x1ff && lo + w < w) {
+        // the lower part of the power can change the result.
+        uint64_t y_lo;
+        uint64_t y_hi = mul_128(w, pow10[1], &y_lo);
+        uint64_t merged_lo = lo + y_hi;
+        hi += merged_lo < lo;
+        lo = merged_lo;
+        if ((hi & 0x1ff) == 0x1ff && lo + 1 == 0 && y_lo + w < w) {
+            return false;
+        }
+    }
+
+    // 54 bits of the mantissa.
+    uint64_t msb = hi >> 63;
+    uint64_t mantissa = hi >> (msb + 9);
+    exp2 -= 1 ^ msb;
+    if (lo == 0 && (hi & 0x1ff) == 0 && (mantissa & 3) == 1) {
+        // halfway between two doubles.
+        return false;
+    }
+
+    // round to 53 bits.
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    if (mantissa >> 53) {
+        mantissa >>= 1;
+        exp2++;
+    }
+    if (exp2 - 1 >= 0x7ff - 1) {
+        return false;
+    }
+
+    uint64_t bits = exp2 << 52 | (mantissa & ((1ull << 52) - 1));
+    memcpy(res, &bits, sizeof(bits));
+    return true;
+}
+
+/** Round an accumulated decimal to the nearest double.
+ *
+ * @param d decimal.
+ * @param text characters of the literal for strtod().
+ * @return double.
+ */
+static double To_double(const decimal_t *d, const char *text) {
+    int64_t q = d->exp10 + (d->negative ? -d->exponent : d->exponent);
+    uint64_t w = d->mantissa;
+    double res, res_up;
+
+    if (w == 0 || q < POW10_MIN) {
+        return 0.0;
+    }
+    if (q > POW10_MAX) {
+        return HUGE_VAL;
+    }
+    if (!d->truncated) {
+        // both w and 10^|q| are exact, so the only rounding is in the operation.
+        if (w <= EXACT_MANTISSA && q >= -EXACT_POW10 && q <= EXACT_POW10) {
+            return (q < 0) ? (double) w / exact_pow10[-q] : (double) w * exact_pow10[q];
+        }
+        if (eisel_lemire(w, q, &res)) {
+            return res;
+        }
+    } else if (eisel_lemire(w, q, &res) && eisel_lemire(w + 1, q, &res_up) && res == res_up) {
+        // the value is between w * 10^q and (w + 1) * 10^q, which round the same way.
+        return res;
+    }
+    return strtod(text, NULL);
+}
+
+/** Parse a float literal.
+ *
+ * @param text
+ * @return double.
+ */
+static double Parse_double(const char *text) {
+    decimal_t d = {0,};
+    const char *s = text;
+
+    for (; *s >= '0' && *s <= '9'; s++) {
+        decimal_digit(&d, *s);
+    }
+    if (*s == '.') {
+        d.fraction = true;
+        for (s++; *s >= '0' && *s <= '9'; s++) {
+            decimal_digit(&d, *s);
+        }
+    }
+    if (*s == 'e' || *s == 'E') {
+        s++;
+        d.negative = *s == '-';
+        s += (*s == '-' || *s == '+');
+        for (; *s >= '0' && *s <= '9'; s++) {
+            decimal_exp_digit(&d, *s);
+        }
+    }
+    return To_double(&d, text);
+}
+
+/** Parse an integer literal.
+ *
+ * @param text
+ * @return uint64_t.
+ */
+static uint64_t Parse_uint(const char *text) {
+    decimal_t d = {0,};
+
+    for (; *text >= '0' && *text <= '9'; text++) {
+        decimal_digit(&d, *text);
+    }
+    return d.integer;
+}
+
+
+const struct numconv_interface_t Numconv = {
+        .to_double = To_double,
+        .parse_double = Parse_double,
+        .parse_uint = Parse_uint,
+};
+
+
+#ifdef SELFTEST_numconv
+#include <stdio.h>
+#include <time.h>
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint64_t rand64() {
+    return (uint64_t) rand() << 62 ^ (uint64_t) rand() << 31 ^ (uint64_t) rand();
+}
+
+/** Random literal the scanner can accept.
+ */
+static void random_literal(char *buf) {
+    switch (rand() % 4) {
+        case 0: {
+            // shortest representations of doubles.
+            double v;
+            do {
+                uint64_t bits = rand64() & ~(1ull << 63);
+                memcpy(&v, &bits, sizeof(v));
+            } while (!isfinite(v));
+            sprintf(buf, "%.*e", rand() % 17 + 1, v);
+            break;
+        }
+        case 1:
+            sprintf(buf, "%llu.%llue%d", (unsigned long long) (rand64() % 1000000),
+                    (unsigned long long) (rand64() % 1000000), rand() % 60 - 30);
+            break;
+        case 2: {
+            // many digits, which are truncated.
+            int len = rand() % 40 + 1;
+            for (int i = 0; i < len; i++) {
+                buf[i] = (char) ('0' + rand() % 10);
+            }
+            buf[0] = (char) ('1' + rand() % 9);
+            sprintf(buf + len, ".%de%d", rand() % 10, rand() % 700 - 350);
+            break;
+        }
+        default:
+            sprintf(buf, "%d.%d", rand() % 1000, rand() % 1000);
+            break;
+    }
+}
+
+/** Conversions must be bit-exact with strtod() and strtoull().
+ */
+int main() {
+    const size_t count = 2000000;
+    static const char *edge[] = {
+            "0.0", "0e0", "1e400", "1e-400", "2.2250738585072011e-308", "2.2250738585072014e-308",
+            "4.9406564584124654e-324", "1.7976931348623157e308", "1.7976931348623159e308",
+            "9007199254740993.0", "9007199254740992.9999999999999999999", "0.1", "123456789012345678901234567890.5",
+            "7.038531e-26", "2.47032822920623272e-324", "1e23", "8.41e21", "00000.000001e5",
+            "18446744073709551615", "18446744073709551616", "99999999999999999999999",
+    };
+    char (*literals)[64] = malloc(count * sizeof(*literals));
+    int failed = 0;
+    if (!literals) {
+        return 1;
+    }
+
+    srand(21);
+    for (size_t i = 0; i < count; i++) {
+        if (i < sizeof(edge) / sizeof(*edge)) {
+            strcpy(literals[i], edge[i]);
+        } else {
+            random_literal(literals[i]);
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        double expected = strtod(literals[i], NULL), got = Parse_double(literals[i]);
+        if (memcmp(&expected, &got, sizeof(double)) != 0) {
+            fprintf(stderr, "FAILED: %s is %.17g instead of %.17g\n", literals[i], got, expected);
+            failed = 1;
+        }
+        if (i < sizeof(edge) / sizeof(*edge) && strchr(literals[i], '.') == NULL
+            && Parse_uint(literals[i]) != strtoull(literals[i], NULL, 10)) {
+            fprintf(stderr, "FAILED: integer %s\n", literals[i]);
+            failed = 1;
+        }
+    }
+
+    volatile double sink;
+    double start = now();
+    for (size_t i = 0; i < count; i++) {
+        sink = strtod(literals[i], NULL);
+    }
+    double libc = now() - start;
+    start = now();
+    for (size_t i = 0; i < count; i++) {
+        sink = Parse_double(literals[i]);
+    }
+    double own = now() - start;
+
+    (void) sink;
+    printf("%zu literals\n", count);
+    printf("    strtod:  %6.2f ns/literal\n", libc * 1e9 / (double) count);
+    printf("    numconv: %6.2f ns/literal\n", own * 1e9 / (double) count);
+    printf("%s\n", failed ? "FAILED" : "OK");
+
+    free(literals);
+    return failed;
+}
+#endif
@@ -0,0 +1,95 @@
+/**
+ * @file numconv.h
+ *
+ * @brief Conversions of numeric literals without allocations, bit-exact with strtoull() and strtod().
+ *
+ * @author Skuratovich Aliaksandr <xskura01@vutbr.cz>
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+
+// significant digits, which fit into the mantissa of decimal_t.
+#define DECIMAL_DIGITS 19
+// bigger exponents make infinity or zero anyway.
+#define DECIMAL_EXP_MAX 100000
+
+
+/** A numeric literal accumulated digit by digit, while it is scanned.
+ *  Its value is mantissa * 10^(exp10 + sign * exponent).
+ */
+typedef struct decimal {
+    uint64_t integer; ///< value of an integer literal, saturated as strtoull() does.
+    uint64_t mantissa; ///< first DECIMAL_DIGITS significant digits.
+    int64_t exp10; ///< exponent of the mantissa without the exponent part.
+    int64_t exponent; ///< absolute value of the exponent part.
+    int digits; ///< number of significant digits in the mantissa.
+    bool fraction; ///< digits are after the decimal point.
+    bool negative; ///< the exponent part is negative.
+    bool truncated; ///< nonzero digits did not fit into the mantissa.
+} decimal_t;
+
+/** Accumulate a digit of the integer or the fractional part.
+ *
+ * @param d decimal.
+ * @param ch digit character.
+ */
+static inline void decimal_digit(decimal_t *d, int ch) {
+    uint64_t digit = (uint64_t) (ch - '0');
+
+    d->integer = (d->integer > (UINT64_MAX - digit) / 10) ? UINT64_MAX : d->integer * 10 + digit;
+    if (d->mantissa == 0 && digit == 0) {
+        // a leading zero.
+        d->exp10 -= d->fraction;
+    } else if (d->digits < DECIMAL_DIGITS) {
+        d->mantissa = d->mantissa * 10 + digit;
+        d->digits++;
+        d->exp10 -= d->fraction;
+    } else {
+        d->truncated |= digit != 0;
+        d->exp10 += !d->fraction;
+    }
+}
+
+/** Accumulate a digit of the exponent part.
+ *
+ * @param d decimal.
+ * @param ch digit character.
+ */
+static inline void decimal_exp_digit(decimal_t *d, int ch) {
+    if (d->exponent < DECIMAL_EXP_MAX) {
+        d->exponent = d->exponent * 10 + (ch - '0');
+    }
+}
+
+
+extern const struct numconv_interface_t Numconv;
+
+struct numconv_interface_t {
+    /** Round an accumulated decimal to the nearest double, the same way strtod() does.
+     *  Most numbers are converted by the Clinger's or the Eisel-Lemire algorithm,
+     *  the rest by strtod() of their text.
+     *
+     * @param d decimal.
+     * @param text characters of the literal, followed by a character which is not its part.
+     * @return double.
+     */
+    double (*to_double)(const decimal_t *, const char *);
+
+    /** Parse a float literal digits[.digits][(e|E)[+|-]digits] as strtod() does.
+     *
+     * @param text characters of the literal, followed by a character which is not its part.
+     * @return double.
+     */
+    double (*parse_double)(const char *);
+
+    /** Parse an integer literal as strtoull(text, NULL, 10) does.
+     *
+     * @param text digits, followed by a character which is not a digit.
+     * @return the value, UINT64_MAX when it is out of range.
+     */
+    uint64_t (*parse_uint)(const char *);
+};
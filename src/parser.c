@@ -19,10 +19,9 @@
 #include "expressions.h"
 #include "code_generator.h"
 #include "semantics.h"
+#include "context.h"
 
 
-static pfile_t *pfile;
-
 /** Print an error ife terminal symbol is unexpected.
  *
  * @param a expected.
@@ -55,22 +54,18 @@ void print_error_unexpected_token(const char *a, const char *b) {
  *  There is a need to store a function id to perform code generation magic.
  *  Set a local table to the newly puched table.
  */
-#define SYMSTACK_PUSH(_scope_type, _id_fun_name)                 \
-    do {                                                         \
-        char *_str = NULL;                                       \
-        local_table = Symtable.ctor();                           \
-        if ((_id_fun_name) != NULL) {                            \
-            _str = Dynstring.c_str(_id_fun_name);                \
-        }                                                        \
-        Symstack.push(symstack, local_table, _scope_type, _str); \
+#define SYMSTACK_PUSH(_scope_type, _id_fun_name)                          \
+    do {                                                                  \
+        context->local_table = Symtable.ctor();                           \
+        Symstack.push(context->symstack, context->local_table, _scope_type, _id_fun_name); \
     } while (0)
 
 /** Pop an item from the stack. Change local table, too.
  */
 #define SYMSTACK_POP()                         \
      do {                                      \
-        Symstack.pop(symstack);                \
-        local_table = Symstack.top(symstack);  \
+        Symstack.pop(context->symstack);       \
+        context->local_table = Symstack.top(context->symstack);  \
      } while(0)
 
 /** Set an error code and return an error if there's a declaration error.
@@ -81,7 +76,7 @@ void print_error_unexpected_token(const char *a, const char *b) {
         fprintf(stderr, "line %zu, character %zu\n",                 \
            Scanner.get_line(), Scanner.get_charpos());               \
         fprintf(stderr, "[error](semantic): variable with name '%s'" \
-           " has already been declared!\n", Dynstring.c_str(a));     \
+           " has already been declared!\n", Dynstring.c_str((a)->name)); \
         return false;                                                \
     } while (0)
 
@@ -89,24 +84,24 @@ void print_error_unexpected_token(const char *a, const char *b) {
  */
 #define SEMANTICS_SYMTABLE_CHECK_AND_PUT(name, type)                    \
     do {                                                                \
-        dynstring_t *_name = name;                                      \
+        const atom_t *_name = name;                                     \
         symbol_t *_dummy_symbol = NULL;                                 \
         /* if name is already defined in the local scope */             \
-        if (Symtable.get_symbol(local_table, _name, &_dummy_symbol)) {  \
+        if (Symtable.get_symbol(context->local_table, _name, &_dummy_symbol)) {  \
             error_multiple_declaration(_name);                          \
             goto err;                                                   \
         }                                                               \
         /* if there exists a function with the same name */             \
-        if (Symtable.get_symbol(global_table, _name, &_dummy_symbol)) { \
+        if (Symtable.get_symbol(context->global_table, _name, &_dummy_symbol)) { \
             error_multiple_declaration(_name);                          \
             goto err;                                                   \
         }                                                               \
-        Symstack.put_symbol(symstack, _name, type);                     \
+        Symstack.put_symbol(context->symstack, _name, type);            \
     } while (0)
 
 #define PARSE_DEFAULT_EXPRESSION(received_signature, expr_type)              \
     do {                                                                     \
-        if (!Expr.default_expression(pfile, received_signature, expr_type)) {\
+        if (!Expr.default_expression(context->pfile, received_signature, expr_type)) {\
             debug_msg("\n");                                                 \
             debug_msg_s("\t\t[error] assignment expression failed.\n");      \
             goto err;                                                        \
@@ -115,7 +110,7 @@ void print_error_unexpected_token(const char *a, const char *b) {
 
 #define PARSE_RETURN_EXPRESSIONS(expected_rets)                                     \
     do {                                                                            \
-        if (!Expr.return_expressions(pfile, expected_rets)) {                       \
+        if (!Expr.return_expressions(context->pfile, expected_rets)) {              \
             debug_msg("\n");                                                        \
             debug_msg_s("\t\t[error] return expression failed.\n");                 \
             goto err;                                                               \
@@ -124,7 +119,7 @@ void print_error_unexpected_token(const char *a, const char *b) {
 
 #define PARSE_FUNCTION_EXPRESSION()                                   \
     do {                                                              \
-        if (!Expr.function_expression(pfile)) {                       \
+        if (!Expr.function_expression(context->pfile)) {              \
             debug_msg("\n");                                          \
             debug_msg_s("\t\t[error] function expression failed.\n"); \
             goto err;                                                 \
@@ -133,7 +128,7 @@ void print_error_unexpected_token(const char *a, const char *b) {
 
 #define PARSE_GLOBAL_EXPRESSION()                                     \
     do {                                                              \
-        if (!Expr.global_expression(pfile)) {                         \
+        if (!Expr.global_expression(context->pfile)) {                \
             debug_msg("\n");                                          \
             debug_msg_s("\t\t[error] global expression failed.\n");   \
             goto err;                                                 \
@@ -144,20 +139,20 @@ void print_error_unexpected_token(const char *a, const char *b) {
 static void increase_nesting() {
 #ifdef DEBUG
     FILE *fp = fopen("nesting.out", "a+");
-    for (int i = 0; i < (int) nested_cycle_level; i++) {
+    for (int i = 0; i < (int) context->nested_cycle_level; i++) {
         fprintf(fp, "\t");
     }
     fprintf(fp, "cycle\n");
     fclose(fp);
 #endif
-    nested_cycle_level++;
+    context->nested_cycle_level++;
 }
 
 static void decrease_nesting() {
-    nested_cycle_level--;
+    context->nested_cycle_level--;
 #ifdef DEBUG
     FILE *fp = fopen("nesting.out", "a+");
-    for (int i = 0; i < nested_cycle_level; i++) {
+    for (int i = 0; i < context->nested_cycle_level; i++) {
         fprintf(fp, "\t");
     }
     fprintf(fp, "end\n");
@@ -167,13 +162,13 @@ static void decrease_nesting() {
 
 static bool cond_stmt();
 
-static bool fun_body(char *);
+static bool fun_body(const atom_t *);
 
 static bool fun_stmt();
 
 static bool break_() {
     EXPECTED(KEYWORD_break);
-    if (nested_cycle_level == 0) {
+    if (context->nested_cycle_level == 0) {
         Errors.set_error(ERROR_SYNTAX);
         goto err;
     }
@@ -200,10 +195,10 @@ static bool else_stmt() {
     // also, we need to create a new symtable for 'else' scope.
     SYMSTACK_PUSH(SCOPE_TYPE_condition, NULL);
     // generate start of else block
-    instructions.cond_cnt++;
-    Generator.cond_else(instructions.outer_cond_id, instructions.cond_cnt);
+    context->instructions.cond_cnt++;
+    Generator.cond_else(context->instructions.outer_cond_id, context->instructions.cond_cnt);
     // <fun_body>
-    if (!fun_body("")) {
+    if (!fun_body(NULL)) {
         goto err;
     }
     SYMSTACK_POP();
@@ -224,7 +219,7 @@ static bool elseif_stmt() {
     SYMSTACK_PUSH(SCOPE_TYPE_condition, NULL);
 
     // generate start of elseif block
-    Generator.cond_elseif(instructions.outer_cond_id, instructions.cond_cnt);
+    Generator.cond_elseif(context->instructions.outer_cond_id, context->instructions.cond_cnt);
 
     return cond_stmt();
     err:
@@ -262,7 +257,7 @@ static bool cond_body() {
             SYMSTACK_POP();
 
             // generate start of end block
-            Generator.cond_end(instructions.outer_cond_id, instructions.cond_cnt);
+            Generator.cond_end(context->instructions.outer_cond_id, context->instructions.cond_cnt);
             Generator.pop_cond_info();
 
             return true;
@@ -297,8 +292,8 @@ static bool cond_stmt() {
     // then
     EXPECTED(KEYWORD_then);
     // generate condition evaluation (JUMPIFNEQ ...)
-    instructions.cond_cnt++;
-    Generator.cond_if(instructions.outer_cond_id, instructions.cond_cnt);
+    context->instructions.cond_cnt++;
+    Generator.cond_if(context->instructions.outer_cond_id, context->instructions.cond_cnt);
 
     if (!cond_body()) {
         goto err;
@@ -381,7 +376,7 @@ static bool repeat_body() {
  * @param pfile input file for Scanner.get_next_token().
  * @return bool.
  */
-static bool assignment(dynstring_t *id_name, int id_type) {
+static bool assignment(const atom_t *id_name, int id_type) {
     debug_msg("<assignment> -> \n");
 
     dynstring_t *received_signature = Dynstring.ctor("");
@@ -473,7 +468,7 @@ static bool for_increment() {
 static bool for_cycle() {
     debug_msg("for ->\n");
 
-    dynstring_t *id_name = NULL;
+    const atom_t *id_name = NULL;
     dynstring_t *expected_signature = Dynstring.ctor("f");
     dynstring_t *received_signature = Dynstring.ctor("");
 
@@ -486,10 +481,10 @@ static bool for_cycle() {
     EXPECTED(KEYWORD_for);
 
     Generator.comment("for loop");
-    if (!instructions.in_loop) {
-        instructions.in_loop = true;
-        instructions.outer_loop_id = Symstack.get_scope_info(symstack).unique_id;
-        instructions.before_loop_start = instrList->tail;   // use when declaring vars in loop
+    if (!context->instructions.in_loop) {
+        context->instructions.in_loop = true;
+        context->instructions.outer_loop_id = Symstack.get_scope_info(context->symstack).unique_id;
+        context->instructions.before_loop_start = Instrbuf.mark(context->instrList); // use when declaring vars in loop
     }
 
     // get id, or get an error.
@@ -531,19 +526,17 @@ static bool for_cycle() {
     Generator.for_cond(id_name);
 
     // <fun_body>, which ends with 'end'
-    if (!fun_body(Dynstring.c_str(id_name))) {
+    if (!fun_body(id_name)) {
         goto err;
     }
 
     SYMSTACK_POP();
     decrease_nesting();
 
-    Dynstring.dtor(id_name);
     Dynstring.dtor(expected_signature);
     Dynstring.dtor(received_signature);
     return true;
     err:
-    Dynstring.dtor(id_name);
     Dynstring.dtor(expected_signature);
     Dynstring.dtor(received_signature);
     return false;
@@ -565,8 +558,8 @@ static bool if_statement() {
     // generate code
     Generator.comment("condition statement");
     Generator.push_cond_info();
-    instructions.outer_cond_id = Symstack.get_scope_info(symstack).unique_id;
-    instructions.cond_cnt = 1;
+    context->instructions.outer_cond_id = Symstack.get_scope_info(context->symstack).unique_id;
+    context->instructions.cond_cnt = 1;
 
     return cond_stmt();
     err:
@@ -581,7 +574,7 @@ static bool if_statement() {
  * @return
  */
 static bool var_definition() {
-    dynstring_t *id_name = NULL;
+    const atom_t *id_name = NULL;
     int id_type;
     EXPECTED(KEYWORD_local);
 
@@ -603,10 +596,8 @@ static bool var_definition() {
     }
     SEMANTICS_SYMTABLE_CHECK_AND_PUT(id_name, id_type);
 
-    Dynstring.dtor(id_name);
     return true;
     err:
-    Dynstring.dtor(id_name);
     return false;
 }
 
@@ -630,10 +621,10 @@ static bool while_cycle() {
     // while
     EXPECTED(KEYWORD_while);
     // nested while
-    if (!instructions.in_loop) {
-        instructions.in_loop = true;
-        instructions.outer_loop_id = Symstack.get_scope_info(symstack).unique_id;
-        instructions.before_loop_start = instrList->tail;   // use when declaring vars in loop
+    if (!context->instructions.in_loop) {
+        context->instructions.in_loop = true;
+        context->instructions.outer_loop_id = Symstack.get_scope_info(context->symstack).unique_id;
+        context->instructions.before_loop_start = Instrbuf.mark(context->instrList); // use when declaring vars in loop
     }
     Generator.comment("while loop");
     Generator.while_header();
@@ -645,7 +636,7 @@ static bool while_cycle() {
     Generator.while_cond();
     // do
     EXPECTED(KEYWORD_do);
-    if (!fun_body("")) {
+    if (!fun_body(NULL)) {
         goto err;
     }
 
@@ -670,19 +661,15 @@ static bool while_cycle() {
  */
 static bool return_stmt() {
     debug_msg("<return_stmt> ->\n");
-    // create expected returns vector from returns
-    dynstring_t *expected_rets = Dynstring.dup(
-            Symstack.get_parent_func(symstack)->function_semantics->definition.returns);
-    debug_assert(expected_rets != NULL && "string created with Dynstring.dup must not be NULL");
+    // expected returns are the signature of the function.
+    const atom_t *expected_rets = Symstack.get_parent_func(context->symstack)->function_semantics->definition.returns;
 
     EXPECTED(KEYWORD_return);
     // return expr
     PARSE_RETURN_EXPRESSIONS(expected_rets);
 
-    Dynstring.dtor(expected_rets);
     return true;
     err:
-    Dynstring.dtor(expected_rets);
     return false;
 }
 
@@ -706,10 +693,10 @@ static bool repeat_until_cycle() {
     // repeat
     EXPECTED(KEYWORD_repeat);
     // nested while
-    if (!instructions.in_loop) {
-        instructions.in_loop = true;
-        instructions.outer_loop_id = Symstack.get_scope_info(symstack).unique_id;
-        instructions.before_loop_start = instrList->tail;   // use when declaring vars in loop
+    if (!context->instructions.in_loop) {
+        context->instructions.in_loop = true;
+        context->instructions.outer_loop_id = Symstack.get_scope_info(context->symstack).unique_id;
+        context->instructions.before_loop_start = Instrbuf.mark(context->instrList); // use when declaring vars in loop
     }
     Generator.comment("repeat-until loop");
     Generator.repeat_until_header();
@@ -723,10 +710,11 @@ static bool repeat_until_cycle() {
     CHECK_EXPR_SIGNATURES(expected_signature, received_signature, ERROR_TYPE_MISSMATCH);
     // expression result in LF@%result
     Generator.repeat_until_cond();
-    if (instructions.outer_loop_id == Symstack.get_scope_info(symstack).unique_id) {
-        instructions.in_loop = false;
-        instructions.outer_loop_id = 0;
-        instructions.before_loop_start = NULL;
+    if (context->instructions.outer_loop_id == Symstack.get_scope_info(context->symstack).unique_id) {
+        context->instructions.in_loop = false;
+        context->instructions.outer_loop_id = 0;
+        context->instructions.before_loop_start = NULL;
+        Generator.flush();
     }
 
     // pop a symstack
@@ -812,7 +800,7 @@ static bool fun_stmt() {
  * @param pfile input file for Scanner.get_next_token().
  * @return bool.
  */
-static bool fun_body(char *id_name) {
+static bool fun_body(const atom_t *id_name) {
     debug_msg("<fun_body> ->\n");
 
     if (Scanner.get_curr_token().type != KEYWORD_end) {
@@ -822,32 +810,31 @@ static bool fun_body(char *id_name) {
     // end |
     EXPECTED(KEYWORD_end);
 
-    switch (Symstack.get_scope_info(symstack).scope_type) {
+    switch (Symstack.get_scope_info(context->symstack).scope_type) {
         case SCOPE_TYPE_while_cycle:
             Generator.comment("while loop - end");
             Generator.while_end();
-            if (instructions.outer_loop_id == Symstack.get_scope_info(symstack).unique_id) {
-                instructions.in_loop = false;
-                instructions.outer_loop_id = 0;
-                instructions.before_loop_start = NULL;
+            if (context->instructions.outer_loop_id == Symstack.get_scope_info(context->symstack).unique_id) {
+                context->instructions.in_loop = false;
+                context->instructions.outer_loop_id = 0;
+                context->instructions.before_loop_start = NULL;
+                Generator.flush();
             }
             break;
 
         case SCOPE_TYPE_function:
-            Generator.func_end(Symstack.get_parent_func_name(symstack));
+            Generator.func_end(Symstack.get_parent_func_name(context->symstack));
             break;
 
-        case SCOPE_TYPE_for_cycle:;
-            dynstring_t *var_name = Dynstring.ctor(id_name);
+        case SCOPE_TYPE_for_cycle:
             Generator.comment("for loop - end");
-            Generator.for_end(var_name);
-            if (instructions.outer_loop_id == Symstack.get_scope_info(symstack).unique_id) {
-                instructions.in_loop = false;
-                instructions.outer_loop_id = 0;
-                instructions.before_loop_start = NULL;
+            Generator.for_end(id_name);
+            if (context->instructions.outer_loop_id == Symstack.get_scope_info(context->symstack).unique_id) {
+                context->instructions.in_loop = false;
+                context->instructions.outer_loop_id = 0;
+                context->instructions.before_loop_start = NULL;
+                Generator.flush();
             }
-
-            Dynstring.dtor(var_name);
             break;
 
         case SCOPE_TYPE_do_cycle:
@@ -856,7 +843,7 @@ static bool fun_body(char *id_name) {
 
         case SCOPE_TYPE_condition:
             Generator.comment("condition - end");
-            Generator.cond_end(instructions.outer_cond_id, instructions.cond_cnt);
+            Generator.cond_end(context->instructions.outer_cond_id, context->instructions.cond_cnt);
             Generator.pop_cond_info();
             break;
 
@@ -877,10 +864,10 @@ static bool fun_body(char *id_name) {
  * @param pfile input file for Scanner.get_next_token().
  * @return bool.
  */
-static bool other_funparams(pfile_t *pfile, func_info_t function_def_info, size_t param_index) {
+static bool other_funparams(func_info_t *function_def_info, size_t param_index) {
     debug_msg("<other_funparam> ->\n");
 
-    dynstring_t *id_name = NULL;
+    const atom_t *id_name = NULL;
 
     // ) |
     EXPECTED_OPT(TOKEN_RPAREN);
@@ -901,19 +888,17 @@ static bool other_funparams(pfile_t *pfile, func_info_t function_def_info, size_
     // semantic check.
     SEMANTICS_SYMTABLE_CHECK_AND_PUT(id_name, id_type);
     // for function info in the symtable.
-    Semantics.add_param(&function_def_info, id_type);
+    Semantics.add_param(function_def_info, id_type);
     // generate code
     Generator.func_start_param(id_name, param_index++);
 
-    if (!other_funparams(pfile, function_def_info, param_index)) {
+    if (!other_funparams(function_def_info, param_index)) {
         goto err;
     }
 
     noerr:
-    Dynstring.dtor(id_name);
     return true;
     err:
-    Dynstring.dtor(id_name);
     return false;
 }
 
@@ -924,10 +909,10 @@ static bool other_funparams(pfile_t *pfile, func_info_t function_def_info, size_
  * @param pfile input file for Scanner.get_next_token().
  * @return bool.
  */
-static bool funparam_def_list(pfile_t *pfile, func_info_t function_def_info) {
+static bool funparam_def_list(func_info_t *function_def_info) {
     debug_msg("<funparam_def_list> ->\n");
 
-    dynstring_t *id_name = NULL;
+    const atom_t *id_name = NULL;
 
     // ) |
     EXPECTED_OPT(TOKEN_RPAREN);
@@ -946,20 +931,18 @@ static bool funparam_def_list(pfile_t *pfile, func_info_t function_def_info) {
         goto err;
     }
     // add a datatype to function parameters
-    Semantics.add_param(&function_def_info, id_type);
+    Semantics.add_param(function_def_info, id_type);
     // parameters in function definition cannot be declared twice, nor be function names.
     SEMANTICS_SYMTABLE_CHECK_AND_PUT(id_name, id_type);
 
     // <other_funparams>
-    if (!other_funparams(pfile, function_def_info, param_index)) {
+    if (!other_funparams(function_def_info, param_index)) {
         goto err;
     }
 
     noerr:
-    Dynstring.dtor(id_name);
     return true;
     err:
-    Dynstring.dtor(id_name);
     return false;
 }
 
@@ -970,16 +953,16 @@ static bool funparam_def_list(pfile_t *pfile, func_info_t function_def_info) {
  * @param pfile input file for Scanner.get_next_token().
  * @return bool.
  */
-static bool other_datatypes(pfile_t *pfile, func_info_t function_decl_info) {
+static bool other_datatypes(func_info_t *function_decl_info) {
     debug_msg("<other_datatypes> ->\n");
 
     // ) |
     EXPECTED_OPT(TOKEN_RPAREN);
     // ,
     EXPECTED(TOKEN_COMMA);
-    Semantics.add_param(&function_decl_info, Scanner.get_curr_token().type);
+    Semantics.add_param(function_decl_info, Scanner.get_curr_token().type);
 
-    return datatype() && other_datatypes(pfile, function_decl_info);
+    return datatype() && other_datatypes(function_decl_info);
     noerr:
     return true;
     err:
@@ -993,15 +976,15 @@ static bool other_datatypes(pfile_t *pfile, func_info_t function_decl_info) {
  * @param pfile input file for Scanner.get_next_token().
  * @return bool.
  */
-static bool datatype_list(pfile_t *pfile, func_info_t function_decl_info) {
+static bool datatype_list(func_info_t *function_decl_info) {
     debug_msg("<datatype_list> ->\n");
 
     // ) |
     EXPECTED_OPT(TOKEN_RPAREN);
-    Semantics.add_param(&function_decl_info, Scanner.get_curr_token().type);
+    Semantics.add_param(function_decl_info, Scanner.get_curr_token().type);
 
     //<datatype> && <other_datatypes>
-    return datatype() && other_datatypes(pfile, function_decl_info);
+    return datatype() && other_datatypes(function_decl_info);
     noerr:
     return true;
     err:
@@ -1015,7 +998,7 @@ static bool datatype_list(pfile_t *pfile, func_info_t function_decl_info) {
  * @param pfile input file for Scanner.get_next_token().
  * @return bool.
  */
-static bool other_funrets(pfile_t *pfile, func_info_t function_info) {
+static bool other_funrets(func_info_t *function_info) {
     debug_msg("<other_funrets> -> \n");
 
     // e |
@@ -1024,10 +1007,10 @@ static bool other_funrets(pfile_t *pfile, func_info_t function_info) {
     }
     // ,
     EXPECTED(TOKEN_COMMA);
-    Semantics.add_return(&function_info, Scanner.get_curr_token().type);
+    Semantics.add_return(function_info, Scanner.get_curr_token().type);
 
     // <datatype> <other_funrets>
-    if (!datatype() || !other_funrets(pfile, function_info)) {
+    if (!datatype() || !other_funrets(function_info)) {
         goto err;
     }
 
@@ -1043,7 +1026,7 @@ static bool other_funrets(pfile_t *pfile, func_info_t function_info) {
  * @param pfile input file for Scanner.get_next_token().
  * @return bool.
  */
-static bool funretopt(pfile_t *pfile, func_info_t function_info) {
+static bool funretopt(func_info_t *function_info) {
     debug_msg("<funretopt> ->\n");
 
     // e |
@@ -1053,10 +1036,10 @@ static bool funretopt(pfile_t *pfile, func_info_t function_info) {
 
     // :
     EXPECTED(TOKEN_COLON);
-    Semantics.add_return(&function_info, Scanner.get_curr_token().type);
+    Semantics.add_return(function_info, Scanner.get_curr_token().type);
 
     // <datatype> <other_funrets>
-    if (!datatype() || !other_funrets(pfile, function_info)) {
+    if (!datatype() || !other_funrets(function_info)) {
         goto err;
     }
 
@@ -1075,7 +1058,7 @@ static bool funretopt(pfile_t *pfile, func_info_t function_info) {
 static bool function_declaration() {
     debug_msg("<function_declaration> ->\n");
 
-    dynstring_t *id_name = NULL;
+    const atom_t *id_name = NULL;
     symbol_t *symbol;
 
     // global
@@ -1085,7 +1068,7 @@ static bool function_declaration() {
     EXPECTED(TOKEN_ID);
     // Semantic control.
     // if we find a symbol on the stack, check it.
-    if (Symstack.get_symbol(symstack, id_name, &symbol)) {
+    if (Symstack.get_symbol(context->symstack, id_name, &symbol)) {
         // If function has been previously declared.
         if (Semantics.is_declared(symbol->function_semantics)) {
             Errors.set_error(ERROR_DEFINITION);
@@ -1093,7 +1076,7 @@ static bool function_declaration() {
         }
     }
     // normally put id on the stack.
-    symbol = Symstack.put_symbol(symstack, id_name, ID_TYPE_func_decl);
+    symbol = Symstack.put_symbol(context->symstack, id_name, ID_TYPE_func_decl);
     // :
     EXPECTED(TOKEN_COLON);
     // function
@@ -1101,11 +1084,11 @@ static bool function_declaration() {
     // (
     EXPECTED(TOKEN_LPAREN);
     // <funparam_decl_list>
-    if (!datatype_list(pfile, symbol->function_semantics->declaration)) {
+    if (!datatype_list(&symbol->function_semantics->declaration)) {
         goto err;
     }
     // <funretopt> can be empty
-    if (!funretopt(pfile, symbol->function_semantics->declaration)) {
+    if (!funretopt(&symbol->function_semantics->declaration)) {
         goto err;
     }
 
@@ -1114,10 +1097,8 @@ static bool function_declaration() {
         SEMANTIC_CHECK_FUNCTION_SIGNATURES(symbol);
     }
 
-    Dynstring.dtor(id_name);
     return true;
     err:
-    Dynstring.dtor(id_name);
     return false;
 }
 
@@ -1131,38 +1112,38 @@ static bool function_declaration() {
 static bool function_definition() {
     debug_msg("<function_definition> ->\n");
 
-    dynstring_t *id_name = NULL;
+    const atom_t *id_name = NULL;
     symbol_t *symbol = NULL;
 
     // function
     EXPECTED(KEYWORD_function);
-    debug_assert((local_table == global_table) && "tables must be equal now");
+    debug_assert((context->local_table == context->global_table) && "tables must be equal now");
     // create dynstring to id_name
     GET_ID_SAFE(id_name);
     // id
     EXPECTED(TOKEN_ID);
     // if we find a symbol on the stack, check it.
-    if (Symstack.get_symbol(symstack, id_name, &symbol)) {
+    if (Symstack.get_symbol(context->symstack, id_name, &symbol)) {
         // function has been defined yee
         if (Semantics.is_defined(symbol->function_semantics)) {
             Errors.set_error(ERROR_DEFINITION);
             goto err;
         }
     }
-    symbol = Symstack.put_symbol(symstack, id_name, ID_TYPE_func_def);
+    symbol = Symstack.put_symbol(context->symstack, id_name, ID_TYPE_func_def);
     // (
     EXPECTED(TOKEN_LPAREN);
     // push a symtable on to the stack.
     SYMSTACK_PUSH(SCOPE_TYPE_function, id_name);
     // generate code for new function start
-    debug_msg_s("\t[define] function %s\n", Dynstring.c_str(id_name));
+    debug_msg_s("\t[define] function %s\n", Dynstring.c_str(id_name->name));
     Generator.func_start(id_name);
     // <funparam_def_list>
-    if (!funparam_def_list(pfile, symbol->function_semantics->definition)) {
+    if (!funparam_def_list(&symbol->function_semantics->definition)) {
         goto err;
     }
     // <funretopt>
-    if (!funretopt(pfile, symbol->function_semantics->definition)) {
+    if (!funretopt(&symbol->function_semantics->definition)) {
         goto err;
     }
     // check signatures if declared
@@ -1171,18 +1152,16 @@ static bool function_definition() {
     }
 
     // generate code for return values
-    Generator.return_defvars(symbol->function_semantics->definition.returns);
+    Generator.return_defvars(symbol->function_semantics->definition.returns->name);
 
     // <fun_body>
-    if (!fun_body("")) {
+    if (!fun_body(NULL)) {
         goto err;
     }
     SYMSTACK_POP();
 
-    Dynstring.dtor(id_name);
     return true;
     err:
-    Dynstring.dtor(id_name);
     return false;
 }
 
@@ -1199,7 +1178,6 @@ static bool stmt() {
     debug_msg("<stmt> ->\n");
 
     token_t token = Scanner.get_curr_token();
-    dynstring_t *id_name = NULL;
 
     switch (token.type) {
         // function declaration: global id : function ( <datatype_list> <funretopt>
@@ -1228,10 +1206,8 @@ static bool stmt() {
             goto err;
     }
 
-    Dynstring.dtor(id_name);
     return true;
     err:
-    Dynstring.dtor(id_name);
     return false;
 }
 
@@ -1288,7 +1264,11 @@ static bool program() {
         goto err;
     }
     // ifj21
-    if (Dynstring.cmp(Scanner.get_curr_token().attribute.id, prolog_str) != 0) {
+    token_t prolog_tok = Scanner.get_curr_token();
+    dynstring_t *prolog = Scanner.materialize(&prolog_tok);
+    int prolog_cmp = Dynstring.cmp(prolog, prolog_str);
+    Dynstring.dtor(prolog);
+    if (prolog_cmp != 0) {
         Errors.set_error(ERROR_SEMANTICS_OTHER);
         goto err;
     }
@@ -1301,7 +1281,7 @@ static bool program() {
         goto err;
     }
     // every declared function must be defined.
-    if (!Symstack.traverse(symstack, declared_implies_defined)) {
+    if (!Symstack.traverse(context->symstack, declared_implies_defined)) {
         Errors.set_error(ERROR_DEFINITION);
         goto err;
     }
@@ -1322,31 +1302,31 @@ static void Init_parser() {
     Scanner.init();
 
     // create a stack with symtables.
-    symstack = Symstack.init();
-    soft_assert(symstack != NULL, ERROR_INTERNAL);
+    context->symstack = Symstack.init();
+    soft_assert(context->symstack != NULL, ERROR_INTERNAL);
 
     // create a global table.
-    global_table = Symtable.ctor();
-    soft_assert(global_table != NULL, ERROR_INTERNAL);
+    context->global_table = Symtable.ctor();
+    soft_assert(context->global_table != NULL, ERROR_INTERNAL);
 
     //at the beginning, local and global tables are equal.
-    local_table = global_table;
+    context->local_table = context->global_table;
 
     // push a global frame
-    Symstack.push(symstack, global_table, SCOPE_TYPE_global, /*fun_name*/ NULL);
+    Symstack.push(context->symstack, context->global_table, SCOPE_TYPE_global, /*fun_name*/ NULL);
 
     // add builtin functions.
-    Symtable.add_builtin_function(global_table, "write", "", "");
+    Symtable.add_builtin_function(context->global_table, "write", NULL, ""); // write(...)
 
-    Symtable.add_builtin_function(global_table, "readi", "", "i"); // string
-    Symtable.add_builtin_function(global_table, "readn", "", "f"); // integer
-    Symtable.add_builtin_function(global_table, "reads", "", "s"); // number
+    Symtable.add_builtin_function(context->global_table, "readi", "", "i"); // string
+    Symtable.add_builtin_function(context->global_table, "readn", "", "f"); // integer
+    Symtable.add_builtin_function(context->global_table, "reads", "", "s"); // number
 
-    Symtable.add_builtin_function(global_table, "tointeger", "f", "i"); // (f : number) : integer
-    Symtable.add_builtin_function(global_table, "substr", "sii",
+    Symtable.add_builtin_function(context->global_table, "tointeger", "f", "i"); // (f : number) : integer
+    Symtable.add_builtin_function(context->global_table, "substr", "sii",
                                   "s"); // substr(s : string, i : integer, j : integer) : string
-    Symtable.add_builtin_function(global_table, "ord", "si", "i"); // (s : string, i : integer) : integer
-    Symtable.add_builtin_function(global_table, "chr", "i", "s"); // (i : integer) : string
+    Symtable.add_builtin_function(context->global_table, "ord", "si", "i"); // (s : string, i : integer) : integer
+    Symtable.add_builtin_function(context->global_table, "chr", "i", "s"); // (i : integer) : string
 
 }
 
@@ -1355,8 +1335,10 @@ static void Init_parser() {
  * @return void
  */
 static void Free_parser() {
-    Symstack.dtor(symstack);
+    Symstack.dtor(context->symstack);
+    Expr.free();
     Scanner.free();
+    Intern.free();
 }
 
 
@@ -1365,20 +1347,26 @@ static void Free_parser() {
  *  precedence parsing method for expressions.
  *
  * @param pfile input file for Scanner.get_next_token().
+ * @param lex_threads lex the whole file into a token buffer before parsing on up to lex_threads threads,
+ *                    0 lexes tokens on demand.
  * @return bool.
  */
-static bool Analyse(pfile_t *pfile_) {
+static bool Analyse(pfile_t *pfile_, size_t lex_threads) {
     soft_assert(pfile_ != NULL, ERROR_INTERNAL);
 
     bool res = false;
-    pfile = pfile_;
+    context->pfile = pfile_;
     Errors.set_error(ERROR_NOERROR);
 
     // initialize structures(symstack, symtable)
     // add builtin functions.
     Init_parser();
+    // lex the whole program before parsing.
+    if (lex_threads != 0) {
+        Scanner.prelex(context->pfile, lex_threads);
+    }
     // get_symbol first token to get_symbol start
-    if (TOKEN_DEAD == Scanner.get_next_token(pfile).type) {
+    if (TOKEN_DEAD == Scanner.get_next_token(context->pfile).type) {
         Errors.set_error(ERROR_LEXICAL);
     } else {
         res = program();
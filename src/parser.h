@@ -42,13 +42,16 @@ void print_error_unexpected_token(const char *, const char *);
     do {                                                                      \
         token_t tok__ = Scanner.get_curr_token();                             \
         if (tok__.type == (p)) {                                              \
-            if (tok__.type == TOKEN_ID || tok__.type == TOKEN_STR) {          \
-                debug_msg("\t%s = { '%s' }\n", Scanner.to_string(tok__.type), \
-                   Dynstring.c_str(tok__.attribute.id));                      \
+            if (tok__.type == TOKEN_ID) {                                     \
+                debug_msg("\t%s = { '%s' }\n", Scanner.to_string(tok__.type),  \
+                   Dynstring.c_str(tok__.attribute.atom->name));             \
+            } else if (tok__.type == TOKEN_STR) {                             \
+                debug_msg("\t%s = { '%.*s' }\n", Scanner.to_string(tok__.type), \
+                   (int) tok__.attribute.span.len, Scanner.lexeme(&tok__));   \
             } else {                                                          \
                 debug_msg("\t%s\n", Scanner.to_string(tok__.type));           \
             }                                                                 \
-            if (TOKEN_DEAD == Scanner.get_next_token(pfile).type) {            \
+            if (TOKEN_DEAD == Scanner.get_next_token(context->pfile).type) {   \
                 Errors.set_error(ERROR_LEXICAL);                              \
                 goto err;                                                     \
             }                                                                 \
@@ -60,7 +63,7 @@ void print_error_unexpected_token(const char *, const char *);
 #define GET_ID_SAFE(_idname)                                                 \
     do {                                                                    \
         if (Scanner.get_curr_token().type == TOKEN_ID) {                    \
-            _idname = Dynstring.dup(Scanner.get_curr_token().attribute.id); \
+            _idname = Scanner.get_curr_token().attribute.atom;              \
         }                                                                   \
     } while (0)
 
@@ -73,22 +76,15 @@ void print_error_unexpected_token(const char *, const char *);
     } while (0)
 
 
-/** A symbol stack with symbol tables for the program.
- */
-symstack_t *symstack;
-
-/** Global scope(the first one) with function declarations and definitions.
- */
-symtable_t *global_table;
-
-/** A current table.
- */
-symtable_t *local_table;
-
-int nested_cycle_level;
-
 extern const struct parser_interface_t Parser;
 
 struct parser_interface_t {
-    bool (*analyse)(pfile_t *);
+    /** Analyse the program and generate its code.
+     *
+     * @param pfile program file.
+     * @param lex_threads lex the whole file into a token buffer before parsing on up to lex_threads threads,
+     *                    0 lexes tokens on demand. The file must not be a stream.
+     * @return true if there are no errors.
+     */
+    bool (*analyse)(pfile_t *, size_t);
 };
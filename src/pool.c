@@ -0,0 +1,356 @@
+/**
+ * @file pool.c
+ *
+ * @brief Work-stealing thread pool. Tasks are independent, so a deque with a lock is enough,
+ *        the owner and thieves take from its different ends and rarely meet.
+ *
+ * @author Skuratovich Aliaksandr <xskura01@vutbr.cz>
+ */
+#include "pool.h"
+#include "debug.h"
+#include "errors.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+
+// initial capacity of a deque, it doubles when it is full.
+#define DEQUE_INITIAL 64
+
+
+typedef struct task {
+    void (*fun)(void *);
+    void *arg;
+} task_t;
+
+/** Deque of a worker, tasks are in tasks[top, bottom).
+ */
+typedef struct deque {
+    pthread_mutex_t lock;
+    task_t *tasks;
+    size_t top; ///< thieves steal from here.
+    size_t bottom; ///< the owner pushes and pops here.
+    size_t cap;
+} deque_t;
+
+typedef struct worker {
+    pool_t *pool;
+    size_t index;
+    pthread_t thread;
+} worker_t;
+
+struct pool {
+    size_t count; ///< number of workers.
+    deque_t *deques; ///< deque of every worker.
+    worker_t *workers;
+    size_t next; ///< deque for the next submitted task.
+
+    pthread_mutex_t lock; ///< protects the counters below.
+    pthread_cond_t work; ///< signalled when a task is submitted or the pool stops.
+    pthread_cond_t done; ///< signalled when all tasks are finished.
+    size_t queued; ///< tasks in deques.
+    size_t pending; ///< tasks submitted and not finished.
+    size_t stolen; ///< tasks taken from other deques.
+    bool stop;
+};
+
+
+/** Push a task to the bottom of a deque.
+ */
+static void deque_push(deque_t *deque, task_t task) {
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom == deque->cap) {
+        // move tasks to the beginning, or grow.
+        size_t len = deque->bottom - deque->top;
+        if (len * 2 > deque->cap) {
+            deque->cap *= 2;
+        }
+        task_t *tasks = malloc(deque->cap * sizeof(task_t));
+        soft_assert(tasks != NULL, ERROR_INTERNAL);
+        memcpy(tasks, deque->tasks + deque->top, len * sizeof(task_t));
+        free(deque->tasks);
+        deque->tasks = tasks;
+        deque->top = 0;
+        deque->bottom = len;
+    }
+    deque->tasks[deque->bottom++] = task;
+    pthread_mutex_unlock(&deque->lock);
+}
+
+/** Take a task from the bottom, the owner does it.
+ *
+ * @return false if the deque is empty.
+ */
+static bool deque_pop(deque_t *deque, task_t *task) {
+    bool res = false;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->top < deque->bottom) {
+        *task = deque->tasks[--deque->bottom];
+        res = true;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return res;
+}
+
+/** Take a task from the top, thieves do it.
+ *
+ * @return false if the deque is empty.
+ */
+static bool deque_steal(deque_t *deque, task_t *task) {
+    bool res = false;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->top < deque->bottom) {
+        *task = deque->tasks[deque->top++];
+        res = true;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return res;
+}
+
+/** Find a task for a worker, in its own deque first.
+ *
+ * @return false if all deques are empty.
+ */
+static bool take(pool_t *pool, size_t index, task_t *task) {
+    if (deque_pop(&pool->deques[index], task)) {
+        return true;
+    }
+    for (size_t i = 1; i < pool->count; i++) {
+        if (deque_steal(&pool->deques[(index + i) % pool->count], task)) {
+            pthread_mutex_lock(&pool->lock);
+            pool->stolen++;
+            pthread_mutex_unlock(&pool->lock);
+            return true;
+        }
+    }
+    return false;
+}
+
+/** Worker loop, it runs tasks until the pool stops.
+ */
+static void *work(void *arg) {
+    worker_t *worker = arg;
+    pool_t *pool = worker->pool;
+    task_t task;
+
+    for (;;) {
+        if (take(pool, worker->index, &task)) {
+            pthread_mutex_lock(&pool->lock);
+            pool->queued--;
+            pthread_mutex_unlock(&pool->lock);
+
+            task.fun(task.arg);
+
+            pthread_mutex_lock(&pool->lock);
+            if (--pool->pending == 0) {
+                pthread_cond_broadcast(&pool->done);
+            }
+            pthread_mutex_unlock(&pool->lock);
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        while (pool->queued == 0 && !pool->stop) {
+            pthread_cond_wait(&pool->work, &pool->lock);
+        }
+        bool stop = pool->stop && pool->queued == 0;
+        pthread_mutex_unlock(&pool->lock);
+        if (stop) {
+            return NULL;
+        }
+    }
+}
+
+/** Create a pool and start its workers.
+ *
+ * @param count number of workers.
+ * @return new pool.
+ */
+static pool_t *Ctor(size_t count) {
+    pool_t *pool = calloc(1, sizeof(pool_t));
+    soft_assert(pool != NULL, ERROR_INTERNAL);
+
+    pool->count = count ? count : 1;
+    pool->deques = calloc(pool->count, sizeof(deque_t));
+    pool->workers = calloc(pool->count, sizeof(worker_t));
+    soft_assert(pool->deques && pool->workers, ERROR_INTERNAL);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    for (size_t i = 0; i < pool->count; i++) {
+        deque_t *deque = &pool->deques[i];
+        pthread_mutex_init(&deque->lock, NULL);
+        deque->cap = DEQUE_INITIAL;
+        deque->tasks = malloc(deque->cap * sizeof(task_t));
+        soft_assert(deque->tasks != NULL, ERROR_INTERNAL);
+    }
+    for (size_t i = 0; i < pool->count; i++) {
+        pool->workers[i] = (worker_t) {.pool = pool, .index = i};
+        soft_assert(pthread_create(&pool->workers[i].thread, NULL, work, &pool->workers[i]) == 0,
+                    ERROR_INTERNAL);
+    }
+    return pool;
+}
+
+/** Add a task, tasks can submit tasks too.
+ *  The task is counted before it is pushed, so a worker cannot finish it before it is counted.
+ *
+ * @param pool
+ * @param fun task.
+ * @param arg its argument.
+ */
+static void Submit(pool_t *pool, void (*fun)(void *), void *arg) {
+    pthread_mutex_lock(&pool->lock);
+    pool->queued++;
+    pool->pending++;
+    size_t index = pool->next;
+    pool->next = (pool->next + 1) % pool->count;
+    deque_push(&pool->deques[index], (task_t) {.fun = fun, .arg = arg});
+    pthread_cond_signal(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/** Wait until all submitted tasks are finished.
+ *
+ * @param pool
+ */
+static void Wait(pool_t *pool) {
+    pthread_mutex_lock(&pool->lock);
+    while (pool->pending != 0) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/** Number of stolen tasks.
+ *
+ * @param pool
+ * @return stolen.
+ */
+static size_t Stolen(pool_t *pool) {
+    pthread_mutex_lock(&pool->lock);
+    size_t stolen = pool->stolen;
+    pthread_mutex_unlock(&pool->lock);
+    return stolen;
+}
+
+/** Stop the workers and free the pool.
+ *
+ * @param pool
+ */
+static void Dtor(pool_t *pool) {
+    if (pool == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = true;
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (size_t i = 0; i < pool->count; i++) {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+    for (size_t i = 0; i < pool->count; i++) {
+        pthread_mutex_destroy(&pool->deques[i].lock);
+        free(pool->deques[i].tasks);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work);
+    pthread_cond_destroy(&pool->done);
+    free(pool->deques);
+    free(pool->workers);
+    free(pool);
+}
+
+
+const struct pool_interface_t Pool = {
+        .ctor = Ctor,
+        .submit = Submit,
+        .wait = Wait,
+        .stolen = Stolen,
+        .dtor = Dtor,
+};
+
+
+#ifdef SELFTEST_pool
+#include <stdio.h>
+#include <stdatomic.h>
+
+static atomic_size_t runs[100000];
+
+static void count_run(void *arg) {
+    size_t i = (size_t) arg;
+    // uneven tasks, so workers have to steal.
+    volatile size_t spin = (i % 97 == 0) ? 200000 : 10;
+    while (spin--) { ;
+    }
+    runs[i]++;
+}
+
+// depth of the tree of tasks submitting tasks.
+#define NESTED_DEPTH 14
+
+static pool_t *nested_pool;
+static atomic_size_t leaves;
+
+/** Task submitting two tasks of a lower depth, leaves are counted.
+ */
+static void submit_nested(void *arg) {
+    size_t depth = (size_t) arg;
+    if (depth == 0) {
+        leaves++;
+        return;
+    }
+    Pool.submit(nested_pool, submit_nested, (void *) (depth - 1));
+    Pool.submit(nested_pool, submit_nested, (void *) (depth - 1));
+}
+
+/** Every task runs exactly once, for any number of workers.
+ *  Pool.wait() waits for tasks submitted by tasks too.
+ */
+int main() {
+    const size_t tasks = sizeof(runs) / sizeof(*runs);
+    const size_t workers[] = {1, 2, 4, 8};
+    int failed = 0;
+
+    for (size_t w = 0; w < sizeof(workers) / sizeof(*workers); w++) {
+        pool_t *pool = Pool.ctor(workers[w]);
+        for (size_t round = 0; round < 2; round++) {
+            for (size_t i = 0; i < tasks; i++) {
+                Pool.submit(pool, count_run, (void *) i);
+            }
+            Pool.wait(pool);
+        }
+        nested_pool = pool;
+        for (size_t round = 0; round < 20; round++) {
+            leaves = 0;
+            Pool.submit(pool, submit_nested, (void *) NESTED_DEPTH);
+            Pool.wait(pool);
+            if (leaves != (1u << NESTED_DEPTH)) {
+                fprintf(stderr, "FAILED: %zu workers, wait returned after %zu of %u nested tasks\n",
+                        workers[w], (size_t) leaves, 1u << NESTED_DEPTH);
+                failed = 1;
+                break;
+            }
+        }
+        size_t stolen = Pool.stolen(pool);
+        Pool.dtor(pool);
+
+        for (size_t i = 0; i < tasks; i++) {
+            if (runs[i] != 2) {
+                fprintf(stderr, "FAILED: %zu workers, task %zu ran %zu times\n", workers[w], i, (size_t) runs[i]);
+                failed = 1;
+                break;
+            }
+            runs[i] = 0;
+        }
+        printf("%zu workers: %zu tasks, %u nested tasks 20 times, %zu stolen\n",
+               workers[w], 2 * tasks, (2u << NESTED_DEPTH) - 1, stolen);
+    }
+    printf("%s\n", failed ? "FAILED" : "OK");
+    return failed;
+}
+#endif
@@ -0,0 +1,55 @@
+/**
+ * @file pool.h
+ *
+ * @brief Work-stealing thread pool. Every worker has its own deque of tasks,
+ *        it takes tasks from the bottom of it and steals from the top of the others, when it is empty.
+ *
+ * @author Skuratovich Aliaksandr <xskura01@vutbr.cz>
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+
+
+/** An opaque structure representing a pool.
+ */
+typedef struct pool pool_t;
+
+extern const struct pool_interface_t Pool;
+
+struct pool_interface_t {
+    /** Create a pool and start its workers.
+     *
+     * @param workers number of threads, at least 1.
+     * @return new pool.
+     */
+    pool_t *(*ctor)(size_t);
+
+    /** Add a task, tasks are spread over the deques of the workers.
+     *
+     * @param pool
+     * @param fun task, it is called as fun(arg) on one of the workers.
+     * @param arg
+     */
+    void (*submit)(pool_t *, void (*)(void *), void *);
+
+    /** Wait until all submitted tasks are finished.
+     *
+     * @param pool
+     */
+    void (*wait)(pool_t *);
+
+    /** Number of tasks taken from deques of other workers.
+     *
+     * @param pool
+     * @return number of stolen tasks.
+     */
+    size_t (*stolen)(pool_t *);
+
+    /** Finish all tasks, stop the workers and free the pool.
+     *
+     * @param pool
+     */
+    void (*dtor)(pool_t *);
+};
@@ -6,33 +6,117 @@
 #include "progfile.h"
 #include "dynstring.h"
 
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// first chunk read from a pipe. The buffer doubles every time it is full.
+#define READ_CHUNK 4096
+
+// size of the sliding window of a streamed file.
+#define STREAM_WINDOW (64 * 1024)
+
+// The scanner moves the head back by one character after it has read a character beyond a lexeme.
+#define STREAM_LOOKBACK 1
+
+// The scanner peeks only at the very next character.
+#define STREAM_LOOKAHEAD 1
 
 /** An opaque structure representing a file.
+ *
+ *  Positions are absolute offsets in the file. The tape holds the characters [base, size).
+ *  For a file in memory base is 0 and size is the file size.
+ *  A streamed file keeps only a window of STREAM_WINDOW characters; the window slides forward
+ *  when the head reaches its end, keeping STREAM_LOOKBACK characters behind the head
+ *  and everything from the pinned position. If the pinned characters fill the window, it grows.
+ *  tape[size - base] is always '\0', except for a view of a part of another file.
  */
 struct c_progfile {
-    size_t size; // File size
-    size_t pos;  // position in file
-    char tape[];
+    size_t size;   // end of the characters on the tape (File size, if the file is not streamed)
+    size_t pos;    // position in file
+    size_t base;   // position of tape[0] in file
+    size_t mapped; // length of the mapping if the tape is mmap'ed, 0 otherwise
+    size_t window; // capacity of the tape of a streamed file
+    size_t pinned; // characters from this position are kept on the tape of a streamed file
+    bool stream;   // the tape is a sliding window over fd
+    bool borrowed; // the tape belongs to another pfile, see View()
+    bool close_fd; // fd has been opened by pfile
+    int fd;
+    char *tape;    // points to the storage, a heap buffer or a mapping
+    char storage[];
 };
 
-/** Pfile constructor. Create a pfile object using memcpy from a char *. FIts for tests.
+/** Slide the window of a streamed file forward and read next characters.
  *
- * @param pfile char array which become a tape.
+ * @param pfile
+ * @return true if new characters have been read, false on end of file.
+ */
+static bool Refill(pfile_t *pfile) {
+    size_t keep = ((pfile->pos < pfile->size) ? pfile->pos : pfile->size);
+    ssize_t rb;
+
+    if (!pfile->stream) {
+        return false;
+    }
+
+    keep = (keep - pfile->base > STREAM_LOOKBACK) ? keep - STREAM_LOOKBACK : pfile->base;
+    if (pfile->pinned < keep) {
+        keep = (pfile->pinned > pfile->base) ? pfile->pinned : pfile->base;
+    }
+    memmove(pfile->tape, pfile->tape + (keep - pfile->base), pfile->size - keep);
+    pfile->base = keep;
+
+    if (pfile->size - pfile->base == pfile->window) { // full of pinned characters
+        char *tape = malloc(pfile->window * 2 + 1);
+        soft_assert(tape != NULL, ERROR_INTERNAL);
+        memcpy(tape, pfile->tape, pfile->window);
+        if (pfile->tape != pfile->storage) {
+            free(pfile->tape);
+        }
+        pfile->tape = tape;
+        pfile->window *= 2;
+    }
+
+    do {
+        rb = read(pfile->fd, pfile->tape + (pfile->size - pfile->base),
+                  pfile->window - (pfile->size - pfile->base));
+    } while (rb < 0 && errno == EINTR);
+
+    if (rb <= 0) {
+        if (pfile->close_fd) {
+            close(pfile->fd);
+        }
+        pfile->stream = false;
+        pfile->tape[pfile->size - pfile->base] = '\0';
+        return false;
+    }
+    pfile->size += (size_t) rb;
+    pfile->tape[pfile->size - pfile->base] = '\0';
+    return true;
+}
+
+/** Pfile constructor. Create a pfile object using memcpy of characters, which can contain '\0'.
+ *
+ * @param tape characters which become a tape.
+ * @param len number of characters.
  * @return new pfile object.
  */
-static pfile_t *Ctor(char *tape) {
+static pfile_t *Ctor_n(const char *tape, size_t len) {
     pfile_t *pfile;
     if (!tape) {
         goto err0;
     }
-    size_t len = strlen(tape);
 
     pfile = calloc(1, len + 1 + sizeof(pfile_t));
     if (!pfile) {
         goto err0;
     }
 
-    memcpy(pfile->tape, tape, len + 1);
+    pfile->tape = pfile->storage;
+    memcpy(pfile->tape, tape, len);
+    pfile->tape[len] = '\0';
     pfile->size = len;
 
     return pfile;
@@ -41,6 +125,15 @@ static pfile_t *Ctor(char *tape) {
     return NULL;
 }
 
+/** Pfile constructor. Create a pfile object using memcpy from a char *. FIts for tests.
+ *
+ * @param pfile char array which become a tape.
+ * @return new pfile object.
+ */
+static pfile_t *Ctor(char *tape) {
+    return Ctor_n(tape, tape ? strlen(tape) : 0);
+}
+
 /** Move the head of the tape by step @param step.
  *  0 means the next char will be returned,
  *  because previous pgetc() has post-increased pos.
@@ -53,9 +146,12 @@ static char Peek_at(pfile_t *pfile, size_t step) {  //MAYBE RENAME TO MOVE_FILE_
     soft_assert(pfile != NULL, ERROR_INTERNAL);
 
     size_t newpos = pfile->pos + step;
+    soft_assert(!pfile->stream || step < STREAM_LOOKAHEAD, ERROR_INTERNAL);
 
+    while (newpos >= pfile->size && Refill(pfile))
+        ;
     if (newpos < pfile->size) {
-        return pfile->tape[newpos];
+        return pfile->tape[newpos - pfile->base];
     } else {
         return EOF;
     }
@@ -70,13 +166,13 @@ static char Peek_at(pfile_t *pfile, size_t step) {  //MAYBE RENAME TO MOVE_FILE_
  */
 static int Getc(pfile_t *pfile) {
     soft_assert(pfile != NULL, ERROR_INTERNAL);
-    if (pfile->pos < pfile->size) {
-        return pfile->tape[pfile->pos++];
+    if (pfile->pos < pfile->size || (pfile->pos == pfile->size && Refill(pfile))) {
+        return pfile->tape[pfile->pos++ - pfile->base];
     } else {
         pfile->pos++;
     }
 
-    return EOF;;
+    return EOF;
 }
 
 /** Move tape head one character backward, and return a current character
@@ -86,7 +182,12 @@ static int Getc(pfile_t *pfile) {
  */
 static int Ungetc(pfile_t *pfile) {
     soft_assert(pfile != NULL, ERROR_INTERNAL);
-    return (pfile->pos > 0) ? pfile->tape[--pfile->pos] : EOF;
+    if (pfile->pos == 0) {
+        return EOF;
+    }
+    soft_assert(pfile->pos > pfile->base, ERROR_INTERNAL); // out of the lookback window
+    pfile->pos--;
+    return (pfile->pos < pfile->size) ? pfile->tape[pfile->pos - pfile->base] : EOF;
 }
 
 /** Free data structure.
@@ -96,9 +197,16 @@ static int Ungetc(pfile_t *pfile) {
  */
 static void Free(pfile_t *pfile) {
     soft_assert(pfile != NULL, ERROR_INTERNAL);
+    if (pfile->stream && pfile->close_fd) {
+        close(pfile->fd);
+    }
+    if (pfile->mapped) {
+        munmap(pfile->tape, pfile->mapped);
+    } else if (pfile->tape != pfile->storage && !pfile->borrowed) {
+        free(pfile->tape);
+    }
     pfile->size = 0;
     pfile->pos = 0;
-    // pfile->tape = 0; // not sure about it
     free(pfile);
 }
 
@@ -119,7 +227,64 @@ static char *Get_tape(pfile_t *pfile) {
  */
 static char *Get_tape_current(pfile_t *pfile) {
     soft_assert(pfile != NULL, ERROR_INTERNAL);
-    return (pfile->tape + pfile->pos);
+    return (pfile->tape + (pfile->pos - pfile->base));
+}
+
+/** Get the number of characters on the tape from the head position.
+ *  If the head is at the end of a streamed window, the window slides forward first.
+ *
+ * @param pfile
+ * @return number of characters available at get_tape_current(). 0 on end of file.
+ */
+static size_t Available(pfile_t *pfile) {
+    soft_assert(pfile != NULL, ERROR_INTERNAL);
+    if (pfile->pos == pfile->size) {
+        Refill(pfile);
+    }
+    return (pfile->pos < pfile->size) ? pfile->size - pfile->pos : 0;
+}
+
+/** Move the head forward.
+ *
+ * @param pfile
+ * @param n number of characters to skip, at most available(pfile).
+ */
+static void Skip(pfile_t *pfile, size_t n) {
+    soft_assert(pfile != NULL, ERROR_INTERNAL);
+    soft_assert(pfile->pos + n <= pfile->size, ERROR_INTERNAL);
+    pfile->pos += n;
+}
+
+/** Get the absolute position of the head in the file.
+ *
+ * @param pfile
+ * @return position, which does not change when a streamed window slides.
+ */
+static size_t Tell(pfile_t *pfile) {
+    soft_assert(pfile != NULL, ERROR_INTERNAL);
+    return pfile->pos;
+}
+
+/** Get characters at an absolute position.
+ *
+ * @param pfile
+ * @param pos position on the tape.
+ * @return pointer to the tape.
+ */
+static const char *Get_at(pfile_t *pfile, size_t pos) {
+    soft_assert(pfile != NULL, ERROR_INTERNAL);
+    soft_assert(pos >= pfile->base, ERROR_INTERNAL); // the window has slid over it
+    return pfile->tape + (pos - pfile->base);
+}
+
+/** Keep characters from the position on the tape of a streamed file.
+ *
+ * @param pfile
+ * @param pos position returned by tell().
+ */
+static void Pin(pfile_t *pfile, size_t pos) {
+    soft_assert(pfile != NULL, ERROR_INTERNAL);
+    pfile->pinned = pos;
 }
 
 /** Refresh pfile->tape to the new value.
@@ -135,93 +300,194 @@ static void Set_tape(pfile_t *pfile, char *tape) {
     soft_assert(pfile != NULL, ERROR_INTERNAL);
 
     size_t diff = tape - pfile->tape;
-    if (diff > 0 && diff < pfile->size - 1) {
-        pfile->pos = diff;
+    if (diff > 0 && diff < pfile->size - pfile->base - 1) {
+        pfile->pos = pfile->base + diff;
     }
 }
 
-/** Reads a file from stdin to progfile structure.
+/** Read everything from a file descriptor into a heap buffer.
+ *  The buffer grows geometrically and becomes the tape itself, so the data is not copied once more.
  *
+ * @param fd file descriptor, e.g. a pipe.
  * @return File stored in pfile structure. If error_interface return NULL.
  */
-static pfile_t *Getfile_stdin() {
+static pfile_t *Read_fd(int fd) {
     pfile_t *pfile;
+    size_t allocated = READ_CHUNK;
+    size_t size = 0;
+    ssize_t rb;
+    char *buf = malloc(allocated);
 
-    int ch;
-    size_t allocated, alloc_step = allocated = 128;
-
-    pfile = calloc(1, sizeof(pfile_t) + alloc_step);
-    if (!pfile) {
+    if (!buf) {
         goto err0;
     }
 
-    while (EOF != (ch = fgetc(stdin))) {
-        if (pfile->size + 2 >= allocated) {
-            pfile_t *r = realloc(pfile, sizeof(pfile_t) + (allocated += alloc_step));
+    for (;;) {
+        if (size + 1 >= allocated) {
+            char *r = realloc(buf, allocated *= 2);
             if (!r) {
-                goto err;
+                goto err1;
             }
-            pfile = r;
+            buf = r;
         }
-        pfile->tape[pfile->size++] = (char) ch;
-        pfile->tape[pfile->size] = 0;
+        rb = read(fd, buf + size, allocated - size - 1);
+        if (rb == 0) {
+            break;
+        }
+        if (rb < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            goto err1;
+        }
+        size += (size_t) rb;
     }
+    buf[size] = '\0';
 
+    if (!(pfile = calloc(1, sizeof(pfile_t)))) {
+        goto err1;
+    }
+    pfile->tape = buf;
+    pfile->size = size;
     return pfile;
 
-    err:
-    free(pfile);
+    err1:
+    free(buf);
     err0:
     Errors.set_error(ERROR_INTERNAL);
     return NULL;
 }
 
-/** Store file to progfile structure.
+/** Store a file from a file descriptor to progfile structure.
+ *  Regular files are mapped to memory, everything else is read by chunks.
+ *  The file is taken from the current offset of fd, a file which has been partly read
+ *  (e.g. by a shell command before the compiler) is read by chunks as well.
  *
- * @param filename
- * @param mode File opening mode.
- * @return pfile where file is stored. If error_interface returns NULL.
+ *  A mapping is '\0' terminated by the zeroed tail of its last page.
+ *  If a file size is a multiple of the page size, there is no tail, so the file is read instead.
+ *  The mapping is MAP_PRIVATE, the file must not be truncated while the compiler runs,
+ *  otherwise reading of the lost pages kills the process with SIGBUS.
+ *
+ * @param fd file descriptor.
+ * @return File stored in pfile structure. If error_interface return NULL.
  */
-static pfile_t *Getfile(const char *filename, const char *mode) {
+static pfile_t *Getfile_fd(int fd) {
     pfile_t *pfile;
-    FILE *fp = fopen(filename, mode);
-    size_t size;
+    struct stat st;
+    char *map;
 
-    if (fp == NULL) {
-        goto err0;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0
+        || (st.st_size % sysconf(_SC_PAGESIZE)) == 0 || lseek(fd, 0, SEEK_CUR) != 0) {
+        return Read_fd(fd);
     }
 
-    fseek(fp, 0L, SEEK_END);
-    size = ftell(fp);
-    fseek(fp, 0, SEEK_SET); // return a pointer back to the beginning of the file
+    map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        return Read_fd(fd);
+    }
+    posix_madvise(map, (size_t) st.st_size, POSIX_MADV_SEQUENTIAL);
 
-    if (NULL == (pfile = calloc(1, size + sizeof(pfile_t) + 1))) { // + 1 is for '\0' for "EOF"
-        goto err1;
+    if (!(pfile = calloc(1, sizeof(pfile_t)))) {
+        munmap(map, (size_t) st.st_size);
+        Errors.set_error(ERROR_INTERNAL);
+        return NULL;
     }
+    pfile->tape = map;
+    pfile->size = (size_t) st.st_size;
+    pfile->mapped = (size_t) st.st_size;
+    return pfile;
+}
 
-    pfile->size = size;
-    size_t rb;
+/** Reads a file from stdin to progfile structure.
+ *
+ * @return File stored in pfile structure. If error_interface return NULL.
+ */
+static pfile_t *Getfile_stdin() {
+    return Getfile_fd(STDIN_FILENO);
+}
+
+/** Open a file as a stream. Only a window of the file is held in memory.
+ *
+ * @param filename file to stream. If NULL, stdin is streamed.
+ * @return pfile, which reads the file by chunks. If error_interface returns NULL.
+ */
+static pfile_t *Getfile_stream(const char *filename) {
+    pfile_t *pfile;
+    int fd = (filename) ? open(filename, O_RDONLY) : STDIN_FILENO;
 
-    if (size != (rb = fread(pfile->tape, 1, size, fp))) {
-        goto err2;
+    if (fd < 0) {
+        goto err0;
     }
 
-    fclose(fp);
+    // + 1 is for '\0'
+    if (!(pfile = calloc(1, sizeof(pfile_t) + STREAM_WINDOW + 1))) {
+        goto err1;
+    }
+    pfile->tape = pfile->storage;
+    pfile->window = STREAM_WINDOW;
+    pfile->pinned = SIZE_MAX;
+    pfile->fd = fd;
+    pfile->close_fd = (filename != NULL);
+    pfile->stream = true;
     return pfile;
 
-    err2:
-    free(pfile);
     err1:
-    fclose(fp);
+    if (filename) {
+        close(fd);
+    }
     err0:
     Errors.set_error(ERROR_INTERNAL);
     return NULL;
 }
 
+/** Store file to progfile structure.
+ *
+ * @param filename
+ * @return pfile where file is stored. If error_interface returns NULL.
+ */
+static pfile_t *Getfile(const char *filename) {
+    pfile_t *pfile;
+    int fd = open(filename, O_RDONLY);
+
+    if (fd < 0) {
+        Errors.set_error(ERROR_INTERNAL);
+        return NULL;
+    }
+
+    pfile = Getfile_fd(fd);
+    close(fd);
+    return pfile;
+}
+
+/** Make a file of characters [start, end) of another file, which holds them on its tape.
+ *  The view shares the tape, positions in it are the same as in the file,
+ *  and it ends at end. It must be freed before the file.
+ *
+ * @param pfile
+ * @param start position of the first character.
+ * @param end position after the last character.
+ * @return new pfile object.
+ */
+static pfile_t *View(pfile_t *pfile, size_t start, size_t end) {
+    soft_assert(pfile != NULL, ERROR_INTERNAL);
+    soft_assert(pfile->base <= start && start <= end && end <= pfile->size, ERROR_INTERNAL);
+
+    pfile_t *view = calloc(1, sizeof(pfile_t) + 1);
+    soft_assert(view != NULL, ERROR_INTERNAL);
+    view->tape = pfile->tape;
+    view->base = pfile->base;
+    view->pos = start;
+    view->size = end;
+    view->pinned = SIZE_MAX;
+    view->borrowed = true;
+    return view;
+}
+
 
 const struct pfile_interface_t Pfile = {
         .getfile = Getfile,
         .getfile_stdin  = Getfile_stdin,
+        .getfile_stream = Getfile_stream,
         .dtor = Free,
         .pgetc = Getc,
         .ungetc = Ungetc,
@@ -229,5 +495,12 @@ const struct pfile_interface_t Pfile = {
         .set_tape = Set_tape,
         .peek_at = Peek_at,
         .get_tape_current = Get_tape_current,
+        .available = Available,
+        .skip = Skip,
+        .tell = Tell,
+        .get_at = Get_at,
+        .pin = Pin,
+        .view = View,
         .ctor = Ctor,
+        .ctor_n = Ctor_n,
 };
@@ -27,20 +27,31 @@ extern const struct pfile_interface_t Pfile;
 struct pfile_interface_t {
     /**
      * @brief Store file to progfile structure.
+     * Regular files are mapped to memory instead of being copied.
      *
      * @param filename
-     * @param mode File opening mode.
      * @return pfile where file is stored. If error_interface returns NULL.
      */
-    pfile_t *(*getfile)(const char *, const char *);
+    pfile_t *(*getfile)(const char *);
 
     /**
      * @brief Reads a file from stdin to progfile structure.
+     * If stdin is redirected from a regular file, the file is mapped, otherwise it is read by chunks.
      *
      * @return File stored in pfile structure. If error_interface return NULL.
      */
     pfile_t *(*getfile_stdin)(void);
 
+    /**
+     * @brief Open a file as a stream, so only a small window of it is held in memory.
+     * The window keeps one character behind the head for ungetc, one character ahead for peek_at
+     * and everything after the pinned position, so get_tape and get_tape_current return the current window only.
+     *
+     * @param filename file to stream. If NULL, stdin is streamed.
+     * @return pfile reading the file by chunks. If error_interface returns NULL.
+     */
+    pfile_t *(*getfile_stream)(const char *);
+
     /**
      * @brief Free data structure.
      *
@@ -81,6 +92,62 @@ struct pfile_interface_t {
      */
     char *(*get_tape_current)(pfile_t *);
 
+    /**
+     * @brief Get the number of characters on the tape from the head position.
+     * get_tape_current() can be read up to this length without pgetc().
+     * If the head is at the end of a streamed window, the window slides forward first.
+     *
+     * @param pfile
+     * @return number of characters available. 0 on end of file.
+     */
+    size_t (*available)(pfile_t *);
+
+    /**
+     * @brief Move the head forward by @param n characters, at most available().
+     *
+     * @param pfile
+     * @param n
+     */
+    void (*skip)(pfile_t *, size_t);
+
+    /**
+     * @brief Get the absolute position of the head in the file.
+     *
+     * @param pfile
+     * @return position, which does not change when a streamed window slides.
+     */
+    size_t (*tell)(pfile_t *);
+
+    /**
+     * @brief Get characters at an absolute position.
+     * A streamed file holds only positions after the pinned one and the head.
+     *
+     * @param pfile
+     * @param pos position returned by tell().
+     * @return pointer to the tape.
+     */
+    const char *(*get_at)(pfile_t *, size_t);
+
+    /**
+     * @brief Keep characters from the position on the tape, a streamed window grows if needed.
+     * Each call replaces the previous pin.
+     *
+     * @param pfile
+     * @param pos position returned by tell().
+     */
+    void (*pin)(pfile_t *, size_t);
+
+    /**
+     * @brief Make a file of characters [start, end) of another file, which holds them on its tape.
+     * The view shares the tape and positions with the file. It must be freed before the file.
+     *
+     * @param pfile
+     * @param start position of the first character.
+     * @param end position after the last character.
+     * @return new pfile object.
+     */
+    pfile_t *(*view)(pfile_t *, size_t, size_t);
+
     /**
      * @brief Refresh pfile->tape to the new value.
      * NOTE: new @param tape must be the part of pfile->tape, e.g. it can be strchr(gettape(pfile), some_char).
@@ -110,5 +177,14 @@ struct pfile_interface_t {
      * @return pointer on pfile_t or NULL
      */
     pfile_t *(*ctor)(char *);
+
+    /**
+     * @brief Create a file from characters in memory, which are copied.
+     *
+     * @param tape characters, they can contain '\0'.
+     * @param len number of characters.
+     * @return pointer on pfile_t or NULL
+     */
+    pfile_t *(*ctor_n)(const char *, size_t);
 };
 
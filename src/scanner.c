@@ -6,33 +6,124 @@
  * @author Skuratovich Aliaksandr <xskura01@vutbr.cz>
  */
 #include "scanner.h"
+#include "tokbuf.h"
+#include "numconv.h"
+#include "context.h"
 
+#include <pthread.h>
 
-/** Previous token is used for error handling, if I will not give a d&ck.
- */
-static token_t prev;
 
-/** Current token of the program.
+/** Tokens, the program and prelexed tokens are in the compilation context, see context.h.
+ *  The state of the engines is per thread, because parts of a file are lexed in parallel
+ *  and a compilation runs on one thread. Scanner.init() resets it.
  */
-static token_t curr;
 
 /** Current line of the program.
  */
-static size_t lines = 1;
+static _Thread_local size_t lines = 1;
 
 /** Current state of the dfa.
  */
-static int state = STATE_INIT;
+static _Thread_local int state = STATE_INIT;
 
 /** Current character position in the line
  */
-static size_t charpos;
+static _Thread_local size_t charpos;
+
+/** Smallest part of a file lexed by a thread, selftests make it smaller.
+ */
+static size_t lex_part_min = 256 * 1024;
 
 
 #define is_hexnumber(ch) (((ch) >= '0' && (ch) <= '9') || ((ch) >= 'A' && (ch) <= 'F') || ((ch) >= 'a' && (ch) <= 'f'))
 #define hex2dec(ch) ((uint8_t)((ch) -(((ch) > '9') ? (-10 + (((ch) > 'Z' ) ? 'a': 'A')): '0')))
 
 
+/** Keep characters of a lexeme on the tape, until the next token is requested.
+ *
+ * @param pfile
+ * @param start position of the first character of the lexeme.
+ */
+static void pin_lexeme(pfile_t *pfile, size_t start) {
+    Pfile.pin(pfile, start);
+}
+
+/** Make a dynstring from characters, which can contain '\0'.
+ */
+static dynstring_t *str_from(const char *s, size_t len) {
+    dynstring_t *str = Dynstring.ctor("");
+    Dynstring.append_n(str, s, len);
+    return str;
+}
+
+/** Count lines and the character position after whitespace skipped between lexemes.
+ *  Gives the same result as going through the characters one by one:
+ *  '\n' and '\r' start a new line and '\t' is 4 characters wide.
+ *
+ * @param s skipped characters.
+ * @param n number of characters.
+ */
+static void count_whitespace(const char *s, size_t n) {
+    size_t last = n; // characters after the last newline are on the current line.
+    while (last > 0 && s[last - 1] != '\n' && s[last - 1] != '\r') {
+        last--;
+    }
+    if (last > 0) {
+        lines += Textscan.count(s, last, '\n') + Textscan.count(s, last, '\r');
+        charpos = 0;
+    }
+    charpos += (n - last) + 3 * Textscan.count(s + last, n - last, '\t');
+}
+
+/** Count lines and the character position after skipped characters of a comment.
+ *  Only '\n' starts a new line in comments.
+ *
+ * @param s skipped characters.
+ * @param n number of characters.
+ */
+static void count_comment(const char *s, size_t n) {
+    size_t last = n;
+    while (last > 0 && s[last - 1] != '\n') {
+        last--;
+    }
+    if (last > 0) {
+        lines += Textscan.count(s, last, '\n');
+        charpos = 0;
+    }
+    charpos += n - last;
+}
+
+/** Skip whitespace under the tape head at once.
+ *
+ * @param pfile
+ */
+static void skip_whitespace(pfile_t *pfile) {
+    size_t avail, n;
+    do {
+        avail = Pfile.available(pfile);
+        const char *s = Pfile.get_tape_current(pfile);
+        n = Textscan.span_whitespace(s, avail);
+        count_whitespace(s, n);
+        Pfile.skip(pfile, n);
+    } while (n == avail && avail != 0);
+}
+
+/** Skip characters of a comment up to the stop character or (char) EOF.
+ *
+ * @param pfile
+ * @param stop character which changes the state of the comment automaton.
+ */
+static void skip_comment(pfile_t *pfile, char stop) {
+    size_t avail, n;
+    do {
+        avail = Pfile.available(pfile);
+        const char *s = Pfile.get_tape_current(pfile);
+        n = Textscan.find_any(s, avail, stop, (char) EOF, stop, stop);
+        count_comment(s, n);
+        Pfile.skip(pfile, n);
+    } while (n == avail && avail != 0);
+}
+
 /** Covert state to string.
  *
  * @param s state
@@ -53,26 +144,60 @@ static char *state_tostring(const int s) {
  */
 typedef struct kypair {
     const char *nam;
+    size_t len;
     int kwd;
 } kpar_t;
 
+/** Keywords in the order of KEYWORDS(X).
+ */
+static const kpar_t keywords[] = {
+        #define X(n) { #n , sizeof(#n) - 1, KEYWORD(n) },
+        KEYWORDS(X)
+        #undef X
+        {NULL, 0, 0} // the end
+};
+
+#define KEYWORD_TABLE_SIZE 64
+
+/** Perfect hash of a keyword, uses its length, the first and the last character.
+ *  The hash has no collisions for KEYWORDS(X), which is checked in init_keywords().
+ *  If a new keyword makes a collision, the coefficients have to be changed.
+ */
+#define KEYWORD_HASH(len, first, last) \
+    ((((len) * 4) + ((unsigned char) (first) * 12) + ((unsigned char) (last) * 3)) & (KEYWORD_TABLE_SIZE - 1))
+
+/** Keywords indexed by KEYWORD_HASH. Empty slots have len == 0.
+ */
+static kpar_t keyword_table[KEYWORD_TABLE_SIZE];
+
+/** Fill the keyword table from KEYWORDS(X).
+ */
+static void init_keywords() {
+    static bool initialized = false;
+    if (initialized) {
+        return;
+    }
+
+    for (int i = 0; keywords[i].nam != NULL; i++) {
+        size_t h = KEYWORD_HASH(keywords[i].len, keywords[i].nam[0], keywords[i].nam[keywords[i].len - 1]);
+        soft_assert(keyword_table[h].nam == NULL, ERROR_INTERNAL); // the hash is not perfect anymore.
+        keyword_table[h] = keywords[i];
+    }
+    initialized = true;
+}
+
 /** Convert an identifier to keyword.
  *
  * @param identif to be coverted.
+ * @param len length of the identifier, must be > 0.
  * @return keyword.
  */
-static int to_keyword(const char *identif) {
-    static const kpar_t kwds[] = {
-            #define X(n) { #n , KEYWORD(n) },
-            KEYWORDS(X)
-            #undef X
-            {NULL, 0} // the end
-    };
+static int to_keyword(const char *identif, size_t len) {
+    const kpar_t *kw = &keyword_table[KEYWORD_HASH(len, identif[0], identif[len - 1])];
 
-    for (int i = 0; kwds[i].nam != NULL; i++)
-        if (strcmp(kwds[i].nam, identif) == 0) {
-            return kwds[i].kwd;
-        }
+    if (kw->len == len && memcmp(kw->nam, identif, len) == 0) {
+        return kw->kwd;
+    }
 
     return TOKEN_ID;
 }
@@ -160,24 +285,47 @@ static token_t lex_string(pfile_t *pfile) {
     int ch;
     uint8_t escaped_char;
     bool accepted = false;
-    token_t token = {.type = TOKEN_STR, .attribute.id = Dynstring.ctor("")};
-
-    while (!accepted && (ch = Pfile.pgetc(pfile)) != EOF) {
+    size_t start = Pfile.tell(pfile);
+    dynstring_t *decoded = NULL; // created by the first escape sequence
+    token_t token = {.type = TOKEN_STR, .attribute.span = {.offset = start}};
+
+    pin_lexeme(pfile, start);
+    for (;;) {
+        if (!accepted && state == STATE_STR_INIT) { // ordinary characters are skipped at once.
+            size_t avail = Pfile.available(pfile);
+            const char *s = Pfile.get_tape_current(pfile);
+            size_t n = Textscan.find_any(s, avail, '"', '\\', '\n', (char) EOF);
+            if (decoded) {
+                Dynstring.append_n(decoded, s, n);
+            }
+            Pfile.skip(pfile, n);
+            charpos += n;
+        }
+        if (accepted || (ch = Pfile.pgetc(pfile)) == EOF) {
+            break;
+        }
         charpos++;
         switch (state) {
             case STATE_STR_INIT:
                 switch (ch) {
                     case '\\':
+                        if (!decoded) {
+                            decoded = Dynstring.ctor("");
+                            Dynstring.append_n(decoded, Pfile.get_at(pfile, start), Pfile.tell(pfile) - 1 - start);
+                        }
                         state = STATE_STR_ESC;
                         break;
                     case '"':
+                        token.attribute.span.len = Pfile.tell(pfile) - 1 - start;
                         state = STATE_STR_FINAL;
                         accepted = true;
                         break;
                     case '\n':
                         accepted = true;
                     default:
-                        Dynstring.append(token.attribute.id, (char) ch);
+                        if (decoded) {
+                            Dynstring.append(decoded, (char) ch);
+                        }
                         break;
                 }
                 break;
@@ -198,18 +346,18 @@ static token_t lex_string(pfile_t *pfile) {
                         state = STATE_STR_DEC_0_2;
                         break;
                     case 't':
-                        Dynstring.append(token.attribute.id, '\t');
+                        Dynstring.append(decoded, '\t');
                         state = STATE_STR_INIT;
                         break;
                     case 'n':
-                        Dynstring.append(token.attribute.id, '\n');
+                        Dynstring.append(decoded, '\n');
                         state = STATE_STR_INIT;
                         break;
                     case 'x':
                         state = STATE_STR_HEX_1;
                         break;
                     case_2('\\', '\"'):
-                        Dynstring.append(token.attribute.id, (char) ch);
+                        Dynstring.append(decoded, (char) ch);
                         state = STATE_STR_INIT;
                         break;
                     default:
@@ -244,7 +392,7 @@ static token_t lex_string(pfile_t *pfile) {
                     accepted = true;
                 }
                 escaped_char |= hex2dec(ch);
-                Dynstring.append(token.attribute.id, (char) escaped_char);
+                Dynstring.append(decoded, (char) escaped_char);
                 state = STATE_STR_INIT;
                 break;
 
@@ -286,7 +434,7 @@ static token_t lex_string(pfile_t *pfile) {
                     accepted = true;
                 }
                 escaped_char += (ch - '0');
-                Dynstring.append(token.attribute.id, (char) escaped_char);
+                Dynstring.append(decoded, (char) escaped_char);
                 break;
 
             case STATE_STR_DEC_1_1:
@@ -296,7 +444,7 @@ static token_t lex_string(pfile_t *pfile) {
                     accepted = true;
                 }
                 escaped_char += (ch - '0');
-                Dynstring.append(token.attribute.id, (char) escaped_char);
+                Dynstring.append(decoded, (char) escaped_char);
                 break;
 
             case STATE_STR_DEC_1_2:
@@ -306,7 +454,7 @@ static token_t lex_string(pfile_t *pfile) {
                     accepted = true;
                 }
                 escaped_char += (ch - '0');
-                Dynstring.append(token.attribute.id, (char) escaped_char);
+                Dynstring.append(decoded, (char) escaped_char);
                 break;
 
             default:
@@ -316,7 +464,9 @@ static token_t lex_string(pfile_t *pfile) {
     }
     if (state != STATE_STR_FINAL) {
         token.type = TOKEN_DEAD;
-        Dynstring.dtor(token.attribute.id);
+        Dynstring.dtor(decoded);
+    } else {
+        token.attribute.span.str = decoded;
     }
 
     return token;
@@ -332,16 +482,19 @@ static token_t lex_identif(pfile_t *pfile) {
     state = STATE_ID_INIT;
     int ch;
     bool accepted = false;
+    size_t start = Pfile.tell(pfile);
+    size_t len = 0;
     charpos--;
 
-    token_t token = {.type = TOKEN_ID, .attribute.id = Dynstring.ctor("")};
+    token_t token = {.type = TOKEN_ID};
 
+    pin_lexeme(pfile, start);
     while (!accepted && (ch = Pfile.pgetc(pfile)) != EOF) {
         charpos++;
         switch (state) { // an e transition between INIT and STATE_IT_INIT, because it have to be in the separate function
             case STATE_ID_INIT:
                 if (isalpha(ch) || ch == '_') {
-                    Dynstring.append(token.attribute.id, (char) ch);
+                    len++;
                     state = STATE_ID_FINAL;
                 } else {
                     accepted = true;
@@ -350,7 +503,7 @@ static token_t lex_identif(pfile_t *pfile) {
 
             case STATE_ID_FINAL: // so actually there has to be only one identifier state in the dfa
                 if (isalnum(ch) || ch == '_') {
-                    Dynstring.append(token.attribute.id, (char) ch);
+                    len++;
                 } else {
                     accepted = true;
                     Pfile.ungetc(pfile);
@@ -363,14 +516,12 @@ static token_t lex_identif(pfile_t *pfile) {
     }
 
     if (state != STATE_ID_FINAL) {
-        Dynstring.dtor(token.attribute.id);
-        token.type = TOKEN_DEAD;
+        return (token_t) {.type = TOKEN_DEAD};
     }
 
     // this 2 lines of code make parsing much more easier
-    if ((token.type = to_keyword(Dynstring.c_str(token.attribute.id))) != TOKEN_ID) {
-        Dynstring.dtor(token.attribute.id);
-    }
+    token.type = to_keyword(Pfile.get_at(pfile, start), len);
+    token.attribute.span = (span_t) {.offset = start, .len = len};
 
     return token;
 }
@@ -387,7 +538,16 @@ static bool process_comment(pfile_t *pfile) {
     charpos--;
 
     // != EOF is not a true "DFA" way of thinking, but it is more clearly
-    while (!accepted && (ch = Pfile.pgetc(pfile)) != EOF) {
+    for (;;) {
+        // characters which do not change the state are skipped at once.
+        if (state == STATE_COMMENT_SLINE) {
+            skip_comment(pfile, '\n');
+        } else if (state == STATE_COMMENT_BLOCK_2 || state == STATE_COMMENT_BLOCK_END) {
+            skip_comment(pfile, ']');
+        }
+        if (accepted || (ch = Pfile.pgetc(pfile)) == EOF) {
+            break;
+        }
         charpos++;
         if (ch == '\n') {
             lines++;
@@ -488,7 +648,9 @@ static token_t lex_relate_op(pfile_t *pfile) {
  */
 static token_t lex_number(pfile_t *pfile) {
     state = STATE_NUM_INIT;
-    dynstring_t *ascii_num = Dynstring.ctor(""); // ctor an empty string
+    decimal_t num = {0,}; // the value is accumulated while the number is scanned.
+    size_t start = Pfile.tell(pfile);
+    pin_lexeme(pfile, start); // rare long literals are rounded by strtod() of the text.
 
     bool is_fp = true; // suppose it is true.
     int ch;
@@ -507,7 +669,7 @@ static token_t lex_number(pfile_t *pfile) {
                     accepted = true;
                     break;
                 }
-                Dynstring.append(ascii_num, (char) ch);
+                decimal_digit(&num, ch);
                 break;
 
                 // we got here from number init state and there was 0.
@@ -516,10 +678,10 @@ static token_t lex_number(pfile_t *pfile) {
                 // append char is after the statement, so an empty statement is here.
                 if (isdigit(ch)) {
                     state = STATE_NUM_3;
-                    Dynstring.append(ascii_num, (char) ch);
+                    decimal_digit(&num, ch);
                 } else if (ch == '.') {
                     state = STATE_NUM_7;
-                    Dynstring.append(ascii_num, (char) ch);
+                    num.fraction = true;
                 } else {
                     // null has been accepted, so it is a legit integer.
                     is_fp = false;
@@ -531,57 +693,55 @@ static token_t lex_number(pfile_t *pfile) {
                 // 1-9 has been accepted, so is is an integer now.
             case STATE_NUM_2:
                 if (isdigit(ch)) {
-                    // append character after if statement.
-                    ;;
+                    decimal_digit(&num, ch);
                 } else if (ch == '.') {
                     state = STATE_NUM_7;
+                    num.fraction = true;
                 } else if (ch == 'e' || ch == 'E') {
                     state = STATE_NUM_5;
                 } else {
                     is_fp = false;
                     accepted = true;
                     state = STATE_NUM_FINAL;
-                    break;
                 }
-                Dynstring.append(ascii_num, (char) ch);
                 break;
 
                 // tro zeros have been accepted.
             case STATE_NUM_3:
                 if (isdigit(ch)) {
                     state = STATE_NUM_4;
+                    decimal_digit(&num, ch);
                 } else if (ch == '.') {
                     state = STATE_NUM_7;
+                    num.fraction = true;
                 } else {
                     is_fp = false;
                     state = STATE_NUM_FINAL;
                     accepted = true;
-                    break;
                 }
-                Dynstring.append(ascii_num, (char) ch);
                 break;
 
             case STATE_NUM_4:
-                if (isdigit(ch)) { ;;
+                if (isdigit(ch)) {
+                    decimal_digit(&num, ch);
                 } else if (ch == '.') {
                     state = STATE_NUM_7;
+                    num.fraction = true;
                 } else if (ch == 'e' || ch == 'E') {
                     // got an exponent
                     state = STATE_NUM_5;
                 } else {
                     accepted = true;
-                    break;
                 }
-                Dynstring.append(ascii_num, (char) ch);
                 break;
 
             case STATE_NUM_5:
                 if (isdigit(ch)) {
                     state = STATE_NUM_9;
-                    Dynstring.append(ascii_num, (char) ch);
+                    decimal_exp_digit(&num, ch);
                 } else if (ch == '+' || ch == '-') {
                     state = STATE_NUM_6;
-                    Dynstring.append(ascii_num, (char) ch);
+                    num.negative = ch == '-';
                 } else {
                     accepted = true;
                 }
@@ -590,7 +750,7 @@ static token_t lex_number(pfile_t *pfile) {
             case STATE_NUM_6:
                 if (isdigit(ch)) {
                     state = STATE_NUM_9;
-                    Dynstring.append(ascii_num, (char) ch);
+                    decimal_exp_digit(&num, ch);
                 } else {
                     accepted = true;
                 }
@@ -599,7 +759,7 @@ static token_t lex_number(pfile_t *pfile) {
             case STATE_NUM_7:
                 if (isdigit(ch)) {
                     state = STATE_NUM_8;
-                    Dynstring.append(ascii_num, (char) ch);
+                    decimal_digit(&num, ch);
                 } else {
                     accepted = true;
                 }
@@ -607,9 +767,8 @@ static token_t lex_number(pfile_t *pfile) {
 
             case STATE_NUM_8:
                 if (isdigit(ch)) {
-                    Dynstring.append(ascii_num, (char) ch);
+                    decimal_digit(&num, ch);
                 } else if (ch == 'e' || ch == 'E') {
-                    Dynstring.append(ascii_num, (char) ch);
                     state = STATE_NUM_5;
                 } else {
                     accepted = true;
@@ -619,7 +778,7 @@ static token_t lex_number(pfile_t *pfile) {
 
             case STATE_NUM_9:
                 if (isdigit(ch)) {
-                    Dynstring.append(ascii_num, (char) ch);
+                    decimal_exp_digit(&num, ch);
                 } else {
                     accepted = true;
                     state = STATE_NUM_FINAL;
@@ -631,7 +790,6 @@ static token_t lex_number(pfile_t *pfile) {
         }
     }
     if (state != STATE_NUM_FINAL) {
-        Dynstring.dtor(ascii_num);
         return (token_t) {.type = TOKEN_DEAD};
     }
 
@@ -640,12 +798,11 @@ static token_t lex_number(pfile_t *pfile) {
 
     if (is_fp) {
         token.type = TOKEN_NUM_F;
-        token.attribute.num_f = strtod(Dynstring.c_str(ascii_num), NULL);
+        token.attribute.num_f = Numconv.to_double(&num, Pfile.get_at(pfile, start));
     } else {
         token.type = TOKEN_NUM_I;
-        token.attribute.num_i = strtoull(Dynstring.c_str(ascii_num), NULL, 10);
+        token.attribute.num_i = num.integer;
     }
-    Dynstring.dtor(ascii_num);
 
     return token;
 }
@@ -672,11 +829,13 @@ static token_t scanner(pfile_t *pfile) {
         case_2('\n', 13):
             lines++;
             charpos = 0;
+            skip_whitespace(pfile);
             goto next_lexeme;
             break;
 
         case_2('\t', ' '):
             charpos += (ch == '\t') ? 3 : 0;
+            skip_whitespace(pfile);
             goto next_lexeme;
             break;
 
@@ -736,10 +895,535 @@ static token_t scanner(pfile_t *pfile) {
             debug_msg("unrecognized ch with ascii '%d'\n", ch);
             break;
     }
-    if (token.type == TOKEN_DEAD) {
-        Errors.set_error(ERROR_LEXICAL);
+    return token;
+}
+
+/*
+ * Table-driven engine.
+ *
+ * It recognizes the same automata as the functions above, but a character is classified by a lookup
+ * in char_class[] and the next state is found in transitions[state][class], so there is no
+ * branching on characters. The tape is read directly, without pgetc/ungetc calls.
+ * Select it with -DSCANNER_TABLE_DRIVEN.
+ */
+
+/** Character classes. Characters of one class are indistinguishable for all automata.
+ */
+typedef enum char_class {
+    CC_OTHER = 0,
+    CC_EOF,      // end of file and (char) EOF
+    CC_NL,       // '\n'
+    CC_CR,       // '\r'
+    CC_BLANK,    // ' '
+    CC_TAB,      // '\t'
+    CC_ZERO,     // '0'
+    CC_ONE,      // '1'
+    CC_TWO,      // '2'
+    CC_3_4,      // '3' '4'
+    CC_FIVE,     // '5'
+    CC_6_9,      // '6' - '9'
+    CC_HEXALPHA, // [a-dfA-DF]
+    CC_E,        // 'e' 'E'
+    CC_N,        // 'n'
+    CC_T,        // 't'
+    CC_X,        // 'x'
+    CC_ALPHA,    // other letters and '_'
+    CC_DOT,      // '.'
+    CC_PLUS,     // '+'
+    CC_MINUS,    // '-'
+    CC_QUOTE,    // '"'
+    CC_BSLASH,   // '\\'
+    CC_LBRACKET, // '['
+    CC_RBRACKET, // ']'
+    CC_SLASH,    // '/'
+    CC_REL,      // '>' '<' '=' '~'
+    CC_SINGLE,   // single character tokens except '+'
+    CC_COUNT,
+} char_class_t;
+
+#define CS(cc) (UINT64_C(1) << (cc))
+#define CS_ALL (CS(CC_COUNT) - 1)
+#define CS_DIGIT (CS(CC_ZERO) | CS(CC_ONE) | CS(CC_TWO) | CS(CC_3_4) | CS(CC_FIVE) | CS(CC_6_9))
+#define CS_ALPHA (CS(CC_HEXALPHA) | CS(CC_E) | CS(CC_N) | CS(CC_T) | CS(CC_X) | CS(CC_ALPHA))
+#define CS_HEX (CS_DIGIT | CS(CC_HEXALPHA) | CS(CC_E))
+
+/** Class of every character.
+ */
+static const uint8_t char_class[256] = {
+        ['\n'] = CC_NL, ['\r'] = CC_CR, [' '] = CC_BLANK, ['\t'] = CC_TAB,
+        ['0'] = CC_ZERO, ['1'] = CC_ONE, ['2'] = CC_TWO, ['3'] = CC_3_4, ['4'] = CC_3_4,
+        ['5'] = CC_FIVE, ['6'] = CC_6_9, ['7'] = CC_6_9, ['8'] = CC_6_9, ['9'] = CC_6_9,
+        ['a'] = CC_HEXALPHA, ['b'] = CC_HEXALPHA, ['c'] = CC_HEXALPHA, ['d'] = CC_HEXALPHA,
+        ['f'] = CC_HEXALPHA, ['A'] = CC_HEXALPHA, ['B'] = CC_HEXALPHA, ['C'] = CC_HEXALPHA,
+        ['D'] = CC_HEXALPHA, ['F'] = CC_HEXALPHA, ['e'] = CC_E, ['E'] = CC_E,
+        ['n'] = CC_N, ['t'] = CC_T, ['x'] = CC_X,
+        ['g'] = CC_ALPHA, ['h'] = CC_ALPHA, ['i'] = CC_ALPHA, ['j'] = CC_ALPHA, ['k'] = CC_ALPHA,
+        ['l'] = CC_ALPHA, ['m'] = CC_ALPHA, ['o'] = CC_ALPHA, ['p'] = CC_ALPHA, ['q'] = CC_ALPHA,
+        ['r'] = CC_ALPHA, ['s'] = CC_ALPHA, ['u'] = CC_ALPHA, ['v'] = CC_ALPHA, ['w'] = CC_ALPHA,
+        ['y'] = CC_ALPHA, ['z'] = CC_ALPHA,
+        ['G'] = CC_ALPHA, ['H'] = CC_ALPHA, ['I'] = CC_ALPHA, ['J'] = CC_ALPHA, ['K'] = CC_ALPHA,
+        ['L'] = CC_ALPHA, ['M'] = CC_ALPHA, ['N'] = CC_ALPHA, ['O'] = CC_ALPHA, ['P'] = CC_ALPHA,
+        ['Q'] = CC_ALPHA, ['R'] = CC_ALPHA, ['S'] = CC_ALPHA, ['T'] = CC_ALPHA, ['U'] = CC_ALPHA,
+        ['V'] = CC_ALPHA, ['W'] = CC_ALPHA, ['X'] = CC_ALPHA, ['Y'] = CC_ALPHA, ['Z'] = CC_ALPHA,
+        ['_'] = CC_ALPHA,
+        ['.'] = CC_DOT, ['+'] = CC_PLUS, ['-'] = CC_MINUS, ['"'] = CC_QUOTE, ['\\'] = CC_BSLASH,
+        ['['] = CC_LBRACKET, [']'] = CC_RBRACKET, ['/'] = CC_SLASH,
+        ['>'] = CC_REL, ['<'] = CC_REL, ['='] = CC_REL, ['~'] = CC_REL,
+        ['('] = CC_SINGLE, [')'] = CC_SINGLE, ['*'] = CC_SINGLE, ['#'] = CC_SINGLE,
+        [':'] = CC_SINGLE, [','] = CC_SINGLE, ['%'] = CC_SINGLE, ['^'] = CC_SINGLE,
+        [(unsigned char) EOF] = CC_EOF, // pgetc() cannot distinguish it from the end of file.
+};
+
+/** What to do with a character when a transition is taken.
+ */
+typedef enum transition_action {
+    A_NONE = 0,  // consume
+    A_UNGET,     // leave the character on the tape
+    A_APPEND,    // consume and append to the lexeme
+    A_ESC,       // consume and append a character escaped by '\'
+    A_DEC_100,   // consume, escaped char = digit * 100
+    A_DEC_10,    // consume, escaped char += digit * 10
+    A_DEC_1,     // consume, escaped char += digit, append it
+    A_HEX_HI,    // consume, escaped char = digit << 4
+    A_HEX_LO,    // consume, escaped char |= digit, append it
+    // actions from STATE_INIT, they finish a token or start a lexeme.
+    A_SKIP_NL,
+    A_SKIP_BLANK,
+    A_SKIP_TAB,
+    A_SINGLE,
+    A_MINUS,
+    A_SLASH,
+    A_REL,
+    A_DOT,
+} transition_action_t;
+
+/** Transition. next is T_REJECT, T_ACCEPT or T_STATE + a state.
+ */
+typedef struct transition {
+    uint8_t next;
+    uint8_t action;
+} transition_t;
+
+#define T_REJECT 0
+#define T_ACCEPT 1
+#define T_STATE 2
+#define STATES_COUNT (STATE(NUM_FINAL) + 1)
+
+#define GO(s, act) ((transition_t) {.next = T_STATE + STATE(s), .action = (act)})
+#define ACCEPT(act) ((transition_t) {.next = T_ACCEPT, .action = (act)})
+#define REJECT ((transition_t) {.next = T_REJECT, .action = A_NONE})
+
+/** Transitions indexed by the state and a class of the next character.
+ *  Filled from the rules in init_transitions().
+ */
+static transition_t transitions[STATES_COUNT][CC_COUNT];
+
+/** Set a transition from the state for every class in the set.
+ */
+static void on(states_t s, uint64_t classes, transition_t t) {
+    for (int cc = 0; cc < CC_COUNT; cc++) {
+        if (classes & CS(cc)) {
+            transitions[s][cc] = t;
+        }
+    }
+}
+
+/** Fill the transition table. Rules are the same as in lex_* functions.
+ *  Each state rejects everything what is not mentioned.
+ */
+static void init_transitions() {
+    static bool initialized = false;
+    if (initialized) {
+        return;
     }
 
+    // the first character of a lexeme.
+    on(STATE(INIT), CS_ALL, REJECT);
+    on(STATE(INIT), CS(CC_EOF) | CS(CC_PLUS) | CS(CC_SINGLE), ACCEPT(A_SINGLE));
+    on(STATE(INIT), CS(CC_NL) | CS(CC_CR), ACCEPT(A_SKIP_NL));
+    on(STATE(INIT), CS(CC_BLANK), ACCEPT(A_SKIP_BLANK));
+    on(STATE(INIT), CS(CC_TAB), ACCEPT(A_SKIP_TAB));
+    on(STATE(INIT), CS(CC_MINUS), ACCEPT(A_MINUS));
+    on(STATE(INIT), CS(CC_SLASH), ACCEPT(A_SLASH));
+    on(STATE(INIT), CS(CC_REL), ACCEPT(A_REL));
+    on(STATE(INIT), CS(CC_DOT), ACCEPT(A_DOT));
+    on(STATE(INIT), CS(CC_ZERO), GO(NUM_1, A_APPEND));
+    on(STATE(INIT), CS_DIGIT & ~CS(CC_ZERO), GO(NUM_2, A_APPEND));
+    on(STATE(INIT), CS_ALPHA, GO(ID_FINAL, A_APPEND));
+    on(STATE(INIT), CS(CC_QUOTE), GO(STR_INIT, A_NONE));
+
+    // identifiers.
+    on(STATE(ID_INIT), CS_ALPHA, GO(ID_FINAL, A_APPEND));
+    on(STATE(ID_FINAL), CS_ALL, ACCEPT(A_UNGET));
+    on(STATE(ID_FINAL), CS_ALPHA | CS_DIGIT, GO(ID_FINAL, A_APPEND));
+
+    // numbers. Only NUM_1, NUM_2, NUM_3 (integers) and NUM_8, NUM_9 (floats) accept, never on EOF.
+    on(STATE(NUM_INIT), CS(CC_ZERO), GO(NUM_1, A_APPEND));
+    on(STATE(NUM_INIT), CS_DIGIT & ~CS(CC_ZERO), GO(NUM_2, A_APPEND));
+    on(STATE(NUM_1), CS_ALL & ~CS(CC_EOF), ACCEPT(A_UNGET));
+    on(STATE(NUM_1), CS_DIGIT, GO(NUM_3, A_APPEND));
+    on(STATE(NUM_1), CS(CC_DOT), GO(NUM_7, A_APPEND));
+    on(STATE(NUM_2), CS_ALL & ~CS(CC_EOF), ACCEPT(A_UNGET));
+    on(STATE(NUM_2), CS_DIGIT, GO(NUM_2, A_APPEND));
+    on(STATE(NUM_2), CS(CC_DOT), GO(NUM_7, A_APPEND));
+    on(STATE(NUM_2), CS(CC_E), GO(NUM_5, A_APPEND));
+    on(STATE(NUM_3), CS_ALL & ~CS(CC_EOF), ACCEPT(A_UNGET));
+    on(STATE(NUM_3), CS_DIGIT, GO(NUM_4, A_APPEND));
+    on(STATE(NUM_3), CS(CC_DOT), GO(NUM_7, A_APPEND));
+    on(STATE(NUM_4), CS_DIGIT, GO(NUM_4, A_APPEND));
+    on(STATE(NUM_4), CS(CC_DOT), GO(NUM_7, A_APPEND));
+    on(STATE(NUM_4), CS(CC_E), GO(NUM_5, A_APPEND));
+    on(STATE(NUM_5), CS_DIGIT, GO(NUM_9, A_APPEND));
+    on(STATE(NUM_5), CS(CC_PLUS) | CS(CC_MINUS), GO(NUM_6, A_APPEND));
+    on(STATE(NUM_6), CS_DIGIT, GO(NUM_9, A_APPEND));
+    on(STATE(NUM_7), CS_DIGIT, GO(NUM_8, A_APPEND));
+    on(STATE(NUM_8), CS_ALL & ~CS(CC_EOF), ACCEPT(A_UNGET));
+    on(STATE(NUM_8), CS_DIGIT, GO(NUM_8, A_APPEND));
+    on(STATE(NUM_8), CS(CC_E), GO(NUM_5, A_APPEND));
+    on(STATE(NUM_9), CS_ALL & ~CS(CC_EOF), ACCEPT(A_UNGET));
+    on(STATE(NUM_9), CS_DIGIT, GO(NUM_9, A_APPEND));
+
+    // strings. A string is accepted in STR_INIT.
+    on(STATE(STR_INIT), CS_ALL & ~(CS(CC_EOF) | CS(CC_NL)), GO(STR_INIT, A_APPEND));
+    on(STATE(STR_INIT), CS(CC_BSLASH), GO(STR_ESC, A_NONE));
+    on(STATE(STR_INIT), CS(CC_QUOTE), ACCEPT(A_NONE));
+    on(STATE(STR_ESC), CS(CC_ZERO), GO(STR_DEC_0_0, A_DEC_100));
+    on(STATE(STR_ESC), CS(CC_ONE), GO(STR_DEC_0_1, A_DEC_100));
+    on(STATE(STR_ESC), CS(CC_TWO), GO(STR_DEC_0_2, A_DEC_100));
+    on(STATE(STR_ESC), CS(CC_T) | CS(CC_N) | CS(CC_BSLASH) | CS(CC_QUOTE), GO(STR_INIT, A_ESC));
+    on(STATE(STR_ESC), CS(CC_X), GO(STR_HEX_1, A_NONE));
+    on(STATE(STR_HEX_1), CS_HEX, GO(STR_HEX_2, A_HEX_HI));
+    on(STATE(STR_HEX_1), CS(CC_ZERO), GO(STR_HEX_3, A_HEX_HI));
+    on(STATE(STR_HEX_2), CS_HEX, GO(STR_INIT, A_HEX_LO));
+    on(STATE(STR_HEX_3), CS_HEX & ~CS(CC_ZERO), GO(STR_INIT, A_NONE)); // \x0? is skipped
+    on(STATE(STR_DEC_0_0), CS_DIGIT, GO(STR_DEC_1_1, A_DEC_10));
+    on(STATE(STR_DEC_0_1), CS_DIGIT, GO(STR_DEC_1_1, A_DEC_10));
+    on(STATE(STR_DEC_0_2), CS(CC_ZERO) | CS(CC_ONE) | CS(CC_TWO) | CS(CC_3_4), GO(STR_DEC_1_1, A_DEC_10));
+    on(STATE(STR_DEC_0_2), CS(CC_FIVE), GO(STR_DEC_1_2, A_DEC_10));
+    on(STATE(STR_DEC_1_0), CS_DIGIT & ~CS(CC_ZERO), GO(STR_INIT, A_DEC_1));
+    on(STATE(STR_DEC_1_1), CS_DIGIT, GO(STR_INIT, A_DEC_1));
+    on(STATE(STR_DEC_1_2), CS_DIGIT & ~CS(CC_6_9), GO(STR_INIT, A_DEC_1));
+
+    // comments, after "--".
+    on(STATE(COMMENT_INIT), CS_ALL & ~CS(CC_EOF), GO(COMMENT_SLINE, A_NONE));
+    on(STATE(COMMENT_INIT), CS(CC_LBRACKET), GO(COMMENT_BLOCK_1, A_NONE));
+    on(STATE(COMMENT_INIT), CS(CC_NL), GO(COMMENT_FINAL, A_NONE));
+    on(STATE(COMMENT_SLINE), CS_ALL & ~CS(CC_EOF), GO(COMMENT_SLINE, A_NONE));
+    on(STATE(COMMENT_SLINE), CS(CC_NL), GO(COMMENT_FINAL, A_NONE));
+    on(STATE(COMMENT_BLOCK_1), CS_ALL & ~CS(CC_EOF), GO(COMMENT_SLINE, A_NONE));
+    on(STATE(COMMENT_BLOCK_1), CS(CC_LBRACKET), GO(COMMENT_BLOCK_2, A_NONE));
+    on(STATE(COMMENT_BLOCK_2), CS_ALL & ~CS(CC_EOF), GO(COMMENT_BLOCK_2, A_NONE));
+    on(STATE(COMMENT_BLOCK_2), CS(CC_RBRACKET), GO(COMMENT_BLOCK_END, A_NONE));
+    on(STATE(COMMENT_BLOCK_END), CS_ALL & ~CS(CC_EOF), GO(COMMENT_BLOCK_END, A_NONE));
+    on(STATE(COMMENT_BLOCK_END), CS(CC_RBRACKET), GO(COMMENT_FINAL, A_NONE));
+    on(STATE(COMMENT_FINAL), CS_ALL, ACCEPT(A_UNGET));
+
+    initialized = true;
+}
+
+/** Position on the tape, which is read directly.
+ */
+typedef struct cursor {
+    pfile_t *pfile;
+    const unsigned char *start; // tape at the pfile position
+    const unsigned char *head;
+    const unsigned char *end;
+} cursor_t;
+
+/** Move the pfile head to the cursor and get next characters.
+ *
+ * @return false on end of file.
+ */
+static bool cursor_refill(cursor_t *c) {
+    Pfile.skip(c->pfile, c->head - c->start);
+    size_t avail = Pfile.available(c->pfile);
+    c->start = c->head = (const unsigned char *) Pfile.get_tape_current(c->pfile);
+    c->end = c->head + avail;
+    return avail != 0;
+}
+
+/** Get the character under the head, or EOF.
+ */
+static inline int cursor_peek(cursor_t *c) {
+    if (c->head == c->end && !cursor_refill(c)) {
+        return EOF;
+    }
+    return *c->head;
+}
+
+/** A lexeme of an identifier, a string or a number.
+ */
+static _Thread_local struct {
+    char *str;
+    size_t len;
+    size_t size;
+} lexeme;
+
+static inline void lexeme_append(char ch) {
+    if (lexeme.len + 1 >= lexeme.size) {
+        lexeme.size = lexeme.size ? lexeme.size * 2 : 64;
+        lexeme.str = realloc(lexeme.str, lexeme.size);
+        soft_assert(lexeme.str != NULL, ERROR_INTERNAL);
+    }
+    lexeme.str[lexeme.len++] = ch;
+}
+
+static inline void lexeme_append_n(const unsigned char *s, size_t n) {
+    if (lexeme.len + n >= lexeme.size) {
+        while (lexeme.len + n >= lexeme.size) {
+            lexeme.size = lexeme.size ? lexeme.size * 2 : 64;
+        }
+        lexeme.str = realloc(lexeme.str, lexeme.size);
+        soft_assert(lexeme.str != NULL, ERROR_INTERNAL);
+    }
+    memcpy(lexeme.str + lexeme.len, s, n);
+    lexeme.len += n;
+}
+
+/** Skip characters, which do not change the state, at once.
+ *  Only strings and comments have such long runs.
+ *
+ * @param c cursor
+ */
+static inline void run_bulk(cursor_t *c) {
+    const char *s = (const char *) c->head;
+    size_t n;
+
+    switch (state) {
+        case STATE(STR_INIT):
+            n = Textscan.find_any(s, c->end - c->head, '"', '\\', '\n', (char) EOF);
+            lexeme_append_n(c->head, n);
+            charpos += n;
+            break;
+        case STATE(COMMENT_SLINE):
+            n = Textscan.find_any(s, c->end - c->head, '\n', (char) EOF, '\n', '\n');
+            charpos += n;
+            break;
+        case STATE(COMMENT_BLOCK_2):
+        case STATE(COMMENT_BLOCK_END):
+            n = Textscan.find_any(s, c->end - c->head, ']', (char) EOF, ']', ']');
+            count_comment(s, n);
+            break;
+        default:
+            return;
+    }
+    c->head += n;
+}
+
+/** Run the automaton from the state until it accepts or rejects.
+ *  Lines and character positions are counted like in lex_* functions.
+ *
+ * @param c cursor
+ * @param comment newlines are counted in comments.
+ * @return T_ACCEPT or T_REJECT, the last state is in the global state.
+ */
+static int run_automaton(cursor_t *c, bool comment) {
+    uint8_t escaped_char = 0;
+
+    for (;;) {
+        run_bulk(c);
+        int ch = cursor_peek(c);
+        int cc = (ch == EOF) ? CC_EOF : char_class[ch];
+        transition_t t = transitions[state][cc];
+
+        if (cc == CC_EOF) {
+            c->head += (ch != EOF); // (char) EOF is read as EOF, but it is consumed.
+        } else {
+            charpos++;
+            if (comment && ch == '\n') {
+                lines++;
+                charpos = 0;
+            }
+            if (t.action != A_UNGET) {
+                c->head++;
+            }
+        }
+
+        switch (t.action) {
+            case A_APPEND:
+                lexeme_append((char) ch);
+                break;
+            case A_ESC:
+                lexeme_append((char) ((ch == 't') ? '\t' : (ch == 'n') ? '\n' : ch));
+                break;
+            case A_DEC_100:
+                escaped_char = (ch - '0') * 100;
+                break;
+            case A_DEC_10:
+                escaped_char += (ch - '0') * 10;
+                break;
+            case A_DEC_1:
+                escaped_char += (ch - '0');
+                lexeme_append((char) escaped_char);
+                break;
+            case A_HEX_HI:
+                escaped_char = hex2dec(ch) << 4;
+                break;
+            case A_HEX_LO:
+                escaped_char |= hex2dec(ch);
+                lexeme_append((char) escaped_char);
+                break;
+            default:
+                break;
+        }
+
+        if (t.next < T_STATE) {
+            return t.next;
+        }
+        state = t.next - T_STATE;
+    }
+}
+
+/** Make a token from the lexeme accepted in the state.
+ *
+ * @param s the last state of the automaton.
+ * @param start position of the lexeme in the file, without the opening quote of a string.
+ * @param end position after the lexeme.
+ * @return token.
+ */
+static token_t lexeme_to_token(int s, size_t start, size_t end) {
+    token_t token = {0,};
+    lexeme_append('\0');
+    lexeme.len--;
+
+    switch (s) {
+        case STATE(ID_FINAL):
+            token.type = to_keyword(lexeme.str, lexeme.len);
+            token.attribute.span = (span_t) {.offset = start, .len = lexeme.len};
+            break;
+        case STATE(STR_INIT):
+            token.type = TOKEN_STR;
+            token.attribute.span = (span_t) {.offset = start, .len = end - 1 - start};
+            // every escape sequence is shorter than its source.
+            if (lexeme.len != token.attribute.span.len) {
+                token.attribute.span.str = str_from(lexeme.str, lexeme.len);
+            }
+            break;
+        case STATE(NUM_8):
+        case STATE(NUM_9):
+            token.type = TOKEN_NUM_F;
+            token.attribute.num_f = Numconv.parse_double(lexeme.str);
+            break;
+        default:
+            token.type = TOKEN_NUM_I;
+            token.attribute.num_i = Numconv.parse_uint(lexeme.str);
+            break;
+    }
+    return token;
+}
+
+/** Returns one token, in case of a lexical error_interface returned token is TOKEN_DEAD.
+ *  The table-driven version of scanner().
+ *
+ * @param pfile program file.
+ * @return token token of the program.
+ */
+static token_t scanner_table(pfile_t *pfile) {
+    cursor_t c = {.pfile = pfile};
+    token_t token = {0,};
+    int ch, cc;
+    size_t n, start;
+    transition_t t;
+
+    c.start = c.head = c.end = (const unsigned char *) Pfile.get_tape_current(pfile);
+
+    next_lexeme:
+    charpos++;
+    state = STATE_INIT;
+    ch = cursor_peek(&c);
+    cc = (ch == EOF) ? CC_EOF : char_class[ch];
+    t = transitions[STATE_INIT][cc];
+    if (ch != EOF) {
+        c.head++;
+    }
+
+    if (t.next >= T_STATE) {
+        state = t.next - T_STATE;
+        lexeme.len = 0;
+        start = Pfile.tell(pfile) + (c.head - c.start) - 1;
+        if (t.action == A_APPEND) {
+            lexeme_append((char) ch);
+        } else {
+            start++; // the opening quote
+        }
+        pin_lexeme(pfile, start);
+        if (run_automaton(&c, false) == T_ACCEPT) {
+            token = lexeme_to_token(state, start, Pfile.tell(pfile) + (c.head - c.start));
+        }
+        goto ret;
+    }
+
+    switch (t.action) {
+        case A_SKIP_NL:
+        case A_SKIP_TAB:
+        case A_SKIP_BLANK:
+            if (t.action == A_SKIP_NL) {
+                lines++;
+                charpos = 0;
+            } else {
+                charpos += (t.action == A_SKIP_TAB) ? 3 : 0;
+            }
+            n = Textscan.span_whitespace((const char *) c.head, c.end - c.head);
+            count_whitespace((const char *) c.head, n);
+            c.head += n;
+            goto next_lexeme;
+
+        case A_SINGLE:
+            token.type = (cc == CC_EOF) ? TOKEN_EOFILE : ch;
+            break;
+
+        case A_MINUS:
+            if (cursor_peek(&c) == '-') {
+                c.head++;
+                charpos--;
+                state = STATE(COMMENT_INIT);
+                if (run_automaton(&c, true) == T_REJECT) {
+                    token.type = TOKEN_DEAD;
+                    break;
+                }
+                goto next_lexeme;
+            }
+            token.type = TOKEN_SUB;
+            break;
+
+        case A_SLASH:
+            token.type = TOKEN_DIV_F;
+            if (cursor_peek(&c) == '/') {
+                c.head++;
+                charpos++;
+                token.type = TOKEN_DIV_I;
+            }
+            break;
+
+        case A_REL:
+            charpos += 2;
+            if (cursor_peek(&c) == '=') {
+                c.head++;
+                token.type = (ch == '>') ? TOKEN_GE : (ch == '<') ? TOKEN_LE : (ch == '=') ? TOKEN_EQ : TOKEN_NE;
+            } else {
+                token.type = (ch == '>') ? TOKEN_GT : (ch == '<') ? TOKEN_LT : (ch == '=') ? TOKEN_ASSIGN : TOKEN_DEAD;
+            }
+            break;
+
+        case A_DOT:
+            token.type = TOKEN_DEAD;
+            if ((ch = cursor_peek(&c)) != EOF) {
+                c.head++;
+                if (ch == '.') {
+                    charpos++;
+                    token.type = TOKEN_STRCAT;
+                }
+            }
+            break;
+
+        default:
+            token.type = TOKEN_DEAD;
+            debug_msg("unrecognized ch with ascii '%d'\n", ch);
+            break;
+    }
+
+    ret:
+    Pfile.skip(pfile, c.head - c.start);
     return token;
 }
 
@@ -749,9 +1433,66 @@ static token_t scanner(pfile_t *pfile) {
  * @return void
  */
 static void Free_token(token_t *token) {
-    if (token->type == TOKEN_ID || token->type == TOKEN_STR) {
-        Dynstring.dtor(token->attribute.id);
+    if (token->type == TOKEN_STR) {
+        Dynstring.dtor(token->attribute.span.str);
+    }
+}
+
+/** Lex one token with the engine chosen at build time.
+ *  Engines touch only the state of their thread, identifiers are left as spans.
+ *
+ * @param pfile
+ * @return token
+ */
+static token_t lex_raw(pfile_t *pfile) {
+#ifdef SCANNER_TABLE_DRIVEN
+    return scanner_table(pfile);
+#else
+    return scanner(pfile);
+#endif
+}
+
+/** Intern an identifier lexed by an engine, or report a lexical error.
+ *
+ * @param pfile file the token is lexed from.
+ * @param token token from an engine.
+ * @return token
+ */
+static token_t finish_token(pfile_t *pfile, token_t token) {
+    if (token.type == TOKEN_ID) {
+        token.attribute.atom = Intern.get(Pfile.get_at(pfile, token.attribute.span.offset),
+                                          token.attribute.span.len);
+    } else if (token.type == TOKEN_DEAD) {
+        Errors.set_error(ERROR_LEXICAL);
+    }
+    return token;
+}
+
+/** Lex one token.
+ *
+ * @param pfile
+ * @return token
+ */
+static token_t lex_token(pfile_t *pfile) {
+    return finish_token(pfile, lex_raw(pfile));
+}
+
+/** Move to the next prelexed token.
+ *  The last token, EOF or a dead one, is returned again and again as the scanner does it.
+ *
+ * @return token
+ */
+static token_t next_prelexed() {
+    if (context->prelexed_next < context->prelexed->len) {
+        context->prelexed_next++;
+    }
+    context->prev = context->curr;
+    context->curr = Tokbuf.get(context->prelexed, context->prelexed_next - 1);
+    // the error is reported when the parser gets to the token, not when it is lexed.
+    if (context->curr.type == TOKEN_DEAD) {
+        Errors.set_error(ERROR_LEXICAL);
     }
+    return context->curr;
 }
 
 /** Gets next token. and move to next one.
@@ -760,10 +1501,15 @@ static void Free_token(token_t *token) {
  * @return token
  */
 static token_t Get_next_token(pfile_t *pfile) {
-    Free_token(&prev); // need to dtor string
-    prev = curr;
-    curr = scanner(pfile);
-    return curr;
+    if (context->prelexed != NULL) {
+        return next_prelexed();
+    }
+    Free_token(&context->prev); // need to dtor string
+    context->prev = context->curr;
+    context->source = pfile;
+    Pfile.pin(pfile, SIZE_MAX); // the span of the previous token is not needed anymore
+    context->curr = lex_token(pfile);
+    return context->curr;
 }
 
 /** Get current token.
@@ -771,7 +1517,7 @@ static token_t Get_next_token(pfile_t *pfile) {
  * @return current token.
  */
 static token_t Get_curr_token() {
-    return curr;
+    return context->curr;
 }
 
 /** Get current line of the file.
@@ -779,6 +1525,9 @@ static token_t Get_curr_token() {
  * @return current line
  */
 static size_t Get_line() {
+    if (context->prelexed != NULL) {
+        return context->prelexed_next ? context->prelexed->lines[context->prelexed_next - 1] : 1;
+    }
     return lines;
 }
 
@@ -787,6 +1536,9 @@ static size_t Get_line() {
  * @return current line
  */
 static size_t Get_charpos() {
+    if (context->prelexed != NULL) {
+        return context->prelexed_next ? context->prelexed->charpos[context->prelexed_next - 1] : 0;
+    }
     return charpos;
 }
 
@@ -796,19 +1548,287 @@ static size_t Get_charpos() {
  * @return void
  */
 static void Free_scanner() {
-    if (prev.type == TOKEN_ID || prev.type == TOKEN_STR) {
-        Dynstring.dtor(prev.attribute.id);
+    free(lexeme.str);
+    memset(&lexeme, 0x0, sizeof(lexeme));
+    if (context->prelexed != NULL) {
+        // strings of prev and curr belong to the buffer.
+        Tokbuf.dtor(context->prelexed);
+        context->prelexed = NULL;
+    } else {
+        Free_token(&context->prev);
+        Free_token(&context->curr);
     }
-    if (curr.type == TOKEN_ID || curr.type == TOKEN_STR) {
-        Dynstring.dtor(curr.attribute.id);
+    memset(&context->prev, 0x0, sizeof(context->prev));
+    memset(&context->curr, 0x0, sizeof(context->curr));
+}
+
+/** A token lexed by a thread, with the line counted from the start of its part.
+ */
+typedef struct lexed {
+    token_t token;
+    size_t line;
+    size_t charpos;
+} lexed_t;
+
+/** A part of the file lexed by a thread.
+ */
+typedef struct lex_part {
+    pfile_t *pfile; ///< view of the part.
+    lexed_t *tokens; ///< tokens of the part, identifiers are spans.
+    size_t len; ///< number of tokens.
+    size_t cap; ///< capacity of tokens.
+    size_t lines; ///< number of lines counted in the part.
+} lex_part_t;
+
+/** Lex tokens from the file until its end, or until a lexical error.
+ *  A character 0xff is read as the end of file, but the scanner goes on after it.
+ *
+ * @param token last token.
+ * @param pfile
+ * @return true if there are more tokens.
+ */
+static inline bool more_tokens(token_t token, pfile_t *pfile) {
+    return token.type != TOKEN_DEAD && (token.type != TOKEN_EOFILE || Pfile.available(pfile) != 0);
+}
+
+/** Lex a part of the file on a thread.
+ *
+ * @param arg lex_part_t.
+ * @return NULL.
+ */
+static void *lex_part(void *arg) {
+    lex_part_t *part = arg;
+    token_t token;
+
+    lines = 0;
+    charpos = 0;
+    do {
+        if (part->len == part->cap) {
+            part->cap = part->cap ? part->cap * 2 : 1024;
+            part->tokens = realloc(part->tokens, part->cap * sizeof(lexed_t));
+            soft_assert(part->tokens != NULL, ERROR_INTERNAL);
+        }
+        Pfile.pin(part->pfile, SIZE_MAX);
+        token = lex_raw(part->pfile);
+        part->tokens[part->len++] = (lexed_t) {.token = token, .line = lines, .charpos = charpos};
+    } while (more_tokens(token, part->pfile));
+
+    part->lines = lines;
+    free(lexeme.str);
+    memset(&lexeme, 0x0, sizeof(lexeme));
+    return NULL;
+}
+
+/** Find where the tape can be split for parallel lexing.
+ *  A part starts after a newline, which the scanner reads as whitespace, not in a string or a comment.
+ *  So the part is lexed from a fresh state the same way as the whole file is.
+ *  Strings and comments are followed the way the scanner does, as long as it does not fail;
+ *  tokens after a lexical error are not used.
+ *
+ * @param s tape.
+ * @param n length of the tape.
+ * @param bounds returns starts of parts, bounds[0] = 0 and bounds[parts] = n.
+ * @param parts wanted number of parts.
+ * @return number of parts found, at most parts.
+ */
+static size_t split_tape(const char *s, size_t n, size_t *bounds, size_t parts) {
+    const char eof = (char) EOF;
+    size_t found = 1;
+    size_t i = 0;
+    size_t target = n / parts;
+
+    bounds[0] = 0;
+    while (i < n && found < parts) {
+        // code, a newline is looked for only after the target.
+        if (i < target) {
+            i += Textscan.find_any(s + i, target - i, '"', '-', '"', '"');
+            if (i == target) {
+                continue;
+            }
+        } else {
+            i += Textscan.find_any(s + i, n - i, '"', '-', '\n', '\n');
+            if (i == n) {
+                break;
+            }
+        }
+
+        if (s[i] == '\n') {
+            bounds[found++] = ++i;
+            target = (i > found * n / parts) ? i : found * n / parts;
+        } else if (s[i] == '"') {
+            // string, which ends before a newline.
+            for (i++; i < n; i++) {
+                i += Textscan.find_any(s + i, n - i, '"', '\\', '\n', eof);
+                if (i == n || s[i] != '\\') {
+                    break;
+                }
+                i++; // escaped character
+            }
+            i++;
+        } else if (i + 1 < n && s[i + 1] == '-') {
+            // comment, see process_comment()
+            i += 2;
+            if (i + 1 < n && s[i] == '[' && s[i + 1] == '[') {
+                i += 2;
+                i += Textscan.find_any(s + i, n - i, ']', eof, ']', ']');
+                i += (i < n && s[i] == ']');
+                i += Textscan.find_any(s + i, n - i, ']', eof, ']', ']');
+                i++;
+            } else if (i < n && s[i] == '\n') {
+                i++;
+            } else {
+                i += (i < n && s[i] != eof) + (i < n && s[i] == '['); // "--[x" is a line comment, even if x is '\n'
+                i += Textscan.find_any(s + i, n - i, '\n', eof, '\n', '\n');
+                i++;
+            }
+        } else {
+            i++;
+        }
+    }
+
+    bounds[found] = n;
+    return found;
+}
+
+/** Lex the file on threads, part by part, and put tokens of the parts together.
+ *
+ * @param pfile program file.
+ * @param parts number of threads.
+ */
+static void prelex_parts(pfile_t *pfile, size_t parts) {
+    size_t from = Pfile.tell(pfile);
+    size_t n = Pfile.available(pfile);
+    size_t *bounds = calloc(parts + 1, sizeof(size_t));
+    lex_part_t *part = calloc(parts, sizeof(lex_part_t));
+    pthread_t *threads = calloc(parts, sizeof(pthread_t));
+    bool *started = calloc(parts, sizeof(bool));
+    soft_assert(bounds && part && threads && started, ERROR_INTERNAL);
+
+    parts = split_tape(Pfile.get_tape_current(pfile), n, bounds, parts);
+    for (size_t k = 0; k < parts; k++) {
+        part[k].pfile = Pfile.view(pfile, from + bounds[k], from + bounds[k + 1]);
+        started[k] = pthread_create(&threads[k], NULL, lex_part, &part[k]) == 0;
+    }
+    for (size_t k = 0; k < parts; k++) {
+        if (started[k]) {
+            pthread_join(threads[k], NULL);
+        } else {
+            lex_part(&part[k]);
+        }
+    }
+
+    size_t base = lines;
+    bool dead = false;
+    for (size_t k = 0; k < parts; k++) {
+        for (size_t j = 0; j < part[k].len; j++) {
+            lexed_t *t = &part[k].tokens[j];
+            // the end of a part is not the end of the file.
+            bool part_end = k + 1 < parts && j + 1 == part[k].len && t->token.type == TOKEN_EOFILE;
+            if (dead || part_end) {
+                if (t->token.type == TOKEN_STR) {
+                    Dynstring.dtor(t->token.attribute.span.str);
+                }
+                continue;
+            }
+            lines = base + t->line;
+            charpos = t->charpos;
+            Tokbuf.push(context->prelexed, finish_token(pfile, t->token), lines, charpos);
+            dead = t->token.type == TOKEN_DEAD;
+        }
+        base += part[k].lines;
+        Pfile.dtor(part[k].pfile);
+        free(part[k].tokens);
     }
+    Pfile.skip(pfile, n);
+
+    free(bounds);
+    free(part);
+    free(threads);
+    free(started);
+}
+
+/** Lex the whole program in advance, Scanner.get_next_token() then returns the buffered tokens.
+ *  Lexing stops at the end of the file or at the first lexical error.
+ *  Files bigger than lex_part_min are lexed by parts on threads, the tokens are the same.
+ *  The file must hold the whole tape, it cannot be a stream.
+ *
+ * @param pfile program file.
+ * @param threads maximal number of threads.
+ */
+static void Prelex(pfile_t *pfile, size_t threads) {
+    int error = Errors.get_error();
+    size_t parts = Pfile.available(pfile) / lex_part_min;
+    token_t token;
+
+    Tokbuf.dtor(context->prelexed);
+    context->prelexed = Tokbuf.ctor();
+    context->prelexed_next = 0;
+    context->source = pfile;
+
+    if (threads > 1 && parts > 1) {
+        prelex_parts(pfile, (parts < threads) ? parts : threads);
+    } else {
+        do {
+            Pfile.pin(pfile, SIZE_MAX);
+            token = lex_token(pfile);
+            Tokbuf.push(context->prelexed, token, lines, charpos);
+        } while (more_tokens(token, pfile));
+    }
+    Errors.set_error(error);
+
+    debug_msg("[prelex] %zu tokens, %zu bytes allocated, %.2f bytes/token\n", context->prelexed->len,
+              Tokbuf.bytes(context->prelexed),
+              (double) Tokbuf.used_bytes(context->prelexed) / (double) context->prelexed->len);
+}
+
+/** Make a new string from the atom of an identifier or the span of a string.
+ *
+ * @param token the current token.
+ * @return new dynstring with decoded escape sequences.
+ */
+static dynstring_t *Materialize(token_t *token) {
+    soft_assert(token->type == TOKEN_ID || token->type == TOKEN_STR, ERROR_INTERNAL);
+    if (token->type == TOKEN_ID) {
+        return Dynstring.dup(token->attribute.atom->name);
+    }
+    span_t *span = &token->attribute.span;
+
+    if (span->str != NULL) {
+        return str_from(Dynstring.c_str(span->str), Dynstring.len(span->str));
+    }
+    return str_from(Pfile.get_at(context->source, span->offset), span->len);
+}
+
+/** Get characters of the span of a string on the tape.
+ *
+ * @param token the current token.
+ * @return span.len characters of the source.
+ */
+static const char *Lexeme(token_t *token) {
+    return Pfile.get_at(context->source, token->attribute.span.offset);
+}
+
+/** Build read-only tables of the scanner.
+ */
+static void init_tables() {
+    Textscan.init(false);
+    init_keywords();
+    init_transitions();
 }
 
 /** Scanner initialization.
  */
 static void Init_scanner() {
-    memset(&prev, 0x0, sizeof(prev));
-    memset(&curr, 0x0, sizeof(prev));
+    static pthread_once_t tables = PTHREAD_ONCE_INIT;
+    // tables are shared by all compilations.
+    pthread_once(&tables, init_tables);
+
+    lines = 1;
+    charpos = 0;
+    state = STATE_INIT;
+    lexeme.len = 0;
+    memset(&context->prev, 0x0, sizeof(context->prev));
+    memset(&context->curr, 0x0, sizeof(context->curr));
 }
 
 
@@ -819,6 +1839,378 @@ const struct scanner_interface Scanner = {
         .to_string = To_string,
         .get_line = Get_line,
         .get_charpos = Get_charpos,
+        .materialize = Materialize,
+        .lexeme = Lexeme,
+        .prelex = Prelex,
         .init = Init_scanner,
 };
 
+
+#ifdef SELFTEST_scanner
+#include <time.h>
+
+/** Keyword lookup as it was before the perfect hash, a linear search.
+ */
+static int to_keyword_linear(const char *identif) {
+    for (int i = 0; keywords[i].nam != NULL; i++)
+        if (strcmp(keywords[i].nam, identif) == 0) {
+            return keywords[i].kwd;
+        }
+
+    return TOKEN_ID;
+}
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/** Check keyword classification and compare the perfect hash with the linear table.
+ */
+static int test_keywords() {
+    // keywords and identifiers typical for the test programs, some collide with keywords by the hash.
+    static const char *identifiers[] = {
+            #define X(n) #n,
+            KEYWORDS(X)
+            #undef X
+            "main", "i", "a", "b", "str", "res", "counter", "factorial", "n", "result", "x", "substr",
+            "write", "reads", "readi", "tointeger", "value", "_", "do_", "en", "ende", "Function", "x1",
+            "iff", "nill", "UNDEFINED", "local_var", "then2", "or_", "nott",
+    };
+    const size_t count = sizeof(identifiers) / sizeof(*identifiers);
+    size_t lens[sizeof(identifiers) / sizeof(*identifiers)];
+    const size_t rounds = 2000000;
+    volatile size_t sink = 0;
+    int failed = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        lens[i] = strlen(identifiers[i]);
+        if (to_keyword(identifiers[i], lens[i]) != to_keyword_linear(identifiers[i])) {
+            fprintf(stderr, "FAILED: '%s' is classified differently\n", identifiers[i]);
+            failed = 1;
+        }
+    }
+
+    double start = now();
+    for (size_t r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < count; i++) {
+            sink += to_keyword_linear(identifiers[i]);
+        }
+    }
+    double linear = now() - start;
+
+    start = now();
+    for (size_t r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < count; i++) {
+            sink += to_keyword(identifiers[i], lens[i]);
+        }
+    }
+    double hashed = now() - start;
+
+    printf("keyword lookup, %zu identifiers:\n", rounds * count);
+    printf("    linear table: %6.2f ns/lookup\n", linear * 1e9 / (double) (rounds * count));
+    printf("    perfect hash: %6.2f ns/lookup\n", hashed * 1e9 / (double) (rounds * count));
+    return failed;
+}
+
+/** Lex a whole file with an engine.
+ *
+ * @param filename
+ * @param engine scanner or scanner_table.
+ * @param n returns number of tokens.
+ * @return array of tokens, each followed by lines and charpos after it.
+ */
+static token_t *lex_file(const char *filename, token_t (*engine)(pfile_t *), size_t *n) {
+    size_t size = 1024;
+    token_t *tokens = malloc(size * sizeof(token_t));
+    pfile_t *pfile = Pfile.getfile(filename);
+    soft_assert(pfile && tokens, ERROR_INTERNAL);
+
+    lines = 1;
+    charpos = 0;
+    *n = 0;
+    do {
+        if (*n + 3 >= size) {
+            tokens = realloc(tokens, (size *= 2) * sizeof(token_t));
+            soft_assert(tokens, ERROR_INTERNAL);
+        }
+        tokens[*n] = finish_token(pfile, engine(pfile));
+        if (tokens[*n].type == TOKEN_ID || tokens[*n].type == TOKEN_STR) {
+            context->source = pfile;
+            dynstring_t *str = Materialize(&tokens[*n]);
+            Free_token(&tokens[*n]);
+            tokens[*n].attribute.id = str;
+        }
+        tokens[*n + 1] = (token_t) {.type = TOKEN_NUM_I, .attribute.num_i = lines};
+        tokens[*n + 2] = (token_t) {.type = TOKEN_NUM_I, .attribute.num_i = charpos};
+        *n += 3;
+    } while (tokens[*n - 3].type != TOKEN_EOFILE);
+
+    Pfile.dtor(pfile);
+    return tokens;
+}
+
+static bool token_eq(token_t *a, token_t *b) {
+    if (a->type != b->type) {
+        return false;
+    }
+    switch (a->type) {
+        case TOKEN_ID:
+        case TOKEN_STR:
+            return Dynstring.len(a->attribute.id) == Dynstring.len(b->attribute.id)
+                   && memcmp(Dynstring.c_str(a->attribute.id), Dynstring.c_str(b->attribute.id),
+                             Dynstring.len(a->attribute.id)) == 0;
+        case TOKEN_NUM_I:
+            return a->attribute.num_i == b->attribute.num_i;
+        case TOKEN_NUM_F:
+            return memcmp(&a->attribute.num_f, &b->attribute.num_f, sizeof(double)) == 0;
+        default:
+            return true;
+    }
+}
+
+static void free_tokens(token_t *tokens, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (tokens[i].type == TOKEN_ID || tokens[i].type == TOKEN_STR) {
+            Dynstring.dtor(tokens[i].attribute.id);
+        }
+    }
+    free(tokens);
+}
+
+/** Both engines must produce the same tokens, lines and positions for every file.
+ */
+static int test_engines(int argc, char **argv) {
+    int failed = 0;
+    size_t all_tokens = 0;
+    double time_switch = 0, time_table = 0;
+
+    for (int i = 1; i < argc; i++) {
+        size_t n1, n2;
+        double start = now();
+        token_t *t1 = lex_file(argv[i], scanner, &n1);
+        time_switch += now() - start;
+        start = now();
+        token_t *t2 = lex_file(argv[i], scanner_table, &n2);
+        time_table += now() - start;
+
+        for (size_t k = 0; k < n1 && k < n2; k++) {
+            if (!token_eq(&t1[k], &t2[k])) {
+                fprintf(stderr, "FAILED: %s, token %zu: %s differs from %s\n",
+                        argv[i], k / 3, To_string(t1[k - k % 3].type), To_string(t2[k - k % 3].type));
+                failed = 1;
+                break;
+            }
+        }
+        if (n1 != n2) {
+            fprintf(stderr, "FAILED: %s, %zu tokens instead of %zu\n", argv[i], n2 / 3, n1 / 3);
+            failed = 1;
+        }
+        all_tokens += n1 / 3;
+        free_tokens(t1, n1);
+        free_tokens(t2, n2);
+    }
+
+    if (argc > 1) {
+        printf("%d files, %zu tokens: %s\n", argc - 1, all_tokens, failed ? "engines DIFFER" : "engines are identical");
+        printf("    switch scanner: %6.2f ns/token\n", time_switch * 1e9 / (double) all_tokens);
+        printf("    table scanner:  %6.2f ns/token\n", time_table * 1e9 / (double) all_tokens);
+    }
+    return failed;
+}
+
+/** Lex a generated number-heavy program with both engines, they must agree.
+ */
+static int bench_numbers() {
+    const size_t count = 500000;
+    size_t size = count * 48;
+    char *program = malloc(size);
+    soft_assert(program, ERROR_INTERNAL);
+
+    srand(10);
+    size_t len = 0;
+    for (size_t i = 0; i < count; i++) {
+        switch (i % 4) {
+            case 0:
+                len += sprintf(program + len, "local n%zu : integer = %d\n", i, rand());
+                break;
+            case 1:
+                len += sprintf(program + len, "x = %d.%d + %u\n", rand() % 1000, rand(), (unsigned) rand());
+                break;
+            case 2:
+                len += sprintf(program + len, "y = %.17g * %de%d\n", (double) rand() / RAND_MAX, rand() % 100,
+                               rand() % 40 - 20);
+                break;
+            default:
+                len += sprintf(program + len, "z = %u%u%u.5E-%d\n", (unsigned) rand(), (unsigned) rand(),
+                               (unsigned) rand(), rand() % 300);
+                break;
+        }
+    }
+
+    int failed = 0;
+    double elapsed[2] = {0,};
+    size_t tokens = 0;
+    token_t (*engines[2])(pfile_t *) = {scanner, scanner_table};
+    double *values[2];
+    for (int e = 0; e < 2; e++) {
+        pfile_t *pfile = Pfile.ctor(program);
+        soft_assert(pfile, ERROR_INTERNAL);
+        values[e] = malloc(count * 3 * sizeof(double));
+        soft_assert(values[e], ERROR_INTERNAL);
+
+        lines = 1;
+        charpos = 0;
+        tokens = 0;
+        size_t n = 0;
+        token_t token;
+        double start = now();
+        do {
+            token = engines[e](pfile);
+            if (token.type == TOKEN_NUM_F) {
+                values[e][n++] = token.attribute.num_f;
+            } else if (token.type == TOKEN_NUM_I) {
+                values[e][n++] = (double) token.attribute.num_i;
+            }
+            tokens++;
+        } while (token.type != TOKEN_EOFILE && token.type != TOKEN_DEAD);
+        elapsed[e] = now() - start;
+
+        if (token.type == TOKEN_DEAD || (e == 1 && memcmp(values[0], values[1], n * sizeof(double)) != 0)) {
+            fprintf(stderr, "FAILED: numbers are lexed differently\n");
+            failed = 1;
+        }
+        Pfile.dtor(pfile);
+    }
+
+    printf("number-heavy program, %zu bytes, %zu tokens:\n", len, tokens);
+    printf("    switch scanner: %6.2f ns/token\n", elapsed[0] * 1e9 / (double) tokens);
+    printf("    table scanner:  %6.2f ns/token\n", elapsed[1] * 1e9 / (double) tokens);
+
+    free(values[0]);
+    free(values[1]);
+    free(program);
+    return failed;
+}
+
+/** Prelex a file from its beginning.
+ *
+ * @param filename
+ * @param threads
+ * @return the file, tokens are in prelexed.
+ */
+static pfile_t *prelex_file(const char *filename, size_t threads) {
+    pfile_t *pfile = Pfile.getfile(filename);
+    soft_assert(pfile, ERROR_INTERNAL);
+
+    lines = 1;
+    charpos = 0;
+    memset(&context->prev, 0x0, sizeof(context->prev));
+    memset(&context->curr, 0x0, sizeof(context->curr));
+    Prelex(pfile, threads);
+    return pfile;
+}
+
+/** Prelexed tokens must be the same as tokens lexed on demand, up to the first lexical error.
+ *  Files are split into tiny parts, so even small ones are lexed on threads.
+ */
+static int test_prelex(int argc, char **argv) {
+    const size_t threads[] = {1, 2, 3, 4, 8};
+    int failed = 0;
+    size_t all_tokens = 0, all_bytes = 0, allocated_bytes = 0;
+
+    lex_part_min = 16;
+    for (int i = 1; i < argc; i++) {
+        size_t n;
+        token_t *expected = lex_file(argv[i], lex_raw, &n);
+
+        for (size_t t = 0; t < sizeof(threads) / sizeof(*threads); t++) {
+            pfile_t *pfile = prelex_file(argv[i], threads[t]);
+            for (size_t k = 0; k < n; k += 3) {
+                token_t got = next_prelexed();
+                if (got.type == TOKEN_ID || got.type == TOKEN_STR) {
+                    got.attribute.id = Materialize(&got);
+                }
+                token_t got_line = {.type = TOKEN_NUM_I, .attribute.num_i = Get_line()};
+                token_t got_charpos = {.type = TOKEN_NUM_I, .attribute.num_i = Get_charpos()};
+                bool eq = token_eq(&expected[k], &got) && token_eq(&expected[k + 1], &got_line)
+                          && token_eq(&expected[k + 2], &got_charpos);
+                if (got.type == TOKEN_ID || got.type == TOKEN_STR) {
+                    Dynstring.dtor(got.attribute.id);
+                }
+                if (!eq) {
+                    fprintf(stderr, "FAILED: %s, %zu threads, prelexed token %zu differs\n",
+                            argv[i], threads[t], k / 3);
+                    failed = 1;
+                    break;
+                }
+                if (got.type == TOKEN_DEAD) {
+                    break;
+                }
+            }
+            if (t == 0) {
+                all_tokens += context->prelexed->len;
+                all_bytes += Tokbuf.used_bytes(context->prelexed);
+                allocated_bytes += Tokbuf.bytes(context->prelexed);
+            }
+
+            Tokbuf.dtor(context->prelexed);
+            context->prelexed = NULL;
+            Pfile.dtor(pfile);
+        }
+        free_tokens(expected, n);
+    }
+    lex_part_min = 256 * 1024;
+
+    if (argc > 1) {
+        printf("%zu prelexed tokens: %s\n", all_tokens, failed ? "DIFFER" : "identical on 1, 2, 3, 4 and 8 threads");
+        printf("    token buffer: %6.2f bytes/token, token_t is %zu bytes, %zu bytes allocated for all files\n",
+               (double) all_bytes / (double) all_tokens, sizeof(token_t), allocated_bytes);
+    }
+    return failed;
+}
+
+/** Throughput of prelexing on threads.
+ */
+static void bench_prelex(int argc, char **argv) {
+    const size_t threads[] = {1, 2, 4, 8};
+
+    for (size_t t = 0; argc > 1 && t < sizeof(threads) / sizeof(*threads); t++) {
+        size_t bytes = 0;
+        double elapsed = 0;
+        for (int i = 1; i < argc; i++) {
+            double start = now();
+            pfile_t *pfile = prelex_file(argv[i], threads[t]);
+            elapsed += now() - start;
+            bytes += Pfile.tell(pfile);
+
+            Tokbuf.dtor(context->prelexed);
+            context->prelexed = NULL;
+            Pfile.dtor(pfile);
+            Intern.free();
+        }
+        printf("    prelex on %zu threads: %8.2f MB/s\n", threads[t], (double) bytes / elapsed / 1e6);
+    }
+}
+
+/** Usage: scanner_selftest [files...]
+ *  Files are lexed by both scanner engines, which are compared, and prelexed.
+ */
+int main(int argc, char **argv) {
+    fprintf(stderr, "Selftests: %s\n", __FILE__);
+    int failed = 0;
+
+    Context.enter(Context.ctor(NULL));
+    Scanner.init();
+    failed |= test_keywords();
+    failed |= test_engines(argc, argv);
+    failed |= test_prelex(argc, argv);
+    failed |= bench_numbers();
+    bench_prelex(argc, argv);
+    Scanner.free();
+    Context.dtor(context);
+    return failed;
+}
+
+#endif
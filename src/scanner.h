@@ -18,11 +18,23 @@
 #include "progfile.h"
 #include "macros.h"
 #include "dynstring.h"
+#include "textscan.h"
+#include "intern.h"
 #include "debug.h"
 
 
+/** Characters of a string on the tape of the program.
+ */
+typedef struct token_span {
+    size_t offset; ///< position of the first character in the file.
+    size_t len; ///< number of characters.
+    dynstring_t *str; ///< decoded string if the string has escape sequences, NULL otherwise.
+} span_t;
+
 typedef union token_attribute {
-    dynstring_t *id; ///< for storing string or identifier
+    dynstring_t *id; ///< for storing string or identifier, see Scanner.materialize()
+    const atom_t *atom; ///< interned identifier from the scanner
+    span_t span; ///< string from the scanner
     uint64_t num_i; ///< integer number representation.
     double num_f; ///< fp number representation
 } attribute_t;
@@ -186,6 +198,22 @@ struct scanner_interface {
 
     size_t (*get_charpos)(void);
 
+    /** Make a new string from the atom of an identifier or the span of a string. Escape sequences are decoded.
+     *  Only the current token can be materialized, a streamed tape does not hold older ones.
+     *  The caller frees the string.
+     */
+    dynstring_t *(*materialize)(token_t *);
+
+    /** Characters of the span of a string on the tape, span.len of them, escape sequences are not decoded.
+     */
+    const char *(*lexeme)(token_t *);
+
+    /** Lex the whole program into a token buffer in advance, get_next_token() then iterates the buffer.
+     *  Big files are lexed by parts on up to the given number of threads.
+     *  The file must not be a stream.
+     */
+    void (*prelex)(pfile_t *, size_t);
+
     void (*init)();
 };
 
@@ -11,17 +11,18 @@
 #include "dynstring.h"
 #include "expressions.h"
 #include "parser.h"
+#include "context.h"
 
 /** Function checks if return values and parameters
- *  of the function are equal.
+ *  of the function are equal. Signatures are interned, so they are compared by pointers.
  *
  * @param func function definition or declaration semantics.
  * @return bool.
  */
 static bool Check_signatures(func_semantics_t *func) {
     bool res;
-    res = Dynstring.cmp(func->declaration.params, func->definition.params) == 0;
-    res &= (Dynstring.cmp(func->declaration.returns, func->definition.returns) == 0);
+    res = func->declaration.params == func->definition.params;
+    res &= func->declaration.returns == func->definition.returns;
 
     debug_msg("\n\t[semantics] function signatures are %s\n", res ? "same" : "different");
     return res;
@@ -54,6 +55,15 @@ static bool Is_builtin(func_semantics_t *self) {
     return self->is_builtin;
 }
 
+/** A predicate.
+ *
+ * @param self an atom.
+ * @return the truth.
+ */
+static bool Is_variadic(func_semantics_t *self) {
+    return self->is_variadic;
+}
+
 /** Set is_declared.
  *
  * @param self semantics to change it_declared flag.
@@ -90,6 +100,18 @@ static void Builtin(func_semantics_t *self) {
     self->is_builtin = true;
 }
 
+/** Set is_variadic.
+ *
+ * @param self semantics to change is_variadic flag.
+ * @return void.
+ */
+static void Variadic(func_semantics_t *self) {
+    if (self == NULL) {
+        return;
+    }
+    self->is_variadic = true;
+}
+
 /** Convert an id_type to a character for vector representation of types.
  *
  * @param type id_type to convert.
@@ -139,7 +161,7 @@ static int token_to_type(int typ) {
  * @param type param to add.
  */
 static void Add_return(func_info_t *self, int type) {
-    Dynstring.append(self->returns, of_id_type(type));
+    self->returns = Intern.signature_append(self->returns, of_id_type(type));
     debug_msg("\n\t[semantics] add return\n");
 }
 
@@ -149,28 +171,28 @@ static void Add_return(func_info_t *self, int type) {
  * @param type param to add.
  */
 static void Add_param(func_info_t *self, int type) {
-    Dynstring.append(self->params, of_id_type(type));
+    self->params = Intern.signature_append(self->params, of_id_type(type));
     debug_msg("\n\t[semantics] add return\n");
 }
 
-/** Add a function parameter to a function semantics.
+/** Directly set a signature with function return values.
  *
- * @param self info to set a vector.
- * @param vec vector to add.
+ * @param self info to set a signature.
+ * @param signature interned signature.
  */
-static void Set_returns(func_info_t *self, dynstring_t *vec) {
-    debug_msg("\n\t[semantics] Set params: %s\n", Dynstring.c_str(vec));
-    self->returns = vec;
+static void Set_returns(func_info_t *self, const atom_t *signature) {
+    debug_msg("\n\t[semantics] Set returns: %s\n", Dynstring.c_str(signature->name));
+    self->returns = signature;
 }
 
-/** Directly set a vector with function parameters.
+/** Directly set a signature with function parameters.
  *
- * @param self info to set a vector.
- * @param vec vector to add.
+ * @param self info to set a signature.
+ * @param signature interned signature.
  */
-static void Set_params(func_info_t *self, dynstring_t *vec) {
-    debug_msg("\n\t[semantics] Set returns: %s\n", Dynstring.c_str(vec));
-    self->params = vec;
+static void Set_params(func_info_t *self, const atom_t *signature) {
+    debug_msg("\n\t[semantics] Set params: %s\n", Dynstring.c_str(signature->name));
+    self->params = signature;
 }
 
 /** Function semantics destructor.
@@ -181,12 +203,8 @@ static void Dtor(func_semantics_t *self) {
     if (self == NULL) {
         return;
     }
-    Dynstring.dtor(self->definition.returns);
-    Dynstring.dtor(self->declaration.returns);
-
-    Dynstring.dtor(self->definition.params);
-    Dynstring.dtor(self->declaration.params);
-    free(self);
+    // signatures are owned by the signature table.
+    Context.free(MEM_SYMTABLE, self, sizeof(func_semantics_t));
     debug_msg("\n\t[dtor] delete function semantic\n");
 }
 
@@ -199,8 +217,7 @@ static void Dtor(func_semantics_t *self) {
  */
 static func_semantics_t *Ctor(bool is_defined, bool is_declared, bool is_builtin) {
     debug_msg_s("\n");
-    func_semantics_t *newbe = calloc(1, sizeof(func_semantics_t));
-    soft_assert(newbe != NULL, ERROR_INTERNAL);
+    func_semantics_t *newbe = Context.alloc(MEM_SYMTABLE, sizeof(func_semantics_t));
 
     if (is_defined) { Define(newbe); }
     if (is_declared) { Declare(newbe); }
@@ -209,18 +226,15 @@ static func_semantics_t *Ctor(bool is_defined, bool is_declared, bool is_builtin
     if (is_builtin) {
         debug_msg_s("\tIn case of builtin function, there's need to set parameters manually\n");
         Builtin(newbe);
-    } else {
-        newbe->declaration.returns = Dynstring.ctor("");
-        soft_assert(newbe->declaration.returns != NULL, ERROR_INTERNAL);
-        newbe->declaration.params = Dynstring.ctor("");
-        soft_assert(newbe->declaration.params != NULL, ERROR_INTERNAL);
-
-        newbe->definition.returns = Dynstring.ctor("");
-        soft_assert(newbe->definition.returns != NULL, ERROR_INTERNAL);
-        newbe->definition.params = Dynstring.ctor("");
-        soft_assert(newbe->definition.params != NULL, ERROR_INTERNAL);
     }
 
+    // types are added to empty signatures.
+    const atom_t *empty = Intern.signature("", 0);
+    newbe->declaration.returns = empty;
+    newbe->declaration.params = empty;
+    newbe->definition.returns = empty;
+    newbe->definition.params = empty;
+
     return newbe;
 }
 
@@ -280,6 +294,332 @@ static void Trunc_signature(dynstring_t *type_signature) {
     }
 }
 
+/** Result of an operator for types of its operands.
+ */
+typedef struct op_rule {
+    expr_type_t result; ///< type of the expression.
+    type_recast_t recast; ///< operands converted from integer to number.
+    int error; ///< ERROR_NOERROR, or the error of incompatible operands.
+} op_rule_t;
+
+#define E {EXPR_TYPE_UNDEF, NO_RECAST, ERROR_EXPRESSIONS_TYPE_INCOMPATIBILITY}
+#define OK(type, recast) {EXPR_TYPE_##type, recast, ERROR_NOERROR}
+
+#define ROW_E {E, E, E, E, E, E}
+
+// rows are types of the first operand, columns are types of the second one:
+//   nil, integer, number, string, boolean, undefined.
+
+// boolean -> integer|number|string <|<=|>|>= integer|number|string
+#define RULES_RELATIONAL { \
+        ROW_E, \
+        {E, OK(BOOLEAN, NO_RECAST),          OK(BOOLEAN, TYPE_RECAST_FIRST), E, E, E}, \
+        {E, OK(BOOLEAN, TYPE_RECAST_SECOND), OK(BOOLEAN, NO_RECAST),         E, E, E}, \
+        {E, E,                               E,                              OK(BOOLEAN, NO_RECAST), E, E}, \
+        ROW_E, \
+        {E, E,                               E,                              E, E, OK(BOOLEAN, NO_RECAST)}, \
+}
+
+// boolean -> integer|number|string|boolean|nil ==|~= the same type or nil
+#define RULES_EQUALITY { \
+        {OK(BOOLEAN, NO_RECAST), OK(BOOLEAN, NO_RECAST), OK(BOOLEAN, NO_RECAST), OK(BOOLEAN, NO_RECAST), \
+                OK(BOOLEAN, NO_RECAST), OK(BOOLEAN, NO_RECAST)}, \
+        {OK(BOOLEAN, NO_RECAST), OK(BOOLEAN, NO_RECAST),          OK(BOOLEAN, TYPE_RECAST_FIRST), E, E, E}, \
+        {OK(BOOLEAN, NO_RECAST), OK(BOOLEAN, TYPE_RECAST_SECOND), OK(BOOLEAN, NO_RECAST),         E, E, E}, \
+        {OK(BOOLEAN, NO_RECAST), E, E, OK(BOOLEAN, NO_RECAST), E, E}, \
+        {OK(BOOLEAN, NO_RECAST), E, E, E, OK(BOOLEAN, NO_RECAST), E}, \
+        {OK(BOOLEAN, NO_RECAST), E, E, E, E, OK(BOOLEAN, NO_RECAST)}, \
+}
+
+// integer -> integer +|-|* integer
+// number -> integer|number +|-|* integer|number
+#define RULES_ARITHMETIC { \
+        ROW_E, \
+        {E, OK(INTEGER, NO_RECAST),         OK(NUMBER, TYPE_RECAST_FIRST), E, E, E}, \
+        {E, OK(NUMBER, TYPE_RECAST_SECOND), OK(NUMBER, NO_RECAST),         E, E, E}, \
+        ROW_E, \
+        ROW_E, \
+        {E, E,                              E,                             E, E, OK(NUMBER, NO_RECAST)}, \
+}
+
+// number -> integer|number /|^ integer|number
+#define RULES_DIVISION { \
+        ROW_E, \
+        {E, OK(NUMBER, TYPE_RECAST_BOTH),   OK(NUMBER, TYPE_RECAST_FIRST), E, E, E}, \
+        {E, OK(NUMBER, TYPE_RECAST_SECOND), OK(NUMBER, NO_RECAST),         E, E, E}, \
+        ROW_E, \
+        ROW_E, \
+        {E, E,                              E,                             E, E, OK(NUMBER, NO_RECAST)}, \
+}
+
+// integer -> integer //|% integer
+#define RULES_INTEGER_DIVISION {ROW_E, {E, OK(INTEGER, NO_RECAST), E, E, E, E}, ROW_E, ROW_E, ROW_E, ROW_E}
+
+// string -> string .. string
+#define RULES_STRCAT {ROW_E, ROW_E, ROW_E, {E, E, E, OK(STRING, NO_RECAST), E, E}, ROW_E, ROW_E}
+
+// boolean -> boolean and|or boolean
+#define RULES_LOGICAL {ROW_E, ROW_E, ROW_E, ROW_E, {E, E, E, E, OK(BOOLEAN, NO_RECAST), E}, ROW_E}
+
+#define RULES_NONE {ROW_E, ROW_E, ROW_E, ROW_E, ROW_E, ROW_E}
+
+/** Binary operators, types of the operands -> type of the expression.
+ */
+static const op_rule_t binary_rules[OP_UNDEFINED + 1][EXPR_TYPE_COUNT][EXPR_TYPE_COUNT] = {
+        [OP_ID] = RULES_NONE,
+        [OP_CARET] = RULES_DIVISION,
+        [OP_MUL] = RULES_ARITHMETIC,
+        [OP_DIV_I] = RULES_INTEGER_DIVISION,
+        [OP_DIV_F] = RULES_DIVISION,
+        [OP_PERCENT] = RULES_INTEGER_DIVISION,
+        [OP_ADD] = RULES_ARITHMETIC,
+        [OP_SUB] = RULES_ARITHMETIC,
+        [OP_LT] = RULES_RELATIONAL,
+        [OP_LE] = RULES_RELATIONAL,
+        [OP_GT] = RULES_RELATIONAL,
+        [OP_GE] = RULES_RELATIONAL,
+        [OP_EQ] = RULES_EQUALITY,
+        [OP_NE] = RULES_EQUALITY,
+        [OP_HASH] = RULES_NONE,
+        [OP_NOT] = RULES_NONE,
+        [OP_MINUS_UNARY] = RULES_NONE,
+        [OP_STRCAT] = RULES_STRCAT,
+        [OP_AND] = RULES_LOGICAL,
+        [OP_OR] = RULES_LOGICAL,
+        [OP_DOLLAR] = RULES_NONE,
+        [OP_UNDEFINED] = RULES_NONE,
+};
+
+/** Unary operators, type of the operand -> type of the expression.
+ */
+static const op_rule_t unary_rules[OP_UNDEFINED + 1][EXPR_TYPE_COUNT] = {
+        [OP_ID] = ROW_E,
+        [OP_CARET] = ROW_E,
+        [OP_MUL] = ROW_E,
+        [OP_DIV_I] = ROW_E,
+        [OP_DIV_F] = ROW_E,
+        [OP_PERCENT] = ROW_E,
+        [OP_ADD] = ROW_E,
+        [OP_SUB] = ROW_E,
+        [OP_LT] = ROW_E,
+        [OP_LE] = ROW_E,
+        [OP_GT] = ROW_E,
+        [OP_GE] = ROW_E,
+        [OP_EQ] = ROW_E,
+        [OP_NE] = ROW_E,
+        // integer -> # string
+        [OP_HASH] = {E, E, E, OK(INTEGER, NO_RECAST), E, E},
+        // boolean -> not boolean
+        [OP_NOT] = {E, E, E, E, OK(BOOLEAN, NO_RECAST), E},
+        // integer -> - integer
+        // number -> - number
+        [OP_MINUS_UNARY] = {E, OK(INTEGER, NO_RECAST), OK(NUMBER, NO_RECAST), E, E, E},
+        [OP_STRCAT] = ROW_E,
+        [OP_AND] = ROW_E,
+        [OP_OR] = ROW_E,
+        [OP_DOLLAR] = ROW_E,
+        [OP_UNDEFINED] = ROW_E,
+};
+
+#undef RULES_RELATIONAL
+#undef RULES_EQUALITY
+#undef RULES_ARITHMETIC
+#undef RULES_DIVISION
+#undef RULES_INTEGER_DIVISION
+#undef RULES_STRCAT
+#undef RULES_LOGICAL
+#undef RULES_NONE
+#undef ROW_E
+#undef E
+#undef OK
+
+/**
+ * @brief Apply a rule of an operator.
+ *
+ * @param rule
+ * @param expression_type variable to store a type of the expression.
+ * @param r_type variable to store a type of recast, or NULL.
+ * @return bool.
+ */
+static bool apply_rule(const op_rule_t *rule, expr_type_t *expression_type, type_recast_t *r_type) {
+    if (rule->error != ERROR_NOERROR) {
+        Errors.set_error(rule->error);
+        return false;
+    }
+
+    *expression_type = rule->result;
+    if (r_type != NULL) {
+        *r_type = rule->recast;
+    }
+    return true;
+}
+
+/**
+ * @brief Check semantics of binary operation.
+ *
+ * @param first_type type of the first operand.
+ * @param second_type type of the second operand.
+ * @param op binary operator.
+ * @param expression_type variable to store a type of the expression.
+ * @param r_type variable to store a type of recast.
+ * @return bool.
+ */
+static bool Check_binary_compatibility(expr_type_t first_type,
+                                       expr_type_t second_type,
+                                       op_list_t op,
+                                       expr_type_t *expression_type,
+                                       type_recast_t *r_type) {
+    return apply_rule(&binary_rules[op][first_type][second_type], expression_type, r_type);
+}
+
+/**
+ * @brief Check semantics of unary operation.
+ *
+ * @param type type of the operand.
+ * @param op unary operator.
+ * @param expression_type variable to store a type of the expression.
+ * @return bool.
+ */
+static bool Check_unary_compatability(expr_type_t type,
+                                      op_list_t op,
+                                      expr_type_t *expression_type) {
+    return apply_rule(&unary_rules[op][type], expression_type, NULL);
+}
+
+/**
+ * @brief Type of an expression from a character of a signature.
+ *
+ * @param type 'n', 'i', 'f', 's', 'b', other characters are undefined types.
+ * @return type code.
+ */
+static expr_type_t Expr_type(char type) {
+    switch (type) {
+        case 'n':
+            return EXPR_TYPE_NIL;
+        case 'i':
+            return EXPR_TYPE_INTEGER;
+        case 'f':
+            return EXPR_TYPE_NUMBER;
+        case 's':
+            return EXPR_TYPE_STRING;
+        case 'b':
+            return EXPR_TYPE_BOOLEAN;
+        default:
+            return EXPR_TYPE_UNDEF;
+    }
+}
+
+/**
+ * @brief Character of a signature of an expression type.
+ *
+ * @param type type code.
+ * @return 'n', 'i', 'f', 's', 'b' or 'u'.
+ */
+static char Of_expr_type(expr_type_t type) {
+    static const char chars[EXPR_TYPE_COUNT] = {
+            [EXPR_TYPE_NIL] = 'n',
+            [EXPR_TYPE_INTEGER] = 'i',
+            [EXPR_TYPE_NUMBER] = 'f',
+            [EXPR_TYPE_STRING] = 's',
+            [EXPR_TYPE_BOOLEAN] = 'b',
+            [EXPR_TYPE_UNDEF] = 'u',
+    };
+    return chars[type];
+}
+
+/**
+ * @brief Check semantics of single operand.
+ *
+ * @param operand
+ * @param type variable to store the type of the operand.
+ * @return bool.
+ */
+static bool Check_operand(token_t operand, expr_type_t *type) {
+    char result_type;
+    symbol_t *sym;
+
+    // Check if operand is identifier
+    if (operand.type != TOKEN_ID) {
+        result_type = Semantics.of_id_type(Semantics.token_to_id_type(operand.type));
+        goto ret;
+    }
+
+    // Check if identifier is in symbol table
+    if (Symstack.get_local_symbol(context->symstack, operand.attribute.atom, &sym)) {
+        result_type = Semantics.of_id_type(sym->type);
+        goto ret;
+    }
+
+    Errors.set_error(ERROR_DEFINITION);
+    return false;
+
+    ret:
+    *type = Expr_type(result_type);
+    return true;
+}
+
+/**
+ * @brief Check semantics of two types.
+ *
+ * @param expected_type
+ * @param received_char
+ * @param r_type variable to store a type of recast.
+ * @return bool.
+ */
+static bool Check_type_compatibility (const char expected_type,
+                                      const char received_char,
+                                      type_recast_t *r_type) {
+    if (expected_type == received_char) {
+        goto ret;
+    }
+
+    if (received_char == 'n') {
+        goto ret;
+    }
+
+    if (expected_type == 'f' && received_char == 'i') {
+        *r_type = TYPE_RECAST_SECOND;
+        goto ret;
+    }
+
+
+    return false;
+    ret:
+    return true;
+}
+
+const struct semantics_interface_t Semantics = {
+        .ctor = Ctor,
+        .dtor = Dtor,
+        .is_declared = Is_declared,
+        .is_defined = Is_defined,
+        .is_builtin = Is_builtin,
+        .is_variadic = Is_variadic,
+        .add_return = Add_return,
+        .add_param = Add_param,
+        .declare = Declare,
+        .define = Define,
+        .builtin = Builtin,
+        .variadic = Variadic,
+        .set_returns = Set_returns,
+        .set_params = Set_params,
+
+        .check_signatures = Check_signatures,
+        .check_signatures_compatibility = Check_signatures_compatibility,
+        .of_id_type = of_id_type,
+        .token_to_id_type = token_to_type,
+
+        .check_binary_compatibility = Check_binary_compatibility,
+        .check_unary_compatibility = Check_unary_compatability,
+        .expr_type = Expr_type,
+        .of_expr_type = Of_expr_type,
+        .check_operand = Check_operand,
+        .trunc_signature = Trunc_signature,
+        .check_type_compatibility = Check_type_compatibility,
+};
+
+#ifdef SELFTEST_semantics
+// the comparison chains the tables replaced, they are the reference of the tables.
 /**
  * @brief Check semantics of binary operation.
  *
@@ -290,7 +630,7 @@ static void Trunc_signature(dynstring_t *type_signature) {
  * @param r_type variable to store a type of recast.
  * @return bool.
  */
-static bool Check_binary_compatibility(dynstring_t *first_type,
+static bool legacy_binary_compatibility(dynstring_t *first_type,
                                        dynstring_t *second_type,
                                        op_list_t op,
                                        dynstring_t *expression_type,
@@ -466,7 +806,7 @@ static bool Check_binary_compatibility(dynstring_t *first_type,
  * @param expression_type initialized vector to store an expression type.
  * @return bool.
  */
-static bool Check_unary_compatability(dynstring_t *type,
+static bool legacy_unary_compatibility(dynstring_t *type,
                                       op_list_t op,
                                       dynstring_t *expression_type) {
     char result_type;
@@ -518,89 +858,67 @@ static bool Check_unary_compatability(dynstring_t *type,
     return true;
 }
 
-/**
- * @brief Check semantics of single operand.
- *
- * @param operand
- * @param expression_type initialized vector to store an expression type.
- * @return bool.
+/** Usage: semantics_selftest
+ *  Tables of operators must give the same types, recasts and errors as the comparison chains
+ *  for every operator and every pair of types.
  */
-static bool Check_operand(token_t operand, dynstring_t *expression_type) {
-    char result_type;
-    symbol_t *sym;
-
-    // Check if operand is identifier
-    if (operand.type != TOKEN_ID) {
-        result_type = Semantics.of_id_type(Semantics.token_to_id_type(operand.type));
-        goto ret;
-    }
-
-    // Check if identifier is in symbol table
-    if (Symstack.get_local_symbol(symstack, operand.attribute.id, &sym)) {
-        result_type = Semantics.of_id_type(sym->type);
-        goto ret;
-    }
-
-    Errors.set_error(ERROR_DEFINITION);
-    return false;
-
-    ret:
-    Dynstring.append(expression_type, result_type);
-    return true;
-}
+int main() {
+    const char types[] = "nifsbu";
+    context_t *ctx = Context.ctor(NULL);
+    Context.enter(ctx);
+    int failed = 0, checked = 0;
+
+    for (op_list_t op = OP_ID; op <= OP_UNDEFINED; op++) {
+        for (const char *first = types; *first; first++) {
+            for (const char *second = types; *second; second++) {
+                dynstring_t *first_type = Dynstring.ctor((char[]) {*first, '\0'});
+                dynstring_t *second_type = Dynstring.ctor((char[]) {*second, '\0'});
+                dynstring_t *legacy_type = Dynstring.ctor("");
+                type_recast_t legacy_recast = NO_RECAST, recast = NO_RECAST;
+                expr_type_t type = EXPR_TYPE_UNDEF;
+
+                Errors.set_error(ERROR_NOERROR);
+                bool legacy_ok = legacy_binary_compatibility(first_type, second_type, op, legacy_type, &legacy_recast);
+                int legacy_error = Errors.get_error();
+                Errors.set_error(ERROR_NOERROR);
+                bool ok = Semantics.check_binary_compatibility(Semantics.expr_type(*first),
+                                                               Semantics.expr_type(*second), op, &type, &recast);
+                if (ok != legacy_ok || Errors.get_error() != legacy_error || recast != legacy_recast
+                    || (ok && Dynstring.c_str(legacy_type)[0] != Semantics.of_expr_type(type))) {
+                    fprintf(stderr, "FAILED: binary operator %d, types '%c' '%c'\n", op, *first, *second);
+                    failed = 1;
+                }
+                checked++;
 
-/**
- * @brief Check semantics of two types.
- *
- * @param expected_type
- * @param received_char
- * @param r_type variable to store a type of recast.
- * @return bool.
- */
-static bool Check_type_compatibility (const char expected_type,
-                                      const char received_char,
-                                      type_recast_t *r_type) {
-    if (expected_type == received_char) {
-        goto ret;
-    }
+                Dynstring.dtor(first_type);
+                Dynstring.dtor(second_type);
+                Dynstring.dtor(legacy_type);
+            }
 
-    if (received_char == 'n') {
-        goto ret;
-    }
+            dynstring_t *operand_type = Dynstring.ctor((char[]) {*first, '\0'});
+            dynstring_t *legacy_type = Dynstring.ctor("");
+            expr_type_t type = EXPR_TYPE_UNDEF;
+
+            Errors.set_error(ERROR_NOERROR);
+            bool legacy_ok = legacy_unary_compatibility(operand_type, op, legacy_type);
+            int legacy_error = Errors.get_error();
+            Errors.set_error(ERROR_NOERROR);
+            bool ok = Semantics.check_unary_compatibility(Semantics.expr_type(*first), op, &type);
+            if (ok != legacy_ok || Errors.get_error() != legacy_error
+                || (ok && Dynstring.c_str(legacy_type)[0] != Semantics.of_expr_type(type))) {
+                fprintf(stderr, "FAILED: unary operator %d, type '%c'\n", op, *first);
+                failed = 1;
+            }
+            checked++;
 
-    if (expected_type == 'f' && received_char == 'i') {
-        *r_type = TYPE_RECAST_SECOND;
-        goto ret;
+            Dynstring.dtor(operand_type);
+            Dynstring.dtor(legacy_type);
+        }
     }
 
-
-    return false;
-    ret:
-    return true;
+    printf("%d combinations of operators and types: %s\n", checked, failed ? "FAILED" : "OK");
+    Context.enter(NULL);
+    Context.dtor(ctx);
+    return failed;
 }
-
-const struct semantics_interface_t Semantics = {
-        .ctor = Ctor,
-        .dtor = Dtor,
-        .is_declared = Is_declared,
-        .is_defined = Is_defined,
-        .is_builtin = Is_builtin,
-        .add_return = Add_return,
-        .add_param = Add_param,
-        .declare = Declare,
-        .define = Define,
-        .builtin = Builtin,
-        .set_returns = Set_returns,
-        .set_params = Set_params,
-
-        .check_signatures = Check_signatures,
-        .check_signatures_compatibility = Check_signatures_compatibility,
-        .of_id_type = of_id_type,
-        .token_to_id_type = token_to_type,
-
-        .check_binary_compatibility = Check_binary_compatibility,
-        .check_unary_compatibility = Check_unary_compatability,
-        .check_operand = Check_operand,
-        .trunc_signature = Trunc_signature,
-        .check_type_compatibility = Check_type_compatibility,
-};
+#endif
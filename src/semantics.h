@@ -14,13 +14,14 @@
 #include "dynstring.h"
 #include "scanner.h"
 #include "expressions.h"
+#include "intern.h"
 
 
 /** Information about a function datatypes.
  */
 typedef struct func_info {
-    dynstring_t *returns; ///< vector with enum(int) values representing types of return values.
-    dynstring_t *params; ///< vector wish enum(int) values representing types of function arguments.
+    const atom_t *returns; ///< interned signature of types of return values.
+    const atom_t *params; ///< interned signature of types of function arguments.
 } func_info_t;
 
 /** Semantic information about a function.
@@ -31,8 +32,21 @@ typedef struct func_semantics {
     bool is_declared;
     bool is_defined;
     bool is_builtin;
+    bool is_variadic; ///< any number of arguments of any types, params are empty.
 } func_semantics_t;
 
+/** Types of expressions, they index the tables of operators.
+ */
+typedef enum expr_type {
+    EXPR_TYPE_NIL,
+    EXPR_TYPE_INTEGER,
+    EXPR_TYPE_NUMBER,
+    EXPR_TYPE_STRING,
+    EXPR_TYPE_BOOLEAN,
+    EXPR_TYPE_UNDEF,
+    EXPR_TYPE_COUNT,
+} expr_type_t;
+
 typedef enum type_recast {
     TYPE_RECAST_FIRST,
     TYPE_RECAST_SECOND,
@@ -49,7 +63,7 @@ extern const struct semantics_interface_t Semantics;
 
 struct semantics_interface_t {
     /** Function checks if return values and parameters
-     *  of the function are equal.
+     *  of the function are equal. Signatures are interned, so they are compared by pointers.
      *
      * @param func function definition or declaration semantics.
      * @return bool.
@@ -77,6 +91,13 @@ struct semantics_interface_t {
      */
     bool (*is_builtin)(func_semantics_t *);
 
+    /** A predicate.
+     *
+     * @param self an atom.
+     * @return the truth.
+     */
+    bool (*is_variadic)(func_semantics_t *);
+
 
     /** Set is_declared.
      *
@@ -99,6 +120,13 @@ struct semantics_interface_t {
      */
     void (*builtin)(func_semantics_t *);
 
+    /** Set is_variadic.
+     *
+     * @param self semantics to change is_variadic flag.
+     * @return void.
+     */
+    void (*variadic)(func_semantics_t *);
+
     /** Add a return type to a function semantics.
      *
      * @param self info to add a param.
@@ -113,19 +141,19 @@ struct semantics_interface_t {
      */
     void (*add_param)(func_info_t *, int);
 
-    /** Add a function parameter to a function semantics.
+    /** Directly set a signature with function return values.
      *
-     * @param self info to set a vector.
-     * @param vec vector to add.
+     * @param self info to set a signature.
+     * @param signature interned signature.
      */
-    void (*set_returns)(func_info_t *, dynstring_t *);
+    void (*set_returns)(func_info_t *, const atom_t *);
 
-    /** Directly set a vector with function parameters.
+    /** Directly set a signature with function parameters.
      *
-     * @param self info to set a vector.
-     * @param vec vector to add.
+     * @param self info to set a signature.
+     * @param signature interned signature.
      */
-    void (*set_params)(func_info_t *, dynstring_t *);
+    void (*set_params)(func_info_t *, const atom_t *);
 
     /** Function semantics destructor.
      *
@@ -154,30 +182,46 @@ struct semantics_interface_t {
      * @param first_type type of the first operand.
      * @param second_type type of the second operand.
      * @param op binary operator.
-     * @param expression_type initialized vector to store an expression type.
+     * @param expression_type variable to store a type of the expression.
      * @param r_type variable to store a type of recast.
      * @return bool.
      */
-    bool (*check_binary_compatibility)(dynstring_t *, dynstring_t *, op_list_t, dynstring_t *, type_recast_t*);
+    bool (*check_binary_compatibility)(expr_type_t, expr_type_t, op_list_t, expr_type_t *, type_recast_t *);
 
     /**
      * @brief Check semantics of unary operation.
      *
      * @param type type of the operand.
      * @param op unary operator.
-     * @param expression_type initialized vector to store an expression type.
+     * @param expression_type variable to store a type of the expression.
      * @return bool.
      */
-    bool (*check_unary_compatibility)(dynstring_t *, op_list_t, dynstring_t *);
+    bool (*check_unary_compatibility)(expr_type_t, op_list_t, expr_type_t *);
+
+    /**
+     * @brief Type of an expression from a character of a signature.
+     *
+     * @param type 'n', 'i', 'f', 's', 'b', other characters are undefined types.
+     * @return type code.
+     */
+    expr_type_t (*expr_type)(char);
+
+    /**
+     * @brief Character of a signature of an expression type.
+     *
+     * @param type type code.
+     * @return 'n', 'i', 'f', 's', 'b' or 'u'.
+     */
+    char (*of_expr_type)(expr_type_t);
 
     /**
      * @brief Check semantics of single operand.
      *
      * @param operand
-     * @param expression_type initialized vector to store an expression type.
+     * @param type variable to store the type of the operand.
      * @return bool.
      */
-    bool (*check_operand)(token_t, dynstring_t *);
+    bool (*check_operand)(token_t, expr_type_t *);
 
     /**
      * @brief Truncate signature to one type.
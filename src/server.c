@@ -0,0 +1,711 @@
+/**
+ * @file server.c
+ *
+ * @brief Compile server. The main thread reads requests and writes responses of all connections
+ *        without blocking, by poll(). Every complete request is compiled by a task of the thread pool
+ *        in its own context, so a slow client does not take a thread of the pool,
+ *        and the server keeps nothing but read-only tables between requests.
+ *
+ * @author Skuratovich Aliaksandr <xskura01@vutbr.cz>
+ */
+#include "server.h"
+#include "debug.h"
+#include "errors.h"
+#include "pool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+
+// size of chunks of a response passed to the sink by the client.
+#define RESPONSE_CHUNK (64 * 1024)
+// the buffer of a program grows by at most this many characters, so it grows with what the client has sent.
+#define REQUEST_CHUNK (64 * 1024)
+
+
+/** Characters collected in memory, buffers are reused by requests of a connection.
+ */
+typedef struct buffer {
+    char *s;
+    size_t len;
+    size_t cap;
+} buffer_t;
+
+typedef struct server server_t;
+
+typedef enum connection_state {
+    CONN_READING, ///< a request is read by the main thread.
+    CONN_COMPILING, ///< the request is compiled by a task of the pool.
+    CONN_WRITING, ///< the response is written by the main thread.
+} connection_state_t;
+
+/** A connection, its fd is non-blocking.
+ */
+typedef struct connection {
+    int fd;
+    connection_state_t state; ///< it is changed under the lock of the server.
+    bool last; ///< no more requests are read, the input is dropped after the response.
+    uint8_t header[8]; ///< header of the request, then of the response.
+    size_t done; ///< characters of the request read, or of the response written.
+    size_t len; ///< length of the program of the request.
+    buffer_t src; ///< program of the request.
+    buffer_t code; ///< generated code of the response.
+    server_t *server;
+} connection_t;
+
+/** Open connections.
+ */
+struct server {
+    pthread_mutex_t lock; ///< protects connections.
+    connection_t **conns;
+    size_t len;
+    size_t cap;
+    int wake[2]; ///< pipe waking up poll(), when a connection is idle again or the server stops.
+};
+
+// write end of the wake pipe for the signal handler.
+static volatile sig_atomic_t wake_fd = -1;
+static volatile sig_atomic_t stop;
+
+
+/** Make the buffer hold at least cap characters.
+ */
+static void reserve(buffer_t *buf, size_t cap) {
+    if (cap > buf->cap) {
+        buf->cap = (cap > 2 * buf->cap) ? cap : 2 * buf->cap;
+        buf->s = realloc(buf->s, buf->cap);
+        soft_assert(buf->s != NULL, ERROR_INTERNAL);
+    }
+}
+
+/** Sink writing to a buffer.
+ */
+static void write_buffer(void *data, const char *s, size_t len) {
+    buffer_t *buf = data;
+    reserve(buf, buf->len + len);
+    memcpy(buf->s + buf->len, s, len);
+    buf->len += len;
+}
+
+static void put_u32(uint8_t *p, uint32_t n) {
+    p[0] = n >> 24;
+    p[1] = n >> 16;
+    p[2] = n >> 8;
+    p[3] = n;
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+    return (uint32_t) p[0] << 24 | (uint32_t) p[1] << 16 | (uint32_t) p[2] << 8 | p[3];
+}
+
+/** Read len characters, unless the input ends.
+ *
+ * @return number of read characters, less than len at the end of the input or on an error.
+ */
+static size_t read_all(int fd, void *buf, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = read(fd, (char *) buf + done, len - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        done += n;
+    }
+    return done;
+}
+
+/** Write all characters of the vector.
+ *
+ * @return false on an error.
+ */
+static bool write_all(int fd, struct iovec *iov, int count) {
+    while (count > 0) {
+        ssize_t n = writev(fd, iov, count);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            return false;
+        }
+        // skip written parts.
+        while (count > 0 && (size_t) n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char *) iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+    return true;
+}
+
+/** Compile the program of a request and make the header of its response.
+ *  Code longer than a response can carry is not sent, the error is ERROR_INTERNAL.
+ *
+ * @param src program of the request.
+ * @param len number of characters of the program.
+ * @param code buffer for the generated code.
+ * @param header header of the response.
+ */
+static void compile_request(buffer_t *src, size_t len, buffer_t *code, uint8_t *header) {
+    ifj21_sink_t sink = {.write = write_buffer, .data = code};
+
+    code->len = 0;
+    int error = ifj21_compile(src->s, len, &sink);
+    if (code->len > UINT32_MAX) {
+        error = ERROR_INTERNAL;
+        code->len = 0;
+    }
+    put_u32(header, error);
+    put_u32(header + 4, code->len);
+}
+
+/** Make the header of the response to a request longer than SERVER_REQUEST_MAX.
+ */
+static void reject_request(uint8_t *header) {
+    put_u32(header, ERROR_INTERNAL);
+    put_u32(header + 4, 0);
+}
+
+/** Serve a request.
+ *
+ * @param in requests.
+ * @param out responses.
+ * @param src buffer for the program.
+ * @param code buffer for the generated code.
+ * @return 1 if a request is served, 0 at the end of the input, -1 on an error.
+ */
+static int serve_request(int in, int out, buffer_t *src, buffer_t *code) {
+    uint8_t header[8];
+
+    size_t got = read_all(in, header, 4);
+    if (got != 4) {
+        return (got == 0) ? 0 : -1;
+    }
+    size_t len = get_u32(header);
+    if (len > SERVER_REQUEST_MAX) {
+        // the program is not read, so the next request cannot be found.
+        reject_request(header);
+        struct iovec iov = {.iov_base = header, .iov_len = sizeof(header)};
+        write_all(out, &iov, 1);
+        return -1;
+    }
+    reserve(src, len + 1);
+    if (read_all(in, src->s, len) != len) {
+        return -1;
+    }
+
+    compile_request(src, len, code, header);
+    struct iovec iov[2] = {
+            {.iov_base = header, .iov_len = sizeof(header)},
+            {.iov_base = code->s, .iov_len = code->len},
+    };
+    return write_all(out, iov, 2) ? 1 : -1;
+}
+
+/** Serve requests from a file descriptor until the end of it.
+ *
+ * @param in requests.
+ * @param out responses.
+ * @return 0, or an error code if a request is incomplete or a response cannot be written.
+ */
+static int Serve_fd(int in, int out) {
+    buffer_t src = {0}, code = {0};
+    int res;
+    while ((res = serve_request(in, out, &src, &code)) > 0) { ;
+    }
+    free(src.s);
+    free(code.s);
+    return (res < 0) ? ERROR_INTERNAL : 0;
+}
+
+static void close_connection(connection_t *conn) {
+    close(conn->fd);
+    free(conn->src.s);
+    free(conn->code.s);
+    free(conn);
+}
+
+/** Remove a connection from the server and close it, the main thread does it.
+ */
+static void remove_connection(server_t *server, connection_t *conn) {
+    pthread_mutex_lock(&server->lock);
+    for (size_t i = 0; i < server->len; i++) {
+        if (server->conns[i] == conn) {
+            server->conns[i] = server->conns[--server->len];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&server->lock);
+    close_connection(conn);
+}
+
+/** Read characters of a request, which are there, the connection does not block.
+ *  The program of a request longer than SERVER_REQUEST_MAX is not read.
+ *
+ * @return 1 if the request is complete or too long, 0 if more characters are expected,
+ *         -1 at the end of the connection or on an error.
+ */
+static int read_request(connection_t *conn) {
+    for (;;) {
+        char *dst;
+        size_t want;
+        if (conn->done < 4) {
+            dst = (char *) conn->header + conn->done;
+            want = 4 - conn->done;
+        } else {
+            size_t got = conn->done - 4;
+            if (got == conn->len) {
+                return 1;
+            }
+            want = (conn->len - got < REQUEST_CHUNK) ? conn->len - got : REQUEST_CHUNK;
+            reserve(&conn->src, got + want + 1);
+            dst = conn->src.s + got;
+        }
+
+        ssize_t n = read(conn->fd, dst, want);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return 0;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        conn->done += n;
+        if (conn->done == 4) {
+            conn->len = get_u32(conn->header);
+            if (conn->len > SERVER_REQUEST_MAX) {
+                return 1;
+            }
+        }
+    }
+}
+
+/** Write characters of the response, which the connection takes without blocking.
+ *
+ * @return 1 if the response is written, 0 if there are characters left, -1 on an error.
+ */
+static int write_response(connection_t *conn) {
+    size_t total = sizeof(conn->header) + conn->code.len;
+    while (conn->done < total) {
+        struct iovec iov[2];
+        int count = 0;
+        size_t code_done = 0;
+        if (conn->done < sizeof(conn->header)) {
+            iov[count++] = (struct iovec) {.iov_base = conn->header + conn->done,
+                                           .iov_len = sizeof(conn->header) - conn->done};
+        } else {
+            code_done = conn->done - sizeof(conn->header);
+        }
+        iov[count++] = (struct iovec) {.iov_base = conn->code.s + code_done, .iov_len = conn->code.len - code_done};
+
+        ssize_t n = writev(conn->fd, iov, count);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return 0;
+        }
+        if (n < 0) {
+            return -1;
+        }
+        conn->done += n;
+    }
+    return 1;
+}
+
+/** Compile a complete request of a connection, it is a task of the pool.
+ *  The response is written by the main thread.
+ */
+static void serve_connection(void *arg) {
+    connection_t *conn = arg;
+    server_t *server = conn->server;
+    compile_request(&conn->src, conn->len, &conn->code, conn->header);
+
+    pthread_mutex_lock(&server->lock);
+    conn->state = CONN_WRITING;
+    conn->done = 0;
+    pthread_mutex_unlock(&server->lock);
+    // a full pipe wakes poll() anyway.
+    (void) !write(server->wake[1], "", 1);
+}
+
+/** Read a request of a connection, the main thread does it when the connection is readable.
+ *  A complete request is compiled by a task of the pool.
+ */
+static void serve_readable(server_t *server, pool_t *pool, connection_t *conn) {
+    if (conn->last) {
+        // closing a socket with unread input resets the connection, the client would lose the response.
+        char drop[REQUEST_CHUNK];
+        ssize_t n;
+        while ((n = read(conn->fd, drop, sizeof(drop))) > 0) { ;
+        }
+        if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            remove_connection(server, conn);
+        }
+        return;
+    }
+
+    int res = read_request(conn);
+    if (res < 0) {
+        remove_connection(server, conn);
+        return;
+    }
+    if (res == 0) {
+        return;
+    }
+    if (conn->len > SERVER_REQUEST_MAX) {
+        // the program is not read, so the next request cannot be found.
+        reject_request(conn->header);
+        conn->code.len = 0;
+        conn->last = true;
+        pthread_mutex_lock(&server->lock);
+        conn->state = CONN_WRITING;
+        conn->done = 0;
+        pthread_mutex_unlock(&server->lock);
+        return;
+    }
+    pthread_mutex_lock(&server->lock);
+    conn->state = CONN_COMPILING;
+    pthread_mutex_unlock(&server->lock);
+    Pool.submit(pool, serve_connection, conn);
+}
+
+/** Write a response of a connection, the main thread does it when the connection is writable.
+ *  The connection reads the next request after the response, after the last one the client gets
+ *  the end of the input and the connection is closed when the client closes it.
+ */
+static void serve_writable(server_t *server, connection_t *conn) {
+    int res = write_response(conn);
+    if (res < 0) {
+        remove_connection(server, conn);
+        return;
+    }
+    if (res > 0) {
+        if (conn->last) {
+            shutdown(conn->fd, SHUT_WR);
+        }
+        pthread_mutex_lock(&server->lock);
+        conn->state = CONN_READING;
+        conn->done = 0;
+        pthread_mutex_unlock(&server->lock);
+    }
+}
+
+static void on_signal(int sig) {
+    (void) sig;
+    stop = 1;
+    if (wake_fd >= 0) {
+        (void) !write(wake_fd, "", 1);
+    }
+}
+
+/** Accept a connection, it waits for a request.
+ */
+static void accept_connection(server_t *server, int sock) {
+    int fd = accept(sock, NULL, NULL);
+    if (fd < 0) {
+        return;
+    }
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    connection_t *conn = calloc(1, sizeof(connection_t));
+    soft_assert(conn != NULL, ERROR_INTERNAL);
+    conn->fd = fd;
+    conn->server = server;
+
+    pthread_mutex_lock(&server->lock);
+    if (server->len == server->cap) {
+        server->cap = server->cap ? 2 * server->cap : 16;
+        server->conns = realloc(server->conns, server->cap * sizeof(connection_t *));
+        soft_assert(server->conns != NULL, ERROR_INTERNAL);
+    }
+    server->conns[server->len++] = conn;
+    pthread_mutex_unlock(&server->lock);
+}
+
+/** Listen on a Unix domain socket and serve connections until SIGINT or SIGTERM.
+ *
+ * @param path path of the socket.
+ * @param jobs number of requests compiled at once.
+ * @return 0, or an error code if the socket cannot be created.
+ */
+static int Serve(const char *path, size_t jobs) {
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    struct stat st;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        Errors.set_error(ERROR_INTERNAL);
+        return ERROR_INTERNAL;
+    }
+    strcpy(addr.sun_path, path);
+
+    // a socket left by a server, which did not stop, is replaced.
+    if (stat(path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+        unlink(path);
+    }
+    server_t server = {.lock = PTHREAD_MUTEX_INITIALIZER};
+    int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0 || bind(sock, (struct sockaddr *) &addr, sizeof(addr)) != 0 || listen(sock, SOMAXCONN) != 0
+        || pipe(server.wake) != 0) {
+        perror(path);
+        if (sock >= 0) {
+            close(sock);
+        }
+        Errors.set_error(ERROR_INTERNAL);
+        return ERROR_INTERNAL;
+    }
+    fcntl(sock, F_SETFL, O_NONBLOCK);
+    fcntl(server.wake[0], F_SETFL, O_NONBLOCK);
+    fcntl(server.wake[1], F_SETFL, O_NONBLOCK);
+
+    wake_fd = server.wake[1];
+    struct sigaction action = {.sa_handler = on_signal};
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    pool_t *pool = Pool.ctor(jobs);
+    struct pollfd *fds = NULL;
+    connection_t **polled = NULL;
+    size_t cap = 0;
+
+    while (!stop) {
+        // the pipe, the socket and connections, which are not compiled.
+        pthread_mutex_lock(&server.lock);
+        if (cap < server.len + 2) {
+            cap = 2 * (server.len + 2);
+            fds = realloc(fds, cap * sizeof(struct pollfd));
+            polled = realloc(polled, cap * sizeof(connection_t *));
+            soft_assert(fds && polled, ERROR_INTERNAL);
+        }
+        fds[0] = (struct pollfd) {.fd = server.wake[0], .events = POLLIN};
+        fds[1] = (struct pollfd) {.fd = sock, .events = POLLIN};
+        nfds_t count = 2;
+        for (size_t i = 0; i < server.len; i++) {
+            connection_state_t state = server.conns[i]->state;
+            if (state != CONN_COMPILING) {
+                polled[count] = server.conns[i];
+                fds[count++] = (struct pollfd) {.fd = server.conns[i]->fd,
+                                                .events = (state == CONN_READING) ? POLLIN : POLLOUT};
+            }
+        }
+        pthread_mutex_unlock(&server.lock);
+
+        if (poll(fds, count, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (fds[0].revents) {
+            char drain[64];
+            while (read(server.wake[0], drain, sizeof(drain)) > 0) { ;
+            }
+        }
+        if (fds[1].revents) {
+            accept_connection(&server, sock);
+        }
+        // only the main thread moves connections out of reading and writing.
+        for (nfds_t i = 2; i < count; i++) {
+            if (fds[i].revents == 0) {
+                continue;
+            }
+            if (fds[i].events == POLLIN) {
+                serve_readable(&server, pool, polled[i]);
+            } else {
+                serve_writable(&server, polled[i]);
+            }
+        }
+    }
+
+    wake_fd = -1;
+    close(sock);
+    unlink(path);
+
+    // requests being compiled are finished.
+    Pool.dtor(pool);
+    for (size_t i = 0; i < server.len; i++) {
+        close_connection(server.conns[i]);
+    }
+    free(server.conns);
+    free(fds);
+    free(polled);
+    close(server.wake[0]);
+    close(server.wake[1]);
+    return 0;
+}
+
+/** Connect to a server.
+ *
+ * @param path path of the socket.
+ * @return file descriptor of the connection, or -1.
+ */
+static int Connect(const char *path) {
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+/** Compile a program on the server.
+ *
+ * @param fd connection.
+ * @param src characters of the program.
+ * @param len number of characters.
+ * @param sink output of the generated code.
+ * @return error code of the compilation, ERROR_INTERNAL if the server does not answer.
+ */
+static int Request(int fd, const char *src, size_t len, const ifj21_sink_t *sink) {
+    uint8_t header[8];
+    if (len > UINT32_MAX) {
+        return ERROR_INTERNAL;
+    }
+    put_u32(header, len);
+    struct iovec iov[2] = {
+            {.iov_base = header, .iov_len = 4},
+            {.iov_base = (char *) src, .iov_len = len},
+    };
+    if (!write_all(fd, iov, 2) || read_all(fd, header, 8) != 8) {
+        return ERROR_INTERNAL;
+    }
+
+    int error = (int) get_u32(header);
+    size_t left = get_u32(header + 4);
+    char chunk[RESPONSE_CHUNK];
+    while (left > 0) {
+        size_t part = (left < sizeof(chunk)) ? left : sizeof(chunk);
+        if (read_all(fd, chunk, part) != part) {
+            return ERROR_INTERNAL;
+        }
+        sink->write(sink->data, chunk, part);
+        left -= part;
+    }
+    return error;
+}
+
+
+const struct server_interface_t Server = {
+        .serve = Serve,
+        .serve_fd = Serve_fd,
+        .connect = Connect,
+        .request = Request,
+};
+
+
+#ifdef SELFTEST_server
+#include <sys/time.h>
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "FAILED: %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        failed = 1; \
+    } \
+} while (0)
+
+static char socket_path[64];
+
+static const char program[] = "require \"ifj21\"\n"
+                              "function main()\n"
+                              "  write(\"hello\\n\")\n"
+                              "end\n"
+                              "main()\n";
+
+static void *run_server(void *arg) {
+    *(int *) arg = Server.serve(socket_path, 1);
+    return NULL;
+}
+
+/** Connection, which does not wait for the server longer than 5 seconds.
+ */
+static int connect_timed(void) {
+    int fd = -1;
+    for (int i = 0; i < 1000 && fd < 0; i++) {
+        if ((fd = Server.connect(socket_path)) < 0) {
+            usleep(1000);
+        }
+    }
+    soft_assert(fd >= 0, ERROR_INTERNAL);
+    struct timeval timeout = {.tv_sec = 5};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return fd;
+}
+
+/** A server with one thread of the pool serves clients, while another one sends a part of a request,
+ *  a too long request is rejected.
+ */
+int main() {
+    int failed = 0;
+    int served = -1;
+    pthread_t thread;
+    snprintf(socket_path, sizeof(socket_path), "/tmp/ifj21_server_selftest.%d.sock", (int) getpid());
+    soft_assert(pthread_create(&thread, NULL, run_server, &served) == 0, ERROR_INTERNAL);
+
+    // a header and 7 characters of 1000.
+    int slow = connect_timed();
+    uint8_t header[8];
+    put_u32(header, 1000);
+    struct iovec part[2] = {
+            {.iov_base = header, .iov_len = 4},
+            {.iov_base = "require", .iov_len = 7},
+    };
+    CHECK(write_all(slow, part, 2));
+
+    int fd = connect_timed();
+    for (int i = 0; i < 3; i++) {
+        buffer_t code = {0};
+        ifj21_sink_t sink = {.write = write_buffer, .data = &code};
+        CHECK(Server.request(fd, program, sizeof(program) - 1, &sink) == 0);
+        CHECK(code.len > 0);
+        free(code.s);
+    }
+
+    // the response comes before the end of the connection.
+    int big = connect_timed();
+    put_u32(header, SERVER_REQUEST_MAX + 1);
+    struct iovec too_long[2] = {
+            {.iov_base = header, .iov_len = 4},
+            {.iov_base = (char *) program, .iov_len = sizeof(program) - 1},
+    };
+    CHECK(write_all(big, too_long, 2));
+    CHECK(read_all(big, header, 8) == 8);
+    CHECK(get_u32(header) == ERROR_INTERNAL && get_u32(header + 4) == 0);
+    CHECK(read_all(big, header, 1) == 0);
+
+    close(big);
+    close(fd);
+    close(slow);
+    pthread_kill(thread, SIGTERM);
+    pthread_join(thread, NULL);
+    CHECK(served == 0);
+
+    printf("%s\n", failed ? "FAILED" : "OK");
+    return failed;
+}
+#endif
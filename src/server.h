@@ -0,0 +1,62 @@
+/**
+ * @file server.h
+ *
+ * @brief Compile server. A long running process compiles programs sent over a Unix domain socket
+ *        or in frames on stdin, so clients do not pay the start of the compiler.
+ *
+ *        Request:  u32 length, length characters of the program.
+ *        Response: u32 error code, u32 length, length characters of IFJcode21.
+ *        Numbers are big-endian, a connection may send any number of requests.
+ *        A request longer than SERVER_REQUEST_MAX is answered by ERROR_INTERNAL without code
+ *        and the connection is closed. Code longer than u32 is not sent, the error is ERROR_INTERNAL.
+ *
+ * @author Skuratovich Aliaksandr <xskura01@vutbr.cz>
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "compiler.h"
+
+// the longest program of a request.
+#define SERVER_REQUEST_MAX (64 * 1024 * 1024)
+
+
+extern const struct server_interface_t Server;
+
+struct server_interface_t {
+    /** Listen on a Unix domain socket and serve connections on a pool of threads
+     *  until SIGINT or SIGTERM. Requests are read and responses are written by the main thread
+     *  without blocking, only compilations take threads of the pool.
+     *
+     * @param path path of the socket, it is removed at the end.
+     * @param jobs number of requests compiled at once.
+     * @return 0, or an error code if the socket cannot be created.
+     */
+    int (*serve)(const char *, size_t);
+
+    /** Serve requests from a file descriptor until the end of it.
+     *
+     * @param in requests.
+     * @param out responses.
+     * @return 0, or an error code if a request is incomplete or a response cannot be written.
+     */
+    int (*serve_fd)(int, int);
+
+    /** Connect to a server.
+     *
+     * @param path path of the socket.
+     * @return file descriptor of the connection, or -1.
+     */
+    int (*connect)(const char *);
+
+    /** Compile a program on the server.
+     *
+     * @param fd connection.
+     * @param src characters of the program.
+     * @param len number of characters.
+     * @param sink output of the generated code.
+     * @return error code of the compilation, ERROR_INTERNAL if the server does not answer.
+     */
+    int (*request)(int, const char *, size_t, const ifj21_sink_t *);
+};
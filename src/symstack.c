@@ -8,6 +8,7 @@
 
 #include "symstack.h"
 #include "symtable.h"
+#include "context.h"
 
 
 /** Symbol stack element containing not only a symbol table,
@@ -16,7 +17,7 @@
 typedef struct stack_el {
     struct stack_el *next; ///< next element in a list.
     symtable_t *table; ///< pointer on the binary tree with symtable.
-    dynstring_t *fun_name; ///< if info != SCOPE_TYPE_function is NULL.
+    const atom_t *fun_name; ///< if info != SCOPE_TYPE_function is NULL.
     scope_info_t info; ///< information about the scope.
 } stack_el_t;
 
@@ -26,10 +27,6 @@ typedef struct symstack {
     stack_el_t *head; ///< head of the stack.
 } symstack_t;
 
-/** Unique id counter.
- */
-static size_t __unique__id;
-
 
 /** Pretty print function.
  *
@@ -52,9 +49,7 @@ static char *scope_to_str(scope_type_t scope) {
  */
 static symstack_t *SS_Init() {
     debug_msg("\n\t[ctor] Init a symstack.\n");
-    symstack_t *stack = calloc(1, sizeof(symstack_t));
-    soft_assert(stack != NULL, ERROR_INTERNAL);
-    return stack;
+    return Context.alloc(MEM_SYMTABLE, sizeof(symstack_t));
 }
 
 /** Push a new symbol table on the stack.
@@ -64,11 +59,10 @@ static symstack_t *SS_Init() {
  * @param scope_type function, do_cycle, cycle, condition etc.
  * @param fun_name if scope_type is not function, then NULL.
  */
-static void SS_Push(symstack_t *self, symtable_t *table, scope_type_t scope_type, char *fun_name) {
+static void SS_Push(symstack_t *self, symtable_t *table, scope_type_t scope_type, const atom_t *fun_name) {
     debug_msg("\n");
     // create a new elment.
-    stack_el_t *stack_element = calloc(1, sizeof(stack_el_t));
-    soft_assert(stack_element != NULL, ERROR_INTERNAL);
+    stack_el_t *stack_element = Context.alloc(MEM_SYMTABLE, sizeof(stack_el_t));
 
     // map a symtable.
     stack_element->table = table;
@@ -77,14 +71,14 @@ static void SS_Push(symstack_t *self, symtable_t *table, scope_type_t scope_type
     // set scope level. Either 0 or 1 + previous level.
     stack_element->info.scope_level = self->head != NULL ? self->head->info.scope_level + 1 : 0;
     // set a unique id for code generation.
-    stack_element->info.unique_id = __unique__id++;
+    stack_element->info.unique_id = context->unique_id++;
 
     if (scope_type == SCOPE_TYPE_function) {
         if (fun_name != NULL) {
-            stack_element->fun_name = Dynstring.ctor(fun_name);
+            stack_element->fun_name = fun_name;
         } else {
             debug_msg_s("\t[push] Is this function really nameless?\n");
-            stack_element->fun_name = Dynstring.ctor("nameless_function");
+            stack_element->fun_name = Intern.get_c_str("nameless_function");
         }
     }
 
@@ -116,11 +110,10 @@ static void SS_Pop(symstack_t *self) {
     }
 
     Symtable.dtor(self->head->table);
-    Dynstring.dtor(self->head->fun_name);
 
     stack_el_t *del = self->head;
     self->head = self->head->next;
-    free(del);
+    Context.free(MEM_SYMTABLE, del, sizeof(stack_el_t));
     debug_msg_s("\t[pop] popped a symtable\n");
 }
 
@@ -134,6 +127,11 @@ static void SS_Dtor(symstack_t *self) {
         return;
     }
 
+    // at the end of a compilation, elements and their tables are released with its arena.
+    if (context != NULL) {
+        return;
+    }
+
     // iterate the whole stack and delete each element.
     while (self->head != NULL) {
         SS_Pop(self);
@@ -150,7 +148,7 @@ static void SS_Dtor(symstack_t *self) {
  * @param sym a pointer to symbol to store a pointer to the object if we find it.
  * @return true if symbol exists.
  */
-static bool SS_Get_symbol(symstack_t *self, dynstring_t *id,
+static bool SS_Get_symbol(symstack_t *self, const atom_t *id,
                           symbol_t **sym) {
     debug_msg("\n");
     if (self == NULL) {
@@ -176,7 +174,7 @@ static bool SS_Get_symbol(symstack_t *self, dynstring_t *id,
  * @param sym a pointer to symbol to store a pointer to the object if we find it.
  * @return true if symbol exists.
  */
-static bool SS_Get_local_symbol(symstack_t *self, dynstring_t *id,
+static bool SS_Get_local_symbol(symstack_t *self, const atom_t *id,
                                 symbol_t **sym) {
     debug_msg("\n");
     if (self == NULL) {
@@ -220,7 +218,7 @@ static symtable_t *SS_Top(symstack_t *self) {
  * @param type type of an identifier.
  * @return pointer on symbol puched on the stack.
  */
-static symbol_t *SS_Put_symbol(symstack_t *self, dynstring_t *id, id_type_t type) {
+static symbol_t *SS_Put_symbol(symstack_t *self, const atom_t *id, id_type_t type) {
     debug_msg("\n");
     soft_assert(self != NULL, ERROR_INTERNAL);
 
@@ -277,7 +275,7 @@ static char *SS_Get_parent_func_name(symstack_t *self) {
 
     while (iter != NULL) {
         if (iter->info.scope_type == SCOPE_TYPE_function) {
-            return Dynstring.c_str(iter->fun_name);
+            return Dynstring.c_str(iter->fun_name->name);
         }
         iter = iter->next;
     }
@@ -68,7 +68,7 @@ struct symstack_interface_t {
      * @param scope_type function, do_cycle, cycle, condition etc.
      * @param fun_name if scope_type is not function, then NULL.
      */
-    void (*push)(symstack_t *, symtable_t *, scope_type_t, char *fun_name);
+    void (*push)(symstack_t *, symtable_t *, scope_type_t, const atom_t *fun_name);
 
     /** Pop a symtable from a stack.
      *
@@ -89,7 +89,7 @@ struct symstack_interface_t {
      * @param sym a pointer to symbol to store a pointer to the object if we find it.
      * @return true if symbol exists.
      */
-    bool (*get_symbol)(symstack_t *, dynstring_t *, symbol_t **);
+    bool (*get_symbol)(symstack_t *, const atom_t *, symbol_t **);
 
     /** Get top table.
      *
@@ -105,7 +105,7 @@ struct symstack_interface_t {
      * @param type type of an identifier.
      * @return pointer on symbol puched on the stack.
      */
-    symbol_t *(*put_symbol)(symstack_t *, dynstring_t *, id_type_t);
+    symbol_t *(*put_symbol)(symstack_t *, const atom_t *, id_type_t);
 
     /** Get a parent function name.
      *
@@ -143,5 +143,5 @@ struct symstack_interface_t {
      * @param sym a pointer to symbol to store a pointer to the object if we find it.
      * @return true if symbol exists.
      */
-    bool (*get_local_symbol)(symstack_t *, dynstring_t *, symbol_t **);
+    bool (*get_local_symbol)(symstack_t *, const atom_t *, symbol_t **);
 };
@@ -9,6 +9,7 @@
 
 #include "symtable.h"
 #include "errors.h"
+#include "context.h"
 
 /** A node of a symbol table which is a binary search tree.
  */
@@ -66,12 +67,29 @@ static char *type_to_str(id_type_t type) {
  * @return pointer on initialized memory.
  */
 static symtable_t *ST_Ctor() {
-    symtable_t *table = calloc(1, sizeof(symtable_t));
-    soft_assert(table, ERROR_INTERNAL);
+    symtable_t *table = Context.alloc(MEM_SYMTABLE, sizeof(symtable_t));
     debug_msg("[create] symtable.\n");
     return table;
 }
 
+/** Order of names in the tree.
+ *  Atoms are ordered by their hashes, so the tree stays balanced
+ *  whatever order the names come in.
+ *
+ * @param a
+ * @param b
+ * @return 0 if the names are equal, the sign of the difference otherwise.
+ */
+static int atom_cmp(const atom_t *a, const atom_t *b) {
+    if (a == b) {
+        return 0;
+    }
+    if (a->hash != b->hash) {
+        return a->hash > b->hash ? 1 : -1;
+    }
+    return a->id > b->id ? 1 : -1;
+}
+
 /** Helping function to find a symbol in the symtable.
  *  Using binary search tree as a data structure.
  *
@@ -80,12 +98,12 @@ static symtable_t *ST_Ctor() {
  * @param storage will contain a pointer on the symbol in the binary tree.
  * @return true/false.
  */
-static bool _st_get(node_t *node, dynstring_t *id, symbol_t **storage) {
+static bool _st_get(node_t *node, const atom_t *id, symbol_t **storage) {
     if (node == NULL) {
         return false;
     }
 
-    int res = Dynstring.cmp(id, node->symbol.id);
+    int res = atom_cmp(id, node->symbol.id);
     if (res == 0) {
         if (storage != NULL) {
             *storage = &node->symbol;
@@ -102,7 +120,7 @@ static bool _st_get(node_t *node, dynstring_t *id, symbol_t **storage) {
  * @param storage storage will contain a pointer to the symbol.
  * @return bool.
  */
-static bool ST_Get(symtable_t *self, dynstring_t *id, symbol_t **storage) {
+static bool ST_Get(symtable_t *self, const atom_t *id, symbol_t **storage) {
     if (self == NULL) {
         return false;
     }
@@ -118,7 +136,7 @@ static bool ST_Get(symtable_t *self, dynstring_t *id, symbol_t **storage) {
  * @param name str to check.
  * @return bool.
  */
-static bool builtin_name(dynstring_t *name) {
+static bool builtin_name(const atom_t *name) {
     #define BUILTINS 10
     static const char *builtins[BUILTINS] = {
             "readi", "readn", "reads", "tointeger",
@@ -126,7 +144,7 @@ static bool builtin_name(dynstring_t *name) {
     };
 
     for (int i = 0; builtins[i] != NULL; i++) {
-        if (strcmp(Dynstring.c_str(name), builtins[i]) == 0) {
+        if (strcmp(Dynstring.c_str(name->name), builtins[i]) == 0) {
             return true;
         }
     }
@@ -143,7 +161,7 @@ static bool builtin_name(dynstring_t *name) {
  * @param unique_id scope where the variable was declared.
  * @return pointer on the symbol in the binary tree. Newly created or already existed.
  */
-static symbol_t *ST_Put(symtable_t *self, dynstring_t *id, id_type_t type, size_t unique_id) {
+static symbol_t *ST_Put(symtable_t *self, const atom_t *id, id_type_t type, size_t unique_id) {
     if (self == NULL) {
         return NULL;
     }
@@ -152,16 +170,16 @@ static symbol_t *ST_Put(symtable_t *self, dynstring_t *id, id_type_t type, size_
     int res;
 
     while ((*iterator) != NULL) {
-        res = Dynstring.cmp(id, (*iterator)->symbol.id);
+        res = atom_cmp(id, (*iterator)->symbol.id);
         if (res == 0) {
             if (type == ID_TYPE_func_decl) {
                 Semantics.declare((*iterator)->symbol.function_semantics);
-                debug_msg("function declared '%s'\n", Dynstring.c_str(id));
+                debug_msg("function declared '%s'\n", Dynstring.c_str(id->name));
             } else if (type == ID_TYPE_func_def) {
                 Semantics.define((*iterator)->symbol.function_semantics);
-                debug_msg("function defined '%s'\n", Dynstring.c_str(id));
+                debug_msg("function defined '%s'\n", Dynstring.c_str(id->name));
             } else {
-                debug_msg("{%s, %d} is already in the table\n", Dynstring.c_str(id), type);
+                debug_msg("{%s, %d} is already in the table\n", Dynstring.c_str(id->name), type);
             }
             return &(*iterator)->symbol;
         }
@@ -169,10 +187,9 @@ static symbol_t *ST_Put(symtable_t *self, dynstring_t *id, id_type_t type, size_
     }
 
     // base case with no root
-    (*iterator) = calloc(1, sizeof(node_t));
-    soft_assert((*iterator) != NULL, ERROR_INTERNAL);
+    (*iterator) = Context.alloc(MEM_SYMTABLE, sizeof(node_t));
 
-    (*iterator)->symbol.id = Dynstring.ctor(Dynstring.c_str(id));
+    (*iterator)->symbol.id = id;
     (*iterator)->symbol.type = type;
     (*iterator)->symbol.id_of_parent_scope = unique_id;
 
@@ -182,7 +199,7 @@ static symbol_t *ST_Put(symtable_t *self, dynstring_t *id, id_type_t type, size_
     }
 
     debug_msg_s("\t[put] new { .id = '%s', .type = '%s' }.\n",
-                Dynstring.c_str((*iterator)->symbol.id), type_to_str((*iterator)->symbol.type)
+                Dynstring.c_str(id->name), type_to_str((*iterator)->symbol.type)
     );
 
     return &(*iterator)->symbol;
@@ -201,11 +218,10 @@ static void _st_dtor(node_t *node) {
             ) {
         Semantics.dtor(node->symbol.function_semantics);
     }
-    Dynstring.dtor(node->symbol.id);
 
     _st_dtor(node->left);
     _st_dtor(node->right);
-    free(node);
+    Context.free(MEM_SYMTABLE, node, sizeof(node_t));
 }
 
 /** Symbol table destructor.
@@ -217,7 +233,7 @@ static void ST_Dtor(symtable_t *self) {
         return;
     }
     _st_dtor(self->root);
-    free(self);
+    Context.free(MEM_SYMTABLE, self, sizeof(symtable_t));
     debug_msg("[dtor] Symtable deleted\n");
 }
 
@@ -231,7 +247,7 @@ static void ST_Dtor(symtable_t *self) {
  *
  * @param self symbol table.
  * @param name name of the function.
- * @param params vector of the parameters of the function.
+ * @param params vector of the parameters of the function, NULL for any number of any types.
  * @param returns vector with return values of the function.
  */
 static void Add_builtin_function(symtable_t *self, char *name, char *params, char *returns) {
@@ -239,12 +255,9 @@ static void Add_builtin_function(symtable_t *self, char *name, char *params, cha
         debug_msg("\tnull passed into a function...\n");
         return;
     }
-    dynstring_t *dname = Dynstring.ctor(name);
-    dynstring_t *defparamvec = Dynstring.ctor(params);
-    dynstring_t *defreturnvec = Dynstring.ctor(returns);
-
-    dynstring_t *declparamvec = Dynstring.ctor(params);
-    dynstring_t *declreturnvec = Dynstring.ctor(returns);
+    const atom_t *dname = Intern.get_c_str(name);
+    const atom_t *paramvec = Intern.signature((params) ? params : "", (params) ? strlen(params) : 0);
+    const atom_t *returnvec = Intern.signature(returns, strlen(returns));
 
 
     // self, dname, ID_TYPE_func_decl, 0=(global frame unique_id)
@@ -255,14 +268,15 @@ static void Add_builtin_function(symtable_t *self, char *name, char *params, cha
     ST_Get(self, dname, &symbol);
     soft_assert(symbol != NULL, ERROR_INTERNAL);
 
-    Semantics.set_params(&symbol->function_semantics->definition, defparamvec);
-    Semantics.set_returns(&symbol->function_semantics->definition, defreturnvec);
-
-    Semantics.set_params(&symbol->function_semantics->declaration, declparamvec);
-    Semantics.set_returns(&symbol->function_semantics->declaration, declreturnvec);
+    Semantics.set_params(&symbol->function_semantics->definition, paramvec);
+    Semantics.set_returns(&symbol->function_semantics->definition, returnvec);
 
+    Semantics.set_params(&symbol->function_semantics->declaration, paramvec);
+    Semantics.set_returns(&symbol->function_semantics->declaration, returnvec);
+    if (params == NULL) {
+        Semantics.variadic(symbol->function_semantics);
+    }
 
-    Dynstring.dtor(dname);
     //debug_msg("\t[BUILTIN]: builtin function is set.\n");
 }
 
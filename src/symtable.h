@@ -43,7 +43,7 @@ typedef enum id_type {
  */
 typedef struct symbol {
     id_type_t type;
-    dynstring_t *id;
+    const atom_t *id; ///< interned name of the symbol.
     func_semantics_t *function_semantics;
     size_t id_of_parent_scope; // unique_id of scope where the variable was declared.
 } symbol_t;
@@ -79,7 +79,7 @@ struct symtable_interface_t {
      * @param storage storage will contain a pointer to the symbol.
      * @return bool.
      */
-    bool (*get_symbol)(symtable_t *, dynstring_t *, symbol_t **);
+    bool (*get_symbol)(symtable_t *, const atom_t *, symbol_t **);
 
     /** Put a symbol into the symbol table.
      *
@@ -89,7 +89,7 @@ struct symtable_interface_t {
      * @param unique_id unique_id of the scope where the variable was declared.
      * @return pointer on the symbol in the binary tree. Newly created or already existed.
      */
-    symbol_t *(*put)(symtable_t *, dynstring_t *, id_type_t, size_t);
+    symbol_t *(*put)(symtable_t *, const atom_t *, id_type_t, size_t);
 
     /** Symbol table destructor.
      *
@@ -107,7 +107,7 @@ struct symtable_interface_t {
      *
      * @param self symbol table.
      * @param name name of the function.
-     * @param params vector of the parameters of the function.
+     * @param params vector of the parameters of the function, NULL for any number of any types.
      * @param returns vector with return values of the function.
      */
     void (*add_builtin_function)(symtable_t *, char *, char *, char *);
@@ -0,0 +1,394 @@
+/**
+ * @file textscan.c
+ *
+ * @brief Bulk scanning kernels for the scanner.
+ *
+ * SSE2 is a part of x86-64, AVX2 is used if the CPU supports it. Other platforms use scalar kernels,
+ * they can be forced with -DTEXTSCAN_SCALAR.
+ *
+ * @author Skuratovich Aliaksandr <xskura01@vutbr.cz>
+ */
+#include "textscan.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__)) && !defined(TEXTSCAN_SCALAR)
+#define TEXTSCAN_X86
+#include <immintrin.h>
+#endif
+
+
+#define is_ws(ch) ((ch) == ' ' || (ch) == '\t' || (ch) == '\n' || (ch) == '\r')
+
+/*
+ * Scalar kernels, also used for tails of SIMD ones.
+ */
+
+static size_t span_whitespace_scalar(const char *s, size_t n) {
+    size_t i = 0;
+    while (i < n && is_ws(s[i])) {
+        i++;
+    }
+    return i;
+}
+
+static size_t find_any_scalar(const char *s, size_t n, char a, char b, char c, char d) {
+    for (size_t i = 0; i < n; i++) {
+        if (s[i] == a || s[i] == b || s[i] == c || s[i] == d) {
+            return i;
+        }
+    }
+    return n;
+}
+
+static size_t count_scalar(const char *s, size_t n, char c) {
+    size_t cnt = 0;
+    for (size_t i = 0; i < n; i++) {
+        cnt += (s[i] == c);
+    }
+    return cnt;
+}
+
+#ifdef TEXTSCAN_X86
+
+/*
+ * SSE2 kernels, 16 characters per step.
+ */
+
+static size_t span_whitespace_sse2(const char *s, size_t n) {
+    const __m128i sp = _mm_set1_epi8(' '), tab = _mm_set1_epi8('\t');
+    const __m128i nl = _mm_set1_epi8('\n'), cr = _mm_set1_epi8('\r');
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (s + i));
+        __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, sp), _mm_cmpeq_epi8(v, tab)),
+                                  _mm_or_si128(_mm_cmpeq_epi8(v, nl), _mm_cmpeq_epi8(v, cr)));
+        unsigned mask = ~(unsigned) _mm_movemask_epi8(ws) & 0xFFFFu;
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return i + span_whitespace_scalar(s + i, n - i);
+}
+
+static size_t find_any_sse2(const char *s, size_t n, char a, char b, char c, char d) {
+    const __m128i va = _mm_set1_epi8(a), vb = _mm_set1_epi8(b);
+    const __m128i vc = _mm_set1_epi8(c), vd = _mm_set1_epi8(d);
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (s + i));
+        __m128i eq = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)),
+                                  _mm_or_si128(_mm_cmpeq_epi8(v, vc), _mm_cmpeq_epi8(v, vd)));
+        unsigned mask = (unsigned) _mm_movemask_epi8(eq);
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return i + find_any_scalar(s + i, n - i, a, b, c, d);
+}
+
+static size_t count_sse2(const char *s, size_t n, char c) {
+    const __m128i vc = _mm_set1_epi8(c);
+    size_t cnt = 0;
+    size_t i = 0;
+
+    while (i + 16 <= n) {
+        // byte counters are summed before they can overflow, after 255 steps.
+        __m128i acc = _mm_setzero_si128();
+        for (int step = 0; step < 255 && i + 16 <= n; step++, i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *) (s + i));
+            acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(v, vc));
+        }
+        __m128i sum = _mm_sad_epu8(acc, _mm_setzero_si128());
+        cnt += (size_t) _mm_cvtsi128_si64(sum) + (size_t) _mm_cvtsi128_si64(_mm_unpackhi_epi64(sum, sum));
+    }
+    return cnt + count_scalar(s + i, n - i, c);
+}
+
+/*
+ * AVX2 kernels, 32 characters per step.
+ * Tails are left to SSE2 kernels. Upper halves of registers are cleared before,
+ * otherwise legacy SSE instructions are very slow.
+ */
+
+__attribute__((target("avx2")))
+static size_t span_whitespace_avx2(const char *s, size_t n) {
+    const __m256i sp = _mm256_set1_epi8(' '), tab = _mm256_set1_epi8('\t');
+    const __m256i nl = _mm256_set1_epi8('\n'), cr = _mm256_set1_epi8('\r');
+    size_t i = 0;
+
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *) (s + i));
+        __m256i ws = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, sp), _mm256_cmpeq_epi8(v, tab)),
+                                     _mm256_or_si256(_mm256_cmpeq_epi8(v, nl), _mm256_cmpeq_epi8(v, cr)));
+        unsigned mask = ~(unsigned) _mm256_movemask_epi8(ws);
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    _mm256_zeroupper();
+    return i + span_whitespace_sse2(s + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static size_t find_any_avx2(const char *s, size_t n, char a, char b, char c, char d) {
+    const __m256i va = _mm256_set1_epi8(a), vb = _mm256_set1_epi8(b);
+    const __m256i vc = _mm256_set1_epi8(c), vd = _mm256_set1_epi8(d);
+    size_t i = 0;
+
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *) (s + i));
+        __m256i eq = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, va), _mm256_cmpeq_epi8(v, vb)),
+                                     _mm256_or_si256(_mm256_cmpeq_epi8(v, vc), _mm256_cmpeq_epi8(v, vd)));
+        unsigned mask = (unsigned) _mm256_movemask_epi8(eq);
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    _mm256_zeroupper();
+    return i + find_any_sse2(s + i, n - i, a, b, c, d);
+}
+
+__attribute__((target("avx2")))
+static size_t count_avx2(const char *s, size_t n, char c) {
+    const __m256i vc = _mm256_set1_epi8(c);
+    size_t cnt = 0;
+    size_t i = 0;
+
+    while (i + 32 <= n) {
+        __m256i acc = _mm256_setzero_si256();
+        for (int step = 0; step < 255 && i + 32 <= n; step++, i += 32) {
+            __m256i v = _mm256_loadu_si256((const __m256i *) (s + i));
+            acc = _mm256_sub_epi8(acc, _mm256_cmpeq_epi8(v, vc));
+        }
+        __m256i sum = _mm256_sad_epu8(acc, _mm256_setzero_si256());
+        cnt += (size_t) _mm256_extract_epi64(sum, 0) + (size_t) _mm256_extract_epi64(sum, 1)
+               + (size_t) _mm256_extract_epi64(sum, 2) + (size_t) _mm256_extract_epi64(sum, 3);
+    }
+    _mm256_zeroupper();
+    return cnt + count_sse2(s + i, n - i, c);
+}
+
+#endif
+
+/** Kernels chosen by Init.
+ */
+static struct {
+    size_t (*span_whitespace)(const char *, size_t);
+    size_t (*find_any)(const char *, size_t, char, char, char, char);
+    size_t (*count)(const char *, size_t, char);
+    const char *name;
+} kernels = {
+        .span_whitespace = span_whitespace_scalar,
+        .find_any = find_any_scalar,
+        .count = count_scalar,
+        .name = "scalar",
+};
+
+/** Choose the kernels for the CPU.
+ *
+ * @param scalar use scalar kernels even if SIMD ones are available.
+ */
+static void Init(bool scalar) {
+    kernels.span_whitespace = span_whitespace_scalar;
+    kernels.find_any = find_any_scalar;
+    kernels.count = count_scalar;
+    kernels.name = "scalar";
+    if (scalar) {
+        return;
+    }
+
+#ifdef TEXTSCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        kernels.span_whitespace = span_whitespace_avx2;
+        kernels.find_any = find_any_avx2;
+        kernels.count = count_avx2;
+        kernels.name = "avx2";
+    } else {
+        kernels.span_whitespace = span_whitespace_sse2;
+        kernels.find_any = find_any_sse2;
+        kernels.count = count_sse2;
+        kernels.name = "sse2";
+    }
+#endif
+}
+
+/** Length of the prefix consisting of ' ', '\t', '\n' and '\r'.
+ *
+ * @param s characters.
+ * @param n number of characters.
+ * @return length of the whitespace run.
+ */
+static size_t Span_whitespace(const char *s, size_t n) {
+    return kernels.span_whitespace(s, n);
+}
+
+/** Find the first occurrence of any of four characters.
+ *
+ * @param s characters.
+ * @param n number of characters.
+ * @return index of the first occurrence, n if there is none.
+ */
+static size_t Find_any(const char *s, size_t n, char a, char b, char c, char d) {
+    return kernels.find_any(s, n, a, b, c, d);
+}
+
+/** Count occurrences of a character.
+ *
+ * @param s characters.
+ * @param n number of characters.
+ * @param c character to count.
+ * @return number of occurrences.
+ */
+static size_t Count(const char *s, size_t n, char c) {
+    return kernels.count(s, n, c);
+}
+
+/** Name of the chosen kernels.
+ */
+static const char *Name() {
+    return kernels.name;
+}
+
+
+const struct textscan_interface_t Textscan = {
+        .span_whitespace = Span_whitespace,
+        .find_any = Find_any,
+        .count = Count,
+        .init = Init,
+        .name = Name,
+};
+
+#ifdef SELFTEST_textscan
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/** Kernels to test, the scalar ones are the reference.
+ */
+static const struct {
+    const char *name;
+    size_t (*span_whitespace)(const char *, size_t);
+    size_t (*find_any)(const char *, size_t, char, char, char, char);
+    size_t (*count)(const char *, size_t, char);
+} variants[] = {
+        {"scalar", span_whitespace_scalar, find_any_scalar, count_scalar},
+#ifdef TEXTSCAN_X86
+        {"sse2",   span_whitespace_sse2,   find_any_sse2,   count_sse2},
+        {"avx2",   span_whitespace_avx2,   find_any_avx2,   count_avx2},
+#endif
+};
+
+#define VARIANTS (sizeof(variants) / sizeof(*variants))
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static bool supported(size_t v) {
+#ifdef TEXTSCAN_X86
+    return strcmp(variants[v].name, "avx2") != 0 || __builtin_cpu_supports("avx2");
+#else
+    (void) v;
+    return true;
+#endif
+}
+
+/** Compare every kernel with the scalar one on random buffers.
+ *  Buffers are allocated exactly, so reading behind them is caught by sanitizers.
+ */
+static int test_kernels() {
+    static const char alphabet[] = " \t\n\r\"\\]-[xa0\xff\x80";
+    int failed = 0;
+
+    srand(42);
+    for (int round = 0; round < 200000 && !failed; round++) {
+        size_t n = (size_t) rand() % ((round % 100) ? 200 : 20000); // some are longer than 255 steps
+        char *s = malloc(n + 1);
+        // mostly whitespace or mostly text, so that both short and long runs are tested.
+        int spread = (rand() % 2) ? 4 : (int) sizeof(alphabet) - 1;
+        for (size_t i = 0; i < n; i++) {
+            s[i] = (rand() % 50) ? alphabet[rand() % spread] : (char) rand();
+        }
+        char a = alphabet[rand() % (sizeof(alphabet) - 1)], b = (char) rand(), c = '"', d = (char) EOF;
+
+        for (size_t v = 1; v < VARIANTS; v++) {
+            if (!supported(v)) {
+                continue;
+            }
+            if (variants[v].span_whitespace(s, n) != span_whitespace_scalar(s, n)
+                || variants[v].find_any(s, n, a, b, c, d) != find_any_scalar(s, n, a, b, c, d)
+                || variants[v].count(s, n, a) != count_scalar(s, n, a)) {
+                fprintf(stderr, "FAILED: %s kernels differ on a buffer of %zu characters\n", variants[v].name, n);
+                failed = 1;
+            }
+        }
+        free(s);
+    }
+    return failed;
+}
+
+/** Measure throughput of the kernels on typical inputs.
+ */
+static void benchmark() {
+    const size_t n = 16 * 1024 * 1024;
+    const int rounds = 20;
+    char *ws = malloc(n), *text = malloc(n);
+    volatile size_t sink = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        ws[i] = " \t\n "[i % 4];
+        text[i] = (i % 61 == 60) ? '\n' : (char) ('a' + i % 26);
+    }
+    ws[n - 1] = 'x';
+    text[n - 1] = '"';
+
+    printf("throughput, MB/s:\n");
+    printf("    %-8s %16s %16s %16s\n", "kernels", "span_whitespace", "find_any", "count");
+    for (size_t v = 0; v < VARIANTS; v++) {
+        if (!supported(v)) {
+            continue;
+        }
+        double t[3];
+        double start = now();
+        for (int r = 0; r < rounds; r++) {
+            sink += variants[v].span_whitespace(ws, n);
+        }
+        t[0] = now() - start;
+        start = now();
+        for (int r = 0; r < rounds; r++) {
+            sink += variants[v].find_any(text, n, '"', '\\', ']', (char) EOF);
+        }
+        t[1] = now() - start;
+        start = now();
+        for (int r = 0; r < rounds; r++) {
+            sink += variants[v].count(text, n, '\n');
+        }
+        t[2] = now() - start;
+
+        printf("    %-8s", variants[v].name);
+        for (int k = 0; k < 3; k++) {
+            printf(" %16.0f", (double) n * rounds / t[k] / 1e6);
+        }
+        printf("\n");
+    }
+    free(ws);
+    free(text);
+}
+
+int main() {
+    fprintf(stderr, "Selftests: %s\n", __FILE__);
+    int failed = 0;
+
+    Init(false);
+    printf("kernels in use: %s\n", Name());
+    failed |= test_kernels();
+    benchmark();
+    return failed;
+}
+
+#endif
@@ -0,0 +1,61 @@
+/**
+ * @file textscan.h
+ *
+ * @brief Bulk scanning kernels for the scanner (SSE2/AVX2 with a scalar fallback).
+ *
+ * @author Skuratovich Aliaksandr <xskura01@vutbr.cz>
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+
+
+extern const struct textscan_interface_t Textscan;
+
+/**
+ * Kernels working on a part of the tape. None of them reads behind the given length.
+ * The best implementation for the CPU is chosen by init().
+ */
+struct textscan_interface_t {
+    /**
+     * @brief Length of the prefix consisting of ' ', '\t', '\n' and '\r'.
+     *
+     * @param s characters.
+     * @param n number of characters.
+     * @return length of the whitespace run.
+     */
+    size_t (*span_whitespace)(const char *, size_t);
+
+    /**
+     * @brief Find the first occurrence of any of four characters.
+     * Characters can repeat, if less of them is needed.
+     *
+     * @param s characters.
+     * @param n number of characters.
+     * @return index of the first occurrence, n if there is none.
+     */
+    size_t (*find_any)(const char *, size_t, char, char, char, char);
+
+    /**
+     * @brief Count occurrences of a character.
+     *
+     * @param s characters.
+     * @param n number of characters.
+     * @param c character to count.
+     * @return number of occurrences.
+     */
+    size_t (*count)(const char *, size_t, char);
+
+    /**
+     * @brief Choose the kernels for the CPU.
+     *
+     * @param scalar use scalar kernels even if SIMD ones are available.
+     */
+    void (*init)(bool);
+
+    /**
+     * @brief Name of the chosen kernels: "avx2", "sse2" or "scalar".
+     */
+    const char *(*name)(void);
+};
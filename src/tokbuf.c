@@ -0,0 +1,165 @@
+/**
+ * @file tokbuf.c
+ *
+ * @brief Buffer of tokens of the whole program, stored as a structure of arrays.
+ *
+ * @author Skuratovich Aliaksandr <xskura01@vutbr.cz>
+ */
+#include "tokbuf.h"
+#include "errors.h"
+
+
+// initial number of tokens in the buffer.
+#define TOKBUF_INITIAL 1024
+
+
+/** Make an array bigger, abort if there is no memory.
+ */
+static void *grow_array(void *array, size_t cap, size_t size) {
+    void *new_array = realloc(array, cap * size);
+    soft_assert(new_array != NULL, ERROR_INTERNAL);
+    return new_array;
+}
+
+/** Create an empty token buffer.
+ *
+ * @return token buffer.
+ */
+static tokbuf_t *Ctor() {
+    tokbuf_t *self = calloc(1, sizeof(tokbuf_t));
+    soft_assert(self != NULL, ERROR_INTERNAL);
+    return self;
+}
+
+/** Append a token. The buffer takes the decoded string of a string token.
+ *
+ * @param self token buffer.
+ * @param token token to append.
+ * @param line line of the scanner after the token.
+ * @param charpos character position of the scanner after the token.
+ */
+static void Push(tokbuf_t *self, token_t token, size_t line, size_t charpos) {
+    if (self->len == self->cap) {
+        self->cap = self->cap ? self->cap * 2 : TOKBUF_INITIAL;
+        self->types = grow_array(self->types, self->cap, sizeof(*self->types));
+        self->attrs = grow_array(self->attrs, self->cap, sizeof(*self->attrs));
+        self->lines = grow_array(self->lines, self->cap, sizeof(*self->lines));
+        self->charpos = grow_array(self->charpos, self->cap, sizeof(*self->charpos));
+    }
+
+    size_t i = self->len++;
+    self->types[i] = (int16_t) token.type;
+    self->lines[i] = (uint32_t) line;
+    self->charpos[i] = (uint32_t) charpos;
+
+    switch (token.type) {
+        case TOKEN_ID:
+            self->attrs[i].atom = token.attribute.atom;
+            break;
+        case TOKEN_STR:
+            if (self->strings_len == self->strings_cap) {
+                self->strings_cap = self->strings_cap ? self->strings_cap * 2 : TOKBUF_INITIAL;
+                self->strings = grow_array(self->strings, self->strings_cap, sizeof(*self->strings));
+            }
+            self->attrs[i].str = self->strings_len;
+            self->strings[self->strings_len++] = token.attribute.span;
+            break;
+        case TOKEN_NUM_F:
+            self->attrs[i].num_f = token.attribute.num_f;
+            break;
+        default:
+            self->attrs[i].num_i = token.attribute.num_i;
+            break;
+    }
+}
+
+/** Get a token. The decoded string of a string token stays owned by the buffer.
+ *
+ * @param self token buffer.
+ * @param index index of the token, must be < len.
+ * @return token.
+ */
+static token_t Get(tokbuf_t *self, size_t index) {
+    token_t token = {.type = self->types[index]};
+
+    switch (token.type) {
+        case TOKEN_ID:
+            token.attribute.atom = self->attrs[index].atom;
+            break;
+        case TOKEN_STR:
+            token.attribute.span = self->strings[self->attrs[index].str];
+            break;
+        case TOKEN_NUM_F:
+            token.attribute.num_f = self->attrs[index].num_f;
+            break;
+        default:
+            token.attribute.num_i = self->attrs[index].num_i;
+            break;
+    }
+    return token;
+}
+
+/** Number of bytes allocated by the buffer.
+ *
+ * @param self token buffer.
+ * @return bytes.
+ */
+static size_t Bytes(tokbuf_t *self) {
+    size_t bytes = sizeof(tokbuf_t);
+    bytes += self->cap * (sizeof(*self->types) + sizeof(*self->attrs)
+                          + sizeof(*self->lines) + sizeof(*self->charpos));
+    bytes += self->strings_cap * sizeof(*self->strings);
+    for (size_t i = 0; i < self->strings_len; i++) {
+        if (self->strings[i].str != NULL) {
+            bytes += Dynstring.len(self->strings[i].str) + 1;
+        }
+    }
+    return bytes;
+}
+
+/** Number of bytes taken by the tokens, used entries of the arrays and decoded strings,
+ *  without the unused capacity.
+ *
+ * @param self token buffer.
+ * @return bytes.
+ */
+static size_t Used_bytes(tokbuf_t *self) {
+    size_t bytes = self->len * (sizeof(*self->types) + sizeof(*self->attrs)
+                                + sizeof(*self->lines) + sizeof(*self->charpos));
+    bytes += self->strings_len * sizeof(*self->strings);
+    for (size_t i = 0; i < self->strings_len; i++) {
+        if (self->strings[i].str != NULL) {
+            bytes += Dynstring.len(self->strings[i].str) + 1;
+        }
+    }
+    return bytes;
+}
+
+/** Free the buffer with the decoded strings.
+ *
+ * @param self token buffer.
+ */
+static void Dtor(tokbuf_t *self) {
+    if (self == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < self->strings_len; i++) {
+        Dynstring.dtor(self->strings[i].str);
+    }
+    free(self->types);
+    free(self->attrs);
+    free(self->lines);
+    free(self->charpos);
+    free(self->strings);
+    free(self);
+}
+
+
+const struct tokbuf_interface_t Tokbuf = {
+        .ctor = Ctor,
+        .push = Push,
+        .get = Get,
+        .bytes = Bytes,
+        .used_bytes = Used_bytes,
+        .dtor = Dtor,
+};
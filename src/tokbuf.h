@@ -0,0 +1,86 @@
+/**
+ * @file tokbuf.h
+ *
+ * @brief Buffer of tokens of the whole program, stored as a structure of arrays.
+ *
+ * @author Skuratovich Aliaksandr <xskura01@vutbr.cz>
+ */
+#pragma once
+
+#include <stdint.h>
+#include "scanner.h"
+
+
+/** Attribute of a buffered token, 8 bytes instead of 24 of attribute_t.
+ */
+typedef union tokbuf_attribute {
+    const atom_t *atom; ///< identifier.
+    uint64_t num_i; ///< integer number.
+    double num_f; ///< floating point number.
+    size_t str; ///< index of the span of a string in tokbuf.strings.
+} tokbuf_attribute_t;
+
+/** Tokens of the program. The i-th token is made of types[i], attrs[i], lines[i] and charpos[i].
+ *  Spans of strings are kept aside, because they are too big for an attribute.
+ */
+typedef struct tokbuf {
+    int16_t *types; ///< token types.
+    tokbuf_attribute_t *attrs; ///< token attributes.
+    uint32_t *lines; ///< line of the scanner after the token.
+    uint32_t *charpos; ///< character position of the scanner after the token.
+    size_t len; ///< number of tokens.
+    size_t cap; ///< capacity of the arrays.
+
+    span_t *strings; ///< spans of string tokens, decoded strings are owned by the buffer.
+    size_t strings_len; ///< number of strings.
+    size_t strings_cap; ///< capacity of strings.
+} tokbuf_t;
+
+
+extern const struct tokbuf_interface_t Tokbuf;
+
+struct tokbuf_interface_t {
+    /** Create an empty token buffer.
+     *
+     * @return token buffer.
+     */
+    tokbuf_t *(*ctor)(void);
+
+    /** Append a token. The buffer takes the decoded string of a string token.
+     *
+     * @param self token buffer.
+     * @param token token to append.
+     * @param line line of the scanner after the token.
+     * @param charpos character position of the scanner after the token.
+     */
+    void (*push)(tokbuf_t *, token_t, size_t, size_t);
+
+    /** Get a token. The decoded string of a string token stays owned by the buffer.
+     *
+     * @param self token buffer.
+     * @param index index of the token, must be < len.
+     * @return token.
+     */
+    token_t (*get)(tokbuf_t *, size_t);
+
+    /** Number of bytes allocated by the buffer.
+     *
+     * @param self token buffer.
+     * @return bytes.
+     */
+    size_t (*bytes)(tokbuf_t *);
+
+    /** Number of bytes taken by the tokens, used entries of the arrays and decoded strings,
+     *  without the unused capacity.
+     *
+     * @param self token buffer.
+     * @return bytes.
+     */
+    size_t (*used_bytes)(tokbuf_t *);
+
+    /** Free the buffer with the decoded strings.
+     *
+     * @param self token buffer.
+     */
+    void (*dtor)(tokbuf_t *);
+};
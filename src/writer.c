@@ -0,0 +1,289 @@
+/**
+ * @file writer.c
+ *
+ * @brief Output of the generated code to a file descriptor. Code is collected in a big buffer,
+ *        which is reused, and goes to the file with one write(), or with one writev() together
+ *        with a piece of the code bigger than the rest of the buffer.
+ *
+ * @author Skuratovich Aliaksandr <xskura01@vutbr.cz>
+ */
+#include "writer.h"
+#include "errors.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+
+/** Write all characters of the vector, or set the error of the writer.
+ */
+static void write_all(writer_t *self, struct iovec *iov, int count) {
+    while (count > 0 && self->error == 0) {
+        ssize_t n = writev(self->fd, iov, count);
+        self->syscalls++;
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            self->error = errno;
+            return;
+        }
+        self->written += n;
+        // skip written parts.
+        while (count > 0 && (size_t) n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char *) iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+}
+
+/** Sink of a writer. Pieces are copied to the buffer, when the buffer is full,
+ *  the buffer and the piece are written at once.
+ */
+static void write_sink(void *data, const char *s, size_t len) {
+    writer_t *self = data;
+    if (self->len + len <= self->cap) {
+        memcpy(self->buf + self->len, s, len);
+        self->len += len;
+        return;
+    }
+    struct iovec iov[2] = {
+            {.iov_base = self->buf, .iov_len = self->len},
+            {.iov_base = (void *) s, .iov_len = len},
+    };
+    write_all(self, (self->len != 0) ? iov : iov + 1, (self->len != 0) ? 2 : 1);
+    self->len = 0;
+}
+
+/** Create a writer to an open file descriptor, it is not closed by the writer.
+ *
+ * @param fd file descriptor.
+ * @return writer, it is never NULL.
+ */
+static writer_t *Ctor(int fd) {
+    writer_t *self = calloc(1, sizeof(writer_t));
+    soft_assert(self != NULL, ERROR_INTERNAL);
+    self->buf = malloc(WRITER_BUFFER_SIZE);
+    soft_assert(self->buf != NULL, ERROR_INTERNAL);
+    self->cap = WRITER_BUFFER_SIZE;
+    self->fd = fd;
+    self->sink = (ifj21_sink_t) {.write = write_sink, .data = self};
+    return self;
+}
+
+/** Create a writer to a file, the file is created or truncated.
+ *
+ * @param path path of the file.
+ * @return writer, or NULL if the file cannot be opened, errno is set.
+ */
+static writer_t *Open(const char *path) {
+    int fd;
+    do {
+        fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    } while (fd < 0 && errno == EINTR);
+    if (fd < 0) {
+        return NULL;
+    }
+    writer_t *self = Ctor(fd);
+    self->owns_fd = true;
+    return self;
+}
+
+/** Write the buffered code to the file.
+ *
+ * @param self writer.
+ * @return 0, or errno of the first failed write.
+ */
+static int Flush(writer_t *self) {
+    if (self->len != 0) {
+        struct iovec iov = {.iov_base = self->buf, .iov_len = self->len};
+        write_all(self, &iov, 1);
+        self->len = 0;
+    }
+    return self->error;
+}
+
+/** Flush and free the writer, close the file if it was opened by Writer.open().
+ *
+ * @param self writer.
+ * @return 0, or errno of the first failed write or of closing the file.
+ */
+static int Dtor(writer_t *self) {
+    int error = Flush(self);
+    if (self->owns_fd && close(self->fd) != 0 && error == 0) {
+        error = errno;
+    }
+    free(self->buf);
+    free(self);
+    return error;
+}
+
+/**
+ * Interface to use when dealing with writers.
+ */
+const struct writer_interface_t Writer = {
+        .ctor = Ctor,
+        .open = Open,
+        .flush = Flush,
+        .dtor = Dtor,
+};
+
+
+#ifdef SELFTEST_writer
+#include <stdio.h>
+#include <time.h>
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "FAILED: %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        failed = 1; \
+    } \
+} while (0)
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/** Sink measuring the time from the first write to the last one, that is how long the code is printed.
+ */
+typedef struct timed {
+    const ifj21_sink_t *sink;
+    double first;
+    double last;
+    size_t bytes;
+    size_t lines;
+} timed_t;
+
+static void write_timed(void *data, const char *s, size_t len) {
+    timed_t *timed = data;
+    if (timed->bytes == 0) {
+        timed->first = now();
+    }
+    timed->sink->write(timed->sink->data, s, len);
+    timed->bytes += len;
+    timed->last = now();
+}
+
+static void write_counted(void *data, const char *s, size_t len) {
+    timed_t *timed = data;
+    for (const char *end = s + len; (s = memchr(s, '\n', end - s)) != NULL; s++) {
+        timed->lines++;
+    }
+    timed->bytes += len;
+}
+
+static void write_stdio(void *data, const char *s, size_t len) {
+    fwrite(s, 1, len, data);
+}
+
+/** Program of lines statements of expressions.
+ */
+static char *expressions_program(size_t lines, size_t *len) {
+    static const char head[] = "require \"ifj21\"\n"
+                               "function main()\n"
+                               "  local x : integer = 1\n"
+                               "  local s : string = \"a\"\n";
+    static const char line[] = "  x = x + 0 * 2 - (3 + x) // 2 + #s\n";
+    static const char tail[] = "  write(x)\n"
+                               "end\n"
+                               "main()\n";
+    *len = sizeof(head) - 1 + lines * (sizeof(line) - 1) + sizeof(tail) - 1;
+    char *program = malloc(*len + 1);
+    soft_assert(program != NULL, ERROR_INTERNAL);
+    char *end = program;
+    memcpy(end, head, sizeof(head) - 1);
+    end += sizeof(head) - 1;
+    for (size_t i = 0; i < lines; i++) {
+        memcpy(end, line, sizeof(line) - 1);
+        end += sizeof(line) - 1;
+    }
+    memcpy(end, tail, sizeof(tail));
+    return program;
+}
+
+/** Code goes to the file as it is written to the sink. Printing of ~1M instructions is measured
+ *  with stdio and with the writer, argv[1] is the number of statements of the program.
+ */
+int main(int argc, char **argv) {
+    int failed = 0;
+    char path[] = "/tmp/ifj21_writer_XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+
+    // pieces smaller and bigger than the buffer, the buffer is flushed by one writev() with a big piece.
+    size_t total = 3 * WRITER_BUFFER_SIZE + 12345;
+    char *expected = malloc(total);
+    soft_assert(expected != NULL, ERROR_INTERNAL);
+    for (size_t i = 0; i < total; i++) {
+        expected[i] = (char) ('a' + i * 7 % 26);
+    }
+    writer_t *writer = Writer.open(path);
+    CHECK(writer != NULL);
+    size_t pieces[] = {1, 100, 4096, WRITER_BUFFER_SIZE - 4000, WRITER_BUFFER_SIZE + 1, 7, 0};
+    size_t done = 0;
+    for (size_t i = 0; done < total; i = (i + 1) % (sizeof(pieces) / sizeof(pieces[0]))) {
+        size_t len = (pieces[i] < total - done) ? pieces[i] : total - done;
+        writer->sink.write(writer->sink.data, expected + done, len);
+        done += len;
+    }
+    CHECK(writer->syscalls <= 5);
+    CHECK(Writer.dtor(writer) == 0);
+
+    char *got = malloc(total + 1);
+    soft_assert(got != NULL, ERROR_INTERNAL);
+    CHECK(read(fd, got, total + 1) == (ssize_t) total);
+    CHECK(memcmp(got, expected, total) == 0);
+    close(fd);
+    unlink(path);
+    free(got);
+    free(expected);
+
+    CHECK(Writer.open("/nonexistent/ifj21/output.code") == NULL);
+
+    // output throughput.
+    size_t lines = (argc > 1) ? strtoul(argv[1], NULL, 10) : 18000;
+    size_t len;
+    char *program = expressions_program(lines, &len);
+    timed_t counted = {0};
+    ifj21_sink_t counting = {.write = write_counted, .data = &counted};
+    CHECK(ifj21_compile(program, len, &counting) == 0);
+    printf("%zu instructions, %.1f MB of code\n", counted.lines, (double) counted.bytes / 1e6);
+
+    FILE *null_file = fopen("/dev/null", "w");
+    soft_assert(null_file != NULL, ERROR_INTERNAL);
+    ifj21_sink_t stdio = {.write = write_stdio, .data = null_file};
+    writer_t *null_writer = Writer.open("/dev/null");
+    soft_assert(null_writer != NULL, ERROR_INTERNAL);
+    const ifj21_sink_t *sinks[] = {&stdio, &null_writer->sink};
+    const char *names[] = {"stdio fwrite", "writer"};
+    for (size_t i = 0; i < sizeof(sinks) / sizeof(sinks[0]); i++) {
+        double best = 1e9;
+        for (int round = 0; round < 5; round++) {
+            timed_t timed = {.sink = sinks[i]};
+            ifj21_sink_t sink = {.write = write_timed, .data = &timed};
+            CHECK(ifj21_compile(program, len, &sink) == 0);
+            CHECK(timed.bytes == counted.bytes);
+            best = (timed.last - timed.first < best) ? timed.last - timed.first : best;
+        }
+        printf("%-12s: %7.1f MB/s\n", names[i], (double) counted.bytes / 1e6 / best);
+    }
+    printf("writer: %zu syscalls for %zu bytes\n", null_writer->syscalls, null_writer->written);
+    Writer.dtor(null_writer);
+    fclose(null_file);
+    free(program);
+
+    printf("%s\n", failed ? "FAILED" : "OK");
+    return failed;
+}
+
+#endif
@@ -0,0 +1,65 @@
+/**
+ * @file writer.h
+ *
+ * @brief Output of the generated code to a file descriptor. Code is collected in a big buffer,
+ *        which is reused, and goes to the file with one write(), or with one writev() together
+ *        with a piece of the code bigger than the rest of the buffer.
+ *
+ * @author Skuratovich Aliaksandr <xskura01@vutbr.cz>
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "compiler.h"
+
+// size of the buffer of a writer.
+#define WRITER_BUFFER_SIZE (1024 * 1024)
+
+
+/** Writer, pass &writer->sink to a compilation.
+ */
+typedef struct writer {
+    ifj21_sink_t sink; ///< sink writing to this writer.
+    int fd; ///< output.
+    bool owns_fd; ///< the file is closed by Writer.dtor().
+    char *buf; ///< code which is not written yet.
+    size_t len; ///< number of characters in buf.
+    size_t cap; ///< size of buf.
+    size_t written; ///< number of characters written to the file.
+    size_t syscalls; ///< number of write() and writev() calls.
+    int error; ///< errno of the first failed write, 0 if there is none. Nothing is written after it.
+} writer_t;
+
+
+extern const struct writer_interface_t Writer;
+
+struct writer_interface_t {
+    /** Create a writer to an open file descriptor, it is not closed by the writer.
+     *
+     * @param fd file descriptor.
+     * @return writer, it is never NULL.
+     */
+    writer_t *(*ctor)(int);
+
+    /** Create a writer to a file, the file is created or truncated.
+     *
+     * @param path path of the file.
+     * @return writer, or NULL if the file cannot be opened, errno is set.
+     */
+    writer_t *(*open)(const char *);
+
+    /** Write the buffered code to the file.
+     *
+     * @param self writer.
+     * @return 0, or errno of the first failed write.
+     */
+    int (*flush)(writer_t *);
+
+    /** Flush and free the writer, close the file if it was opened by Writer.open().
+     *
+     * @param self writer.
+     * @return 0, or errno of the first failed write or of closing the file.
+     */
+    int (*dtor)(writer_t *);
+};
@@ -0,0 +1,42 @@
+/**
+ * @file peak_rss.c
+ *
+ * @brief Run a command and report its peak resident set size to stderr.
+ *
+ * Usage: peak_rss command [args...]
+ * stdin and stdout are passed to the command, exit code of the command is returned.
+ */
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+
+int main(int argc, char **argv) {
+    struct rusage usage;
+    int status;
+    pid_t pid;
+
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s command [args...]\n", argv[0]);
+        return 1;
+    }
+
+    if ((pid = fork()) == 0) {
+        execvp(argv[1], argv + 1);
+        perror(argv[1]);
+        _exit(127);
+    }
+
+    if (pid < 0 || wait4(pid, &status, 0, &usage) < 0) {
+        perror("peak_rss");
+        return 1;
+    }
+
+#ifdef __APPLE__
+    fprintf(stderr, "peak RSS: %ld KiB\n", usage.ru_maxrss / 1024); // bytes on macOS
+#else
+    fprintf(stderr, "peak RSS: %ld KiB\n", usage.ru_maxrss);
+#endif
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
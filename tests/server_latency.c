@@ -0,0 +1,137 @@
+/**
+ * @file server_latency.c
+ *
+ * @brief Compare latency of cold runs of the compiler with the compile server.
+ *
+ * Usage: server_latency path/to/ifj21 files...
+ * Starts "ifj21 --server", then compiles every file by
+ *  - cold: a new "ifj21 file" process,
+ *  - client: a new "ifj21 --client socket file" process,
+ *  - warm: a request over an open connection,
+ * and prints mean, median and 90th percentile of the times in microseconds.
+ */
+#include "../src/progfile.h"
+#include "../src/server.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+
+#define ROUNDS 5
+
+static double now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/** Run a command with stdout and stderr to /dev/null.
+ *
+ * @return microseconds from fork() to the end of the process.
+ */
+static double run(char **args) {
+    double start = now_us();
+    pid_t pid = fork();
+    if (pid == 0) {
+        int null = open("/dev/null", O_WRONLY);
+        dup2(null, STDOUT_FILENO);
+        dup2(null, STDERR_FILENO);
+        execv(args[0], args);
+        _exit(127);
+    }
+    waitpid(pid, NULL, 0);
+    return now_us() - start;
+}
+
+static void discard(void *data, const char *s, size_t len) {
+    (void) data, (void) s, (void) len;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+static void report(const char *name, double *times, size_t n) {
+    double sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        sum += times[i];
+    }
+    qsort(times, n, sizeof(double), cmp_double);
+    printf("%-8s mean %9.1f us, median %9.1f us, p90 %9.1f us\n",
+           name, sum / n, times[n / 2], times[n * 9 / 10]);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s path/to/ifj21 files...\n", argv[0]);
+        return 1;
+    }
+    char *ifj21 = argv[1];
+    char socket[64];
+    snprintf(socket, sizeof(socket), "/tmp/ifj21_latency.%d", (int) getpid());
+
+    pid_t server = fork();
+    if (server == 0) {
+        int null = open("/dev/null", O_WRONLY);
+        dup2(null, STDERR_FILENO);
+        execl(ifj21, ifj21, "--server", socket, (char *) NULL);
+        _exit(127);
+    }
+    int fd = -1;
+    for (int i = 0; i < 1000 && fd < 0; i++) {
+        usleep(1000);
+        fd = Server.connect(socket);
+    }
+    if (fd < 0) {
+        fprintf(stderr, "the server does not start\n");
+        kill(server, SIGTERM);
+        return 1;
+    }
+
+    size_t files = argc - 2, n = files * ROUNDS;
+    double *cold = calloc(n, sizeof(double));
+    double *client = calloc(n, sizeof(double));
+    double *warm = calloc(n, sizeof(double));
+    ifj21_sink_t sink = {.write = discard};
+
+    for (size_t r = 0; r < ROUNDS; r++) {
+        for (size_t i = 0; i < files; i++) {
+            char *file = argv[i + 2];
+            char *cold_args[] = {ifj21, file, NULL};
+            char *client_args[] = {ifj21, "--client", socket, file, NULL};
+            size_t k = r * files + i;
+
+            cold[k] = run(cold_args);
+            client[k] = run(client_args);
+
+            // the program is read before the time is measured, as the server has it in memory.
+            pfile_t *pfile = Pfile.getfile(file);
+            if (!pfile) {
+                continue;
+            }
+            double start = now_us();
+            Server.request(fd, Pfile.get_tape(pfile), Pfile.available(pfile), &sink);
+            warm[k] = now_us() - start;
+            Pfile.dtor(pfile);
+        }
+    }
+
+    printf("%zu files, %d rounds\n", files, ROUNDS);
+    report("cold", cold, n);
+    report("client", client, n);
+    report("warm", warm, n);
+
+    close(fd);
+    kill(server, SIGTERM);
+    waitpid(server, NULL, 0);
+    free(cold);
+    free(client);
+    free(warm);
+    return 0;
+}
@@ -0,0 +1,61 @@
+#!/bin/bash
+
+# ./stream_rss.sh [size_in_MiB]
+# Generates a big machine-like program and compares peak RSS of the compiler
+# reading it as a whole (pipe, mmap) and as a stream (--stream).
+
+size_mb=${1:-256}
+
+RED='\033[0;31m'
+NC='\033[0m'
+
+cd .. 1>/dev/null
+SRC_DIR="`pwd`"
+cd - 1>/dev/null
+
+BUILD_DIR="$SRC_DIR/cmake-build-debug"
+BIN="$BUILD_DIR/ifj21"
+PEAK_RSS="$BUILD_DIR/peak_rss"
+INPUT="$(mktemp /tmp/ifj21_stream.XXXXXX)"
+
+[ -x "$BIN" ] && [ -x "$PEAK_RSS" ] || { echo "ERROR: build ifj21 and peak_rss in $BUILD_DIR" ; exit 1 ; }
+
+# ~64 bytes per line.
+{
+    echo 'require "ifj21"'
+    yes -- '-- generated code, generated code, generated code, generated co' | head -n $((size_mb * 16384))
+    echo 'function main()'
+    echo '    local a : integer = 42'
+    echo '    write(a, "\n")'
+    echo 'end'
+    echo 'main()'
+} > "$INPUT"
+
+echo "input: $(du -h "$INPUT" | cut -f1)"
+
+# measure <description> pipe|file [ifj21 options]
+measure() {
+    local name=$1
+    local how=$2
+    shift 2
+    printf "%-24s" "$name"
+    if [[ "$how" == "pipe" ]]; then
+        cat "$INPUT" | "$PEAK_RSS" "$BIN" "$@" 2>"$INPUT.err" >/dev/null
+        ret_val=${PIPESTATUS[1]}
+    else
+        "$PEAK_RSS" "$BIN" "$@" "$INPUT" 2>"$INPUT.err" >/dev/null
+        ret_val=$?
+    fi
+    rss=$(grep "peak RSS" "$INPUT.err")
+    if [ "$ret_val" -ne 0 ]; then
+        printf "${RED}FAILED${NC} ret_val = $ret_val, "
+    fi
+    echo "$rss"
+}
+
+measure "pipe, whole file" pipe
+measure "mmap, whole file" file
+measure "pipe, --stream"   pipe --stream
+measure "file, --stream"   file --stream
+
+rm -f "$INPUT" "$INPUT.err"